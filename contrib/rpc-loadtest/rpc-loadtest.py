@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+#
+# rpc-loadtest.py:  Drive a local komodod JSON-RPC server with concurrent
+#                   clients and report throughput and latency percentiles.
+#
+# Copyright (c) 2022 The SuperNET Developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#
+
+from http.client import HTTPConnection
+import argparse
+import base64
+import json
+import os
+import sys
+import threading
+import time
+
+def read_cookie(datadir):
+    with open(os.path.join(datadir, '.cookie'), 'r', encoding='utf8') as f:
+        return f.read().strip()
+
+class RPCClient:
+    def __init__(self, host, port, auth):
+        self.authhdr = b"Basic " + base64.b64encode(auth.encode('utf-8'))
+        self.conn = HTTPConnection(host, port=port, timeout=300)
+
+    def post(self, obj):
+        self.conn.request('POST', '/', json.dumps(obj),
+            { 'Authorization' : self.authhdr,
+              'Content-type' : 'application/json' })
+        resp = self.conn.getresponse()
+        body = resp.read()
+        if resp.status != 200:
+            raise RuntimeError("HTTP %d: %s" % (resp.status, body[:200]))
+        return body
+
+def build_request(idx, method, params):
+    return { 'jsonrpc' : '1.0', 'id' : idx, 'method' : method, 'params' : params }
+
+def worker(args, auth, deadline, latencies, counters, lock):
+    client = RPCClient(args.host, args.port, auth)
+    local = []
+    nreq = nbytes = nerr = 0
+    while time.time() < deadline and (args.requests == 0 or nreq < args.requests):
+        if args.batch > 1:
+            obj = [build_request(i, args.method, args.params) for i in range(args.batch)]
+        else:
+            obj = build_request(nreq, args.method, args.params)
+        start = time.perf_counter()
+        try:
+            body = client.post(obj)
+        except Exception as e:
+            nerr += 1
+            client = RPCClient(args.host, args.port, auth)
+            if nerr == 1:
+                print("request failed: %s" % e, file=sys.stderr)
+            continue
+        local.append(time.perf_counter() - start)
+        nreq += 1
+        nbytes += len(body)
+    with lock:
+        latencies.extend(local)
+        counters['requests'] += nreq
+        counters['bytes'] += nbytes
+        counters['errors'] += nerr
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    k = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[k]
+
+def main():
+    parser = argparse.ArgumentParser(description='JSON-RPC load generator for a local node.')
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=7771)
+    parser.add_argument('--rpcuser', help='RPC user, with --rpcpassword')
+    parser.add_argument('--rpcpassword')
+    parser.add_argument('--datadir', help='read credentials from the .cookie file in this directory')
+    parser.add_argument('--method', default='getblockcount')
+    parser.add_argument('--params', default='[]', help='JSON array of parameters')
+    parser.add_argument('--clients', type=int, default=8, help='concurrent connections')
+    parser.add_argument('--batch', type=int, default=1, help='entries per JSON-RPC batch, 1 sends single requests')
+    parser.add_argument('--duration', type=float, default=10.0, help='seconds to run')
+    parser.add_argument('--requests', type=int, default=0, help='stop each client after this many requests (0: no limit)')
+    args = parser.parse_args()
+    args.params = json.loads(args.params)
+
+    if args.rpcuser is not None:
+        auth = '%s:%s' % (args.rpcuser, args.rpcpassword or '')
+    elif args.datadir is not None:
+        auth = read_cookie(args.datadir)
+    else:
+        print('Either --rpcuser/--rpcpassword or --datadir is required', file=sys.stderr)
+        sys.exit(1)
+
+    latencies = []
+    counters = { 'requests' : 0, 'bytes' : 0, 'errors' : 0 }
+    lock = threading.Lock()
+    start = time.time()
+    deadline = start + args.duration
+    threads = [threading.Thread(target=worker, args=(args, auth, deadline, latencies, counters, lock))
+               for _ in range(args.clients)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.time() - start
+
+    latencies.sort()
+    calls = counters['requests'] * max(1, args.batch)
+    print("method       %s" % args.method)
+    print("clients      %d" % args.clients)
+    print("batch        %d" % args.batch)
+    print("requests     %d (%d errors)" % (counters['requests'], counters['errors']))
+    print("calls/s      %.1f" % (calls / elapsed))
+    print("MiB/s        %.2f" % (counters['bytes'] / elapsed / (1024 * 1024)))
+    for p in (50, 90, 99):
+        print("p%-11d %.2f ms" % (p, percentile(latencies, p) * 1000))
+    if latencies:
+        print("max          %.2f ms" % (latencies[-1] * 1000))
+
+if __name__ == '__main__':
+    main()
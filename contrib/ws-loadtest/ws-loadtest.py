@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+#
+# ws-loadtest.py:  Open many websocket connections to a local komodod
+#                  websockets listener, exchange p2p messages on each of
+#                  them and report messages per second and latency percentiles.
+#
+# Copyright (c) 2022 The SuperNET Developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import os
+import random
+import struct
+import sys
+import time
+import zlib
+
+PROTOCOL_VERSION = 170012
+NSPV_PROTOCOL_VERSION = 6
+NSPV_INFO = 0x00
+
+def sha256d(data):
+    return hashlib.sha256(hashlib.sha256(data).digest()).digest()
+
+def ser_compact_size(n):
+    if n < 253:
+        return struct.pack('<B', n)
+    if n < 0x10000:
+        return struct.pack('<BH', 253, n)
+    if n < 0x100000000:
+        return struct.pack('<BI', 254, n)
+    return struct.pack('<BQ', 255, n)
+
+def ser_string(s):
+    return ser_compact_size(len(s)) + s
+
+def ser_address(ip, port):
+    # version message addresses have no time field
+    return struct.pack('<Q', 0) + bytes(10) + b'\xff\xff' + bytes(map(int, ip.split('.'))) + struct.pack('>H', port)
+
+class P2PCodec:
+    """Frames p2p messages and splits a byte stream back into them."""
+
+    def __init__(self, magic):
+        self.magic = magic
+        self.buf = b''
+
+    def encode(self, command, payload):
+        return (self.magic + command.encode('ascii').ljust(12, b'\x00') +
+                struct.pack('<I', len(payload)) + sha256d(payload)[:4] + payload)
+
+    def feed(self, data):
+        self.buf += data
+        msgs = []
+        while len(self.buf) >= 24:
+            if self.buf[:4] != self.magic:
+                raise RuntimeError('bad magic %s, check --magic' % self.buf[:4].hex())
+            length = struct.unpack('<I', self.buf[16:20])[0]
+            if len(self.buf) < 24 + length:
+                break
+            command = self.buf[4:16].rstrip(b'\x00').decode('ascii')
+            msgs.append((command, self.buf[24:24 + length]))
+            self.buf = self.buf[24 + length:]
+        return msgs
+
+class WsConnection:
+    """Minimal RFC 6455 client: binary messages, masked client frames."""
+
+    def __init__(self, reader, writer, deflate):
+        self.reader = reader
+        self.writer = writer
+        self.inflater = zlib.decompressobj(-zlib.MAX_WBITS) if deflate else None
+
+    @classmethod
+    async def connect(cls, host, port, deflate):
+        reader, writer = await asyncio.open_connection(host, port)
+        key = base64.b64encode(os.urandom(16)).decode('ascii')
+        request = ('GET / HTTP/1.1\r\nHost: %s:%d\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n'
+                   'Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n' % (host, port, key))
+        if deflate:
+            request += 'Sec-WebSocket-Extensions: permessage-deflate\r\n'
+        writer.write((request + '\r\n').encode('ascii'))
+        headers = (await reader.readuntil(b'\r\n\r\n')).decode('latin-1')
+        if not headers.startswith('HTTP/1.1 101'):
+            raise RuntimeError('handshake refused: %s' % headers.split('\r\n')[0])
+        return cls(reader, writer, deflate and 'permessage-deflate' in headers.lower())
+
+    def send(self, payload, opcode=0x2):
+        header = bytes([0x80 | opcode])
+        if len(payload) < 126:
+            header += bytes([0x80 | len(payload)])
+        elif len(payload) < 0x10000:
+            header += bytes([0x80 | 126]) + struct.pack('>H', len(payload))
+        else:
+            header += bytes([0x80 | 127]) + struct.pack('>Q', len(payload))
+        mask = os.urandom(4)
+        # xor the whole payload at once, a byte loop is too slow for a load generator
+        n = len(payload)
+        masked = (int.from_bytes(payload, 'big') ^ int.from_bytes((mask * (n // 4 + 1))[:n], 'big')).to_bytes(n, 'big')
+        self.writer.write(header + mask + masked)
+
+    async def recv(self):
+        """Next binary message, answers pings on the way."""
+        message = b''
+        compressed = False
+        while True:
+            b0, b1 = await self.reader.readexactly(2)
+            opcode = b0 & 0x0f
+            length = b1 & 0x7f
+            if length == 126:
+                length = struct.unpack('>H', await self.reader.readexactly(2))[0]
+            elif length == 127:
+                length = struct.unpack('>Q', await self.reader.readexactly(8))[0]
+            payload = await self.reader.readexactly(length)
+            if opcode == 0x8:
+                raise ConnectionError('closed by the node')
+            if opcode == 0x9:
+                self.send(payload, 0xa)
+                continue
+            if opcode == 0xa:
+                continue
+            if opcode != 0x0:
+                compressed = bool(b0 & 0x40)
+            message += payload
+            if b0 & 0x80:
+                break
+        if compressed and self.inflater is not None:
+            message = self.inflater.decompress(message + b'\x00\x00\xff\xff')
+        return message
+
+    def close(self):
+        self.writer.close()
+
+def version_payload(args):
+    return (struct.pack('<iQq', args.protocol_version, 0, int(time.time())) +
+            ser_address('127.0.0.1', args.port) + ser_address('127.0.0.1', 0) +
+            struct.pack('<Q', random.getrandbits(64)) + ser_string(b'/ws-loadtest:0.1/') +
+            struct.pack('<i', 0))
+
+def request_for(args, seq):
+    """The message to send and the command that answers it."""
+    if args.message == 'nspvinfo':
+        request = struct.pack('<BIIi', NSPV_INFO, seq & 0xffffffff, NSPV_PROTOCOL_VERSION, 0)
+        return 'getnSPV', ser_string(request), 'nSPV'
+    return 'ping', struct.pack('<Q', seq), 'pong'
+
+async def client(args, deadline, stats):
+    codec = P2PCodec(args.magic)
+    try:
+        ws = await asyncio.wait_for(WsConnection.connect(args.host, args.port, args.deflate), args.timeout)
+        ws.send(codec.encode('version', version_payload(args)))
+        # the node answers with its own version and a verack
+        while not any(cmd == 'verack' for cmd, _ in codec.feed(await asyncio.wait_for(ws.recv(), args.timeout))):
+            pass
+    except Exception as e:
+        stats['connfail'] += 1
+        if stats['connfail'] == 1:
+            print('connection failed: %s' % e, file=sys.stderr)
+        return
+    stats['connected'] += 1
+
+    seq = 0
+    try:
+        while time.time() < deadline and (args.messages == 0 or seq < args.messages):
+            command, payload, reply = request_for(args, seq)
+            start = time.perf_counter()
+            ws.send(codec.encode(command, payload))
+            try:
+                while True:
+                    data = await asyncio.wait_for(ws.recv(), args.timeout)
+                    stats['bytes'] += len(data)
+                    if any(cmd == reply for cmd, _ in codec.feed(data)):
+                        break
+            except asyncio.TimeoutError:
+                stats['timeouts'] += 1
+                seq += 1
+                continue
+            stats['latencies'].append(time.perf_counter() - start)
+            seq += 1
+    except (ConnectionError, asyncio.IncompleteReadError, RuntimeError) as e:
+        stats['dropped'] += 1
+        if stats['dropped'] == 1:
+            print('connection dropped: %s' % e, file=sys.stderr)
+    finally:
+        ws.close()
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    k = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[k]
+
+async def run(args, stats):
+    deadline = time.time() + args.duration
+    tasks = []
+    for _ in range(args.connections):
+        tasks.append(asyncio.ensure_future(client(args, deadline, stats)))
+        # do not open all connections in the same instant
+        await asyncio.sleep(args.ramp / max(1, args.connections))
+    await asyncio.gather(*tasks)
+
+def main():
+    parser = argparse.ArgumentParser(description='Websocket load generator for a local node.')
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=8192, help='the node\'s -wsport')
+    parser.add_argument('--magic', default='f9eee48d', help='network magic of the chain as hex (default: KMD)')
+    parser.add_argument('--protocol-version', type=int, default=PROTOCOL_VERSION)
+    parser.add_argument('--message', choices=['ping', 'nspvinfo'], default='ping', help='request sent in a loop on each connection')
+    parser.add_argument('--connections', type=int, default=100, help='concurrent websocket connections')
+    parser.add_argument('--duration', type=float, default=10.0, help='seconds to run')
+    parser.add_argument('--messages', type=int, default=0, help='stop each connection after this many requests (0: no limit)')
+    parser.add_argument('--ramp', type=float, default=1.0, help='seconds over which the connections are opened')
+    parser.add_argument('--timeout', type=float, default=5.0, help='seconds to wait for a reply')
+    parser.add_argument('--deflate', action='store_true', help='offer permessage-deflate')
+    args = parser.parse_args()
+    args.magic = bytes.fromhex(args.magic)
+
+    stats = { 'connected' : 0, 'connfail' : 0, 'dropped' : 0, 'timeouts' : 0, 'bytes' : 0, 'latencies' : [] }
+    start = time.time()
+    asyncio.get_event_loop().run_until_complete(run(args, stats))
+    elapsed = time.time() - start
+
+    latencies = sorted(stats['latencies'])
+    print("message      %s" % args.message)
+    print("connections  %d (%d failed, %d dropped)" % (stats['connected'], stats['connfail'], stats['dropped']))
+    print("replies      %d (%d timeouts)" % (len(latencies), stats['timeouts']))
+    print("messages/s   %.1f" % (len(latencies) / elapsed))
+    print("MiB/s        %.2f" % (stats['bytes'] / elapsed / (1024 * 1024)))
+    for p in (50, 90, 99):
+        print("p%-11d %.2f ms" % (p, percentile(latencies, p) * 1000))
+    if latencies:
+        print("max          %.2f ms" % (latencies[-1] * 1000))
+
+if __name__ == '__main__':
+    main()
@@ -15,7 +15,21 @@ bool AMQPAbstractNotifier::NotifyBlock(const CBlockIndex * /*CBlockIndex*/)
     return true;
 }
 
+bool AMQPAbstractNotifier::NotifyBlock(const CBlockIndex *pindex, const CBlock * /*pblock*/)
+{
+    return NotifyBlock(pindex);
+}
+
 bool AMQPAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/)
 {
     return true;
 }
+
+bool AMQPAbstractNotifier::NotifyTransaction(const CTransaction &transaction, const CBlock * /*pblock*/)
+{
+    return NotifyTransaction(transaction);
+}
+
+void AMQPAbstractNotifier::SkipDropped(const CNotificationGap &/*gap*/)
+{
+}
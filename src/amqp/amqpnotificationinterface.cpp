@@ -15,13 +15,9 @@
 // The boost::signals2 signals and slot system is thread safe, so CValidationInterface listeners
 // can be invoked from any thread.
 //
-// Currently signals are fired from main.cpp so the callbacks should be invoked on the same thread.
-// It should be safe to share objects responsible for sending, as they should not be run concurrently
-// across different threads.
-//
-// Developers should be mindful of where notifications are fired to avoid potential race conditions.
-// For example, different signals targeting the same address could be fired from different threads
-// in different parts of the system around the same time.
+// Signals are queued by CQueuedNotificationInterface and the notifiers are only called from its
+// notification thread, so the objects responsible for sending are never run concurrently, whichever
+// thread fired the signal.
 //
 // Like the ZMQ notification interface, if a notifier fails to send a message, the notifier is shut down.
 //
@@ -49,6 +45,15 @@ AMQPNotificationInterface* AMQPNotificationInterface::CreateWithArguments(const
     factories["pubhashtx"] = AMQPAbstractNotifier::Create<AMQPPublishHashTransactionNotifier>;
     factories["pubrawblock"] = AMQPAbstractNotifier::Create<AMQPPublishRawBlockNotifier>;
     factories["pubrawtx"] = AMQPAbstractNotifier::Create<AMQPPublishRawTransactionNotifier>;
+    factories["pubccevent"] = AMQPAbstractNotifier::Create<AMQPPublishCCEventNotifier>;
+    factories["pubccaddress"] = AMQPAbstractNotifier::Create<AMQPPublishCCAddressNotifier>;
+
+    CCEventFilter filter;
+    std::map<std::string, std::string>::const_iterator f = args.find("-ccnotifyfilter");
+    if (f != args.end() && !filter.Parse(f->second)) {
+        LogPrintf("amqp: Invalid -ccnotifyfilter %s\n", f->second);
+        return nullptr;
+    }
 
     for (std::map<std::string, AMQPNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i) {
         std::map<std::string, std::string>::const_iterator j = args.find("-amqp" + i->first);
@@ -58,6 +63,8 @@ AMQPNotificationInterface* AMQPNotificationInterface::CreateWithArguments(const
             AMQPAbstractNotifier *notifier = factory();
             notifier->SetType(i->first);
             notifier->SetAddress(address);
+            if (AMQPPublishCCEventNotifier *ccnotifier = dynamic_cast<AMQPPublishCCEventNotifier*>(notifier))
+                ccnotifier->SetFilter(filter);
             notifiers.push_back(notifier);
         }
     }
@@ -65,8 +72,10 @@ AMQPNotificationInterface* AMQPNotificationInterface::CreateWithArguments(const
     if (!notifiers.empty()) {
         notificationInterface = new AMQPNotificationInterface();
         notificationInterface->notifiers = notifiers;
+        notificationInterface->fCCEvents = args.count("-amqppubccevent") != 0 || args.count("-amqppubccaddress") != 0;
+        notificationInterface->ccfilter = filter;
 
-        if (!notificationInterface->Initialize()) {
+        if (!notificationInterface->Initialize() || !notificationInterface->StartQueue("amqp", args)) {
             delete notificationInterface;
             notificationInterface = nullptr;
         }
@@ -102,6 +111,7 @@ bool AMQPNotificationInterface::Initialize()
 void AMQPNotificationInterface::Shutdown()
 {
     LogPrint("amqp", "amqp: Shutdown notification interface\n");
+    StopQueue();
 
     for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ++i) {
         AMQPAbstractNotifier *notifier = *i;
@@ -109,24 +119,19 @@ void AMQPNotificationInterface::Shutdown()
     }
 }
 
-void AMQPNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+void AMQPNotificationInterface::Dispatch(const CValidationNotification &notification)
 {
     for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ) {
         AMQPAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindex)) {
-            i++;
-        } else {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
+        if (notification.gap)
+            notifier->SkipDropped(*notification.gap);
+        bool fOk = true;
+        if (notification.type == CValidationNotification::BLOCK_TIP) {
+            fOk = notifier->NotifyBlock(notification.pindex, notification.block.get());
+        } else if (notification.type == CValidationNotification::TRANSACTION) {
+            fOk = notifier->NotifyTransaction(*notification.tx, notification.block.get());
         }
-    }
-}
-
-void AMQPNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
-{
-    for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ) {
-        AMQPAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx)) {
+        if (fOk) {
             i++;
         } else {
             notifier->Shutdown();
@@ -5,14 +5,14 @@
 #ifndef ZCASH_AMQP_AMQPNOTIFICATIONINTERFACE_H
 #define ZCASH_AMQP_AMQPNOTIFICATIONINTERFACE_H
 
-#include "validationinterface.h"
+#include "notificationqueue.h"
 #include <string>
 #include <map>
 
 class CBlockIndex;
 class AMQPAbstractNotifier;
 
-class AMQPNotificationInterface : public CValidationInterface
+class AMQPNotificationInterface : public CQueuedNotificationInterface
 {
 public:
     virtual ~AMQPNotificationInterface();
@@ -23,9 +23,8 @@ protected:
     bool Initialize();
     void Shutdown();
 
-    // CValidationInterface
-    void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
-    void UpdatedBlockTip(const CBlockIndex *pindex);
+    // CQueuedNotificationInterface, on the notification thread
+    void Dispatch(const CValidationNotification &notification);
 
 private:
     AMQPNotificationInterface();
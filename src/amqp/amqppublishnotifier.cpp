@@ -4,7 +4,9 @@
 
 #include "amqppublishnotifier.h"
 #include "main.h"
+#include "notificationqueue.h"
 #include "util.h"
+#include "utilstrencodings.h"
 
 #include "amqpsender.h"
 
@@ -17,6 +19,8 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_CCEVENT   = "ccevent";
+static const char *MSG_CCADDRESS = "ccaddress";
 
 // Invoke this method from a new thread to run the proton container event loop.
 void AMQPAbstractPublishNotifier::SpawnProtonContainer()
@@ -93,7 +97,7 @@ void AMQPAbstractPublishNotifier::Shutdown()
 }
 
 
-bool AMQPAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
+bool AMQPAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size, const std::map<std::string, std::string> *properties)
 {
     try { 
         proton::binary content;
@@ -104,6 +108,10 @@ bool AMQPAbstractPublishNotifier::SendMessage(const char *command, const void* d
         message.subject(std::string(command));
         proton::message::property_map & props = message.properties();
         props.put("x-opt-sequence-number", sequence_);
+        if (properties != nullptr) {
+            for (std::map<std::string, std::string>::const_iterator it = properties->begin(); it != properties->end(); it++)
+                props.put(it->first, it->second);
+        }
         handler_->publish(message);
 
     } catch (proton::error_condition &e) {
@@ -128,6 +136,43 @@ bool AMQPAbstractPublishNotifier::SendMessage(const char *command, const void* d
     return true;
 }
 
+void AMQPAbstractPublishNotifier::SkipMessages(uint64_t nMessages)
+{
+    sequence_ += nMessages;
+}
+
+void AMQPPublishHashBlockNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.nBlockTips);
+}
+
+void AMQPPublishHashTransactionNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.nTransactions);
+}
+
+void AMQPPublishRawBlockNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.nBlockTips);
+}
+
+void AMQPPublishRawTransactionNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.nTransactions);
+}
+
+void AMQPPublishCCEventNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.cc.nEvents);
+    sequences.SkipEvalcodes(gap.cc);
+}
+
+void AMQPPublishCCAddressNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.cc.nAddressEvents);
+    sequences.SkipAddresses(gap.cc);
+}
+
 bool AMQPPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     uint256 hash = pindex->GetBlockHash();
@@ -148,22 +193,19 @@ bool AMQPPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &t
     return SendMessage(MSG_HASHTX, data, 32);
 }
 
-bool AMQPPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool AMQPPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const CBlock *pblock)
 {
     LogPrint("amqp", "amqp: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex)) {
-            LogPrint("amqp", "amqp: Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
+    // the block comes with the notification, it is not read back from disk
+    if (pblock == nullptr) {
+        LogPrint("amqp", "amqp: Can't read block from disk");
+        return false;
     }
 
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << *pblock;
+
     return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
 }
 
@@ -175,3 +217,32 @@ bool AMQPPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool AMQPPublishCCEventNotifier::NotifyTransaction(const CTransaction &transaction, const CBlock *pblock)
+{
+    CCEvent event;
+    if (!DecodeCCEvent(transaction, pblock, event) || !filter.Match(event))
+        return true;
+    LogPrint("amqp", "amqp: Publish ccevent %s\n", event.txid.GetHex());
+    std::map<std::string, std::string> properties;
+    properties["evalcode"] = HexStr(&event.evalcode, &event.evalcode + 1);
+    std::vector<unsigned char> data = SerializeCCEvent(event, sequences.NextEvalcode(event.evalcode));
+    return SendMessage(MSG_CCEVENT, data.data(), data.size(), &properties);
+}
+
+bool AMQPPublishCCAddressNotifier::NotifyTransaction(const CTransaction &transaction, const CBlock *pblock)
+{
+    CCEvent event;
+    if (!DecodeCCEvent(transaction, pblock, event))
+        return true;
+    std::vector<std::string> addresses = filter.MatchAddresses(event);
+    for (std::vector<std::string>::const_iterator it = addresses.begin(); it != addresses.end(); it++) {
+        LogPrint("amqp", "amqp: Publish ccaddress %s %s\n", *it, event.txid.GetHex());
+        std::map<std::string, std::string> properties;
+        properties["address"] = *it;
+        std::vector<unsigned char> data = SerializeCCEvent(event, sequences.NextAddress(*it));
+        if (!SendMessage(MSG_CCADDRESS, data.data(), data.size(), &properties))
+            return false;
+    }
+    return true;
+}
@@ -8,7 +8,9 @@
 #include "amqpabstractnotifier.h"
 #include "amqpconfig.h"
 #include "amqpsender.h"
+#include "cc/CCevents.h"
 
+#include <map>
 #include <memory>
 #include <thread>
 
@@ -23,7 +25,10 @@ private:
     std::shared_ptr<AMQPSender> handler_;      // proton container message handler, may be shared between notifiers
 
 public:
-    bool SendMessage(const char *command, const void* data, size_t size);
+    // properties are added to the message application properties, for broker side filtering
+    bool SendMessage(const char *command, const void* data, size_t size, const std::map<std::string, std::string> *properties = nullptr);
+    // skip the sequence numbers of messages that were dropped
+    void SkipMessages(uint64_t nMessages);
     bool Initialize();
     void Shutdown();
     void SpawnProtonContainer();
@@ -33,24 +38,53 @@ class AMQPPublishHashBlockNotifier : public AMQPAbstractPublishNotifier
 {
 public:
     bool NotifyBlock(const CBlockIndex *pindex);
+    void SkipDropped(const CNotificationGap &gap);
 };
 
 class AMQPPublishHashTransactionNotifier : public AMQPAbstractPublishNotifier
 {
 public:
     bool NotifyTransaction(const CTransaction &transaction);
+    void SkipDropped(const CNotificationGap &gap);
 };
 
 class AMQPPublishRawBlockNotifier : public AMQPAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    using AMQPAbstractNotifier::NotifyBlock;
+    bool NotifyBlock(const CBlockIndex *pindex, const CBlock *pblock);
+    void SkipDropped(const CNotificationGap &gap);
 };
 
 class AMQPPublishRawTransactionNotifier : public AMQPAbstractPublishNotifier
 {
 public:
     bool NotifyTransaction(const CTransaction &transaction);
+    void SkipDropped(const CNotificationGap &gap);
+};
+
+// decoded cc transactions, subject ccevent with an evalcode property, see CCEvent
+class AMQPPublishCCEventNotifier : public AMQPAbstractPublishNotifier
+{
+protected:
+    CCEventFilter filter;
+    CCEventSequences sequences;
+
+public:
+    void SetFilter(const CCEventFilter &filterIn) { filter = filterIn; }
+
+    using AMQPAbstractNotifier::NotifyTransaction;
+    bool NotifyTransaction(const CTransaction &transaction, const CBlock *pblock);
+    void SkipDropped(const CNotificationGap &gap);
+};
+
+// decoded cc transactions once per output address, subject ccaddress with an address property
+class AMQPPublishCCAddressNotifier : public AMQPPublishCCEventNotifier
+{
+public:
+    using AMQPAbstractNotifier::NotifyTransaction;
+    bool NotifyTransaction(const CTransaction &transaction, const CBlock *pblock);
+    void SkipDropped(const CNotificationGap &gap);
 };
 
 #endif // ZCASH_AMQP_AMQPPUBLISHNOTIFIER_H
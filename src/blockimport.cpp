@@ -0,0 +1,176 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "blockimport.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "pow.h"
+#include "streams.h"
+#include "util.h"
+
+#include <string.h>
+
+/** A batch is handed to a worker once it holds this many blocks or bytes. */
+static const size_t BLOCK_FILE_BATCH_BLOCKS = 64;
+static const size_t BLOCK_FILE_BATCH_BYTES = 1 << 20;
+
+void CheckBlockFileBatch(CBlockFileBatch& batch, const CChainParams& params)
+{
+    for (size_t i = 0; i < batch.vEntry.size(); i++) {
+        CBlockFileEntry& entry = batch.vEntry[i];
+        entry.hash = entry.block.GetHash();
+
+        if (!CheckEquihashSolution(&entry.block, entry.hash, params)) {
+            entry.strError = "invalid-solution";
+            continue;
+        }
+        bool fMutated;
+        if (entry.block.BuildMerkleTree(&fMutated) != entry.block.hashMerkleRoot) {
+            entry.strError = "bad-txnmrklroot";
+            continue;
+        }
+        if (fMutated) {
+            entry.strError = "bad-txns-duplicate";
+            continue;
+        }
+        entry.fValid = true;
+    }
+}
+
+CBlockFilePrefetcher::CBlockFilePrefetcher(FILE* fileIn, const CChainParams& paramsIn, unsigned int nMaxBlockSizeIn, int nThreads) :
+    params(paramsIn), nMaxBlockSize(nMaxBlockSizeIn), fReaderDone(false), fStop(false), nNext(0)
+{
+    if (nThreads <= 0)
+        nThreads = GetNumCores();
+    // one more batch than workers, so a decoded batch can wait for the caller
+    nMaxInFlight = std::max(nThreads, 1) + 1;
+    reader = std::thread(&CBlockFilePrefetcher::ThreadReader, this, fileIn);
+}
+
+CBlockFilePrefetcher::~CBlockFilePrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    cond.notify_all();
+    reader.join();
+}
+
+bool CBlockFilePrefetcher::Submit(std::unique_ptr<CBlockFileBatch>& batch)
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        cond.wait(lock, [this] { return inflight.size() < nMaxInFlight || fStop; });
+        if (fStop)
+            return false;
+    }
+    // only the reader submits, so the slot is still free once the worker is started
+    CBlockFileBatch* pbatch = batch.get();
+    const CChainParams& paramsRef = params;
+    std::future<void> result = std::async(std::launch::async, [pbatch, &paramsRef]() { CheckBlockFileBatch(*pbatch, paramsRef); });
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        inflight.push_back(InFlight(std::move(batch), std::move(result)));
+    }
+    cond.notify_all();
+    batch.reset(new CBlockFileBatch());
+    return true;
+}
+
+void CBlockFilePrefetcher::ThreadReader(FILE* fileIn)
+{
+    RenameThread("komodo-blkprefetch");
+    std::unique_ptr<CBlockFileBatch> batch(new CBlockFileBatch());
+    try {
+        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
+        CBufferedFile blkdat(fileIn, 2*nMaxBlockSize, nMaxBlockSize+8, SER_DISK, CLIENT_VERSION);
+        uint64_t nRewind = blkdat.GetPos();
+        bool fStopping = false;
+        while (!fStopping && !blkdat.eof()) {
+            blkdat.SetPos(nRewind);
+            nRewind++; // start one byte further next time, in case of failure
+            blkdat.SetLimit(); // remove former limit
+            unsigned int nSize = 0;
+            try {
+                // locate a header
+                unsigned char buf[MESSAGE_START_SIZE];
+                blkdat.FindByte(params.MessageStart()[0]);
+                nRewind = blkdat.GetPos()+1;
+                blkdat >> FLATDATA(buf);
+                if (memcmp(buf, params.MessageStart(), MESSAGE_START_SIZE))
+                    continue;
+                // read size
+                blkdat >> nSize;
+                if (nSize < 80 || nSize > nMaxBlockSize)
+                    continue;
+            } catch (const std::exception&) {
+                // no valid block header found; don't complain
+                break;
+            }
+            try {
+                // read the block, a malformed one leaves nRewind just past its magic to rescan from there
+                uint64_t nBlockPos = blkdat.GetPos();
+                blkdat.SetLimit(nBlockPos + nSize);
+                batch->vEntry.push_back(CBlockFileEntry());
+                CBlockFileEntry& entry = batch->vEntry.back();
+                entry.nPos = nBlockPos;
+                blkdat >> entry.block;
+                nRewind = blkdat.GetPos();
+
+                batch->nBytes += nSize;
+                if (batch->vEntry.size() >= BLOCK_FILE_BATCH_BLOCKS || batch->nBytes >= BLOCK_FILE_BATCH_BYTES)
+                    fStopping = !Submit(batch);
+            } catch (const std::exception& e) {
+                batch->vEntry.pop_back();
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+            }
+        }
+        if (!fStopping && !batch->vEntry.empty())
+            Submit(batch);
+    } catch (const std::runtime_error& e) {
+        std::lock_guard<std::mutex> lock(cs);
+        strReadError = e.what();
+    }
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fReaderDone = true;
+    }
+    cond.notify_all();
+}
+
+CBlockFileEntry* CBlockFilePrefetcher::Next()
+{
+    while (!current || nNext >= current->vEntry.size()) {
+        InFlight next;
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            cond.wait(lock, [this] { return !inflight.empty() || fReaderDone; });
+            if (inflight.empty()) {
+                if (!strReadError.empty())
+                    throw std::runtime_error(strReadError);
+                return NULL;
+            }
+            next = std::move(inflight.front());
+            inflight.pop_front();
+        }
+        cond.notify_all();
+        next.second.get();
+        current = std::move(next.first);
+        nNext = 0;
+    }
+    return &current->vEntry[nNext++];
+}
@@ -0,0 +1,110 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_BLOCKIMPORT_H
+#define KOMODO_BLOCKIMPORT_H
+
+#include "primitives/block.h"
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CChainParams;
+
+/** A block found in a block file, deserialized by the prefetch reader and checked by a worker. */
+struct CBlockFileEntry
+{
+    uint64_t nPos;          //!< offset of the serialized block in the file
+    CBlock block;
+    uint256 hash;
+    bool fValid;            //!< passed the context-free checks
+    std::string strError;   //!< why the checks failed
+
+    CBlockFileEntry() : nPos(0), fValid(false) {}
+};
+
+/** Blocks read from a block file, handed to a worker as one unit. */
+struct CBlockFileBatch
+{
+    std::vector<CBlockFileEntry> vEntry;
+    size_t nBytes;
+
+    CBlockFileBatch() : nBytes(0) {}
+};
+
+/**
+ * Run the checks of a batch that need no chain context: the Equihash solution
+ * and the merkle root. A block passing them here is not verified again on the
+ * validation path, see CheckEquihashSolution.
+ */
+void CheckBlockFileBatch(CBlockFileBatch& batch, const CChainParams& params);
+
+/**
+ * Reads the blocks of a block file ahead of the caller, for -reindex and
+ * -loadblock.
+ *
+ * A reader thread scans the file for the network magic and the block length,
+ * deserializes the blocks and collects them into batches; like a sequential read,
+ * a block that fails to deserialize is rescanned from the byte after its magic.
+ * Each batch is checked on a worker thread while the caller processes earlier
+ * blocks. Next() hands the
+ * blocks out in file order, so ProcessNewBlock sees them in the same order as
+ * with a sequential read. The number of batches in flight is bounded, which
+ * bounds the memory held by blocks that were read but not yet processed.
+ */
+class CBlockFilePrefetcher
+{
+public:
+    /** Takes over fileIn and closes it. nThreads <= 0 uses one worker per core. */
+    CBlockFilePrefetcher(FILE* fileIn, const CChainParams& paramsIn, unsigned int nMaxBlockSizeIn, int nThreads = 0);
+    ~CBlockFilePrefetcher();
+
+    /**
+     * Returns the next block of the file, or NULL at its end. The entry stays valid
+     * until the following call. Throws if reading the file failed.
+     */
+    CBlockFileEntry* Next();
+
+private:
+    typedef std::pair<std::unique_ptr<CBlockFileBatch>, std::future<void> > InFlight;
+
+    void ThreadReader(FILE* fileIn);
+    /** Queue a batch for decoding, waiting while too many are in flight. False when stopping. */
+    bool Submit(std::unique_ptr<CBlockFileBatch>& batch);
+
+    const CChainParams& params;
+    const unsigned int nMaxBlockSize;
+    size_t nMaxInFlight;
+
+    std::mutex cs;
+    std::condition_variable cond;
+    std::deque<InFlight> inflight;
+    bool fReaderDone;
+    bool fStop;
+    std::string strReadError;
+    std::thread reader;
+
+    std::unique_ptr<CBlockFileBatch> current;
+    size_t nNext;
+};
+
+#endif // KOMODO_BLOCKIMPORT_H
@@ -0,0 +1,99 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_BLOCKMAP_H
+#define KOMODO_BLOCKMAP_H
+
+#include "flathashmap.h"
+#include "memusage.h"
+#include "uint256.h"
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+class CBlockIndex;
+
+/**
+ * Fixed-address storage for objects that live as long as the block index.
+ *
+ * Objects are constructed in chunks of CHUNK_SIZE instead of one heap block
+ * each, which drops the per-allocation malloc overhead and keeps entries that
+ * were created together next to each other. Objects are never freed on their
+ * own, Clear() destroys all of them at once.
+ */
+template <typename T, size_t CHUNK_SIZE = 1024>
+class CArena
+{
+public:
+    CArena() : nUsedInLast(CHUNK_SIZE) {}
+    ~CArena() { Clear(); }
+
+    template <typename... Args>
+    T* Allocate(Args&&... args)
+    {
+        if (nUsedInLast == CHUNK_SIZE) {
+            vChunks.push_back(static_cast<T*>(::operator new(sizeof(T) * CHUNK_SIZE)));
+            nUsedInLast = 0;
+        }
+        T* p = vChunks.back() + nUsedInLast;
+        new (p) T(std::forward<Args>(args)...);
+        nUsedInLast++;
+        return p;
+    }
+
+    void Clear()
+    {
+        for (size_t i = 0; i < vChunks.size(); i++) {
+            size_t nUsed = i + 1 == vChunks.size() ? nUsedInLast : CHUNK_SIZE;
+            for (size_t j = 0; j < nUsed; j++)
+                vChunks[i][j].~T();
+            ::operator delete(vChunks[i]);
+        }
+        vChunks.clear();
+        nUsedInLast = CHUNK_SIZE;
+    }
+
+    size_t size() const
+    {
+        return vChunks.empty() ? 0 : (vChunks.size() - 1) * CHUNK_SIZE + nUsedInLast;
+    }
+
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::MallocUsage(sizeof(T) * CHUNK_SIZE) * vChunks.size() + memusage::DynamicUsage(vChunks);
+    }
+
+private:
+    CArena(const CArena&);
+    CArena& operator=(const CArena&);
+
+    std::vector<T*> vChunks;
+    size_t nUsedInLast;
+};
+
+struct BlockHasher
+{
+    size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+};
+
+/**
+ * mapBlockIndex, from block hash to block index entry. Entries never move, so
+ * &entry.first stays valid for CBlockIndex::phashBlock.
+ */
+typedef CFlatHashMap<uint256, CBlockIndex*, BlockHasher> CBlockMap;
+
+#endif // KOMODO_BLOCKMAP_H
@@ -27,7 +27,7 @@ UniValue OracleSubscribe(const CPubKey& pk, int64_t txfee,uint256 oracletxid,CPu
 UniValue OracleData(const CPubKey& pk, int64_t txfee,uint256 oracletxid,std::vector <uint8_t> data);
 // CCcustom
 UniValue OracleDataSample(uint256 reforacletxid,uint256 txid);
-UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num);
+UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num,int32_t beginHeight=-1,int32_t endHeight=-1);
 UniValue OracleInfo(uint256 origtxid);
 UniValue OraclesList();
 
@@ -20,16 +20,28 @@
 #include "CCinclude.h"
 #include <gmp.h>
 #include <key_io.h>
+#include <atomic>
 
 #define PAYMENTS_TXFEE 10000
 #define PAYMENTS_MERGEOFSET 60 // 1H extra. 
 extern std::vector <std::pair<CAmount, CTxDestination>> vAddressSnapshot;
 extern int32_t lastSnapShotHeight;
 
+/// progress of a payments release, updated by PaymentsRelease and read by the async operation running it
+struct PaymentsReleaseProgress
+{
+    enum Stage { ALLOCATIONS, SHARES, INPUTS, SIGNING };
+    std::atomic<int> nStage;
+    std::atomic<int32_t> nRecipients;
+    std::atomic<int32_t> nShares;
+
+    PaymentsReleaseProgress() : nStage(ALLOCATIONS), nRecipients(0), nShares(0) {}
+};
+
 bool PaymentsValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &tx, uint32_t nIn);
 
 // CCcustom
-UniValue PaymentsRelease(struct CCcontract_info *cp,char *jsonstr);
+UniValue PaymentsRelease(struct CCcontract_info *cp,char *jsonstr,PaymentsReleaseProgress *progress = 0);
 UniValue PaymentsFund(struct CCcontract_info *cp,char *jsonstr);
 UniValue PaymentsMerge(struct CCcontract_info *cp,char *jsonstr);
 UniValue PaymentsTxidopret(struct CCcontract_info *cp,char *jsonstr);
@@ -59,6 +59,11 @@ UniValue PricesInfo(uint256 bettxid,int32_t refheight);
 UniValue PricesList(uint32_t filter, CPubKey mypk);
 UniValue PricesGetOrderbook();
 UniValue PricesRefillFund(int64_t amount);
+UniValue PricesLiquidations();
+
+void PricesBlockConnected(const CBlock &block, const CBlockIndex *pindex);
+void PricesBlockDisconnected(const CBlock &block, const CBlockIndex *pindex);
+int32_t PricesTrackedBets(uint256 bettxid);
 
 
 #endif
@@ -0,0 +1,228 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "CCcoinselect.h"
+#include "CCinclude.h"
+
+#include "main.h"
+#include "txmempool.h"
+#include "utiltime.h"
+
+CCoinSelectCache *pcoinselectcache = NULL;
+
+void CCoinSelectCache::ErasePool(std::map<CCoinSelectKey, Pool>::iterator it)
+{
+    for (std::map<COutPoint, CCoinCandidate>::const_iterator c = it->second.candidates.begin(); c != it->second.candidates.end(); c++) {
+        std::pair<std::multimap<COutPoint, CCoinSelectKey>::iterator, std::multimap<COutPoint, CCoinSelectKey>::iterator> range = mapPoolsByOutPoint.equal_range(c->first);
+        for (std::multimap<COutPoint, CCoinSelectKey>::iterator p = range.first; p != range.second; p++) {
+            if (!(p->second < it->first) && !(it->first < p->second)) {
+                mapPoolsByOutPoint.erase(p);
+                break;
+            }
+        }
+    }
+    mapPools.erase(it);
+}
+
+void CCoinSelectCache::Collect(Pool &pool, bool fSkipReserved, int64_t nNow, std::vector<CCoinCandidate> &candidates)
+{
+    pool.nLastUse = nNow;
+    candidates.reserve(pool.candidates.size());
+    for (std::map<COutPoint, CCoinCandidate>::iterator c = pool.candidates.begin(); c != pool.candidates.end(); c++) {
+        if (c->second.nStatus == CCoinCandidate::REJECTED)
+            continue;
+        if (fSkipReserved) {
+            std::map<COutPoint, int64_t>::const_iterator r = mapReserved.find(c->first);
+            if (r != mapReserved.end() && r->second > nNow)
+                continue;
+        }
+        // a conflicted or expired mempool tx is not notified again
+        if (c->second.fUnconfirmed && !mempool.exists(c->first.hash))
+            continue;
+        candidates.push_back(c->second);
+    }
+}
+
+bool CCoinSelectCache::GetCandidates(const CCoinSelectKey &key, const Loader &loader, bool fReload, bool fSkipReserved, std::vector<CCoinCandidate> &candidates)
+{
+    int64_t nNow = GetTime();
+    candidates.clear();
+    {
+        LOCK(cs);
+        std::map<CCoinSelectKey, Pool>::iterator it = mapPools.find(key);
+        if (it != mapPools.end() && (fReload || nNow - it->second.nLoadTime > CCINPUTS_POOL_MAXAGE))
+            ErasePool(it);
+        else if (it != mapPools.end()) {
+            Collect(it->second, fSkipReserved, nNow, candidates);
+            return false;
+        }
+    }
+
+    std::vector<CCoinCandidate> loaded;
+    // blocks are notified under cs_main so none is missed between the query and the insert
+    LOCK(cs_main);
+    loader(loaded);
+
+    {
+        LOCK(cs);
+        std::map<CCoinSelectKey, Pool>::iterator it = mapPools.find(key);
+        if (it != mapPools.end())
+            ErasePool(it);  // loaded by another builder meanwhile
+        if (mapPools.size() >= CCINPUTS_MAX_POOLS) {
+            std::map<CCoinSelectKey, Pool>::iterator oldest = mapPools.begin();
+            for (it = mapPools.begin(); it != mapPools.end(); it++)
+                if (it->second.nLastUse < oldest->second.nLastUse)
+                    oldest = it;
+            ErasePool(oldest);
+        }
+        Pool &pool = mapPools[key];
+        pool.nLoadTime = nNow;
+        for (std::vector<CCoinCandidate>::const_iterator c = loaded.begin(); c != loaded.end(); c++) {
+            if (pool.candidates.insert(std::make_pair(c->outpoint, *c)).second)
+                mapPoolsByOutPoint.insert(std::make_pair(c->outpoint, key));
+        }
+        Collect(pool, fSkipReserved, nNow, candidates);
+        return true;
+    }
+}
+
+void CCoinSelectCache::SetStatus(const CCoinSelectKey &key, const std::vector<CCoinCandidate> &checked)
+{
+    LOCK(cs);
+    std::map<CCoinSelectKey, Pool>::iterator it = mapPools.find(key);
+    if (it == mapPools.end())
+        return;
+    for (std::vector<CCoinCandidate>::const_iterator c = checked.begin(); c != checked.end(); c++) {
+        std::map<COutPoint, CCoinCandidate>::iterator found = it->second.candidates.find(c->outpoint);
+        if (found != it->second.candidates.end())
+            found->second.nStatus = c->nStatus;
+    }
+}
+
+bool CCoinSelectCache::Reserve(const std::vector<COutPoint> &outpoints, int64_t nNow)
+{
+    if (nReserveTime <= 0)
+        return true;
+    LOCK(cs);
+    for (std::map<COutPoint, int64_t>::iterator it = mapReserved.begin(); it != mapReserved.end(); ) {
+        if (it->second <= nNow)
+            mapReserved.erase(it++);
+        else
+            it++;
+    }
+    for (std::vector<COutPoint>::const_iterator op = outpoints.begin(); op != outpoints.end(); op++)
+        if (mapReserved.count(*op) != 0)
+            return false;
+    for (std::vector<COutPoint>::const_iterator op = outpoints.begin(); op != outpoints.end(); op++)
+        mapReserved[*op] = nNow + nReserveTime;
+    return true;
+}
+
+bool CCoinSelectCache::IsReserved(const COutPoint &outpoint, int64_t nNow)
+{
+    LOCK(cs);
+    std::map<COutPoint, int64_t>::const_iterator it = mapReserved.find(outpoint);
+    return it != mapReserved.end() && it->second > nNow;
+}
+
+void CCoinSelectCache::Clear()
+{
+    LOCK(cs);
+    mapPools.clear();
+    mapPoolsByOutPoint.clear();
+}
+
+size_t CCoinSelectCache::PoolCount()
+{
+    LOCK(cs);
+    return mapPools.size();
+}
+
+void CCoinSelectCache::Spend(const COutPoint &outpoint)
+{
+    std::pair<std::multimap<COutPoint, CCoinSelectKey>::iterator, std::multimap<COutPoint, CCoinSelectKey>::iterator> range = mapPoolsByOutPoint.equal_range(outpoint);
+    for (std::multimap<COutPoint, CCoinSelectKey>::iterator p = range.first; p != range.second; p++) {
+        std::map<CCoinSelectKey, Pool>::iterator it = mapPools.find(p->second);
+        if (it != mapPools.end())
+            it->second.candidates.erase(outpoint);
+    }
+    mapPoolsByOutPoint.erase(range.first, range.second);
+    mapReserved.erase(outpoint);
+
+    if (setRecentSpent.insert(outpoint).second) {
+        vRecentSpent.push_back(outpoint);
+        if (vRecentSpent.size() > CCINPUTS_RECENT_SPENT) {
+            setRecentSpent.erase(vRecentSpent.front());
+            vRecentSpent.pop_front();
+        }
+    }
+}
+
+void CCoinSelectCache::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+{
+    LOCK(cs);
+    if (!tx.IsCoinBase())
+        for (std::vector<CTxIn>::const_iterator vin = tx.vin.begin(); vin != tx.vin.end(); vin++)
+            Spend(vin->prevout);
+    if (mapPools.empty())
+        return;
+
+    uint256 txid = tx.GetHash();
+    for (int32_t i = 0; i < tx.vout.size(); i++) {
+        const CTxOut &vout = tx.vout[i];
+        COutPoint outpoint(txid, i);
+        if (vout.nValue == 0)
+            continue;
+        if (pblock == NULL && setRecentSpent.count(outpoint) != 0)
+            continue;  // late notification of a tx whose output is spent already
+
+        char destaddr[KOMODO_ADDRESS_BUFSIZE];
+        if (!Getscriptaddress(destaddr, vout.scriptPubKey))
+            continue;
+        bool fCC = vout.scriptPubKey.IsPayToCryptoCondition() != 0;
+        std::map<CCoinSelectKey, Pool>::iterator it = mapPools.lower_bound(CCoinSelectKey(destaddr, uint256(), 0, false));
+        for (; it != mapPools.end() && it->first.address == destaddr; it++) {
+            if (it->first.IsToken() != fCC || (pblock == NULL && !it->first.fMempool))
+                continue;
+            std::map<COutPoint, CCoinCandidate>::iterator found = it->second.candidates.find(outpoint);
+            if (found != it->second.candidates.end()) {
+                if (pblock != NULL)
+                    found->second.fUnconfirmed = false;
+                continue;
+            }
+            CCoinCandidate c(outpoint, vout.nValue, vout.scriptPubKey, tx.IsCoinBase(), fCC ? CCoinCandidate::UNCHECKED : CCoinCandidate::SPENDABLE);
+            c.fUnconfirmed = pblock == NULL;
+            it->second.candidates.insert(std::make_pair(outpoint, c));
+            mapPoolsByOutPoint.insert(std::make_pair(outpoint, it->first));
+        }
+    }
+}
+
+bool ReserveTxInputs(const CMutableTransaction &mtx, size_t nvins)
+{
+    if (pcoinselectcache == NULL || !pcoinselectcache->IsReserving())
+        return true;
+    std::vector<COutPoint> outpoints;
+    for (size_t i = nvins; i < mtx.vin.size(); i++)
+        outpoints.push_back(mtx.vin[i].prevout);
+    return pcoinselectcache->Reserve(outpoints, GetTime());
+}
+
+void CCoinSelectCache::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added)
+{
+    // outputs of disconnected blocks are back in the mempool or gone
+    if (!added)
+        Clear();
+}
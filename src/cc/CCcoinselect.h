@@ -0,0 +1,156 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_CCCOINSELECT_H
+#define KOMODO_CCCOINSELECT_H
+
+#include "amount.h"
+#include "primitives/transaction.h"
+#include "sync.h"
+#include "validationinterface.h"
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+static const bool DEFAULT_CCINPUTSCACHE = true;
+/** Seconds the inputs added by a tx builder stay reserved for it, 0 to not reserve. */
+static const int64_t DEFAULT_CCINPUTSRESERVE = 0;
+/** Pools are reloaded from the indexes after this many seconds. */
+static const int64_t CCINPUTS_POOL_MAXAGE = 600;
+static const size_t CCINPUTS_MAX_POOLS = 1024;
+/** Selections tried by a builder, when its pool was stale or other builders reserved its picks. */
+static const int32_t CCINPUTS_SELECT_ATTEMPTS = 3;
+/** Number of spent outpoints remembered to drop late mempool notifications. */
+static const size_t CCINPUTS_RECENT_SPENT = 20000;
+
+/** Candidate pool of one address, for normal coins (null tokenid) or for one token. */
+struct CCoinSelectKey
+{
+    std::string address;
+    uint256 tokenid;
+    uint8_t evalcode;   // token eval code, 0 for normal coins
+    bool fMempool;      // pool includes the mempool outputs
+
+    CCoinSelectKey() : evalcode(0), fMempool(false) {}
+    CCoinSelectKey(const std::string &_address, uint256 _tokenid, uint8_t _evalcode, bool _fMempool) :
+        address(_address), tokenid(_tokenid), evalcode(_evalcode), fMempool(_fMempool) {}
+
+    bool IsToken() const { return evalcode != 0; }
+
+    friend bool operator<(const CCoinSelectKey &a, const CCoinSelectKey &b)
+    {
+        if (a.address != b.address)
+            return a.address < b.address;
+        if (a.tokenid != b.tokenid)
+            return a.tokenid < b.tokenid;
+        if (a.evalcode != b.evalcode)
+            return a.evalcode < b.evalcode;
+        return a.fMempool < b.fMempool;
+    }
+};
+
+struct CCoinCandidate
+{
+    enum Status { UNCHECKED = 0, SPENDABLE = 1, REJECTED = 2 };
+
+    COutPoint outpoint;
+    CAmount nValue;
+    CScript script;
+    bool fCoinbase;     // maturity is checked when selected
+    bool fUnconfirmed;  // added from a mempool notification, dropped when the tx leaves the mempool unconfirmed
+    int8_t nStatus;     // token outputs are checked with IsTokensvout once, on first use
+
+    CCoinCandidate() : nValue(0), fCoinbase(false), fUnconfirmed(false), nStatus(UNCHECKED) {}
+    CCoinCandidate(const COutPoint &_outpoint, CAmount _nValue, const CScript &_script, bool _fCoinbase, int8_t _nStatus) :
+        outpoint(_outpoint), nValue(_nValue), script(_script), fCoinbase(_fCoinbase), fUnconfirmed(false), nStatus(_nStatus) {}
+};
+
+/**
+ * Spendable outputs of the addresses cc transactions are built from.
+ *
+ * A pool is loaded with the same address or unspent cc index query the tx
+ * builders used to run for each transaction, and is then kept up to date from
+ * the validation interface: outputs spent by mempool or block transactions
+ * are dropped and new outputs to the pool address are added, checked for
+ * normal pools and unchecked for token pools. The result of the token check
+ * is kept in the pool, so each output is fetched and decoded once.
+ *
+ * Pools are dropped on reorgs and reloaded after CCINPUTS_POOL_MAXAGE, or when
+ * a builder cannot cover its amount, as mempool evictions are not notified.
+ *
+ * Builders reserve the outputs they add to a transaction. Reserve() takes all
+ * of them or none, so builders running at the same time never add the same
+ * output; a reservation ends when the output is seen spent or when it expires.
+ */
+class CCoinSelectCache : public CValidationInterface
+{
+public:
+    typedef std::function<void(std::vector<CCoinCandidate> &)> Loader;
+
+    explicit CCoinSelectCache(int64_t nReserveTimeIn) : nReserveTime(nReserveTimeIn) {}
+
+    /**
+     * Candidates of the pool for key, loaded with loader when missing, stale or
+     * if fReload. Outputs reserved by other builders are left out if fSkipReserved.
+     * Returns true if the pool was loaded by this call.
+     */
+    bool GetCandidates(const CCoinSelectKey &key, const Loader &loader, bool fReload, bool fSkipReserved, std::vector<CCoinCandidate> &candidates);
+    /** Store the result of checking token candidates. */
+    void SetStatus(const CCoinSelectKey &key, const std::vector<CCoinCandidate> &checked);
+
+    /** Reserve all outpoints or none of them if one is reserved already. */
+    bool Reserve(const std::vector<COutPoint> &outpoints, int64_t nNow);
+    bool IsReserved(const COutPoint &outpoint, int64_t nNow);
+    bool IsReserving() const { return nReserveTime > 0; }
+
+    void Clear();
+    size_t PoolCount();
+
+protected:
+    void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added);
+
+private:
+    struct Pool
+    {
+        int64_t nLoadTime;
+        int64_t nLastUse;
+        std::map<COutPoint, CCoinCandidate> candidates;
+    };
+
+    void ErasePool(std::map<CCoinSelectKey, Pool>::iterator it);
+    void Collect(Pool &pool, bool fSkipReserved, int64_t nNow, std::vector<CCoinCandidate> &candidates);
+    void Spend(const COutPoint &outpoint);
+
+    CCriticalSection cs;
+    const int64_t nReserveTime;
+    std::map<CCoinSelectKey, Pool> mapPools;
+    std::multimap<COutPoint, CCoinSelectKey> mapPoolsByOutPoint;
+    std::map<COutPoint, int64_t> mapReserved;   // expiry time
+    std::set<COutPoint> setRecentSpent;
+    std::deque<COutPoint> vRecentSpent;
+};
+
+/** Set by init when -ccinputscache is on, NULL otherwise. */
+extern CCoinSelectCache *pcoinselectcache;
+
+/** Reserve the inputs added to mtx from position nvins, true if they are not reserved by another builder. */
+bool ReserveTxInputs(const CMutableTransaction &mtx, size_t nvins);
+
+#endif // KOMODO_CCCOINSELECT_H
@@ -0,0 +1,214 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "CCevents.h"
+#include "CCinclude.h"
+
+#include "primitives/block.h"
+#include "streams.h"
+#include "utilstrencodings.h"
+#include "version.h"
+
+#include <boost/algorithm/string.hpp>
+
+std::vector<std::string> CCEvent::GetAddresses() const
+{
+    std::vector<std::string> addresses;
+    for (std::vector<CCEventOutput>::const_iterator it = vout.begin(); it != vout.end(); it++)
+        if (!it->address.empty() && std::find(addresses.begin(), addresses.end(), it->address) == addresses.end())
+            addresses.push_back(it->address);
+    return addresses;
+}
+
+// the opreturn of the last vout, or the one dropped into a cc vout by newer modules
+static bool GetEventOpret(const CTransaction &tx, CScript &opret, vscript_t &vopret)
+{
+    if (tx.vout.size() > 0 && tx.vout.back().scriptPubKey.IsOpReturn()) {
+        opret = tx.vout.back().scriptPubKey;
+        if (GetOpReturnData(opret, vopret) && vopret.size() >= 2)
+            return true;
+    }
+    for (std::vector<CTxOut>::const_iterator it = tx.vout.begin(); it != tx.vout.end(); it++) {
+        if (it->scriptPubKey.IsPayToCryptoCondition() == 0)
+            continue;
+        opret = GetCCDropAsOpret(it->scriptPubKey);
+        if (!opret.empty() && GetOpReturnData(opret, vopret) && vopret.size() >= 2)
+            return true;
+    }
+    return false;
+}
+
+bool DecodeCCEvent(const CTransaction &tx, const CBlock *pblock, CCEvent &event)
+{
+    bool fCC = false;
+    for (std::vector<CTxOut>::const_iterator it = tx.vout.begin(); it != tx.vout.end() && !fCC; it++)
+        fCC = it->scriptPubKey.IsPayToCryptoCondition() != 0;
+    for (std::vector<CTxIn>::const_iterator it = tx.vin.begin(); it != tx.vin.end() && !fCC; it++)
+        fCC = IsCCInput(it->scriptSig);
+    if (!fCC || tx.IsCoinBase())
+        return false;
+
+    event = CCEvent();
+    event.txid = tx.GetHash();
+    if (pblock != NULL)
+        event.blockhash = pblock->GetHash();
+
+    CScript opret;
+    vscript_t vopret;
+    if (GetEventOpret(tx, opret, vopret)) {
+        event.evalcode = vopret[0];
+        event.funcid = vopret[1];
+        std::vector<vscript_t> oprets;
+        uint8_t tokenFuncid = 0;
+        if (event.evalcode == EVAL_TOKENS) {
+            std::vector<CPubKey> voutPubkeys;
+            tokenFuncid = DecodeTokenOpRetV1(opret, event.tokenid, voutPubkeys, oprets);
+        } else if (event.evalcode == EVAL_TOKENSV2)
+            tokenFuncid = DecodeTokenOpRetV2(opret, event.tokenid, oprets);
+        if (tokenFuncid != 0)
+            event.funcid = tokenFuncid;  // old style 'c' or 't' for both versions
+        if (tokenFuncid == 'c')
+            event.tokenid = event.txid;
+        else if (tokenFuncid == 0)
+            event.tokenid.SetNull();
+        if (tokenFuncid != 0 && !oprets.empty() && oprets[0].size() >= 2) {
+            event.moduleEvalcode = oprets[0][0];
+            event.moduleFuncid = oprets[0][1];
+        }
+    }
+
+    for (uint32_t i = 0; i < tx.vout.size(); i++) {
+        const CTxOut &vout = tx.vout[i];
+        if (vout.scriptPubKey.IsOpReturn())
+            continue;
+        char destaddr[KOMODO_ADDRESS_BUFSIZE];
+        if (!Getscriptaddress(destaddr, vout.scriptPubKey))
+            destaddr[0] = 0;
+        event.vout.push_back(CCEventOutput(i, vout.nValue, vout.scriptPubKey.IsPayToCryptoCondition() != 0, destaddr));
+    }
+    return true;
+}
+
+std::vector<unsigned char> SerializeCCEvent(const CCEvent &event, uint64_t nSequence)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CCEVENT_VERSION << nSequence << event;
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+bool CCEventFilter::Parse(const std::string &strFilter)
+{
+    std::vector<std::string> items;
+    boost::split(items, strFilter, boost::is_any_of(", "), boost::token_compress_on);
+    for (std::vector<std::string>::const_iterator it = items.begin(); it != items.end(); it++) {
+        if (it->empty())
+            continue;
+        if (it->size() <= 2 && IsHex(it->size() == 1 ? "0" + *it : *it))
+            setEvalcodes.insert(ParseHex(it->size() == 1 ? "0" + *it : *it)[0]);
+        else if (it->size() < KOMODO_ADDRESS_BUFSIZE)
+            setAddresses.insert(*it);
+        else
+            return false;
+    }
+    return true;
+}
+
+bool CCEventFilter::Match(const CCEvent &event) const
+{
+    if (IsEmpty())
+        return true;
+    if (setEvalcodes.count(event.evalcode) != 0 || (event.moduleEvalcode != 0 && setEvalcodes.count(event.moduleEvalcode) != 0))
+        return true;
+    for (std::vector<CCEventOutput>::const_iterator it = event.vout.begin(); it != event.vout.end(); it++)
+        if (setAddresses.count(it->address) != 0)
+            return true;
+    return false;
+}
+
+bool CCEventFilter::MatchAddress(const std::string &address) const
+{
+    return setAddresses.empty() || setAddresses.count(address) != 0;
+}
+
+std::vector<std::string> CCEventFilter::MatchAddresses(const CCEvent &event) const
+{
+    std::vector<std::string> addresses;
+    if (!Match(event))
+        return addresses;
+    std::vector<std::string> all = event.GetAddresses();
+    for (std::vector<std::string>::const_iterator it = all.begin(); it != all.end(); it++)
+        if (MatchAddress(*it))
+            addresses.push_back(*it);
+    return addresses;
+}
+
+void CCEventGap::Add(const CCEvent &event, const CCEventFilter &filter)
+{
+    if (!filter.Match(event))
+        return;
+    nEvents++;
+    mapEvalcodes[event.evalcode]++;
+    std::vector<std::string> addresses = filter.MatchAddresses(event);
+    for (std::vector<std::string>::const_iterator it = addresses.begin(); it != addresses.end(); it++) {
+        nAddressEvents++;
+        mapAddresses[*it]++;
+    }
+}
+
+void CCEventGap::Add(const CCEventGap &gap)
+{
+    nEvents += gap.nEvents;
+    nAddressEvents += gap.nAddressEvents;
+    for (std::map<uint8_t, uint64_t>::const_iterator it = gap.mapEvalcodes.begin(); it != gap.mapEvalcodes.end(); it++)
+        mapEvalcodes[it->first] += it->second;
+    for (std::map<std::string, uint64_t>::const_iterator it = gap.mapAddresses.begin(); it != gap.mapAddresses.end(); it++)
+        mapAddresses[it->first] += it->second;
+}
+
+CCEventSequences::CCEventSequences()
+{
+    memset(evalcodeSequences, 0, sizeof(evalcodeSequences));
+}
+
+uint64_t CCEventSequences::NextEvalcode(uint8_t evalcode)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return evalcodeSequences[evalcode]++;
+}
+
+uint64_t CCEventSequences::NextAddress(const std::string &address)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    if (addressSequences.size() >= CCEVENT_MAX_ADDRESS_SEQUENCES && addressSequences.count(address) == 0)
+        addressSequences.clear();
+    return addressSequences[address]++;
+}
+
+void CCEventSequences::SkipEvalcodes(const CCEventGap &gap)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    for (std::map<uint8_t, uint64_t>::const_iterator it = gap.mapEvalcodes.begin(); it != gap.mapEvalcodes.end(); it++)
+        evalcodeSequences[it->first] += it->second;
+}
+
+void CCEventSequences::SkipAddresses(const CCEventGap &gap)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    for (std::map<std::string, uint64_t>::const_iterator it = gap.mapAddresses.begin(); it != gap.mapAddresses.end(); it++) {
+        if (addressSequences.size() >= CCEVENT_MAX_ADDRESS_SEQUENCES && addressSequences.count(it->first) == 0)
+            addressSequences.clear();
+        addressSequences[it->first] += it->second;
+    }
+}
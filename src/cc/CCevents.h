@@ -0,0 +1,162 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_CCEVENTS_H
+#define KOMODO_CCEVENTS_H
+
+#include "amount.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+class CBlock;
+class CTransaction;
+
+/** Version byte leading every published cc event body. */
+static const uint8_t CCEVENT_VERSION = 1;
+/** Per address sequences kept by a publisher, they restart from 0 when it is full. */
+static const size_t CCEVENT_MAX_ADDRESS_SEQUENCES = 1000000;
+
+struct CCEventOutput
+{
+    uint32_t n;
+    CAmount nValue;
+    bool fCC;
+    std::string address;
+
+    CCEventOutput() : n(0), nValue(0), fCC(false) {}
+    CCEventOutput(uint32_t _n, CAmount _nValue, bool _fCC, const std::string &_address) : n(_n), nValue(_nValue), fCC(_fCC), address(_address) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(n);
+        READWRITE(nValue);
+        READWRITE(fCC);
+        READWRITE(address);
+    }
+};
+
+/**
+ * A cc transaction as published on the ccevent and ccaddress topics, decoded
+ * from its opreturn (or the opreturn dropped into its first cc output).
+ * Token transactions carry the tokenid and the evalcode and funcid of the
+ * module data wrapped in the token opreturn, e.g. an assets order.
+ */
+struct CCEvent
+{
+    uint256 txid;
+    uint256 blockhash;          // null while in the mempool
+    uint8_t evalcode;
+    uint8_t funcid;
+    uint256 tokenid;            // null for non token txns
+    uint8_t moduleEvalcode;     // 0 if the token opreturn has no module data
+    uint8_t moduleFuncid;
+    std::vector<CCEventOutput> vout;
+
+    CCEvent() : evalcode(0), funcid(0), moduleEvalcode(0), moduleFuncid(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(blockhash);
+        READWRITE(evalcode);
+        READWRITE(funcid);
+        READWRITE(tokenid);
+        READWRITE(moduleEvalcode);
+        READWRITE(moduleFuncid);
+        READWRITE(vout);
+    }
+
+    /** Distinct output addresses in output order. */
+    std::vector<std::string> GetAddresses() const;
+};
+
+/** Decode tx into event, false if tx has no cc inputs or outputs. */
+bool DecodeCCEvent(const CTransaction &tx, const CBlock *pblock, CCEvent &event);
+
+/**
+ * Message body: CCEVENT_VERSION, the topic sequence number (uint64 LE) and
+ * the event, all with the usual network serialization.
+ */
+std::vector<unsigned char> SerializeCCEvent(const CCEvent &event, uint64_t nSequence);
+
+/** Evalcodes and addresses a node publishes events for, set with -ccnotifyfilter. Empty matches all. */
+class CCEventFilter
+{
+public:
+    /** Parse a comma separated list of hex evalcodes (like f5) and addresses. */
+    bool Parse(const std::string &strFilter);
+    bool IsEmpty() const { return setEvalcodes.empty() && setAddresses.empty(); }
+    /** Event is published on ccevent: its evalcode, module evalcode or an address is listed. */
+    bool Match(const CCEvent &event) const;
+    /** Address is published on ccaddress. */
+    bool MatchAddress(const std::string &address) const;
+    /** Addresses of event published on ccaddress, none if the event does not Match. */
+    std::vector<std::string> MatchAddresses(const CCEvent &event) const;
+
+private:
+    std::set<uint8_t> setEvalcodes;
+    std::set<std::string> setAddresses;
+};
+
+/**
+ * ccevent and ccaddress messages that cc transactions dropped from a full
+ * notification queue would have published, see CNotificationGap.
+ */
+struct CCEventGap
+{
+    uint64_t nEvents;                               // messages on ccevent
+    uint64_t nAddressEvents;                        // messages on ccaddress
+    std::map<uint8_t, uint64_t> mapEvalcodes;       // per ccevent topic
+    std::map<std::string, uint64_t> mapAddresses;   // per ccaddress topic
+
+    CCEventGap() : nEvents(0), nAddressEvents(0) {}
+
+    /** Counts the messages event is published in with filter. */
+    void Add(const CCEvent &event, const CCEventFilter &filter);
+    void Add(const CCEventGap &gap);
+};
+
+/**
+ * Up-counting sequence numbers per ccevent topic (evalcode) and per ccaddress
+ * topic (address), so a subscriber to a single topic can detect gaps. Memory
+ * only, like the notifier sequence numbers.
+ */
+class CCEventSequences
+{
+public:
+    CCEventSequences();
+    uint64_t NextEvalcode(uint8_t evalcode);
+    uint64_t NextAddress(const std::string &address);
+    /** Skip the numbers of the dropped messages, so subscribers see the gap. */
+    void SkipEvalcodes(const CCEventGap &gap);
+    void SkipAddresses(const CCEventGap &gap);
+
+private:
+    std::mutex cs;
+    uint64_t evalcodeSequences[256];
+    std::map<std::string, uint64_t> addressSequences;
+};
+
+#endif // KOMODO_CCEVENTS_H
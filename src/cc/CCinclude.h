@@ -459,6 +459,8 @@ uint256 OraclesBatontxid(uint256 oracletxid,CPubKey pk);
 uint8_t DecodeOraclesCreateOpRet(const CScript &scriptPubKey,std::string &name,std::string &description,std::string &format);
 uint8_t DecodeOraclesOpRet(const CScript &scriptPubKey,uint256 &oracletxid,CPubKey &pk,int64_t &num);
 uint8_t DecodeOraclesData(const CScript &scriptPubKey,uint256 &oracletxid,uint256 &batontxid,CPubKey &pk,std::vector <uint8_t>&data);
+bool OraclesDataIndexEntry(const CTransaction &tx,int32_t height,COraclesDataIndexKey &key,COraclesDataIndexValue &sample);
+void OraclesDataIndexBlock(const CBlock &block,int32_t height,bool fConnect,std::vector<std::pair<COraclesDataIndexKey,COraclesDataIndexValue> > &vect);
 int32_t oracle_format(uint256 *hashp,int64_t *valp,char *str,uint8_t fmt,uint8_t *data,int32_t offset,int32_t datalen);
 /// \endcond
 
@@ -1102,6 +1104,7 @@ bool IsBlockHashInActiveChain(uint256 hashBlock);
 bool SubcallCCValidate(Eval* eval, uint8_t evalcode, const CTransaction& ctx, int32_t nIn);
 
 extern bool fUnspentCCIndex;  // if unspent cc index enabled
+extern bool fOraclesIndex;  // if oracles data index enabled
 
 /// decode condition to UniValue for decoderawtransaction
 UniValue CCDecodeMixedMode(const CC *cond);
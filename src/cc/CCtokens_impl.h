@@ -21,6 +21,7 @@
 #include "key_io.h"
 
 #include "CCtokens.h"
+#include "CCcoinselect.h"
 #include "CCassets.h"
 #include "CCassetsCore_impl.h"
 #include "importcoin.h"
@@ -83,83 +84,138 @@ CAmount AddTokenCCInputs(struct CCcontract_info *cp, CMutableTransaction &mtx, c
     int32_t n = 0; 
     const bool CC_INPUTS_TRUE = true;
     const char *funcname = __func__;
+    const bool fAddVins = total != 0 && maxinputs != 0;  // if it is not just to calc amount...
 
     if (cp->evalcode != V::EvalCode())
         LOGSTREAMFN(cctokens_log, CCLOG_INFO, stream << funcname << "()" << " warning: EVAL_TOKENS *cp is needed but used evalcode=" << (int)cp->evalcode << std::endl);  
 
-    // make lambda to use it for either index kind:
-    auto add_token_vin = [&](uint256 txhash, int32_t index, CAmount satoshis) -> void
+    // make lambda to use it for either pool, returns true when enough inputs are added
+    // outputs are checked with IsTokensvout once, the result is kept in the coin selection cache
+    auto add_token_vin = [&](const CCoinCandidate &candidate, std::vector<CCoinCandidate> &checked) -> bool
     {
-        CTransaction tx;
-        uint256 hashBlock;
+        uint256 txhash = candidate.outpoint.hash;
+        int32_t index = candidate.outpoint.n;
+        CAmount satoshis = candidate.nValue;
 
 		//if (it->second.satoshis < threshold)            // this should work also for non-fungible tokens (there should be only 1 satoshi for non-fungible token issue)
 		//	continue;
 
         if (satoshis == 0)
-            return;  // skip null vins 
+            return false;  // skip null vins 
 
         if (std::find_if(mtx.vin.begin(), mtx.vin.end(), [&](const CTxIn &vin){ return vin.prevout.hash == txhash && vin.prevout.n == index; }) != mtx.vin.end())  
-            return;  // vin already added
+            return false;  // vin already added
+
+        if (candidate.nStatus == CCoinCandidate::UNCHECKED)
+        {
+            CTransaction tx;
+            uint256 hashBlock;
+
+            if (myGetTransaction(txhash, tx, hashBlock) == 0 || index >= tx.vout.size())
+                return false;
 
-		if (myGetTransaction(txhash, tx, hashBlock) != 0)
-		{
             char destaddr[KOMODO_ADDRESS_BUFSIZE];
 			Getscriptaddress(destaddr, tx.vout[index].scriptPubKey);
+            checked.push_back(candidate);
 			if (strcmp(destaddr, tokenaddr) != 0 /*&& 
                 strcmp(destaddr, cp->unspendableCCaddr) != 0 &&   // TODO: check why this. Should not we add token inputs from unspendable cc addr if mypubkey is used?
                 strcmp(destaddr, cp->unspendableaddr2) != 0*/)      // or the logic is to allow to spend all available tokens (what about unspendableaddr3)?
-				return;
+            {
+                checked.back().nStatus = CCoinCandidate::REJECTED;
+				return false;
+            }
 			
             LOGSTREAM(cctokens_log, CCLOG_DEBUG1, stream << funcname << "()" << " checking tx vout destaddress=" << destaddr << " amount=" << tx.vout[index].nValue << std::endl);
 
-			if (IsTokensvout<V>(cp, NULL, tx, index, tokenid) > 0 && !myIsutxo_spentinmempool(ignoretxid, ignorevin, txhash, index))
-			{                
-                if (total != 0 && maxinputs != 0)  // if it is not just to calc amount...
-					mtx.vin.push_back(CTxIn(txhash, index, CScript()));
-
-				totalinputs += satoshis;
-                LOGSTREAM(cctokens_log, CCLOG_DEBUG1, stream << funcname << "()" << " adding input nValue=" << satoshis  << std::endl);
-				n++;
-
-				if ((total > 0 && totalinputs >= total) || (maxinputs > 0 && n >= maxinputs))
-					return;
-			}
-            else
+			if (IsTokensvout<V>(cp, NULL, tx, index, tokenid) <= 0)
             {
                 LOGSTREAM(cctokens_log, CCLOG_DEBUG1, stream << funcname << "()" << " function IsTokensvout returned non-positive for txid=" << txhash.GetHex() << " index=" << index << std::endl);
+                checked.back().nStatus = CCoinCandidate::REJECTED;
+                return false;
             }
-		}
+            checked.back().nStatus = CCoinCandidate::SPENDABLE;
+        }
+
+        if (myIsutxo_spentinmempool(ignoretxid, ignorevin, txhash, index))
+            return false;
+
+        if (fAddVins)
+            mtx.vin.push_back(CTxIn(txhash, index, CScript()));
+
+        totalinputs += satoshis;
+        LOGSTREAM(cctokens_log, CCLOG_DEBUG1, stream << funcname << "()" << " adding input nValue=" << satoshis  << std::endl);
+        n++;
+
+        return (total > 0 && totalinputs >= total) || (maxinputs > 0 && n >= maxinputs);
     }; // auto add_token_vin
 
-    if (fUnspentCCIndex && GetTokenOpReturnVersion<V>(NULL, tokenid) > 0)
+    // token outputs to tokenaddr from either index kind
+    CCoinSelectCache::Loader loader = [&](std::vector<CCoinCandidate> &loaded)
     {
-        std::vector<std::pair<CUnspentCCIndexKey, CUnspentCCIndexValue> > unspentOutputs;
-
-        SetCCunspentsCCIndex(unspentOutputs, tokenaddr, tokenid);
-        if (useMempool)  
-            AddCCunspentsCCIndexMempool(unspentOutputs, tokenaddr, tokenid);
-            
-        // threshold = total / (maxinputs != 0 ? maxinputs : CC_MAXVINS);   // let's not use threshold
-        LOGSTREAMFN(cctokens_log, CCLOG_DEBUG1, stream << funcname << "()" << " unspent ccindex found unspentOutputs=" << unspentOutputs.size() << std::endl);
-        for (std::vector<std::pair<CUnspentCCIndexKey, CUnspentCCIndexValue> >::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++)
-            add_token_vin(it->first.txhash, it->first.index, it->second.satoshis);
-    }
-    else
-    {
-        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+        if (fUnspentCCIndex && GetTokenOpReturnVersion<V>(NULL, tokenid) > 0)
+        {
+            std::vector<std::pair<CUnspentCCIndexKey, CUnspentCCIndexValue> > unspentOutputs;
 
-        if (useMempool)  
-	        SetCCunspentsWithMempool(unspentOutputs, (char*)tokenaddr, CC_INPUTS_TRUE);
+            SetCCunspentsCCIndex(unspentOutputs, tokenaddr, tokenid);
+            if (useMempool)  
+                AddCCunspentsCCIndexMempool(unspentOutputs, tokenaddr, tokenid);
+                
+            // threshold = total / (maxinputs != 0 ? maxinputs : CC_MAXVINS);   // let's not use threshold
+            LOGSTREAMFN(cctokens_log, CCLOG_DEBUG1, stream << funcname << "()" << " unspent ccindex found unspentOutputs=" << unspentOutputs.size() << std::endl);
+            for (std::vector<std::pair<CUnspentCCIndexKey, CUnspentCCIndexValue> >::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++)
+                loaded.push_back(CCoinCandidate(COutPoint(it->first.txhash, it->first.index), it->second.satoshis, CScript(), false, CCoinCandidate::UNCHECKED));
+        }
         else
-        	SetCCunspents(unspentOutputs, (char*)tokenaddr, CC_INPUTS_TRUE);
-            
-        LOGSTREAMFN(cctokens_log, CCLOG_DEBUG1, stream << funcname << "()" << " unspent index found unspentOutputs=" << unspentOutputs.size() << std::endl);
-        for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++)
-            add_token_vin(it->first.txhash, it->first.index, it->second.satoshis);
-    }
+        {
+            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
-	return totalinputs;
+            if (useMempool)  
+                SetCCunspentsWithMempool(unspentOutputs, (char*)tokenaddr, CC_INPUTS_TRUE);
+            else
+                SetCCunspents(unspentOutputs, (char*)tokenaddr, CC_INPUTS_TRUE);
+                
+            LOGSTREAMFN(cctokens_log, CCLOG_DEBUG1, stream << funcname << "()" << " unspent index found unspentOutputs=" << unspentOutputs.size() << std::endl);
+            for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++)
+                loaded.push_back(CCoinCandidate(COutPoint(it->first.txhash, it->first.index), it->second.satoshis, it->second.script, false, CCoinCandidate::UNCHECKED));
+        }
+    };
+
+    // nspv clients are not notified of new txns, they query the utxos each time
+    CCoinSelectCache *pcache = KOMODO_NSPV_SUPERLITE ? NULL : pcoinselectcache;
+    CCoinSelectKey key(tokenaddr, tokenid, V::EvalCode(), useMempool);
+    size_t nvins = mtx.vin.size();
+    bool fReload = false;
+    for (int32_t attempt = 0; attempt < CCINPUTS_SELECT_ATTEMPTS; attempt++)
+    {
+        std::vector<CCoinCandidate> candidates, checked;
+        bool fLoaded = true;
+        if (pcache != NULL)
+            fLoaded = pcache->GetCandidates(key, loader, fReload, fAddVins, candidates);
+        else
+            loader(candidates);
+
+        totalinputs = 0;
+        n = 0;
+        for (std::vector<CCoinCandidate>::const_iterator it = candidates.begin(); it != candidates.end(); it++)
+            if (add_token_vin(*it, checked))
+                break;
+        if (pcache != NULL && !checked.empty())
+            pcache->SetStatus(key, checked);
+
+        if (!fAddVins)
+            return totalinputs;
+        if (total > 0 && totalinputs < total && !fLoaded) {
+            // the cached pool may miss outputs of evicted mempool txns
+            mtx.vin.resize(nvins);
+            fReload = true;
+            continue;
+        }
+        if (ReserveTxInputs(mtx, nvins))
+            return totalinputs;
+        // another builder took some of the inputs meanwhile
+        mtx.vin.resize(nvins);
+    }
+	return 0;
 }
 
 // overload to get inputs for a pubkey
@@ -14,6 +14,7 @@
  ******************************************************************************/
 
 #include "CCinclude.h"
+#include "CCcoinselect.h"
 #include "CCtokens.h"
 #include "key_io.h"
 
@@ -1160,75 +1161,88 @@ CAmount AddNormalinputsLocal(CMutableTransaction& mtx, CPubKey mypk, CAmount tot
 
     //TokelRemoveTimeLockedCoins(vecOutputs, txLockTime);
 
-    sum = 0LL;
-    BOOST_FOREACH (const COutput& out, vecOutputs) {
-        if (out.fSpendable != 0 && (vecOutputs.size() < maxinputs || out.tx->vout[out.i].nValue > 0LL)) {  // threshold not used as may lead to insufficient inputs messages
-            txid = out.tx->GetHash();
-            vout = out.i;
-            if (myGetTransaction(txid, tx, hashBlock) != false && tx.vout.size() > 0 && vout < tx.vout.size() && tx.vout[vout].scriptPubKey.IsPayToCryptoCondition() == 0) 
-            {
+    int64_t nNow = GetTime();
+    size_t nvins = mtx.vin.size();
+    for (int32_t attempt = 0; attempt < CCINPUTS_SELECT_ATTEMPTS; attempt++) {
+        n = 0;
+        sum = totalinputs = 0;
+        memset(utxos, 0, CC_MAXVINS * sizeof(*utxos));
+        BOOST_FOREACH (const COutput& out, vecOutputs) {
+            if (out.fSpendable != 0 && (vecOutputs.size() < maxinputs || out.tx->vout[out.i].nValue > 0LL)) {  // threshold not used as may lead to insufficient inputs messages
+                txid = out.tx->GetHash();
+                vout = out.i;
+                if (out.tx->vout[vout].scriptPubKey.IsPayToCryptoCondition() == 0) 
                 {
-                    LOCK(cs_main);
-                    if (CoinbaseGetBlocksToMaturity(tx, hashBlock) > 0) {
-                        //std::cerr << __func__ << " skipping immature coinbase tx=" << txid.GetHex() << " COINBASE_MATURITY=" << COINBASE_MATURITY << std::endl;
-                        continue;
+                    // the wallet has the tx already, only coinbases are fetched for the maturity check
+                    if (out.tx->IsCoinBase()) {
+                        if (myGetTransaction(txid, tx, hashBlock) == false)
+                            continue;
+                        if (CoinbaseGetBlocksToMaturity(tx, hashBlock) > 0) {
+                            //std::cerr << __func__ << " skipping immature coinbase tx=" << txid.GetHex() << " COINBASE_MATURITY=" << COINBASE_MATURITY << std::endl;
+                            continue;
+                        }
+                    }
+                    if (pcoinselectcache != NULL && pcoinselectcache->IsReserving() && pcoinselectcache->IsReserved(COutPoint(txid, vout), nNow))
+                        continue; //added by another builder
+                    //fprintf(stderr,"check %.8f to vins array.%d of %d %s/v%d\n",(double)out.tx->vout[out.i].nValue/COIN,n,maxutxos,txid.GetHex().c_str(),(int32_t)vout);
+                    if (mtx.vin.size() > 0) {
+                        if (std::find_if(mtx.vin.begin(), mtx.vin.end(), [&](const CTxIn &vin){ return vin.prevout.hash == txid && vin.prevout.n == vout; }) != mtx.vin.end())  
+                            continue; //already added
+                    }
+                    if (n > 0) {
+                        if (std::find_if(utxos, utxos+n, [&](const CC_utxo &utxo){ return utxo.txid == txid && utxo.vout == vout; }) != utxos+n)  
+                            continue; //already added
+                    }
+                    if (myIsutxo_spentinmempool(ignoretxid, ignorevin, txid, vout) == 0) {
+                        up = &utxos[n++];
+                        up->txid = txid;
+                        up->nValue = out.tx->vout[out.i].nValue;
+                        up->vout = vout;
+                        sum += up->nValue;
+                        //fprintf(stderr,"add %.8f to vins array.%d of %d\n",(double)up->nValue/COIN,n,maxutxos);
+                        if (n >= maxinputs || sum >= total)
+                            break;
                     }
-                }
-                //fprintf(stderr,"check %.8f to vins array.%d of %d %s/v%d\n",(double)out.tx->vout[out.i].nValue/COIN,n,maxutxos,txid.GetHex().c_str(),(int32_t)vout);
-                if (mtx.vin.size() > 0) {
-                    if (std::find_if(mtx.vin.begin(), mtx.vin.end(), [&](const CTxIn &vin){ return vin.prevout.hash == txid && vin.prevout.n == vout; }) != mtx.vin.end())  
-                        continue; //already added
-                }
-                if (n > 0) {
-                    if (std::find_if(utxos, utxos+n, [&](const CC_utxo &utxo){ return utxo.txid == txid && utxo.vout == vout; }) != utxos+n)  
-                        continue; //already added
-                }
-                if (myIsutxo_spentinmempool(ignoretxid, ignorevin, txid, vout) == 0) {
-                    up = &utxos[n++];
-                    up->txid = txid;
-                    up->nValue = out.tx->vout[out.i].nValue;
-                    up->vout = vout;
-                    sum += up->nValue;
-                    //fprintf(stderr,"add %.8f to vins array.%d of %d\n",(double)up->nValue/COIN,n,maxutxos);
-                    if (n >= maxinputs || sum >= total)
-                        break;
                 }
             }
         }
-    }
-    remains = total;
-    for (int32_t i = 0; i < maxinputs && n > 0; i++) {
-        below = above = 0;
-        abovei = belowi = -1;
-        if (CC_vinselect(&abovei, &above, &belowi, &below, utxos, n, remains) < 0) {
-            printf("error finding unspent i.%d of %d, %.8f vs %.8f\n", i, n, (double)remains / COIN, (double)total / COIN);
-            free(utxos);
-            return (0);
+        remains = total;
+        for (int32_t i = 0; i < maxinputs && n > 0; i++) {
+            below = above = 0;
+            abovei = belowi = -1;
+            if (CC_vinselect(&abovei, &above, &belowi, &below, utxos, n, remains) < 0) {
+                printf("error finding unspent i.%d of %d, %.8f vs %.8f\n", i, n, (double)remains / COIN, (double)total / COIN);
+                break;
+            }
+            if (belowi < 0 || abovei >= 0)
+                ind = abovei;
+            else
+                ind = belowi;
+            if (ind < 0) {
+                printf("error finding unspent i.%d of %d, %.8f vs %.8f, abovei.%d belowi.%d ind.%d\n", i, n, (double)remains / COIN, (double)total / COIN, abovei, belowi, ind);
+                break;
+            }
+            up = &utxos[ind];
+            mtx.vin.push_back(CTxIn(up->txid, up->vout, CScript(), (4294967295U-1)));  // for TOKEL sequence non-final to allow CLTV spending
+            totalinputs += up->nValue;
+            remains -= up->nValue;
+            utxos[ind] = utxos[--n];
+            memset(&utxos[n], 0, sizeof(utxos[n]));
+            //fprintf(stderr,"totalinputs %.8f vs total %.8f i.%d vs max.%d\n",(double)totalinputs/COIN,(double)total/COIN,i,maxinputs);
+            if (totalinputs >= total || (i + 1) >= maxinputs)
+                break;
         }
-        if (belowi < 0 || abovei >= 0)
-            ind = abovei;
-        else
-            ind = belowi;
-        if (ind < 0) {
-            printf("error finding unspent i.%d of %d, %.8f vs %.8f, abovei.%d belowi.%d ind.%d\n", i, n, (double)remains / COIN, (double)total / COIN, abovei, belowi, ind);
+        if (totalinputs >= total && ReserveTxInputs(mtx, nvins)) {
             free(utxos);
-            return (0);
+            //fprintf(stderr,"return totalinputs %.8f\n",(double)totalinputs/COIN);
+            return (totalinputs);
         }
-        up = &utxos[ind];
-        mtx.vin.push_back(CTxIn(up->txid, up->vout, CScript(), (4294967295U-1)));  // for TOKEL sequence non-final to allow CLTV spending
-        totalinputs += up->nValue;
-        remains -= up->nValue;
-        utxos[ind] = utxos[--n];
-        memset(&utxos[n], 0, sizeof(utxos[n]));
-        //fprintf(stderr,"totalinputs %.8f vs total %.8f i.%d vs max.%d\n",(double)totalinputs/COIN,(double)total/COIN,i,maxinputs);
-        if (totalinputs >= total || (i + 1) >= maxinputs)
+        // not covered, or another builder took some of the inputs meanwhile: reserved ones are skipped on the next attempt
+        mtx.vin.resize(nvins);
+        if (totalinputs < total)
             break;
     }
     free(utxos);
-    if (totalinputs >= total) {
-        //fprintf(stderr,"return totalinputs %.8f\n",(double)totalinputs/COIN);
-        return (totalinputs);
-    }
 #endif
     return (0);
 }
@@ -1240,78 +1254,64 @@ CAmount AddNormalinputs2(CMutableTransaction &mtx, CAmount total, int32_t maxinp
     return AddNormalinputsRemote(mtx, mypk, total, maxinputs);
 }
 
-// has additional mypk param for nspv calls
-CAmount AddNormalinputsRemote(CMutableTransaction& mtx, CPubKey mypk, CAmount total, int32_t maxinputs, bool useMempool)
+// adds normal inputs from candidates to mtx with CC_vinselect, returns 0 and leaves mtx.vin as it was if total is not covered
+static CAmount SelectNormalinputs(CMutableTransaction& mtx, const std::vector<CCoinCandidate> &candidates, CAmount total, int32_t maxinputs)
 {
     int32_t abovei, belowi, ind, vout, n = 0;
-    CAmount sum, /*threshold,*/ above, below;
-    CAmount remains, nValue, totalinputs = 0;
-    char coinaddr[64];
+    CAmount sum, above, below;
+    CAmount remains, totalinputs = 0;
     uint256 txid, hashBlock;
     CTransaction tx;
     struct CC_utxo *utxos, *up;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs;
+    size_t nvins = mtx.vin.size();
 
-    if (KOMODO_NSPV_SUPERLITE)
-        return (NSPV_AddNormalinputs(mtx, mypk, total, maxinputs, &NSPV_U));
     utxos = (struct CC_utxo*)calloc(CC_MAXVINS, sizeof(*utxos));
-    if (maxinputs > CC_MAXVINS)
-        maxinputs = CC_MAXVINS;
-    /*if (maxinputs > 0)
-        threshold = total / maxinputs;
-    else
-        threshold = total;*/
     sum = 0;
-    Getscriptaddress(coinaddr, CScript() << vscript_t(mypk.begin(), mypk.end()) << OP_CHECKSIG);
-    if (!useMempool)
-        SetCCunspents(unspentOutputs, coinaddr, false);
-    else
-        SetCCunspentsWithMempool(unspentOutputs, coinaddr, false);
-
     int64_t txLockTime = (int64_t)komodo_next_tx_locktime();
 
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++) {
-        txid = it->first.txhash;
-        vout = (int32_t)it->first.index;
-        //if ( it->second.satoshis < threshold )
+    for (std::vector<CCoinCandidate>::const_iterator it = candidates.begin(); it != candidates.end(); it++) {
+        txid = it->outpoint.hash;
+        vout = (int32_t)it->outpoint.n;
+        //if ( it->nValue < threshold )
         //    continue;  // do not use threshold
-        if (it->second.satoshis == 0)
+        if (it->nValue == 0)
             continue; //skip null outputs
 
         // if CLTV tx check it is spendable already
         int64_t nLockTime;
-        if (it->second.script.IsCheckLockTimeVerify(&nLockTime) && !TokelCheckLockTimeHelper(nLockTime, txLockTime))
+        if (it->script.IsCheckLockTimeVerify(&nLockTime) && !TokelCheckLockTimeHelper(nLockTime, txLockTime))
             continue;
 
-        if (myGetTransaction(txid, tx, hashBlock) != 0 && tx.vout.size() > 0 && vout < tx.vout.size() && tx.vout[vout].scriptPubKey.IsPayToCryptoCondition() == 0) 
+        // only coinbases need the tx, to check maturity
+        if (it->fCoinbase)
         {
-            {
-                LOCK(cs_main);
-                if (CoinbaseGetBlocksToMaturity(tx, hashBlock) > 0) {
-                    //std::cerr << __func__ << " skipping immature coinbase tx=" << txid.GetHex() << " COINBASE_MATURITY=" << COINBASE_MATURITY << std::endl;
-                    continue;
-                }
-            }
-            //fprintf(stderr,"check %.8f to vins array.%d of %d %s/v%d\n",(double)tx.vout[vout].nValue/COIN,n,maxinputs,txid.GetHex().c_str(),(int32_t)vout);
-            if (mtx.vin.size() > 0) {
-                if (std::find_if(mtx.vin.begin(), mtx.vin.end(), [&](const CTxIn &vin){ return vin.prevout.hash == txid && vin.prevout.n == vout; }) != mtx.vin.end())  
-                    continue; //already added
-            }
-            if (n > 0) {
-                if (std::find_if(utxos, utxos+n, [&](const CC_utxo &utxo){ return utxo.txid == txid && utxo.vout == vout; }) != utxos+n)  
-                    continue; //already added
-            }
-            if (myIsutxo_spentinmempool(ignoretxid, ignorevin, txid, vout) == 0) {
-                up = &utxos[n++];
-                up->txid = txid;
-                up->nValue = it->second.satoshis;
-                up->vout = vout;
-                sum += up->nValue;
-                //fprintf(stderr,"add %.8f to vins array.%d of %d\n",(double)up->nValue/COIN,n,maxinputs);
-                if (n >= maxinputs || sum >= total)
-                    break;
+            if (myGetTransaction(txid, tx, hashBlock) == 0)
+                continue;
+            LOCK(cs_main);
+            if (CoinbaseGetBlocksToMaturity(tx, hashBlock) > 0) {
+                //std::cerr << __func__ << " skipping immature coinbase tx=" << txid.GetHex() << " COINBASE_MATURITY=" << COINBASE_MATURITY << std::endl;
+                continue;
             }
         }
+        //fprintf(stderr,"check %.8f to vins array.%d of %d %s/v%d\n",(double)it->nValue/COIN,n,maxinputs,txid.GetHex().c_str(),(int32_t)vout);
+        if (mtx.vin.size() > 0) {
+            if (std::find_if(mtx.vin.begin(), mtx.vin.end(), [&](const CTxIn &vin){ return vin.prevout.hash == txid && vin.prevout.n == vout; }) != mtx.vin.end())  
+                continue; //already added
+        }
+        if (n > 0) {
+            if (std::find_if(utxos, utxos+n, [&](const CC_utxo &utxo){ return utxo.txid == txid && utxo.vout == vout; }) != utxos+n)  
+                continue; //already added
+        }
+        if (myIsutxo_spentinmempool(ignoretxid, ignorevin, txid, vout) == 0) {
+            up = &utxos[n++];
+            up->txid = txid;
+            up->nValue = it->nValue;
+            up->vout = vout;
+            sum += up->nValue;
+            //fprintf(stderr,"add %.8f to vins array.%d of %d\n",(double)up->nValue/COIN,n,maxinputs);
+            if (n >= maxinputs || sum >= total)
+                break;
+        }
     }
 
     remains = total;
@@ -1320,8 +1320,7 @@ CAmount AddNormalinputsRemote(CMutableTransaction& mtx, CPubKey mypk, CAmount to
         abovei = belowi = -1;
         if (CC_vinselect(&abovei, &above, &belowi, &below, utxos, n, remains) < 0) {
             printf("error finding unspent i.%d of %d, %.8f vs %.8f\n", i, n, (double)remains / COIN, (double)total / COIN);
-            free(utxos);
-            return (0);
+            break;
         }
         if (belowi < 0 || abovei >= 0)
             ind = abovei;
@@ -1329,8 +1328,7 @@ CAmount AddNormalinputsRemote(CMutableTransaction& mtx, CPubKey mypk, CAmount to
             ind = belowi;
         if (ind < 0) {
             printf("error finding unspent i.%d of %d, %.8f vs %.8f, abovei.%d belowi.%d ind.%d\n", i, n, (double)remains / COIN, (double)total / COIN, abovei, belowi, ind);
-            free(utxos);
-            return (0);
+            break;
         }
         up = &utxos[ind];
         mtx.vin.push_back(CTxIn(up->txid, up->vout, CScript(), (4294967295U-1)));  // for TOKEL sequence non-final to allow CLTV spending
@@ -1347,6 +1345,67 @@ CAmount AddNormalinputsRemote(CMutableTransaction& mtx, CPubKey mypk, CAmount to
         //fprintf(stderr,"return totalinputs %.8f\n",(double)totalinputs/COIN);
         return (totalinputs);
     }
+    mtx.vin.resize(nvins);
+    return (0);
+}
+
+// has additional mypk param for nspv calls
+CAmount AddNormalinputsRemote(CMutableTransaction& mtx, CPubKey mypk, CAmount total, int32_t maxinputs, bool useMempool)
+{
+    char coinaddr[64];
+    std::vector<CCoinCandidate> candidates;
+
+    if (KOMODO_NSPV_SUPERLITE)
+        return (NSPV_AddNormalinputs(mtx, mypk, total, maxinputs, &NSPV_U));
+    if (maxinputs > CC_MAXVINS)
+        maxinputs = CC_MAXVINS;
+    /*if (maxinputs > 0)
+        threshold = total / maxinputs;
+    else
+        threshold = total;*/
+    Getscriptaddress(coinaddr, CScript() << vscript_t(mypk.begin(), mypk.end()) << OP_CHECKSIG);
+
+    // normal outputs of the address, each tx is fetched once when the pool is loaded
+    CCoinSelectCache::Loader loader = [&](std::vector<CCoinCandidate> &loaded) {
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs;
+        if (!useMempool)
+            SetCCunspents(unspentOutputs, coinaddr, false);
+        else
+            SetCCunspentsWithMempool(unspentOutputs, coinaddr, false);
+        for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++) {
+            uint256 txid = it->first.txhash, hashBlock;
+            int32_t vout = (int32_t)it->first.index;
+            CTransaction tx;
+            if (it->second.satoshis == 0)
+                continue; //skip null outputs
+            if (myGetTransaction(txid, tx, hashBlock) != 0 && tx.vout.size() > 0 && vout < tx.vout.size() && tx.vout[vout].scriptPubKey.IsPayToCryptoCondition() == 0) 
+                loaded.push_back(CCoinCandidate(COutPoint(txid, vout), it->second.satoshis, it->second.script, tx.IsCoinBase(), CCoinCandidate::SPENDABLE));
+        }
+    };
+
+    CCoinSelectKey key(coinaddr, zeroid, 0, useMempool);
+    bool fReload = false;
+    size_t nvins = mtx.vin.size();
+    for (int32_t attempt = 0; attempt < CCINPUTS_SELECT_ATTEMPTS; attempt++) {
+        bool fLoaded = true;
+        if (pcoinselectcache != NULL)
+            fLoaded = pcoinselectcache->GetCandidates(key, loader, fReload, true, candidates);
+        else {
+            candidates.clear();
+            loader(candidates);
+        }
+        CAmount totalinputs = SelectNormalinputs(mtx, candidates, total, maxinputs);
+        if (totalinputs == 0) {
+            if (fLoaded)
+                return (0);
+            fReload = true;  // the cached pool may miss outputs of evicted mempool txns
+            continue;
+        }
+        if (ReserveTxInputs(mtx, nvins))
+            return (totalinputs);
+        // another builder took some of the inputs meanwhile
+        mtx.vin.resize(nvins);
+    }
     return (0);
 }
 
@@ -1296,13 +1296,13 @@ int64_t correlate_price(int32_t height,int64_t *prices,int32_t n)
 
 int64_t OracleCorrelatedPrice(int32_t height,std::vector <int64_t> origprices)
 {
-    std::vector <int64_t> sorted; int32_t i,n; int64_t *prices,price;
+    int32_t i,n; int64_t *prices,price;
     if ( (n= origprices.size()) == 1 )
         return(origprices[0]);
     std::sort(origprices.begin(), origprices.end());
     prices = (int64_t *)calloc(n,sizeof(*prices));
     i = 0;
-    for (std::vector<int64_t>::const_iterator it=sorted.begin(); it!=sorted.end(); it++)
+    for (std::vector<int64_t>::const_iterator it=origprices.begin(); it!=origprices.end(); it++)
         prices[i++] = *it;
     price = correlate_price(height,prices,i);
     free(prices);
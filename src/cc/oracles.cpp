@@ -170,6 +170,38 @@ uint8_t DecodeOraclesData(const CScript& scriptPubKey, uint256& oracletxid, uint
     return (0);
 }
 
+// oracles data index entry of a data tx, keyed by the baton output of the publisher
+bool OraclesDataIndexEntry(const CTransaction& tx, int32_t height, COraclesDataIndexKey& key, COraclesDataIndexValue& sample)
+{
+    uint256 oracletxid, batontxid;
+    CPubKey pk;
+    std::vector<uint8_t> data;
+    std::vector<std::vector<unsigned char>> vSols;
+    CTxDestination vDest;
+    txnouttype txType = TX_PUBKEYHASH;
+
+    if (tx.vout.size() < 2 || tx.vout[1].nValue != CC_MARKER_VALUE)
+        return false;
+    if (DecodeOraclesData(tx.vout.back().scriptPubKey, oracletxid, batontxid, pk, data) != 'D')
+        return false;
+    if (GetAddressType(tx.vout[1].scriptPubKey, vDest, txType, vSols) != 3 || vSols.size() == 0)
+        return false;
+    key = COraclesDataIndexKey(oracletxid, vSols[0].size() == 20 ? uint160(vSols[0]) : Hash160(vSols[0]), height, tx.GetHash());
+    sample = COraclesDataIndexValue(pk, batontxid, data);
+    return true;
+}
+
+// oracles data index updates of a block: its samples when connecting, erasures of them when disconnecting
+void OraclesDataIndexBlock(const CBlock& block, int32_t height, bool fConnect, std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue>>& vect)
+{
+    for (const auto& tx : block.vtx) {
+        COraclesDataIndexKey key;
+        COraclesDataIndexValue sample;
+        if (OraclesDataIndexEntry(tx, height, key, sample))
+            vect.push_back(std::make_pair(key, fConnect ? sample : COraclesDataIndexValue()));
+    }
+}
+
 CPubKey OracleBatonPk(char* batonaddr, struct CCcontract_info* cp)
 {
     static secp256k1_context* ctx;
@@ -884,7 +916,31 @@ UniValue OracleDataSample(uint256 reforacletxid, uint256 txid)
     return (result);
 }
 
-UniValue OracleDataSamples(uint256 reforacletxid, char* batonaddr, int32_t num)
+// last num samples of a publisher from the oracles data index, mempool samples first
+static bool OracleDataSamplesIndex(UniValue& b, uint256 reforacletxid, char* batonaddr, std::string format, int32_t num, int32_t beginHeight, int32_t endHeight)
+{
+    std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue>> samples;
+    uint160 batonHash;
+    int type;
+
+    if (CBitcoinAddress(batonaddr).GetIndexKey(batonHash, type, true) == 0)
+        return false;
+    if (endHeight < 0)
+        mempool.getOraclesDataIndex(reforacletxid, batonHash, samples);
+    if (num == 0 || (int32_t)samples.size() < num) {
+        if (!GetOraclesDataIndex(reforacletxid, batonHash, samples, beginHeight, endHeight, num == 0 ? 0 : num - (int32_t)samples.size()))
+            return false;
+    }
+    for (std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue>>::iterator it = samples.begin(); it != samples.end() && (num == 0 || (int32_t)b.size() < num); it++) {
+        UniValue a(UniValue::VOBJ);
+        a.push_back(Pair("txid", it->first.txhash.GetHex()));
+        a.push_back(Pair("data", OracleFormat(it->second.data.data(), (int32_t)it->second.data.size(), (char*)format.c_str(), (int32_t)format.size())));
+        b.push_back(a);
+    }
+    return true;
+}
+
+UniValue OracleDataSamples(uint256 reforacletxid, char* batonaddr, int32_t num, int32_t beginHeight, int32_t endHeight)
 {
     UniValue result(UniValue::VOBJ), b(UniValue::VARR);
     CTransaction tx, oracletx;
@@ -902,6 +958,14 @@ UniValue OracleDataSamples(uint256 reforacletxid, char* batonaddr, int32_t num)
     result.push_back(Pair("result", "success"));
     if (myGetTransaction(reforacletxid, oracletx, hashBlock) != 0 && oracletx.vout.size() > 0) {
         if (DecodeOraclesCreateOpRet(oracletx.vout.back().scriptPubKey, name, description, format) == 'C') {
+            if (fOraclesIndex) {
+                if (!OracleDataSamplesIndex(b, reforacletxid, batonaddr, format, num, beginHeight, endHeight))
+                    CCERR_RESULT("oraclescc", CCLOG_INFO, stream << "cant read oracles data index for " << batonaddr);
+                result.push_back(Pair("samples", b));
+                return (result);
+            }
+            if (beginHeight >= 0 || endHeight >= 0)
+                CCERR_RESULT("oraclescc", CCLOG_INFO, stream << "height range needs -oraclesindex");
             std::vector<CTransaction> tmp_txs;
             myGet_mempool_txs(tmp_txs, EVAL_ORACLES, 'D');
             for (std::vector<CTransaction>::const_iterator it = tmp_txs.begin(); it != tmp_txs.end(); it++) {
@@ -15,6 +15,9 @@
 
 #include "CCPayments.h"
 
+#include <set>
+#include <thread>
+
 /* 
  0) txidopret <- allocation, scriptPubKey, opret
  1) create <-  locked_blocks, minrelease, list of txidopret
@@ -278,31 +281,33 @@ bool payments_lockedblocks(uint256 blockhash,int32_t lockedblocks,int32_t &block
 int32_t payments_getallocations(int32_t top, int32_t bottom, const std::vector<std::vector<uint8_t>> &excludeScriptPubKeys, mpz_t &mpzTotalAllocations, std::vector<CScript> &scriptPubKeys,  std::vector<int64_t> &allocations)
 {
     mpz_t mpzAllocation; int32_t i =0;
+    std::set<CScript> excluded;
+    for ( auto skipkey : excludeScriptPubKeys ) 
+        excluded.insert(CScript(skipkey.begin(), skipkey.end()));
+    if ( top > bottom )
+    {
+        scriptPubKeys.reserve(top-bottom);
+        allocations.reserve(top-bottom);
+    }
+    mpz_init(mpzAllocation); 
     for (int32_t j = bottom; j < vAddressSnapshot.size(); j++)
     {
         auto &address = vAddressSnapshot[j];
         CScript scriptPubKey = GetScriptForDestination(address.second); 
-        bool skip = false;
         // skip excluded addresses. 
-        for ( auto skipkey : excludeScriptPubKeys ) 
-        {
-            if ( scriptPubKey == CScript(skipkey.begin(), skipkey.end()) )
-                skip = true;
-        }
-        if ( !skip )
+        if ( excluded.count(scriptPubKey) == 0 )
         {
-            mpz_init(mpzAllocation); 
             i++;
             //fprintf(stderr, "address: %s nValue.%li \n", CBitcoinAddress(address.second).ToString().c_str(), address.first);
             scriptPubKeys.push_back(scriptPubKey);
             allocations.push_back(address.first);
             mpz_set_lli(mpzAllocation,address.first);
             mpz_add(mpzTotalAllocations,mpzTotalAllocations,mpzAllocation); 
-            mpz_clear(mpzAllocation);
         }
         if ( i+bottom == top ) 
             break; // we reached top amount to pay, it can be less than this, if less address exist on chain, return the number we got.
     }
+    mpz_clear(mpzAllocation);
     return(i);
 }
 
@@ -705,7 +710,51 @@ int32_t payments_parsehexdata(std::vector<uint8_t> &hexdata,cJSON *item,int32_t
     } else return(-1);
 }
 
-UniValue PaymentsRelease(struct CCcontract_info *cp,char *jsonstr)
+/** Recipients per thread when the shares of a release are computed in parallel. */
+static const int32_t PAYMENTS_SHARES_PER_THREAD = 256;
+
+// replaces the allocations in mtx.vout[1..m] by their share of amount, or by fixedshare if fFixedAmount.
+// large snapshots are split across threads, each with its own gmp temporaries. A share that does not fit
+// into an int64_t is set to -1, so the caller reports it in vout order.
+static void payments_shares(CMutableTransaction &mtx,int32_t m,int64_t amount,mpz_t &mpzTotalAllocations,bool fFixedAmount,int64_t fixedshare,PaymentsReleaseProgress *progress)
+{
+    auto shares = [&](int32_t begin,int32_t end)
+    {
+        mpz_t mpzAmount,mpzValue; mpz_init(mpzAmount); mpz_init(mpzValue);
+        mpz_set_lli(mpzAmount,amount);
+        for (int32_t i=begin; i<end; i++)
+        {
+            if ( fFixedAmount )
+                mtx.vout[i+1].nValue = fixedshare;
+            else
+            {
+                mpz_set_lli(mpzValue,mtx.vout[i+1].nValue);
+                mpz_mul(mpzValue,mpzValue,mpzAmount); 
+                mpz_tdiv_q(mpzValue,mpzValue,mpzTotalAllocations); 
+                mtx.vout[i+1].nValue = mpz_fits_slong_p(mpzValue) ? mpz_get_si2(mpzValue) : -1;
+            }
+        }
+        if ( progress != 0 )
+            progress->nShares += end - begin;
+        mpz_clear(mpzValue); mpz_clear(mpzAmount);
+    };
+    int32_t nThreads = std::min(GetNumCores(), m / PAYMENTS_SHARES_PER_THREAD);
+    if ( nThreads <= 1 )
+    {
+        shares(0,m);
+        return;
+    }
+    // mpzTotalAllocations is only read while the threads run
+    std::vector<std::thread> threads;
+    int32_t chunk = (m + nThreads - 1) / nThreads;
+    for (int32_t begin=chunk; begin<m; begin+=chunk)
+        threads.push_back(std::thread(shares,begin,std::min(m,begin+chunk)));
+    shares(0,std::min(m,chunk));
+    for (auto &thread : threads)
+        thread.join();
+}
+
+UniValue PaymentsRelease(struct CCcontract_info *cp,char *jsonstr,PaymentsReleaseProgress *progress)
 {
     LOCK(cs_main);
     CMutableTransaction tmpmtx,mtx = CreateNewContextualCMutableTransaction(Params().GetConsensus(),komodo_nextheight()); UniValue result(UniValue::VOBJ); uint256 createtxid,hashBlock,tokenid;
@@ -860,6 +909,15 @@ UniValue PaymentsRelease(struct CCcontract_info *cp,char *jsonstr)
                             free_json(params);
                         return(result);
                     }
+                    if ( fFixedAmount && top == bottom )
+                    {
+                        result.push_back(Pair("result","error"));
+                        result.push_back(Pair("error","invalid range top/bottom"));
+                        if ( params != 0 )
+                            free_json(params);
+                        return(result);
+                    }
+                    mtx.vout.reserve(mtx.vout.size() + allocations.size() + 1);
                     i = 0;
                     for ( auto allocation : allocations )
                     {
@@ -869,31 +927,24 @@ UniValue PaymentsRelease(struct CCcontract_info *cp,char *jsonstr)
                         i++;
                     }
                 }
+                if ( progress != 0 )
+                {
+                    progress->nRecipients = m;
+                    progress->nStage = PaymentsReleaseProgress::SHARES;
+                }
                 newamount = amount;
                 int64_t totalamountsent = 0;
-                mpz_t mpzAmount; mpz_init(mpzAmount); mpz_set_lli(mpzAmount,amount);
+                payments_shares(mtx,m,amount,mpzTotalAllocations,fFixedAmount,fFixedAmount ? amount / (top-bottom) : 0,progress);
                 for (i=0; i<m; i++)
                 {
-                    mpz_t mpzValue; mpz_init(mpzValue);
-                    if ( fFixedAmount )
-                        mtx.vout[i+1].nValue = amount / (top-bottom);
-                    else 
+                    if ( mtx.vout[i+1].nValue < 0 )
                     {
-                        mpz_set_lli(mpzValue,mtx.vout[i+1].nValue);
-                        mpz_mul(mpzValue,mpzValue,mpzAmount); 
-                        mpz_tdiv_q(mpzValue,mpzValue,mpzTotalAllocations); 
-                        if ( mpz_fits_slong_p(mpzValue) ) 
-                            mtx.vout[i+1].nValue = mpz_get_si2(mpzValue);
-                        else
-                        {
-                            result.push_back(Pair("result","error"));
-                            result.push_back(Pair("error","value too big, try releasing a smaller amount"));
-                            if ( params != 0 )
-                                free_json(params);
-                            return(result);
-                        } 
-                    }
-                    mpz_clear(mpzValue);
+                        result.push_back(Pair("result","error"));
+                        result.push_back(Pair("error","value too big, try releasing a smaller amount"));
+                        if ( params != 0 )
+                            free_json(params);
+                        return(result);
+                    } 
                     //fprintf(stderr, "[%i] nValue.%li minimum.%i scriptpubkey.%s\n", i, mtx.vout[i+1].nValue, minimum, HexStr(mtx.vout[i+1].scriptPubKey.begin(),mtx.vout[i+1].scriptPubKey.end()).c_str());
                     if ( mtx.vout[i+1].nValue < minimum )
                     {
@@ -918,7 +969,7 @@ UniValue PaymentsRelease(struct CCcontract_info *cp,char *jsonstr)
                 if ( totalamountsent < amount ) newamount = totalamountsent;
                 //int64_t temptst = mpz_get_si2(mpzTotalAllocations);
                 //fprintf(stderr, "checkamount RPC.%li totalallocations.%li\n",totalamountsent, temptst);
-                mpz_clear(mpzAmount); mpz_clear(mpzTotalAllocations);
+                mpz_clear(mpzTotalAllocations);
             }
             else
             {
@@ -928,9 +979,13 @@ UniValue PaymentsRelease(struct CCcontract_info *cp,char *jsonstr)
                     free_json(params);
                 return(result);
             }
+            if ( progress != 0 )
+                progress->nStage = PaymentsReleaseProgress::INPUTS;
             if ( (inputsum= AddPaymentsInputs(true,0,cp,mtx,txidpk,newamount+2*PAYMENTS_TXFEE,CC_MAXVINS/2,createtxid,lockedblocks,minrelease,blocksleft)) >= newamount+2*PAYMENTS_TXFEE )
             {
                 std::string rawtx;
+                if ( progress != 0 )
+                    progress->nStage = PaymentsReleaseProgress::SIGNING;
                 mtx.vout[0].nValue = inputsum - newamount - PAYMENTS_TXFEE; // only 1 txfee, so the minimum in this vout is a tx fee.
                 GetCCaddress1of2(cp,destaddr,Paymentspk,txidpk);
                 CCaddr1of2set(cp,Paymentspk,txidpk,cp->CCpriv,destaddr);
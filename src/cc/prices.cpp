@@ -71,15 +71,25 @@ GetKomodoEarlytxidScriptPub is on line #2080 of komodo_bitcoind.h
 
 #include "CCassets.h"
 #include "CCPrices.h"
+#include "pricesstore.h"
 
 #include <cstdlib>
 #include <gmp.h>
+#include <set>
+#include <tuple>
 
 #define IS_CHARINSTR(c, str) (std::string(str).find((char)(c)) != std::string::npos)
 
 #define NVOUT_CCMARKER 1
 #define NVOUT_NORMALMARKER 3
 
+// a bet takes the max (long) or min (short) synthetic price of this many blocks after its first height as its costbasis
+#ifndef TESTMODE
+#define PRICES_COSTBASIS_PERIOD PRICES_DAYWINDOW
+#else
+#define PRICES_COSTBASIS_PERIOD 7
+#endif
+
 typedef struct OneBetData {
     int64_t positionsize;
     int32_t firstheight;
@@ -1232,35 +1242,11 @@ int64_t prices_syntheticprice(std::vector<uint16_t> vec, int32_t height, int32_t
     return priceIndex;
 }
 
-// calculates costbasis and profit/loss for the bet
-int32_t prices_syntheticprofits(int64_t &costbasis, int32_t firstheight, int32_t height, int16_t leverage, std::vector<uint16_t> vec, int64_t positionsize,  int64_t &profits, int64_t &outprice)
+// calculates costbasis and profit/loss of the bet for the synthetic price at height
+static void prices_betprofits(int64_t &costbasis, int32_t firstheight, int32_t height, int16_t leverage, int64_t positionsize, int64_t price, int64_t &profits)
 {
-    int64_t price;
-#ifndef TESTMODE
-    const int32_t COSTBASIS_PERIOD = PRICES_DAYWINDOW;
-#else
-    const int32_t COSTBASIS_PERIOD = 7;
-#endif
-
-
-    if (height < firstheight) {
-        fprintf(stderr, "requested height is lower than bet firstheight.%d\n", height);
-        return -1;
-    }
-
-    int32_t minmax = (height < firstheight + COSTBASIS_PERIOD);  // if we are within 24h then use min or max value 
-
-    if ((price = prices_syntheticprice(vec, height, minmax, leverage)) < 0)
-    {
-        fprintf(stderr, "error getting synthetic price at height.%d\n", height);
-        return -1;
-    }
+    int32_t minmax = (height < firstheight + PRICES_COSTBASIS_PERIOD);  // if we are within 24h then use min or max value 
 
-    // clear lowest positions:
-    //price /= PRICES_POINTFACTOR;
-    //price *= PRICES_POINTFACTOR;
-    outprice = price;
-   
     if (minmax)    { // if we are within day window, set temp costbasis to max (or min) price value
         if (leverage > 0 && price > costbasis) {
             costbasis = price;  // set temp costbasis
@@ -1339,6 +1325,31 @@ int32_t prices_syntheticprofits(int64_t &costbasis, int32_t firstheight, int32_t
         profits = 0;
 
     //std::cerr << "prices_syntheticprofits() profits=" << profits << std::endl;
+}
+
+// calculates costbasis and profit/loss for the bet
+int32_t prices_syntheticprofits(int64_t &costbasis, int32_t firstheight, int32_t height, int16_t leverage, std::vector<uint16_t> vec, int64_t positionsize,  int64_t &profits, int64_t &outprice)
+{
+    int64_t price;
+
+    if (height < firstheight) {
+        fprintf(stderr, "requested height is lower than bet firstheight.%d\n", height);
+        return -1;
+    }
+
+    int32_t minmax = (height < firstheight + PRICES_COSTBASIS_PERIOD);  // if we are within 24h then use min or max value 
+
+    if ((price = prices_syntheticprice(vec, height, minmax, leverage)) < 0)
+    {
+        fprintf(stderr, "error getting synthetic price at height.%d\n", height);
+        return -1;
+    }
+
+    // clear lowest positions:
+    //price /= PRICES_POINTFACTOR;
+    //price *= PRICES_POINTFACTOR;
+    outprice = price;
+    prices_betprofits(costbasis, firstheight, height, leverage, positionsize, price, profits);
     return 0; //  (positionsize + addedbets + profits);
 }
 
@@ -1599,48 +1610,461 @@ UniValue PricesAddFunding(int64_t txfee, uint256 bettxid, int64_t amount)
     return(result);
 }
 
-// scan chain from the initial bet's first position upto the chain tip and calculate bet's costbasises and profits, breaks if rekt detected 
-int32_t prices_scanchain(std::vector<OneBetData> &bets, int16_t leverage, std::vector<uint16_t> vec, int64_t &lastprice, int32_t &endheight) {
+// updates the profits of the bets entered before height for the synthetic price, returns true if they are rekt together
+static bool prices_betsrekt(std::vector<OneBetData> &bets, int32_t height, int16_t leverage, int64_t price)
+{
+    int64_t totalposition = 0;
+    int64_t totalprofits = 0;
+
+    for (int i = 0; i < bets.size(); i++) {
+        if (height > bets[i].firstheight) {
+            prices_betprofits(bets[i].costbasis, bets[i].firstheight, height, leverage, bets[i].positionsize, price, bets[i].profits);
+            totalposition += bets[i].positionsize;
+            totalprofits += bets[i].profits;
+        }
+    }
+    int64_t equity = totalposition + totalprofits;
+    return equity <= (int64_t)((double)totalposition * prices_minmarginpercent(leverage));
+}
+
+// scan chain from beginheight upto toheight and calculate bet's costbasises and profits, breaks if rekt detected, returns 1 then
+// The bets have to hold their state as of beginheight - 1, a scan from the initial bet's first position starts at its firstheight + 1.
+// The synthetic price is computed once per height. Between the heights where a bet enters or still moves its costbasis the equity of
+// the bets only depends on the price, falling with it for longs and rising for shorts. Such a stretch is checked against its worst price
+// with a range query and skipped as a whole unless it holds the rekt height, which is then found by bisection.
+static int32_t prices_scanchain(std::vector<OneBetData> &bets, int16_t leverage, const std::vector<uint16_t> &vec, int64_t &lastprice, int32_t &endheight, int32_t beginheight, int32_t toheight) {
 
     if (bets.size() == 0)
         return -1;
 
-    bool stop = false;
-    for (int32_t height = bets[0].firstheight+1; ; height++)   // the last datum for 24h is the costbasis value
-    {
-        int64_t totalposition = 0;
-        int64_t totalprofits = 0;
+    std::vector<int64_t> prices;
+    int64_t price;
+    while (beginheight + (int32_t)prices.size() <= toheight) {
+        if ((price = prices_syntheticprice(vec, beginheight + (int32_t)prices.size(), 0, leverage)) < 0) {
+            LogPrint("prices", "%s: prices_syntheticprice returned -1 at height %d, finishing\n", __func__, beginheight + (int32_t)prices.size());
+            break;
+        }
+        prices.push_back(price);
+    }
 
-        // scan upto the chain tip
+    CPriceRangeTable table;
+    table.Build(beginheight, prices);
+    int32_t height = beginheight;
+    while (height < table.End())
+    {
+        int32_t nextheight = table.End();   // first height a bet enters at
+        bool fixed = true;
         for (int i = 0; i < bets.size(); i++) {
+            if (height <= bets[i].firstheight)
+                nextheight = std::min(nextheight, bets[i].firstheight + 1);
+            else if (height < bets[i].firstheight + PRICES_COSTBASIS_PERIOD)
+                fixed = false;
+        }
 
-            if (height > bets[i].firstheight) {
+        if (!fixed) {
+            endheight = height;
+            lastprice = table.At(height);
+            if (prices_betsrekt(bets, height, leverage, lastprice))
+                return 1;  // we are in loss
+            height++;
+            continue;
+        }
 
-                int32_t retcode = prices_syntheticprofits(bets[i].costbasis, bets[i].firstheight, height, leverage, vec, bets[i].positionsize, bets[i].profits, lastprice);
-                if (retcode < 0) {
-                    std::cerr << "prices_scanchain() prices_syntheticprofits returned -1, finishing..." << std::endl;
-                    stop = true;
-                    break;
-                }
-                totalposition += bets[i].positionsize;
-                totalprofits += bets[i].profits;
+        int32_t lastheight = nextheight - 1;
+        int64_t worstprice = leverage > 0 ? table.Min(height, lastheight) : table.Max(height, lastheight);
+        if (prices_betsrekt(bets, height, leverage, worstprice)) {
+            // the first height where the worst price so far gets the bets rekt
+            int32_t lo = height, hi = lastheight;
+            while (lo < hi) {
+                int32_t mid = lo + (hi - lo) / 2;
+                worstprice = leverage > 0 ? table.Min(height, mid) : table.Max(height, mid);
+                if (prices_betsrekt(bets, height, leverage, worstprice))
+                    hi = mid;
+                else
+                    lo = mid + 1;
             }
+            lastheight = lo;
         }
+        endheight = lastheight;
+        lastprice = table.At(lastheight);
+        if (prices_betsrekt(bets, lastheight, leverage, lastprice))
+            return 1;  // we are in loss
+        height = nextheight;
+    }
 
-        if (stop)
-            break;
+    return 0;
+}
 
-        endheight = height;
-        int64_t equity = totalposition + totalprofits;
-        if (equity <= (int64_t)((double)totalposition * prices_minmarginpercent(leverage)))
-        {   // we are in loss
-            break;
+// Scan state of a bet kept between calls. It is advanced on each connected block, so a query only scans the heights
+// that came since. Once no costbasis of the bets moves any more their equity only depends on the synthetic price, and
+// the state keeps the price at which they get rekt: a new block is then checked against it instead of re-simulating
+// the bets, and the open bets are indexed by it.
+struct PricesBetState {
+    std::vector<uint16_t> vec;
+    int16_t leverage;
+    std::vector<OneBetData> bets;   // costbasis and profits as of endheight
+    int32_t endheight;              // last scanned height
+    uint256 endhash;                // block at endheight, null before the first scanned height
+    int64_t lastprice;
+    bool isRekt;
+    bool profitsStale;              // profits are not updated to lastprice yet
+    int64_t liquidationprice;       // 0 while it is not known
+
+    PricesBetState() : leverage(0), endheight(0), lastprice(0), isRekt(false), profitsStale(false), liquidationprice(0) {}
+};
+
+// closed bets are remembered this many blocks after their close, to be restored if it is disconnected
+static const int32_t PRICES_CLOSED_DEPTH = 100;
+
+// the states of the bets closed in a connected block
+struct PricesClosedBets {
+    int32_t height;
+    std::vector<std::pair<uint256, PricesBetState> > bets;
+
+    PricesClosedBets() : height(0) {}
+};
+
+static CCriticalSection cs_pricesbets;
+static std::map<uint256, PricesBetState> pricesBetStates;
+// open bets by synthetic expression and the price they get rekt at
+static std::set<std::tuple<std::vector<uint16_t>, int64_t, uint256> > pricesLiquidationIndex;
+// by block hash
+static std::map<uint256, PricesClosedBets> pricesClosedBets;
+// bets that may be open but are not kept, loaded again by PricesLiquidations
+static std::set<uint256> pricesUntrackedBets;
+
+static void prices_unindexbet(const uint256 &bettxid, const PricesBetState &state)
+{
+    if (state.liquidationprice != 0)
+        pricesLiquidationIndex.erase(std::make_tuple(state.vec, state.liquidationprice, bettxid));
+}
+
+// true if all bets count at height and their costbasis does not move any more
+static bool prices_betsfixed(const std::vector<OneBetData> &bets, int32_t height)
+{
+    for (int i = 0; i < bets.size(); i++) {
+        if (height <= bets[i].firstheight || height < bets[i].firstheight + PRICES_COSTBASIS_PERIOD)
+            return false;
+    }
+    return true;
+}
+
+// finds the price at which the bets get rekt, the highest for longs and the lowest for shorts, 0 if there is none
+// The bets have to be fixed at height, then being rekt is monotone in the price.
+static int64_t prices_liquidationprice(std::vector<OneBetData> bets, int32_t height, int16_t leverage, int64_t lastprice)
+{
+    int64_t maxcostbasis = 0;
+    for (int i = 0; i < bets.size(); i++)
+        maxcostbasis = std::max(maxcostbasis, bets[i].costbasis);
+
+    if (leverage > 0) {
+        // a long loses all of its position at price 0
+        int64_t lo = 0, hi = lastprice;
+        if (!prices_betsrekt(bets, height, leverage, lo) || prices_betsrekt(bets, height, leverage, hi))
+            return 0;
+        while (hi - lo > 1) {
+            int64_t mid = lo + (hi - lo) / 2;
+            if (prices_betsrekt(bets, height, leverage, mid))
+                lo = mid;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+    else {
+        // a short loses all of its position at twice its costbasis
+        int64_t lo = lastprice, hi = 2 * maxcostbasis + 2;
+        if (hi <= lo || prices_betsrekt(bets, height, leverage, lo) || !prices_betsrekt(bets, height, leverage, hi))
+            return 0;
+        while (hi - lo > 1) {
+            int64_t mid = lo + (hi - lo) / 2;
+            if (prices_betsrekt(bets, height, leverage, mid))
+                hi = mid;
+            else
+                lo = mid;
         }
+        return hi;
     }
+}
+
+// updates the liquidation price and the index entry of the bet after its state changed
+static void prices_indexbet(const uint256 &bettxid, PricesBetState &state)
+{
+    prices_unindexbet(bettxid, state);
+    state.liquidationprice = 0;
+    if (!state.isRekt && !state.endhash.IsNull() && prices_betsfixed(state.bets, state.endheight + 1))
+        state.liquidationprice = prices_liquidationprice(state.bets, state.endheight + 1, state.leverage, state.lastprice);
+    if (state.liquidationprice != 0)
+        pricesLiquidationIndex.insert(std::make_tuple(state.vec, state.liquidationprice, bettxid));
+}
+
+// restarts the scan of the bets from their first height
+static void prices_resetbet(PricesBetState &state)
+{
+    for (int i = 0; i < state.bets.size(); i++) {
+        state.bets[i].costbasis = 0;
+        state.bets[i].profits = 0;
+    }
+    state.endheight = 0;
+    state.endhash.SetNull();
+    state.lastprice = 0;
+    state.isRekt = state.profitsStale = false;
+}
 
+// scans the bet upto toheight, from where its state left off
+static int32_t prices_advancebet(const uint256 &bettxid, PricesBetState &state, int32_t toheight)
+{
+    if (state.bets.size() == 0)
+        return -1;
+    // blocks the state was scanned on could have been disconnected
+    if (!state.endhash.IsNull() && (state.endheight > chainActive.Height() || chainActive[state.endheight]->GetBlockHash() != state.endhash))
+        prices_resetbet(state);
+
+    int32_t beginheight = state.endhash.IsNull() ? state.bets[0].firstheight + 1 : state.endheight + 1;   // the last datum for 24h is the costbasis value
+    if (!state.isRekt && beginheight <= toheight) {
+        int32_t endheight = state.endheight;
+        int32_t retcode = prices_scanchain(state.bets, state.leverage, state.vec, state.lastprice, endheight, beginheight, toheight);
+        if (retcode < 0)
+            return retcode;
+        if (endheight >= beginheight) {
+            state.endheight = endheight;
+            state.endhash = chainActive[endheight]->GetBlockHash();
+            state.profitsStale = false;
+        }
+        state.isRekt = (retcode == 1);
+    }
+    if (state.profitsStale) {
+        prices_betsrekt(state.bets, state.endheight, state.leverage, state.lastprice);
+        state.profitsStale = false;
+    }
+    prices_indexbet(bettxid, state);
     return 0;
 }
 
+// advances the bet by the block at height, the state has to be scanned upto the block before it
+static void prices_stepbet(const uint256 &bettxid, PricesBetState &state, int32_t height, const uint256 &blockhash)
+{
+    int64_t price;
+    if ((price = prices_syntheticprice(state.vec, height, 0, state.leverage)) < 0)
+        return;
+
+    if (state.liquidationprice != 0) {
+        // the price is on the safe side of the liquidation price, so the bets are not rekt and only their profits lag behind
+        if (state.leverage > 0 ? price > state.liquidationprice : price < state.liquidationprice) {
+            state.endheight = height;
+            state.endhash = blockhash;
+            state.lastprice = price;
+            state.profitsStale = true;
+            return;
+        }
+    }
+    state.isRekt = prices_betsrekt(state.bets, height, state.leverage, price);
+    state.endheight = height;
+    state.endhash = blockhash;
+    state.lastprice = price;
+    state.profitsStale = false;
+    prices_indexbet(bettxid, state);
+}
+
+// the bet a cashout or rekt tx closes
+static bool prices_closedbettxid(const CTransaction &tx, uint256 &bettxid)
+{
+    CPubKey pk;
+    int32_t lastheight;
+    int64_t costbasis, lastprice, liquidationprice, equity, exitfee;
+    return prices_finalopretdecode(tx.vout.back().scriptPubKey, bettxid, pk, lastheight, costbasis, lastprice, liquidationprice, equity, exitfee) != 0;
+}
+
+// tracks the bets opened, added to and closed in a connected block and advances the open bets by it
+void PricesBlockConnected(const CBlock &block, const CBlockIndex *pindex)
+{
+    int32_t height = pindex->GetHeight();
+    LOCK(cs_pricesbets);
+
+    for (std::map<uint256, PricesClosedBets>::iterator it = pricesClosedBets.begin(); it != pricesClosedBets.end(); ) {
+        if (it->second.height <= height - PRICES_CLOSED_DEPTH)
+            pricesClosedBets.erase(it++);
+        else
+            it++;
+    }
+
+    for (const CTransaction &tx : block.vtx) {
+        vscript_t vopret;
+        uint8_t funcId = PricesCheckOpret(tx, vopret);
+        if (funcId == 'B') {
+            PricesBetState state;
+            OneBetData bet1;
+            CPubKey pk;
+            int64_t firstprice;
+            uint256 tokenid;
+            if (prices_betopretdecode(tx.vout.back().scriptPubKey, pk, bet1.firstheight, bet1.positionsize, state.leverage, firstprice, state.vec, tokenid) == 'B' &&
+                pricesBetStates.count(tx.GetHash()) == 0) {
+                state.bets.push_back(bet1);
+                pricesBetStates[tx.GetHash()] = state;
+            }
+        }
+        else if (funcId == 'A') {
+            uint256 bettxid;
+            CPubKey pk;
+            OneBetData added;
+            std::map<uint256, PricesBetState>::iterator it;
+            if (prices_addopretdecode(tx.vout.back().scriptPubKey, bettxid, pk, added.positionsize) == 'A' && (it = pricesBetStates.find(bettxid)) != pricesBetStates.end()) {
+                added.firstheight = height;
+                prices_unindexbet(bettxid, it->second);
+                it->second.bets.push_back(added);
+                it->second.liquidationprice = 0;
+            }
+        }
+        else if (funcId == 'F' || funcId == 'R') {
+            uint256 bettxid;
+            if (prices_closedbettxid(tx, bettxid)) {
+                std::map<uint256, PricesBetState>::iterator it = pricesBetStates.find(bettxid);
+                if (it != pricesBetStates.end()) {
+                    PricesClosedBets &closed = pricesClosedBets[pindex->GetBlockHash()];
+                    closed.height = height;
+                    closed.bets.push_back(*it);
+                    prices_unindexbet(bettxid, it->second);
+                    pricesBetStates.erase(it);
+                }
+                pricesUntrackedBets.erase(bettxid);
+            }
+        }
+    }
+
+    uint256 prevhash = pindex->pprev != NULL ? pindex->pprev->GetBlockHash() : uint256();
+    for (std::map<uint256, PricesBetState>::iterator it = pricesBetStates.begin(); it != pricesBetStates.end(); it++) {
+        PricesBetState &state = it->second;
+        if (state.isRekt)
+            continue;
+        if (!state.endhash.IsNull() && state.endheight == height - 1 && state.endhash == prevhash)
+            prices_stepbet(it->first, state, height, pindex->GetBlockHash());
+        else
+            prices_advancebet(it->first, state, height);
+    }
+}
+
+// undoes PricesBlockConnected for a disconnected block: bets opened in it are dropped, bets closed in it are kept again
+// and the bets scanned over it are scanned again from their first height
+void PricesBlockDisconnected(const CBlock &block, const CBlockIndex *pindex)
+{
+    int32_t height = pindex->GetHeight();
+    LOCK(cs_pricesbets);
+
+    std::map<uint256, PricesClosedBets>::iterator itClosed = pricesClosedBets.find(pindex->GetBlockHash());
+    for (std::vector<CTransaction>::const_reverse_iterator itTx = block.vtx.rbegin(); itTx != block.vtx.rend(); itTx++) {
+        const CTransaction &tx = *itTx;
+        vscript_t vopret;
+        uint8_t funcId = PricesCheckOpret(tx, vopret);
+        if (funcId == 'F' || funcId == 'R') {
+            uint256 bettxid;
+            if (prices_closedbettxid(tx, bettxid)) {
+                bool restored = false;
+                if (itClosed != pricesClosedBets.end()) {
+                    for (size_t i = 0; i < itClosed->second.bets.size() && !restored; i++) {
+                        if (itClosed->second.bets[i].first == bettxid) {
+                            pricesBetStates[bettxid] = itClosed->second.bets[i].second;
+                            prices_indexbet(bettxid, pricesBetStates[bettxid]);
+                            restored = true;
+                        }
+                    }
+                }
+                // closed before its state was kept or too long ago
+                if (!restored && pricesBetStates.count(bettxid) == 0)
+                    pricesUntrackedBets.insert(bettxid);
+            }
+        }
+        else if (funcId == 'A') {
+            uint256 bettxid;
+            CPubKey pk;
+            int64_t positionsize;
+            std::map<uint256, PricesBetState>::iterator it;
+            if (prices_addopretdecode(tx.vout.back().scriptPubKey, bettxid, pk, positionsize) == 'A' && (it = pricesBetStates.find(bettxid)) != pricesBetStates.end()) {
+                std::vector<OneBetData> &bets = it->second.bets;
+                for (int i = (int)bets.size() - 1; i > 0; i--) {
+                    if (bets[i].firstheight == height && bets[i].positionsize == positionsize) {
+                        prices_unindexbet(bettxid, it->second);
+                        it->second.liquidationprice = 0;
+                        bets.erase(bets.begin() + i);
+                        break;
+                    }
+                }
+            }
+        }
+        else if (funcId == 'B') {
+            std::map<uint256, PricesBetState>::iterator it = pricesBetStates.find(tx.GetHash());
+            if (it != pricesBetStates.end()) {
+                prices_unindexbet(it->first, it->second);
+                pricesBetStates.erase(it);
+            }
+            pricesUntrackedBets.erase(tx.GetHash());
+        }
+    }
+    if (itClosed != pricesClosedBets.end())
+        pricesClosedBets.erase(itClosed);
+
+    for (std::map<uint256, PricesBetState>::iterator it = pricesBetStates.begin(); it != pricesBetStates.end(); it++) {
+        PricesBetState &state = it->second;
+        if (!state.endhash.IsNull() && state.endheight >= height) {
+            prices_resetbet(state);
+            prices_indexbet(it->first, state);
+        }
+    }
+}
+
+// number of bets kept for bettxid, -1 if it is not tracked
+int32_t PricesTrackedBets(uint256 bettxid)
+{
+    LOCK(cs_pricesbets);
+    std::map<uint256, PricesBetState>::const_iterator it = pricesBetStates.find(bettxid);
+    return it != pricesBetStates.end() ? (int32_t)it->second.bets.size() : -1;
+}
+
+// scans the bet from its kept state and returns its bets, last height and price
+static int32_t prices_scanbet(uint256 bettxid, BetInfo &betinfo)
+{
+    LOCK(cs_pricesbets);
+    bool tracked = pricesBetStates.count(bettxid) != 0;
+    PricesBetState &state = pricesBetStates[bettxid];
+
+    // the kept bets have to be the first ones of the bet, bets added since may only count after the scanned heights
+    bool same = state.vec == betinfo.vecparsed && state.leverage == betinfo.leverage && state.bets.size() > 0 && state.bets.size() <= betinfo.bets.size();
+    for (int i = 0; same && i < betinfo.bets.size(); i++) {
+        if (i < state.bets.size())
+            same = state.bets[i].positionsize == betinfo.bets[i].positionsize && state.bets[i].firstheight == betinfo.bets[i].firstheight;
+        else
+            same = state.endhash.IsNull() || betinfo.bets[i].firstheight >= state.endheight;
+    }
+    if (!same) {
+        prices_unindexbet(bettxid, state);
+        state = PricesBetState();
+        state.vec = betinfo.vecparsed;
+        state.leverage = betinfo.leverage;
+        state.bets = betinfo.bets;
+    }
+    else {
+        state.bets.insert(state.bets.end(), betinfo.bets.begin() + state.bets.size(), betinfo.bets.end());
+    }
+
+    int32_t retcode = prices_advancebet(bettxid, state, chainActive.Height());
+    if (retcode >= 0) {
+        betinfo.bets = state.bets;
+        if (!state.endhash.IsNull()) {
+            betinfo.lastheight = state.endheight;
+            betinfo.lastprice = state.lastprice;
+        }
+    }
+    // closed bets are not kept, a tracked one whose close is not in a block yet is looked at again
+    if (retcode < 0 || !betinfo.isOpen) {
+        if (tracked)
+            pricesUntrackedBets.insert(bettxid);
+        prices_unindexbet(bettxid, state);
+        pricesBetStates.erase(bettxid);
+    }
+    else
+        pricesUntrackedBets.erase(bettxid);
+    return retcode;
+}
+
 // pricescostbasis rpc impl: set cost basis (open price) for the bet (deprecated)
 UniValue PricesSetcostbasis(int64_t txfee, uint256 bettxid)
 {
@@ -1796,7 +2220,7 @@ int32_t prices_getbetinfo(uint256 bettxid, BetInfo &betinfo)
             }
 
 
-            if (prices_scanchain(betinfo.bets, betinfo.leverage, betinfo.vecparsed, betinfo.lastprice, betinfo.lastheight) < 0) {
+            if (prices_scanbet(bettxid, betinfo) < 0) {
                 return -4;
             }
 
@@ -2518,3 +2942,65 @@ UniValue PricesGetOrderbook()
 //    result.push_back(Pair("TotalLiabilities", ValueFromAmount(totalLiabilities)));
     return result;
 }
+
+// pricesliquidations rpc impl: open bets sorted by the synthetic price they get rekt at, for each expression
+UniValue PricesLiquidations()
+{
+    static bool tracked = false;
+    UniValue result(UniValue::VARR);
+
+    if (!tracked) {
+        // bets opened before the node started are only kept once they are looked at
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        struct CCcontract_info *cp, C;
+
+        cp = CCinit(&C, EVAL_PRICES);
+        SetAddressIndexOutputs(addressIndex, cp->normaladdr, false);        // old normal marker
+        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++)
+        {
+            BetInfo betinfo;
+            if (it->first.index == NVOUT_NORMALMARKER)
+                prices_getbetinfo(it->first.txhash, betinfo);
+        }
+        tracked = true;
+    }
+    // bets dropped from tracking while they may still be open
+    std::vector<uint256> vUntracked;
+    {
+        LOCK(cs_pricesbets);
+        vUntracked.assign(pricesUntrackedBets.begin(), pricesUntrackedBets.end());
+    }
+    for (const uint256 &bettxid : vUntracked) {
+        BetInfo betinfo;
+        prices_getbetinfo(bettxid, betinfo);
+    }
+
+    LOCK(cs_pricesbets);
+    UniValue group(UniValue::VOBJ), positions(UniValue::VARR);
+    for (auto it = pricesLiquidationIndex.begin(); it != pricesLiquidationIndex.end(); it++)
+    {
+        const std::vector<uint16_t> &vec = std::get<0>(*it);
+        if (it == pricesLiquidationIndex.begin() || vec != std::get<0>(*std::prev(it))) {
+            if (positions.size() > 0) {
+                group.push_back(Pair("positions", positions));
+                result.push_back(group);
+            }
+            group = UniValue(UniValue::VOBJ);
+            positions = UniValue(UniValue::VARR);
+            group.push_back(Pair("expression", prices_getsourceexpression(vec)));
+        }
+        const PricesBetState &state = pricesBetStates[std::get<2>(*it)];
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("bettxid", std::get<2>(*it).GetHex()));
+        entry.push_back(Pair("leverage", (int64_t)state.leverage));
+        entry.push_back(Pair("LiquidationPrice", ValueFromAmount(std::get<1>(*it))));
+        entry.push_back(Pair("LastPrice", ValueFromAmount(state.lastprice)));
+        entry.push_back(Pair("LastHeight", state.endheight));
+        positions.push_back(entry);
+    }
+    if (positions.size() > 0) {
+        group.push_back(Pair("positions", positions));
+        result.push_back(group);
+    }
+    return result;
+}
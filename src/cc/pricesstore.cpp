@@ -0,0 +1,223 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "pricesstore.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/** Room mapped beyond the end of the data, 65536 blocks of a symbol file. */
+static const uint64_t PRICES_MAP_RESERVE = 4 << 20;
+
+struct CPricesFile::Mapping
+{
+    const unsigned char* pbegin;
+    uint64_t nLength;
+
+    Mapping(const unsigned char* pbeginIn, uint64_t nLengthIn) : pbegin(pbeginIn), nLength(nLengthIn) {}
+    ~Mapping()
+    {
+#ifndef _WIN32
+        munmap((void*)pbegin, nLength);
+#endif
+    }
+};
+
+CPricesFile::CPricesFile() : fOpen(false), nSize(0), fpFallback(NULL)
+{
+}
+
+CPricesFile::~CPricesFile()
+{
+    Close();
+}
+
+bool CPricesFile::Open(const std::string& strPathIn)
+{
+    Close();
+    std::lock_guard<std::mutex> lock(csRemap);
+    strPath = strPathIn;
+    uint64_t nEnd = 0;
+#ifndef _WIN32
+    struct stat st;
+    if (stat(strPath.c_str(), &st) == 0)
+        nEnd = st.st_size;
+#endif
+    if (!Remap(nEnd)) {
+        // read with stdio instead
+        if ((fpFallback = fopen(strPath.c_str(), "rb")) == NULL)
+            return false;
+        fseek(fpFallback, 0, SEEK_END);
+        nEnd = ftell(fpFallback);
+    }
+    nSize.store(nEnd, std::memory_order_release);
+    fOpen.store(true, std::memory_order_release);
+    return true;
+}
+
+void CPricesFile::Close()
+{
+    std::lock_guard<std::mutex> lock(csRemap);
+    fOpen.store(false, std::memory_order_release);
+    std::atomic_store(&mapping, std::shared_ptr<const Mapping>());
+    if (fpFallback != NULL) {
+        fclose(fpFallback);
+        fpFallback = NULL;
+    }
+    nSize.store(0, std::memory_order_release);
+}
+
+bool CPricesFile::Remap(uint64_t nEnd)
+{
+#ifndef _WIN32
+    int fd = open(strPath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    // the reserve is never read before the file has grown into it
+    uint64_t nLength = nEnd + PRICES_MAP_RESERVE;
+    void* p = mmap(NULL, nLength, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        LogPrintf("%s: cannot map %s: %s\n", __func__, strPath, strerror(errno));
+        return false;
+    }
+    std::atomic_store(&mapping, std::shared_ptr<const Mapping>(new Mapping((const unsigned char*)p, nLength)));
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CPricesFile::Extend(uint64_t nEnd)
+{
+    std::lock_guard<std::mutex> lock(csRemap);
+    if (nEnd <= nSize.load(std::memory_order_relaxed))
+        return;
+    std::shared_ptr<const Mapping> m = std::atomic_load(&mapping);
+    if (m && nEnd > m->nLength && !Remap(nEnd)) {
+        // keep serving the records with stdio
+        std::atomic_store(&mapping, std::shared_ptr<const Mapping>());
+        if (fpFallback == NULL)
+            fpFallback = fopen(strPath.c_str(), "rb");
+    }
+    // the mapping covering nEnd is published before the new size
+    nSize.store(nEnd, std::memory_order_release);
+}
+
+bool CPricesFile::Read(void* buf, uint64_t nPos, size_t nBytes) const
+{
+    if (nPos + nBytes > Size())
+        return false;
+    std::shared_ptr<const Mapping> m = std::atomic_load(&mapping);
+    if (m && nPos + nBytes <= m->nLength) {
+        memcpy(buf, m->pbegin + nPos, nBytes);
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(csRemap);
+    if (fpFallback == NULL || fseek(fpFallback, nPos, SEEK_SET) != 0)
+        return false;
+    return fread(buf, 1, nBytes, fpFallback) == nBytes;
+}
+
+static int FloorLog2(uint32_t n)
+{
+    int k = 0;
+    while (n >>= 1)
+        k++;
+    return k;
+}
+
+void CPriceRangeTable::Build(int32_t nBeginIn, const std::vector<int64_t>& vals)
+{
+    nBegin = nBeginIn;
+    vValue = vals;
+    vPrefix.assign(1, 0);
+    vPrefix.reserve(vals.size() + 1);
+    for (size_t i = 0; i < vals.size(); i++)
+        vPrefix.push_back(vPrefix.back() + (uint64_t)vals[i]);
+
+    vBlockMin.clear();
+    vBlockMax.clear();
+    size_t nBlocks = (vals.size() + BLOCK - 1) / BLOCK;
+    if (nBlocks == 0)
+        return;
+    vBlockMin.push_back(std::vector<int64_t>(nBlocks));
+    vBlockMax.push_back(std::vector<int64_t>(nBlocks));
+    for (size_t b = 0; b < nBlocks; b++) {
+        std::vector<int64_t>::const_iterator first = vals.begin() + b * BLOCK;
+        std::vector<int64_t>::const_iterator last = vals.begin() + std::min(vals.size(), (b + 1) * BLOCK);
+        vBlockMin[0][b] = *std::min_element(first, last);
+        vBlockMax[0][b] = *std::max_element(first, last);
+    }
+    for (size_t k = 1; ((size_t)1 << k) <= nBlocks; k++) {
+        size_t nHalf = (size_t)1 << (k - 1);
+        size_t nRows = nBlocks - ((size_t)1 << k) + 1;
+        vBlockMin.push_back(std::vector<int64_t>(nRows));
+        vBlockMax.push_back(std::vector<int64_t>(nRows));
+        for (size_t b = 0; b < nRows; b++) {
+            vBlockMin[k][b] = std::min(vBlockMin[k - 1][b], vBlockMin[k - 1][b + nHalf]);
+            vBlockMax[k][b] = std::max(vBlockMax[k - 1][b], vBlockMax[k - 1][b + nHalf]);
+        }
+    }
+}
+
+int64_t CPriceRangeTable::Extreme(int32_t height1, int32_t height2, bool fMax) const
+{
+    int32_t i = height1 - nBegin, j = height2 - nBegin;
+    int32_t bi = i / BLOCK, bj = j / BLOCK;
+    int64_t result = vValue[i];
+    if (bi == bj) {
+        for (int32_t n = i + 1; n <= j; n++)
+            result = fMax ? std::max(result, vValue[n]) : std::min(result, vValue[n]);
+        return result;
+    }
+    // the partial blocks at both ends
+    for (int32_t n = i + 1; n < (bi + 1) * BLOCK; n++)
+        result = fMax ? std::max(result, vValue[n]) : std::min(result, vValue[n]);
+    for (int32_t n = bj * BLOCK; n <= j; n++)
+        result = fMax ? std::max(result, vValue[n]) : std::min(result, vValue[n]);
+    // the whole blocks in between, as two overlapping powers of two
+    if (bi + 1 <= bj - 1) {
+        int k = FloorLog2(bj - 1 - bi);
+        const std::vector<int64_t>& row = fMax ? vBlockMax[k] : vBlockMin[k];
+        int64_t left = row[bi + 1], right = row[bj - ((int32_t)1 << k)];
+        result = fMax ? std::max(result, std::max(left, right)) : std::min(result, std::min(left, right));
+    }
+    return result;
+}
+
+int64_t CPriceRangeTable::Min(int32_t height1, int32_t height2) const
+{
+    return Extreme(height1, height2, false);
+}
+
+int64_t CPriceRangeTable::Max(int32_t height1, int32_t height2) const
+{
+    return Extreme(height1, height2, true);
+}
+
+int64_t CPriceRangeTable::Sum(int32_t height1, int32_t height2) const
+{
+    return (int64_t)(vPrefix[height2 - nBegin + 1] - vPrefix[height1 - nBegin]);
+}
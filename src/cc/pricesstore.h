@@ -0,0 +1,112 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_PRICESSTORE_H
+#define KOMODO_PRICESSTORE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/**
+ * Read-only view of a prices file, see komodo_pricesinit.
+ *
+ * The file is written with stdio by komodo_pricesupdate, which reports the new
+ * end of the written data with Extend(). Readers copy records straight from a
+ * shared memory mapping and take no lock. The mapping reserves room beyond the
+ * end of the file so it is replaced only every few thousand blocks; a replaced
+ * mapping stays alive until the last reader using it is done.
+ *
+ * Where memory mapping is not available the records are read with stdio under
+ * a mutex, like before.
+ */
+class CPricesFile
+{
+public:
+    CPricesFile();
+    ~CPricesFile();
+
+    /** Map the file at strPathIn, the data ends at its current length. */
+    bool Open(const std::string& strPathIn);
+    void Close();
+    bool IsOpen() const { return fOpen.load(std::memory_order_acquire); }
+
+    /** The file now holds data up to nEnd, called by the writer after fflush. */
+    void Extend(uint64_t nEnd);
+    uint64_t Size() const { return nSize.load(std::memory_order_acquire); }
+
+    /** Copy nBytes at nPos into buf, false if they are beyond the end of the data. */
+    bool Read(void* buf, uint64_t nPos, size_t nBytes) const;
+
+private:
+    struct Mapping;
+
+    bool Remap(uint64_t nEnd);
+
+    std::string strPath;
+    std::atomic<bool> fOpen;
+    std::atomic<uint64_t> nSize;
+    std::shared_ptr<const Mapping> mapping;   //!< accessed with std::atomic_load/store only
+    mutable std::mutex csRemap;               //!< serializes Remap and the stdio fallback
+    FILE* fpFallback;
+};
+
+/**
+ * Range minimum, maximum and sum queries over the price of consecutive heights.
+ *
+ * The series is split into blocks of BLOCK heights. A sparse table over the
+ * block minima and maxima answers the whole blocks of a range with two lookups,
+ * the partial blocks at the ends are scanned. Prefix sums answer Sum(). Memory
+ * stays close to the size of the series itself, so a table over the whole price
+ * history of a chain is cheap to build.
+ *
+ * The prefix sums wrap around, Sum() is exact whenever the sum of the range fits
+ * into an int64_t.
+ */
+class CPriceRangeTable
+{
+public:
+    static const int32_t BLOCK = 32;
+
+    CPriceRangeTable() : nBegin(0) {}
+
+    /** Index vals, where vals[i] is the price at height nBeginIn + i. */
+    void Build(int32_t nBeginIn, const std::vector<int64_t>& vals);
+
+    int32_t Begin() const { return nBegin; }
+    int32_t End() const { return nBegin + (int32_t)vValue.size(); }
+    bool Contains(int32_t height1, int32_t height2) const { return nBegin <= height1 && height1 <= height2 && height2 < End(); }
+
+    /** Queries over the inclusive range [height1, height2], which has to be Contains()ed. */
+    int64_t At(int32_t height) const { return vValue[height - nBegin]; }
+    int64_t Min(int32_t height1, int32_t height2) const;
+    int64_t Max(int32_t height1, int32_t height2) const;
+    int64_t Sum(int32_t height1, int32_t height2) const;
+
+private:
+    int32_t nBegin;
+    std::vector<int64_t> vValue;
+    std::vector<uint64_t> vPrefix;                 //!< vPrefix[i] is the sum of the first i values
+    std::vector<std::vector<int64_t> > vBlockMin;  //!< vBlockMin[k][b] covers blocks b .. b + 2^k - 1
+    std::vector<std::vector<int64_t> > vBlockMax;
+
+    int64_t Extreme(int32_t height1, int32_t height2, bool fMax) const;
+};
+
+#endif // KOMODO_PRICESSTORE_H
@@ -19,9 +19,78 @@
  ******************************************************************************/
 
 #include "chain.h"
+#include "main.h"
+#include "memusage.h"
+#include "txdb.h"
+
+#include <mutex>
 
 using namespace std;
 
+/**
+ * Guard nSolution of entries already in mapBlockIndex, RPC and getheaders read headers without cs_main.
+ * Sharded by entry so the memory stats walk over every entry does not serialize with them.
+ */
+static const size_t BLOCK_SOLUTION_LOCKS = 64;
+static std::mutex csBlockSolution[BLOCK_SOLUTION_LOCKS];
+
+static std::mutex& SolutionLock(const CBlockIndex* pindex)
+{
+    return csBlockSolution[((uintptr_t)pindex / sizeof(CBlockIndex)) % BLOCK_SOLUTION_LOCKS];
+}
+
+bool CBlockIndex::HasSolution() const
+{
+    std::lock_guard<std::mutex> lock(SolutionLock(this));
+    return !nSolution.empty();
+}
+
+void CBlockIndex::TrimSolution()
+{
+    std::lock_guard<std::mutex> lock(SolutionLock(this));
+    std::vector<unsigned char>().swap(nSolution);
+}
+
+bool CBlockIndex::LoadSolution()
+{
+    std::vector<unsigned char> vchSolution;
+    if (!ReadSolution(vchSolution))
+        return false;
+    std::lock_guard<std::mutex> lock(SolutionLock(this));
+    nSolution.swap(vchSolution);
+    return true;
+}
+
+size_t CBlockIndex::SolutionMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(SolutionLock(this));
+    return memusage::DynamicUsage(nSolution);
+}
+
+bool CBlockIndex::ReadSolution(std::vector<unsigned char>& vchSolution) const
+{
+    {
+        std::lock_guard<std::mutex> lock(SolutionLock(this));
+        if (!nSolution.empty()) {
+            vchSolution = nSolution;
+            return true;
+        }
+    }
+    CDiskBlockIndex diskindex;
+    if (pblocktree == NULL || !pblocktree->ReadDiskBlockIndex(GetBlockHash(), diskindex))
+        return false;
+    vchSolution.swap(diskindex.nSolution);
+    return true;
+}
+
+std::vector<unsigned char> CBlockIndex::GetSolution() const
+{
+    std::vector<unsigned char> vchSolution;
+    if (!ReadSolution(vchSolution))
+        throw std::runtime_error(strprintf("%s: failed to read block index entry %s", __func__, GetBlockHash().ToString()));
+    return vchSolution;
+}
+
 /**
  * CChain implementation
  */
@@ -305,6 +305,7 @@ public:
     unsigned int nTime;
     unsigned int nBits;
     uint256 nNonce;
+    //! Empty once trimmed from memory, use GetSolution() unless the entry was just built
     std::vector<unsigned char> nSolution;
 
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
@@ -389,7 +390,39 @@ public:
         return ret;
     }
 
+    //! Whether the Equihash solution is held in memory
+    bool HasSolution() const;
+
+    //! Drop the in-memory solution, only once this entry is stored in the block tree database
+    void TrimSolution();
+
+    //! Read a trimmed solution back into memory, false if the entry is not in the block tree database
+    bool LoadSolution();
+
+    //! Heap bytes of the in-memory solution
+    size_t SolutionMemoryUsage() const;
+
+    //! The Equihash solution, read back from the block tree database if it was trimmed, false on a read failure
+    bool ReadSolution(std::vector<unsigned char>& vchSolution) const;
+
+    //! As ReadSolution, throws on a read failure
+    std::vector<unsigned char> GetSolution() const;
+
+    bool ReadBlockHeader(CBlockHeader& block) const
+    {
+        block = GetBlockHeaderWithoutSolution();
+        return ReadSolution(block.nSolution);
+    }
+
     CBlockHeader GetBlockHeader() const
+    {
+        CBlockHeader block = GetBlockHeaderWithoutSolution();
+        block.nSolution      = GetSolution();
+        return block;
+    }
+
+    //! The header fields kept in memory, for callers that never look at the solution
+    CBlockHeader GetBlockHeaderWithoutSolution() const
     {
         CBlockHeader block;
         block.nVersion       = nVersion;
@@ -400,7 +433,6 @@ public:
         block.nTime          = nTime;
         block.nBits          = nBits;
         block.nNonce         = nNonce;
-        block.nSolution      = nSolution;
         return block;
     }
 
@@ -470,13 +502,13 @@ public:
 
     int32_t GetVerusPOSTarget() const
     {
-        return GetBlockHeader().GetVerusPOSTarget();
+        return GetBlockHeaderWithoutSolution().GetVerusPOSTarget();
     }
 
     bool IsVerusPOSBlock() const
     {
         if ( ASSETCHAINS_LWMAPOS != 0 )
-            return GetBlockHeader().IsVerusPOSBlock();
+            return GetBlockHeaderWithoutSolution().IsVerusPOSBlock();
         else return(0);
     }
 };
@@ -0,0 +1,96 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "chainsnapshot.h"
+
+#include "chain.h"
+#include "komodo_defs.h"
+#include "main.h"
+#include "sync.h"
+
+#include <mutex>
+
+static std::mutex csSnapshot;
+static CChainSnapshotRef currentSnapshot;
+static thread_local CChainSnapshotRef threadSnapshot;
+
+CChainSnapshot::CChainSnapshot() :
+    pindexTip(NULL), nHeight(-1), nMedianTimePast(0), nNotarizedHeight(0), nPrevMoMHeight(0)
+{
+}
+
+CChainSnapshot::CChainSnapshot(CBlockIndex* pindex) :
+    pindexTip(pindex), nHeight(-1), nMedianTimePast(0), nNotarizedHeight(0), nPrevMoMHeight(0)
+{
+    if (pindex != NULL) {
+        nHeight = pindex->GetHeight();
+        hashTip = pindex->GetBlockHash();
+        nMedianTimePast = pindex->GetMedianTimePast();
+    }
+    nNotarizedHeight = komodo_notarized_height(&nPrevMoMHeight, &notarizedHash, &notarizedDestTxid);
+}
+
+CBlockIndex* CChainSnapshot::operator[](int nHeightIn) const
+{
+    if (pindexTip == NULL || nHeightIn < 0 || nHeightIn > nHeight)
+        return NULL;
+    return pindexTip->GetAncestor(nHeightIn);
+}
+
+bool CChainSnapshot::Contains(const CBlockIndex* pindex) const
+{
+    return pindex != NULL && (*this)[pindex->GetHeight()] == pindex;
+}
+
+CBlockIndex* CChainSnapshot::Next(const CBlockIndex* pindex) const
+{
+    if (Contains(pindex))
+        return (*this)[pindex->GetHeight() + 1];
+    return NULL;
+}
+
+void PublishChainSnapshot(CBlockIndex* pindexTip)
+{
+    CChainSnapshotRef snapshot = std::make_shared<const CChainSnapshot>(pindexTip);
+    std::lock_guard<std::mutex> lock(csSnapshot);
+    currentSnapshot = snapshot;
+}
+
+CChainSnapshotRef GetChainSnapshot()
+{
+    if (threadSnapshot)
+        return threadSnapshot;
+    {
+        std::lock_guard<std::mutex> lock(csSnapshot);
+        if (currentSnapshot)
+            return currentSnapshot;
+    }
+    // nothing published yet (still loading the block index)
+    LOCK(cs_main);
+    PublishChainSnapshot(chainActive.Tip());
+    std::lock_guard<std::mutex> lock(csSnapshot);
+    return currentSnapshot;
+}
+
+CChainSnapshotScope::CChainSnapshotScope() : prev(threadSnapshot)
+{
+    pinned = GetChainSnapshot();
+    threadSnapshot = pinned;
+}
+
+CChainSnapshotScope::~CChainSnapshotScope()
+{
+    threadSnapshot = prev;
+}
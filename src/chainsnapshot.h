@@ -0,0 +1,90 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_CHAINSNAPSHOT_H
+#define KOMODO_CHAINSNAPSHOT_H
+
+#include "uint256.h"
+
+#include <memory>
+#include <stdint.h>
+
+class CBlockIndex;
+
+/**
+ * Immutable view of the active chain as of one tip change.
+ *
+ * A new snapshot is published by UpdateTip while cs_main is held; readers take
+ * a reference with GetChainSnapshot() and can then answer height, hash and
+ * main-chain membership questions without cs_main. This works because block
+ * index entries are never freed while the node runs and their pprev/pskip
+ * links never change, so walking back from a published tip stays valid even
+ * after chainActive has moved on.
+ *
+ * Coins are not part of the snapshot: pcoinsTip is a mutable cache without
+ * versions, so coin lookups still take cs_main, just for the lookup itself.
+ */
+class CChainSnapshot
+{
+public:
+    CBlockIndex* pindexTip;
+    int nHeight;
+    uint256 hashTip;
+    int64_t nMedianTimePast;
+
+    // notarization state at the time of the tip change, see komodo_notarized_height
+    int32_t nNotarizedHeight;
+    int32_t nPrevMoMHeight;
+    uint256 notarizedHash;
+    uint256 notarizedDestTxid;
+
+    CChainSnapshot();
+    explicit CChainSnapshot(CBlockIndex* pindex);
+
+    /** Block at nHeightIn on this chain, or NULL if out of range. */
+    CBlockIndex* operator[](int nHeightIn) const;
+    bool Contains(const CBlockIndex* pindex) const;
+    /** Successor of pindex on this chain, or NULL if pindex is the tip or not on it. */
+    CBlockIndex* Next(const CBlockIndex* pindex) const;
+};
+
+typedef std::shared_ptr<const CChainSnapshot> CChainSnapshotRef;
+
+/**
+ * Publish the snapshot for a new tip (NULL when the chain is unloaded). Called
+ * wherever chainActive's tip is set, with cs_main held or before threads start.
+ */
+void PublishChainSnapshot(CBlockIndex* pindexTip);
+
+/**
+ * The snapshot RPC handlers should read from. Inside a command flagged
+ * chainSnapshot in the RPC table this is the one pinned when the command
+ * started, so a whole call sees a single tip; elsewhere it is the latest one.
+ */
+CChainSnapshotRef GetChainSnapshot();
+
+/** Pins the current snapshot for the calling thread while in scope. */
+class CChainSnapshotScope
+{
+public:
+    CChainSnapshotScope();
+    ~CChainSnapshotScope();
+
+private:
+    CChainSnapshotRef pinned;
+    CChainSnapshotRef prev;
+};
+
+#endif // KOMODO_CHAINSNAPSHOT_H
@@ -107,11 +107,11 @@ CCoinsViewCache::~CCoinsViewCache()
 }
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
-    return memusage::DynamicUsage(cacheCoins) +
-           memusage::DynamicUsage(cacheSproutAnchors) +
-           memusage::DynamicUsage(cacheSaplingAnchors) +
-           memusage::DynamicUsage(cacheSproutNullifiers) +
-           memusage::DynamicUsage(cacheSaplingNullifiers) +
+    return cacheCoins.DynamicMemoryUsage() +
+           cacheSproutAnchors.DynamicMemoryUsage() +
+           cacheSaplingAnchors.DynamicMemoryUsage() +
+           cacheSproutNullifiers.DynamicMemoryUsage() +
+           cacheSaplingNullifiers.DynamicMemoryUsage() +
            cachedCoinsUsage;
 }
 
@@ -0,0 +1,236 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "coinsflush.h"
+
+#include "txdb.h"
+#include "util.h"
+#include "utiltime.h"
+
+void CCoinsViewAsyncFlush::FrozenLayer::swap(FrozenLayer& other)
+{
+    coins.swap(other.coins);
+    std::swap(hashBlock, other.hashBlock);
+    std::swap(hashSproutAnchor, other.hashSproutAnchor);
+    std::swap(hashSaplingAnchor, other.hashSaplingAnchor);
+    sproutAnchors.swap(other.sproutAnchors);
+    saplingAnchors.swap(other.saplingAnchors);
+    sproutNullifiers.swap(other.sproutNullifiers);
+    saplingNullifiers.swap(other.saplingNullifiers);
+}
+
+CCoinsViewAsyncFlush::CCoinsViewAsyncFlush(CCoinsView* baseIn, CCoinsViewDB* dbIn) :
+    CCoinsViewBacked(baseIn), db(dbIn), fWriting(false), fFailed(false), fStop(false)
+{
+    writer = std::thread(&CCoinsViewAsyncFlush::ThreadWriter, this);
+}
+
+CCoinsViewAsyncFlush::~CCoinsViewAsyncFlush()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    cond.notify_all();
+    writer.join();
+}
+
+void CCoinsViewAsyncFlush::ThreadWriter()
+{
+    RenameThread("komodo-coinsflush");
+    std::unique_lock<std::mutex> lock(cs);
+    while (true) {
+        // a pending layer is still written when stopping
+        cond.wait(lock, [this] { return fWriting || fStop; });
+        if (!fWriting)
+            return;
+
+        // readers only look at the frozen layer while it is written, so it can be used without cs
+        lock.unlock();
+        int64_t nStart = GetTimeMicros();
+        bool fOk = false;
+        try {
+            fOk = db->WriteFlush(frozen.coins, frozen.hashBlock, frozen.hashSproutAnchor, frozen.hashSaplingAnchor,
+                                 frozen.sproutAnchors, frozen.saplingAnchors, frozen.sproutNullifiers, frozen.saplingNullifiers);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        if (!fOk)
+            LogPrintf("%s: failed to write to coin database\n", __func__);
+        LogPrint("bench", "    - Background coins flush of %u transactions: %.2fms\n", (unsigned int)frozen.coins.size(), (GetTimeMicros() - nStart) * 0.001);
+        lock.lock();
+
+        {
+            // the entries are on disk now, free them after releasing cs
+            FrozenLayer done;
+            frozen.swap(done);
+            fWriting = false;
+            if (!fOk)
+                fFailed = true;
+            cond.notify_all();
+            lock.unlock();
+        }
+        lock.lock();
+    }
+}
+
+bool CCoinsViewAsyncFlush::BatchWrite(CCoinsMap &mapCoins,
+                                      const uint256 &hashBlock,
+                                      const uint256 &hashSproutAnchor,
+                                      const uint256 &hashSaplingAnchor,
+                                      CAnchorsSproutMap &mapSproutAnchors,
+                                      CAnchorsSaplingMap &mapSaplingAnchors,
+                                      CNullifiersMap &mapSproutNullifiers,
+                                      CNullifiersMap &mapSaplingNullifiers)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    if (fWriting) {
+        int64_t nStart = GetTimeMicros();
+        cond.wait(lock, [this] { return !fWriting; });
+        LogPrint("bench", "    - Wait for previous coins flush: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
+    }
+    if (fFailed)
+        return false;
+
+    // The frozen layer is empty, so the caller gets empty maps back
+    frozen.coins.swap(mapCoins);
+    frozen.sproutAnchors.swap(mapSproutAnchors);
+    frozen.saplingAnchors.swap(mapSaplingAnchors);
+    frozen.sproutNullifiers.swap(mapSproutNullifiers);
+    frozen.saplingNullifiers.swap(mapSaplingNullifiers);
+    frozen.hashBlock = hashBlock;
+    frozen.hashSproutAnchor = hashSproutAnchor;
+    frozen.hashSaplingAnchor = hashSaplingAnchor;
+    fWriting = true;
+    cond.notify_all();
+    return true;
+}
+
+bool CCoinsViewAsyncFlush::Sync() const
+{
+    std::unique_lock<std::mutex> lock(cs);
+    cond.wait(lock, [this] { return !fWriting; });
+    return !fFailed;
+}
+
+bool CCoinsViewAsyncFlush::IsWriting() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return fWriting;
+}
+
+bool CCoinsViewAsyncFlush::IsHealthy() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return !fFailed;
+}
+
+bool CCoinsViewAsyncFlush::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        CAnchorsSproutMap::const_iterator it = frozen.sproutAnchors.find(rt);
+        if (it != frozen.sproutAnchors.end() && (it->second.flags & CAnchorsSproutCacheEntry::DIRTY)) {
+            if (!it->second.entered)
+                return false;
+            tree = it->second.tree;
+            return true;
+        }
+    }
+    return base->GetSproutAnchorAt(rt, tree);
+}
+
+bool CCoinsViewAsyncFlush::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        CAnchorsSaplingMap::const_iterator it = frozen.saplingAnchors.find(rt);
+        if (it != frozen.saplingAnchors.end() && (it->second.flags & CAnchorsSaplingCacheEntry::DIRTY)) {
+            if (!it->second.entered)
+                return false;
+            tree = it->second.tree;
+            return true;
+        }
+    }
+    return base->GetSaplingAnchorAt(rt, tree);
+}
+
+bool CCoinsViewAsyncFlush::GetNullifier(const uint256 &nullifier, ShieldedType type) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        const CNullifiersMap& nullifiers = type == SPROUT ? frozen.sproutNullifiers : frozen.saplingNullifiers;
+        CNullifiersMap::const_iterator it = nullifiers.find(nullifier);
+        if (it != nullifiers.end() && (it->second.flags & CNullifiersCacheEntry::DIRTY))
+            return it->second.entered;
+    }
+    return base->GetNullifier(nullifier, type);
+}
+
+bool CCoinsViewAsyncFlush::GetCoins(const uint256 &txid, CCoins &coins) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        CCoinsMap::const_iterator it = frozen.coins.find(txid);
+        if (it != frozen.coins.end() && (it->second.flags & CCoinsCacheEntry::DIRTY)) {
+            // a pruned entry is about to be erased from the database
+            if (it->second.coins.IsPruned())
+                return false;
+            coins = it->second.coins;
+            return true;
+        }
+    }
+    return base->GetCoins(txid, coins);
+}
+
+bool CCoinsViewAsyncFlush::HaveCoins(const uint256 &txid) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        CCoinsMap::const_iterator it = frozen.coins.find(txid);
+        if (it != frozen.coins.end() && (it->second.flags & CCoinsCacheEntry::DIRTY))
+            return !it->second.coins.IsPruned();
+    }
+    return base->HaveCoins(txid);
+}
+
+uint256 CCoinsViewAsyncFlush::GetBestBlock() const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (fWriting && !frozen.hashBlock.IsNull())
+            return frozen.hashBlock;
+    }
+    return base->GetBestBlock();
+}
+
+uint256 CCoinsViewAsyncFlush::GetBestAnchor(ShieldedType type) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        const uint256& hashAnchor = type == SPROUT ? frozen.hashSproutAnchor : frozen.hashSaplingAnchor;
+        if (fWriting && !hashAnchor.IsNull())
+            return hashAnchor;
+    }
+    return base->GetBestAnchor(type);
+}
+
+bool CCoinsViewAsyncFlush::GetStats(CCoinsStats &stats) const
+{
+    // the statistics walk the database, which has to hold the complete state
+    if (!Sync())
+        return false;
+    return base->GetStats(stats);
+}
@@ -0,0 +1,100 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_COINSFLUSH_H
+#define KOMODO_COINSFLUSH_H
+
+#include "coins.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+class CCoinsViewDB;
+
+/**
+ * Coins view layer that writes flushed caches to the coins database on a
+ * background thread.
+ *
+ * BatchWrite takes over the maps of the cache being flushed (the frozen
+ * layer) and returns at once, so pcoinsTip is empty again and block connection
+ * continues while the writer thread hands the frozen layer to
+ * CCoinsViewDB::WriteFlush. Reads check the frozen layer before falling back
+ * to the database, which keeps the view consistent while the write is in
+ * progress. Only one layer is written at a time: a second BatchWrite waits
+ * until the previous one is on disk, so writes reach the database in order.
+ *
+ * A failed background write is reported by the next BatchWrite or Sync.
+ */
+class CCoinsViewAsyncFlush : public CCoinsViewBacked
+{
+public:
+    /** Reads fall through to baseIn, flushes are written to dbIn. */
+    CCoinsViewAsyncFlush(CCoinsView* baseIn, CCoinsViewDB* dbIn);
+    ~CCoinsViewAsyncFlush();
+
+    bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
+    bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
+    bool GetNullifier(const uint256 &nullifier, ShieldedType type) const;
+    bool GetCoins(const uint256 &txid, CCoins &coins) const;
+    bool HaveCoins(const uint256 &txid) const;
+    uint256 GetBestBlock() const;
+    uint256 GetBestAnchor(ShieldedType type) const;
+    bool BatchWrite(CCoinsMap &mapCoins,
+                    const uint256 &hashBlock,
+                    const uint256 &hashSproutAnchor,
+                    const uint256 &hashSaplingAnchor,
+                    CAnchorsSproutMap &mapSproutAnchors,
+                    CAnchorsSaplingMap &mapSaplingAnchors,
+                    CNullifiersMap &mapSproutNullifiers,
+                    CNullifiersMap &mapSaplingNullifiers);
+    bool GetStats(CCoinsStats &stats) const;
+
+    /** Waits until the frozen layer, if any, is written. Returns false if a background write failed. */
+    bool Sync() const;
+    /** True while a frozen layer is being written. */
+    bool IsWriting() const;
+    /** False once a background write failed. */
+    bool IsHealthy() const;
+
+private:
+    struct FrozenLayer
+    {
+        CCoinsMap coins;
+        uint256 hashBlock;
+        uint256 hashSproutAnchor;
+        uint256 hashSaplingAnchor;
+        CAnchorsSproutMap sproutAnchors;
+        CAnchorsSaplingMap saplingAnchors;
+        CNullifiersMap sproutNullifiers;
+        CNullifiersMap saplingNullifiers;
+
+        void swap(FrozenLayer& other);
+    };
+
+    void ThreadWriter();
+
+    CCoinsViewDB* db;
+
+    mutable std::mutex cs;
+    mutable std::condition_variable cond;
+    FrozenLayer frozen;     // only modified with cs held and fWriting false
+    bool fWriting;
+    bool fFailed;
+    bool fStop;
+    std::thread writer;
+};
+
+#endif // KOMODO_COINSFLUSH_H
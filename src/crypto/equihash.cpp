@@ -256,18 +256,26 @@ eh_index UntruncateIndex(const eh_trunc t, const eh_index r, const unsigned int
 
 std::vector<eh_index> GetIndicesFromMinimal(std::vector<unsigned char> minimal,
                                             size_t cBitLen)
+{
+    std::vector<unsigned char> array;
+    std::vector<eh_index> ret;
+    GetIndicesFromMinimal(minimal, cBitLen, array, ret);
+    return ret;
+}
+
+void GetIndicesFromMinimal(const std::vector<unsigned char>& minimal, size_t cBitLen,
+                           std::vector<unsigned char>& array, std::vector<eh_index>& indices)
 {
     assert(((cBitLen+1)+7)/8 <= sizeof(eh_index));
     size_t lenIndices { 8*sizeof(eh_index)*minimal.size()/(cBitLen+1) };
     size_t bytePad { sizeof(eh_index) - ((cBitLen+1)+7)/8 };
-    std::vector<unsigned char> array(lenIndices);
+    array.assign(lenIndices, 0);
     ExpandArray(minimal.data(), minimal.size(),
                 array.data(), lenIndices, cBitLen+1, bytePad);
-    std::vector<eh_index> ret;
+    indices.clear();
     for (size_t i = 0; i < lenIndices; i += sizeof(eh_index)) {
-        ret.push_back(ArrayToEhIndex(array.data()+i));
+        indices.push_back(ArrayToEhIndex(array.data()+i));
     }
-    return ret;
 }
 
 std::vector<unsigned char> GetMinimalFromIndices(std::vector<eh_index> indices,
@@ -806,7 +814,7 @@ invalidsolution:
 #endif // ENABLE_MINING
 
 template<unsigned int N, unsigned int K>
-bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln)
+bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln)
 {
     if (soln.size() != SolutionWidth) {
         LogPrint("pow", "Invalid solution length: %d (expected %d)\n",
@@ -814,10 +822,15 @@ bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, std::vector<
         return false;
     }
 
-    std::vector<FullStepRow<FinalFullWidth>> X;
+    // Scratch space is kept per thread, so verifying a solution does not allocate
+    static thread_local std::vector<FullStepRow<FinalFullWidth>> X;
+    static thread_local std::vector<unsigned char> vArray;
+    static thread_local std::vector<eh_index> vIndices;
+    X.clear();
     X.reserve(1 << K);
+    GetIndicesFromMinimal(soln, CollisionBitLength, vArray, vIndices);
     unsigned char tmpHash[HashOutput];
-    for (eh_index i : GetIndicesFromMinimal(soln, CollisionBitLength)) {
+    for (eh_index i : vIndices) {
         GenerateHash(base_state, i/IndicesPerHashOutput, tmpHash, HashOutput, N);
         X.emplace_back(tmpHash+((i % IndicesPerHashOutput) * GetSizeInBytes(N)),
                        GetSizeInBytes(N), HashLength, CollisionBitLength, i);
@@ -826,7 +839,7 @@ bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, std::vector<
     size_t hashLen = HashLength;
     size_t lenIndices = sizeof(eh_index);
     while (X.size() > 1) {
-        std::vector<FullStepRow<FinalFullWidth>> Xc;
+        // each pair is merged into the slot at half its index, which has been read already
         for (size_t i = 0; i < X.size(); i += 2) {
             if (!HasCollision(X[i], X[i+1], CollisionByteLength)) {
                 LogPrint("pow", "Invalid solution: invalid collision length between StepRows\n");
@@ -842,9 +855,9 @@ bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, std::vector<
                 LogPrint("pow", "Invalid solution: duplicate indices\n");
                 return false;
             }
-            Xc.emplace_back(X[i], X[i+1], hashLen, lenIndices, CollisionByteLength);
+            X[i/2] = FullStepRow<FinalFullWidth>(X[i], X[i+1], hashLen, lenIndices, CollisionByteLength);
         }
-        X = Xc;
+        X.erase(X.begin() + X.size()/2, X.end());
         hashLen -= CollisionByteLength;
         lenIndices *= 2;
     }
@@ -863,7 +876,7 @@ template bool Equihash<200,9>::OptimisedSolve(const eh_HashState& base_state,
                                               const std::function<bool(const std::vector<unsigned char>&)> validBlock,
                                               const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<200,9>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<200,9>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
                                               
 // Explicit instantiations for Equihash<96,3>
 template int Equihash<150,5>::InitialiseState(eh_HashState& base_state);
@@ -875,7 +888,7 @@ template bool Equihash<150,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(const std::vector<unsigned char>&)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<150,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<150,5>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<48,5>
 template int Equihash<144,5>::InitialiseState(eh_HashState& base_state);
@@ -887,7 +900,7 @@ template bool Equihash<144,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(const std::vector<unsigned char>&)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<144,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<144,5>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<96,5>
 template int Equihash<ASSETCHAINS_N,ASSETCHAINS_K>::InitialiseState(eh_HashState& base_state);
@@ -899,7 +912,7 @@ template bool Equihash<ASSETCHAINS_N,ASSETCHAINS_K>::OptimisedSolve(const eh_Has
                                              const std::function<bool(const std::vector<unsigned char>&)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<ASSETCHAINS_N,ASSETCHAINS_K>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<ASSETCHAINS_N,ASSETCHAINS_K>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<96,5>
 template int Equihash<48,5>::InitialiseState(eh_HashState& base_state);
@@ -911,7 +924,7 @@ template bool Equihash<48,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(const std::vector<unsigned char>&)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<48,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<48,5>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<48,5>
 template int Equihash<210,9>::InitialiseState(eh_HashState& base_state);
@@ -923,4 +936,4 @@ template bool Equihash<210,9>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(const std::vector<unsigned char>&)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<210,9>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<210,9>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
@@ -41,6 +41,9 @@ eh_trunc TruncateIndex(const eh_index i, const unsigned int ilen);
 
 std::vector<eh_index> GetIndicesFromMinimal(std::vector<unsigned char> minimal,
                                             size_t cBitLen);
+/** As above, into caller-provided buffers that keep their capacity between calls. */
+void GetIndicesFromMinimal(const std::vector<unsigned char>& minimal, size_t cBitLen,
+                           std::vector<unsigned char>& array, std::vector<eh_index>& indices);
 std::vector<unsigned char> GetMinimalFromIndices(std::vector<eh_index> indices,
                                                  size_t cBitLen);
 
@@ -200,7 +203,7 @@ public:
                         const std::function<bool(const std::vector<unsigned char>&)> validBlock,
                         const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-    bool IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+    bool IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 };
 
 #include "equihash.tcc"
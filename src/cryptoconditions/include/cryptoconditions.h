@@ -48,6 +48,13 @@ enum CCTypeId {
 typedef int (*VerifyEval)(struct CC *cond, void *context);
 
 
+/*
+ * Receives the secp256k1 checks of a tree, see cc_secp256k1CollectTreeMsg32
+ */
+typedef void (*CCSecp256k1Collector)(const uint8_t *publicKey, const uint8_t *signature,
+                                     const uint8_t *msg32, void *context);
+
+
 
 /*
  * Crypto Condition
@@ -99,6 +106,8 @@ int             cc_signTreeSecp256k1Msg32(CC *cond, const uint8_t *privateKey, c
 int             cc_signTreeSecp256k1HashMsg32(CC *cond, const unsigned char *privateKey, const unsigned char *msg32);
 int             cc_secp256k1VerifyTreeMsg32(const CC *cond, const uint8_t *msg32);
 int             cc_secp256k1HashVerifyTreeMsg32(const CC *cond, const unsigned char *msg32);
+int             cc_secp256k1CollectTreeMsg32(const CC *cond, const uint8_t *msg32,
+                        CCSecp256k1Collector collect, void *context);
 size_t          cc_conditionBinary(const CC *cond, uint8_t *buf);
 size_t          cc_fulfillmentBinary(const CC *cond, uint8_t *buf, size_t bufLength);
 size_t          cc_fulfillmentBinaryMixedMode(const CC *cond, uint8_t *buf, size_t bufLength);
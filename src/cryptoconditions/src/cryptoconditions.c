@@ -28,6 +28,7 @@
 #include "secp256k1hash.c"
 #include "anon.c"
 #include "eval.c"
+#include "der.c"
 #include "json_rpc.c"
 
 struct CCType *CCTypeRegistry[] = {
@@ -116,6 +117,9 @@ uint32_t fromAsnSubtypes(const ConditionTypes_t types) {
 
 
 size_t cc_conditionBinary(const CC *cond, unsigned char *buf) {  // TODO: make buf size as a param
+    if (cc_useDerCodec)
+        return derConditionBinary(cond, buf, 1000);
+
     Condition_t *asn = calloc(1, sizeof(Condition_t));
     asnCondition(cond, asn);
     size_t out = 0;
@@ -225,6 +229,11 @@ CC *fulfillmentToCC(Fulfillment_t *ffill, const FulfillmentFlags flags) {
 
 CC *cc_readFulfillmentBinaryWithFlags(const unsigned char *ffill_bin, size_t ffill_bin_len, FulfillmentFlags flags) {
     CC *cond = 0;
+    if (cc_useDerCodec) {
+        // input the direct reader declines is left to asn1c
+        cond = derReadFulfillment(ffill_bin, ffill_bin_len, flags);
+        if (cond) return cond;
+    }
     unsigned char *buf = calloc(1,ffill_bin_len);
     Fulfillment_t *ffill = 0;
     asn_dec_rval_t rval = ber_decode(0, &asn_DEF_Fulfillment, (void **)&ffill, ffill_bin, ffill_bin_len);
@@ -313,6 +322,10 @@ int cc_verify(const struct CC *cond, const unsigned char *msg, size_t msgLength,
 
 
 CC *cc_readConditionBinary(const unsigned char *cond_bin, size_t length) {
+    if (cc_useDerCodec) {
+        CC *cond = derReadCondition(cond_bin, length);
+        if (cond) return cond;
+    }
     Condition_t *asnCond = 0;
     asn_dec_rval_t rval;
     rval = ber_decode(0, &asn_DEF_Condition, (void **)&asnCond, cond_bin, length);
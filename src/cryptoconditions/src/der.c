@@ -0,0 +1,513 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * Direct DER codec for the supported condition types.
+ *
+ * The asn1c path decodes into a malloc'ed asn tree, re-encodes it to reject
+ * malleated input and then converts it to a CC tree. The reader below walks
+ * the buffer once and builds the CC tree directly, the writer produces
+ * condition binaries and fingerprint contents on the stack.
+ *
+ * The reader only accepts the canonical encoding asn1c would produce (minimal
+ * lengths and integers, sorted SET OF, no trailing bytes). Anything else,
+ * including encodings it does not know how to handle, is declined by
+ * returning NULL and the caller falls back to asn1c, which stays the reference
+ * for edge cases. tests/fuzz_der.c checks both codecs against each other.
+ */
+
+#include "asn/Condition.h"
+#include "asn/Fulfillment.h"
+#include "include/sha256.h"
+#include "internal.h"
+
+
+int cc_useDerCodec = 1;
+
+
+#define DER_MAX_DEPTH 64
+#define DER_MAX_CONDITION 64    /* largest condition binary is 54 bytes */
+
+
+typedef struct DerSlice {
+    const uint8_t *p;
+    size_t len;
+} DerSlice;
+
+
+/*
+ * Take one tag-length-value off the front of in. Only single byte tags and
+ * minimally encoded definite lengths are accepted.
+ */
+static int derTake(DerSlice *in, uint8_t *tag, DerSlice *value, DerSlice *whole) {
+    if (in->len < 2 || (in->p[0] & 0x1f) == 0x1f) return 0;
+
+    size_t len = in->p[1], hdr = 2;
+    if (len & 0x80) {
+        size_t nbytes = len & 0x7f;
+        if (nbytes == 0 || nbytes > 3 || in->len < 2 + nbytes || in->p[2] == 0) return 0;
+        len = 0;
+        for (size_t i=0; i<nbytes; i++) len = (len << 8) | in->p[2+i];
+        if (len < 0x80) return 0;
+        hdr += nbytes;
+    }
+    if (in->len - hdr < len) return 0;
+
+    *tag = in->p[0];
+    value->p = in->p + hdr;
+    value->len = len;
+    if (whole) {
+        whole->p = in->p;
+        whole->len = hdr + len;
+    }
+    in->p += hdr + len;
+    in->len -= hdr + len;
+    return 1;
+}
+
+
+static int derTakeTag(DerSlice *in, uint8_t expected, DerSlice *value) {
+    uint8_t tag;
+    return derTake(in, &tag, value, NULL) && tag == expected;
+}
+
+
+static int derTakeOctets(DerSlice *in, uint8_t expected, size_t size, DerSlice *value) {
+    return derTakeTag(in, expected, value) && value->len == size;
+}
+
+
+/*
+ * Unsigned INTEGER in the range the ASN.1 module allows (0..4294967295)
+ */
+static int derTakeUInt(DerSlice *in, uint8_t expected, unsigned long *out) {
+    DerSlice v;
+    if (!derTakeTag(in, expected, &v)) return 0;
+    if (v.len == 0 || v.len > 5 || v.p[0] & 0x80) return 0;
+    if (v.len > 1 && v.p[0] == 0 && !(v.p[1] & 0x80)) return 0;
+    uint64_t value = 0;
+    for (size_t i=0; i<v.len; i++) value = (value << 8) | v.p[i];
+    if (value > 0xffffffffUL) return 0;
+    *out = (unsigned long) value;
+    return 1;
+}
+
+
+static int derTakeSubtypes(DerSlice *in, uint32_t *mask) {
+    DerSlice v;
+    if (!derTakeTag(in, 0x82, &v)) return 0;
+    if (v.len < 2 || v.len > 5 || v.p[0] > 7) return 0;
+    if (v.p[v.len-1] & ((1 << v.p[0]) - 1)) return 0;
+    *mask = 0;
+    for (int i=0; i<(v.len-1)*8; i++) {
+        if (v.p[1 + (i >> 3)] & (1 << (7 - i % 8))) {
+            *mask |= 1U << i;
+        }
+    }
+    return 1;
+}
+
+
+/*
+ * SET OF ordering used by the asn1c DER encoder
+ */
+static int derCmp(const DerSlice *a, const DerSlice *b) {
+    size_t common = a->len < b->len ? a->len : b->len;
+    int ret = memcmp(a->p, b->p, common);
+    if (ret == 0) {
+        if (a->len < b->len) return -1;
+        if (a->len > b->len) return 1;
+    }
+    return ret;
+}
+
+
+static int derCmpQsort(const void *a, const void *b) {
+    return derCmp((const DerSlice*)a, (const DerSlice*)b);
+}
+
+
+/*
+ * Count the elements of a SET OF, checking they are in DER order
+ */
+static int derCountSorted(DerSlice set, size_t *count) {
+    DerSlice prev = {NULL, 0}, value, whole;
+    uint8_t tag;
+    *count = 0;
+    while (set.len) {
+        if (!derTake(&set, &tag, &value, &whole)) return 0;
+        if (prev.p && derCmp(&prev, &whole) > 0) return 0;
+        prev = whole;
+        (*count)++;
+    }
+    return 1;
+}
+
+
+static CC *derTakeCondition(DerSlice *in) {
+    uint8_t tag;
+    DerSlice v, fp;
+    if (!derTake(in, &tag, &v, NULL) || (tag & 0xe0) != 0xa0) return NULL;
+
+    int typeId = tag & 0x1f;
+    CCType *realType = typeId < CCTypeRegistryLength ? CCTypeRegistry[typeId] : NULL;
+    if (!realType) return NULL;
+
+    unsigned long cost;
+    uint32_t subtypes = 0;
+    size_t fpSize = typeId == CC_Secp256k1hash ? 20 : 32;
+    if (!derTakeOctets(&v, 0x80, fpSize, &fp)) return NULL;
+    if (!derTakeUInt(&v, 0x81, &cost)) return NULL;
+    if (cc_hasSubtypes(typeId) && !derTakeSubtypes(&v, &subtypes)) return NULL;
+    if (v.len) return NULL;
+
+    CC *cond = cc_new(CC_Anon);
+    cond->conditionType = realType;
+    memcpy(cond->fingerprint, fp.p, fpSize);
+    cond->cost = cost;
+    cond->subtypes = subtypes;
+    return cond;
+}
+
+
+static CC *derTakeFulfillment(DerSlice *in, FulfillmentFlags flags, int depth);
+
+
+static void derFreeSubconditions(CC **subconditions, size_t count) {
+    for (size_t i=0; i<count; i++) {
+        if (subconditions[i]) cc_free(subconditions[i]);
+    }
+    free(subconditions);
+}
+
+
+static CC *derThreshold(DerSlice v, FulfillmentFlags flags, int depth) {
+    DerSlice ffills, conds;
+    size_t nffills, nconds;
+    if (!derTakeTag(&v, 0xa0, &ffills) || !derTakeTag(&v, 0xa1, &conds) || v.len) return NULL;
+    if (!derCountSorted(ffills, &nffills) || !derCountSorted(conds, &nconds)) return NULL;
+
+    long threshold = nffills;
+    if (flags & MixedMode) {
+        // The real threshold is carried by a one byte preimage in the first slot
+        if (nffills == 0) return NULL;
+        CC *tc = derTakeFulfillment(&ffills, flags, depth+1);
+        if (!tc) return NULL;
+        if (tc->type->typeId != CC_Preimage || tc->preimageLength != 1) {
+            cc_free(tc);
+            return NULL;
+        }
+        threshold = tc->preimage[0];
+        cc_free(tc);
+        nffills--;
+        if (threshold > nffills + nconds) return NULL;
+    }
+
+    size_t size = nffills + nconds;
+    if (size > 255) return NULL;
+
+    CC **subconditions = calloc(size ? size : 1, sizeof(CC*));
+    for (size_t i=0; i<size; i++) {
+        subconditions[i] = (i < nffills) ?
+            derTakeFulfillment(&ffills, flags, depth+1) :
+            derTakeCondition(&conds);
+        if (!subconditions[i]) {
+            derFreeSubconditions(subconditions, i);
+            return NULL;
+        }
+    }
+
+    CC *cond = cc_new(CC_Threshold);
+    cond->threshold = threshold;
+    cond->size = size;
+    cond->subconditions = subconditions;
+    return cond;
+}
+
+
+static CC *derTakeFulfillment(DerSlice *in, FulfillmentFlags flags, int depth) {
+    uint8_t tag;
+    DerSlice v, a, b;
+    CC *cond = NULL, *sub;
+    unsigned long mml;
+
+    if (depth > DER_MAX_DEPTH || !derTake(in, &tag, &v, NULL)) return NULL;
+
+    switch (tag) {
+        case 0xa0 | CC_Preimage:
+            if (!derTakeTag(&v, 0x80, &a) || v.len) return NULL;
+            cond = cc_new(CC_Preimage);
+            cond->preimage = calloc(1, a.len);
+            memcpy(cond->preimage, a.p, a.len);
+            cond->preimageLength = a.len;
+            return cond;
+
+        case 0xa0 | CC_Prefix:
+            if (!derTakeTag(&v, 0x80, &a) || !derTakeUInt(&v, 0x81, &mml) ||
+                    !derTakeTag(&v, 0xa2, &b) || v.len) return NULL;
+            sub = derTakeFulfillment(&b, flags, depth+1);
+            if (!sub) return NULL;
+            if (b.len) {
+                cc_free(sub);
+                return NULL;
+            }
+            cond = cc_new(CC_Prefix);
+            cond->maxMessageLength = mml;
+            cond->prefix = calloc(1, a.len);
+            memcpy(cond->prefix, a.p, a.len);
+            cond->prefixLength = a.len;
+            cond->subcondition = sub;
+            return cond;
+
+        case 0xa0 | CC_Threshold:
+            return derThreshold(v, flags, depth);
+
+        case 0xa0 | CC_Ed25519:
+            if (!derTakeOctets(&v, 0x80, 32, &a) || !derTakeOctets(&v, 0x81, 64, &b) || v.len) return NULL;
+            cond = cc_new(CC_Ed25519);
+            cond->publicKey = calloc(1, 32);
+            memcpy(cond->publicKey, a.p, 32);
+            cond->signature = calloc(1, 64);
+            memcpy(cond->signature, b.p, 64);
+            return cond;
+
+        case 0xa0 | CC_Secp256k1:
+            if (!derTakeOctets(&v, 0x80, SECP256K1_PK_SIZE, &a) ||
+                    !derTakeOctets(&v, 0x81, SECP256K1_SIG_SIZE, &b) || v.len) return NULL;
+            return cc_secp256k1Condition(a.p, b.p);
+
+        case 0xa0 | CC_Secp256k1hash:
+            if (!derTakeOctets(&v, 0x80, SECP256K1_PK_SIZE, &a) ||
+                    !derTakeOctets(&v, 0x81, SECP256K1_SIG_SIZE, &b) || v.len) return NULL;
+            return cc_secp256k1hashCondition(NULL, a.p, b.p);
+
+        case 0xa0 | CC_Eval:
+            // the optional param is not used by any eval yet
+            if (!derTakeTag(&v, 0x80, &a) || v.len) return NULL;
+            cond = cc_new(CC_Eval);
+            cond->code = calloc(1, a.len);
+            memcpy(cond->code, a.p, a.len);
+            cond->codeLength = a.len;
+            return cond;
+    }
+    return NULL;
+}
+
+
+CC *derReadFulfillment(const unsigned char *buf, size_t len, FulfillmentFlags flags) {
+    DerSlice in = {buf, len};
+    CC *cond = derTakeFulfillment(&in, flags, 0);
+    if (cond && in.len) {
+        cc_free(cond);
+        return NULL;
+    }
+    return cond;
+}
+
+
+CC *derReadCondition(const unsigned char *buf, size_t len) {
+    DerSlice in = {buf, len};
+    CC *cond = derTakeCondition(&in);
+    if (cond && in.len) {
+        cc_free(cond);
+        return NULL;
+    }
+    return cond;
+}
+
+
+/*
+ * Writer
+ */
+
+static size_t derLengthSize(size_t len) {
+    return len < 0x80 ? 1 : len < 0x100 ? 2 : len < 0x10000 ? 3 : 4;
+}
+
+
+static size_t derWriteHeader(uint8_t tag, size_t len, uint8_t *out) {
+    size_t n = derLengthSize(len);
+    out[0] = tag;
+    if (n == 1) {
+        out[1] = len;
+    } else {
+        out[1] = 0x80 | (n - 1);
+        for (size_t i=n-1; i>0; i--, len >>= 8) out[1+i] = len & 0xff;
+    }
+    return 1 + n;
+}
+
+
+/*
+ * Minimal two's complement contents, as NativeInteger_encode_der writes
+ * an unsigned long
+ */
+static size_t derIntegerContents(unsigned long value, uint8_t *out) {
+    uint8_t buf[sizeof(value)];
+    for (int i=sizeof(buf)-1; i>=0; i--, value >>= 8) buf[i] = (uint8_t) value;
+    size_t skip = 0;
+    while (skip < sizeof(buf)-1 &&
+            ((buf[skip] == 0x00 && !(buf[skip+1] & 0x80)) ||
+             (buf[skip] == 0xff && (buf[skip+1] & 0x80)))) skip++;
+    memcpy(out, buf + skip, sizeof(buf) - skip);
+    return sizeof(buf) - skip;
+}
+
+
+static size_t derWriteInteger(uint8_t tag, unsigned long value, uint8_t *out) {
+    uint8_t contents[sizeof(value)];
+    size_t n = derIntegerContents(value, contents);
+    size_t hdr = derWriteHeader(tag, n, out);
+    memcpy(out + hdr, contents, n);
+    return hdr + n;
+}
+
+
+/*
+ * Same bit layout as asnSubtypes
+ */
+static size_t derWriteSubtypes(uint32_t mask, uint8_t *out) {
+    uint8_t bits[4] = {0, 0, 0, 0};
+    int maxId = 0;
+    for (int i=0; i<32; i++) {
+        if (mask & (1U << i)) {
+            maxId = i;
+            bits[i >> 3] |= 1 << (7 - i % 8);
+        }
+    }
+    size_t size = 1 + (maxId >> 3);
+    size_t hdr = derWriteHeader(0x82, 1 + size, out);
+    out[hdr] = 7 - maxId % 8;
+    memcpy(out + hdr + 1, bits, size);
+    return hdr + 1 + size;
+}
+
+
+/*
+ * Condition binary written into out, which must hold DER_MAX_CONDITION bytes
+ */
+static size_t derWriteCondition(const CC *cond, uint8_t *out) {
+    CCType *type = cc_isAnon(cond) ? cond->conditionType : cond->type;
+    int typeId = type->typeId;
+    if (typeId < 0 || typeId >= CCTypeRegistryLength || !CCTypeRegistry[typeId]) return 0;
+
+    uint8_t fp[32], contents[DER_MAX_CONDITION];
+    memset(fp, 0, sizeof(fp));
+    cond->type->fingerprint(cond, fp);
+
+    size_t fpSize = typeId == CC_Secp256k1hash ? 20 : 32;
+    size_t n = derWriteHeader(0x80, fpSize, contents);
+    memcpy(contents + n, fp, fpSize);
+    n += fpSize;
+    n += derWriteInteger(0x81, cc_getCost(cond), contents + n);
+    if (cc_hasSubtypes(typeId)) {
+        n += derWriteSubtypes(cond->type->getSubtypes(cond), contents + n);
+    }
+
+    size_t hdr = derWriteHeader(0xa0 | typeId, n, out);
+    memcpy(out + hdr, contents, n);
+    return hdr + n;
+}
+
+
+size_t derConditionBinary(const CC *cond, unsigned char *buf, size_t bufLength) {
+    uint8_t out[DER_MAX_CONDITION];
+    size_t n = derWriteCondition(cond, out);
+    if (n == 0 || n > bufLength) return 0;
+    memcpy(buf, out, n);
+    return n;
+}
+
+
+/*
+ * Fingerprint contents are hashed as they are written. hashFingerprintContents
+ * leaves the fingerprint untouched when the encoding does not fit in BUF_SIZE,
+ * so the same limit applies here.
+ */
+static int derFingerprintFits(size_t contentLength) {
+    if (1 + derLengthSize(contentLength) + contentLength > BUF_SIZE) {
+        fprintf(stderr, "Encoding fingerprint failed\n");
+        return 0;
+    }
+    return 1;
+}
+
+
+static void derHashHeader(sha256_context_t *ctx, uint8_t tag, size_t len) {
+    uint8_t hdr[5];
+    sha256_update(ctx, hdr, derWriteHeader(tag, len, hdr));
+}
+
+
+void derThresholdFingerprint(const CC *cond, uint8_t *out) {
+    size_t count = cond->size;
+    uint8_t encs[count ? count : 1][DER_MAX_CONDITION];
+    DerSlice sorted[count ? count : 1];
+    size_t setLength = 0;
+
+    for (size_t i=0; i<count; i++) {
+        sorted[i].p = encs[i];
+        sorted[i].len = derWriteCondition(cond->subconditions[i], encs[i]);
+        setLength += sorted[i].len;
+    }
+    qsort(sorted, count, sizeof(DerSlice), derCmpQsort);
+
+    uint8_t threshold[16];
+    size_t thresholdLength = derWriteInteger(0x80, cond->threshold, threshold);
+    size_t contentLength = thresholdLength + 1 + derLengthSize(setLength) + setLength;
+    if (!derFingerprintFits(contentLength)) return;
+
+    sha256_context_t ctx;
+    sha256_init(&ctx);
+    derHashHeader(&ctx, 0x30, contentLength);
+    sha256_update(&ctx, threshold, thresholdLength);
+    derHashHeader(&ctx, 0xa1, setLength);
+    for (size_t i=0; i<count; i++) {
+        sha256_update(&ctx, sorted[i].p, sorted[i].len);
+    }
+    sha256_final(out, &ctx);
+}
+
+
+void derPrefixFingerprint(const CC *cond, uint8_t *out) {
+    uint8_t sub[DER_MAX_CONDITION], mml[16];
+    size_t subLength = derWriteCondition(cond->subcondition, sub);
+    size_t mmlLength = derWriteInteger(0x81, cond->maxMessageLength, mml);
+    size_t contentLength = 1 + derLengthSize(cond->prefixLength) + cond->prefixLength +
+        mmlLength + 1 + derLengthSize(subLength) + subLength;
+    if (!derFingerprintFits(contentLength)) return;
+
+    sha256_context_t ctx;
+    sha256_init(&ctx);
+    derHashHeader(&ctx, 0x30, contentLength);
+    derHashHeader(&ctx, 0x80, cond->prefixLength);
+    sha256_update(&ctx, cond->prefix, cond->prefixLength);
+    sha256_update(&ctx, mml, mmlLength);
+    derHashHeader(&ctx, 0xa2, subLength);
+    sha256_update(&ctx, sub, subLength);
+    sha256_final(out, &ctx);
+}
+
+
+/*
+ * Ed25519 and secp256k1 fingerprint contents: SEQUENCE { publicKey }
+ */
+void derPublicKeyFingerprint(const uint8_t *publicKey, size_t publicKeyLength, uint8_t *out) {
+    uint8_t buf[4 + 33];
+    size_t n = derWriteHeader(0x30, 2 + publicKeyLength, buf);
+    n += derWriteHeader(0x80, publicKeyLength, buf + n);
+    memcpy(buf + n, publicKey, publicKeyLength);
+    sha256(buf, n + publicKeyLength, out);
+}
@@ -26,6 +26,10 @@ struct CCType CC_Ed25519Type;
 
 
 static void ed25519Fingerprint(const CC *cond, uint8_t *out) {
+    if (cc_useDerCodec) {
+        derPublicKeyFingerprint(cond->publicKey, 32, out);
+        return;
+    }
     Ed25519FingerprintContents_t *fp = calloc(1, sizeof(Ed25519FingerprintContents_t));
     OCTET_STRING_fromBuf(&fp->publicKey, cond->publicKey, 32);
     hashFingerprintContents(&asn_DEF_Ed25519FingerprintContents, fp, out);
@@ -80,6 +80,18 @@ struct CC *fulfillmentToCC(Fulfillment_t *ffill, const FulfillmentFlags flags);
 struct CCType *getTypeByAsnEnum(Condition_PR present);
 
 
+/*
+ * Direct DER codec, see der.c
+ */
+extern int cc_useDerCodec;
+CC *derReadFulfillment(const unsigned char *buf, size_t len, FulfillmentFlags flags);
+CC *derReadCondition(const unsigned char *buf, size_t len);
+size_t derConditionBinary(const CC *cond, unsigned char *buf, size_t bufLength);
+void derThresholdFingerprint(const CC *cond, uint8_t *out);
+void derPrefixFingerprint(const CC *cond, uint8_t *out);
+void derPublicKeyFingerprint(const uint8_t *publicKey, size_t publicKeyLength, uint8_t *out);
+
+
 /*
  * Utility functions
  */
@@ -38,6 +38,10 @@ static int prefixVisitChildren(CC *cond, CCVisitor visitor) {
 
 
 static void prefixFingerprint(const CC *cond, uint8_t *out) {
+    if (cc_useDerCodec) {
+        derPrefixFingerprint(cond, out);
+        return;
+    }
     PrefixFingerprintContents_t *fp = calloc(1, sizeof(PrefixFingerprintContents_t));
     asnCondition(cond->subcondition, &fp->subcondition);
     fp->maxMessageLength = cond->maxMessageLength;
@@ -89,6 +89,10 @@ void initVerify() {
 
 
 static void secp256k1Fingerprint(const CC *cond, uint8_t *out) {
+    if (cc_useDerCodec) {
+        derPublicKeyFingerprint(cond->publicKey, SECP256K1_PK_SIZE, out);
+        return;
+    }
     Secp256k1FingerprintContents_t *fp = calloc(1, sizeof(Secp256k1FingerprintContents_t));
     OCTET_STRING_fromBuf(&fp->publicKey, cond->publicKey, SECP256K1_PK_SIZE);
     hashFingerprintContents(&asn_DEF_Secp256k1FingerprintContents, fp, out);
@@ -136,6 +140,45 @@ int cc_secp256k1VerifyTreeMsg32(const CC *cond, const unsigned char *msg32) {
 }
 
 
+/*
+ * Collecting data
+ */
+typedef struct CCSecp256k1CollectData {
+    CCSecp256k1Collector collect;
+    void *context;
+} CCSecp256k1CollectData;
+
+
+/*
+ * Visitor that hands the key and signature of a secp256k1 or secp256k1hash
+ * condition to a collector instead of verifying it
+ */
+static int secp256k1Collect(CC *cond, CCVisitor visitor) {
+    if (cond->type->typeId != CC_Secp256k1 && cond->type->typeId != CC_Secp256k1hash) return 1;
+    if (!cond->publicKey || !cond->signature) return 0;
+    CCSecp256k1CollectData *collecting = (CCSecp256k1CollectData*) visitor.context;
+    collecting->collect(cond->publicKey, cond->signature, visitor.msg, collecting->context);
+    return 1;
+}
+
+
+/*
+ * Collect the secp256k1 checks of a tree so they can be verified together
+ * with those of other conditions. Same restrictions as the verify functions.
+ */
+int cc_secp256k1CollectTreeMsg32(const CC *cond, const unsigned char *msg32,
+                                 CCSecp256k1Collector collect, void *context) {
+    int subtypes = cc_typeMask(cond);
+    if (subtypes & (1 << CC_PrefixType.typeId) &&
+        subtypes & ((1 << CC_Secp256k1) | (1 << CC_Secp256k1hash))) {
+        return 0;
+    }
+    CCSecp256k1CollectData collecting = {collect, context};
+    CCVisitor visitor = {&secp256k1Collect, msg32, 32, &collecting};
+    return cc_visit((CC*) cond, visitor);
+}
+
+
 /*
  * Signing data
  */
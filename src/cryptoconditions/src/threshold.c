@@ -93,6 +93,10 @@ static int cmpConditionBin(const void *a, const void *b) {
 
 
 static void thresholdFingerprint(const CC *cond, uint8_t *out) {
+    if (cc_useDerCodec) {
+        derThresholdFingerprint(cond, out);
+        return;
+    }
     ThresholdFingerprintContents_t *fp = calloc(1, sizeof(ThresholdFingerprintContents_t));
     fp->threshold = cond->threshold;
     for (int i=0; i<cond->size; i++) {
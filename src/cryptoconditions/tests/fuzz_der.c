@@ -0,0 +1,285 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ * Differential fuzzer for the direct DER codec (src/der.c) against asn1c.
+ *
+ * Every input is decoded by both readers. The direct reader may decline input
+ * asn1c accepts (it is then handled by asn1c), but anything it accepts must
+ * give the same tree, and condition binaries and fingerprints written by both
+ * codecs must match byte for byte.
+ *
+ * Standalone, mutating the built-in seeds and any test vectors given:
+ *   make fuzz-der && ./fuzz-der tests/vectors/<name>.json ...
+ * With libFuzzer:
+ *   clang -fsanitize=fuzzer,address -DCC_FUZZ_LIBFUZZER ... tests/fuzz_der.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/cryptoconditions.h"
+#include "../src/internal.h"
+
+
+CC *cc_readFulfillmentBinaryWithFlags(const unsigned char *ffill_bin, size_t ffill_bin_len, FulfillmentFlags flags);
+
+static unsigned long nChecked, nAccepted, nDeclined;
+
+
+static void fail(const char *what, const uint8_t *data, size_t size) {
+    char *hex = cc_hex_encode(data, size);
+    fprintf(stderr, "fuzz_der: %s\ninput: %s\n", what, hex);
+    free(hex);
+    abort();
+}
+
+
+static size_t conditionBinary(const CC *cond, int useDer, uint8_t *buf) {
+    cc_useDerCodec = useDer;
+    size_t len = cc_conditionBinary(cond, buf);
+    cc_useDerCodec = 1;
+    return len;
+}
+
+
+static void compareWriters(const CC *cond, const uint8_t *data, size_t size) {
+    uint8_t a[1000], b[1000];
+    size_t la = conditionBinary(cond, 0, a), lb = conditionBinary(cond, 1, b);
+    if (la != lb || memcmp(a, b, la)) fail("condition binary differs", data, size);
+}
+
+
+static void compareTrees(const CC *ref, const CC *fast, FulfillmentFlags flags, const uint8_t *data, size_t size) {
+    uint8_t a[BUF_SIZE], b[BUF_SIZE];
+    size_t la, lb;
+
+    if (cc_typeMask(ref) != cc_typeMask(fast)) fail("type mask differs", data, size);
+    if (cc_getCost(ref) != cc_getCost(fast)) fail("cost differs", data, size);
+
+    la = conditionBinary(ref, 0, a);
+    lb = conditionBinary(fast, 0, b);
+    if (la != lb || memcmp(a, b, la)) fail("decoded trees have different conditions", data, size);
+
+    cc_useDerCodec = 0;
+    la = (flags & MixedMode) ? cc_fulfillmentBinaryMixedMode(ref, a, sizeof(a)) : cc_fulfillmentBinary(ref, a, sizeof(a));
+    lb = (flags & MixedMode) ? cc_fulfillmentBinaryMixedMode(fast, b, sizeof(b)) : cc_fulfillmentBinary(fast, b, sizeof(b));
+    cc_useDerCodec = 1;
+    if (la != lb || memcmp(a, b, la)) fail("decoded trees have different fulfillments", data, size);
+}
+
+
+static void checkFulfillment(const uint8_t *data, size_t size, FulfillmentFlags flags) {
+    cc_useDerCodec = 0;
+    CC *ref = cc_readFulfillmentBinaryWithFlags(data, size, flags);
+    cc_useDerCodec = 1;
+    CC *fast = derReadFulfillment(data, size, flags);
+
+    nChecked++;
+    if (fast) {
+        if (!ref) fail("direct reader accepted a fulfillment asn1c rejects", data, size);
+        compareTrees(ref, fast, flags, data, size);
+        nAccepted++;
+    } else if (ref) {
+        nDeclined++;
+    }
+    if (ref) compareWriters(ref, data, size);
+
+    cc_free(ref);
+    cc_free(fast);
+}
+
+
+static void checkCondition(const uint8_t *data, size_t size) {
+    cc_useDerCodec = 0;
+    CC *ref = cc_readConditionBinary(data, size);
+    cc_useDerCodec = 1;
+    CC *fast = derReadCondition(data, size);
+
+    if (fast) {
+        if (!ref) fail("direct reader accepted a condition asn1c rejects", data, size);
+        if (cc_typeMask(ref) != cc_typeMask(fast) || cc_getCost(ref) != cc_getCost(fast))
+            fail("decoded conditions differ", data, size);
+        compareWriters(fast, data, size);
+    }
+    cc_free(ref);
+    cc_free(fast);
+}
+
+
+static void checkInput(const uint8_t *data, size_t size) {
+    checkFulfillment(data, size, 0);
+    checkFulfillment(data, size, MixedMode);
+    checkCondition(data, size);
+}
+
+
+#ifdef CC_FUZZ_LIBFUZZER
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    checkInput(data, size);
+    return 0;
+}
+
+#else
+
+#define SECP_PK "0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798"
+#define SECP_SIG "0101010101010101010101010101010101010101010101010101010101010101" \
+                 "0202020202020202020202020202020202020202020202020202020202020202"
+
+/* Shapes used by the CC modules: 1of2 and mixed mode trees with eval, secp256k1 and hash nodes */
+static const char *seedTrees[] = {
+    "{\"type\":\"threshold-sha-256\",\"threshold\":2,\"subfulfillments\":["
+        "{\"type\":\"eval-sha-256\",\"codehex\":\"f2\"},"
+        "{\"type\":\"threshold-sha-256\",\"threshold\":1,\"subfulfillments\":["
+            "{\"type\":\"secp256k1-sha-256\",\"publicKey\":\"" SECP_PK "\",\"signature\":\"" SECP_SIG "\"},"
+            "{\"type\":\"secp256k1-sha-256\",\"publicKey\":\"" SECP_PK "\"}]}]}",
+    "{\"type\":\"threshold-sha-256\",\"threshold\":2,\"subfulfillments\":["
+        "{\"type\":\"eval-sha-256\",\"codehex\":\"f5\"},"
+        "{\"type\":\"secp256k1hash-sha-256\",\"publicKey\":\"" SECP_PK "\",\"signature\":\"" SECP_SIG "\"},"
+        "{\"type\":\"secp256k1hash-sha-256\",\"publicKeyHash\":\"0102030405060708090a0b0c0d0e0f1011121314\"},"
+        "{\"type\":\"preimage-sha-256\",\"preimage\":\"YWJj\"}]}",
+    "{\"type\":\"prefix-sha-256\",\"prefix\":\"YWFh\",\"maxMessageLength\":300,\"subfulfillment\":"
+        "{\"type\":\"preimage-sha-256\",\"preimage\":\"\"}}",
+};
+
+
+static void addSeed(uint8_t ***seeds, size_t **sizes, size_t *count, const uint8_t *data, size_t size) {
+    *seeds = realloc(*seeds, (*count + 1) * sizeof(uint8_t*));
+    *sizes = realloc(*sizes, (*count + 1) * sizeof(size_t));
+    (*seeds)[*count] = malloc(size ? size : 1);
+    memcpy((*seeds)[*count], data, size);
+    (*sizes)[*count] = size;
+    (*count)++;
+}
+
+
+static void addTreeSeeds(CC *cond, uint8_t ***seeds, size_t **sizes, size_t *count) {
+    uint8_t buf[BUF_SIZE];
+    size_t len;
+    if ((len = cc_fulfillmentBinary(cond, buf, sizeof(buf)))) addSeed(seeds, sizes, count, buf, len);
+    if ((len = cc_fulfillmentBinaryMixedMode(cond, buf, sizeof(buf)))) addSeed(seeds, sizes, count, buf, len);
+    if ((len = cc_conditionBinary(cond, buf))) addSeed(seeds, sizes, count, buf, len);
+}
+
+
+static char *readFile(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = calloc(1, len + 1);
+    if (fread(buf, 1, len, f) != (size_t) len) len = 0;
+    fclose(f);
+    return buf;
+}
+
+
+static size_t mutate(uint8_t *buf, size_t size, size_t maxSize) {
+    int n = 1 + rand() % 4;
+    while (n--) {
+        size_t pos = size ? rand() % size : 0;
+        switch (rand() % 6) {
+            case 0: if (size) buf[pos] ^= 1 << (rand() % 8); break;
+            case 1: if (size) buf[pos] = rand(); break;
+            case 2: if (size) buf[pos] += (rand() % 2) ? 1 : -1; break;
+            case 3: size = pos; break;
+            case 4:
+                if (size < maxSize) {
+                    memmove(buf + pos + 1, buf + pos, size - pos);
+                    buf[pos] = rand();
+                    size++;
+                }
+                break;
+            case 5:
+                if (size) {
+                    memmove(buf + pos, buf + pos + 1, size - pos - 1);
+                    size--;
+                }
+                break;
+        }
+    }
+    return size;
+}
+
+
+int main(int argc, char **argv) {
+    uint8_t **seeds = NULL;
+    size_t *sizes = NULL, count = 0;
+    char err[1000];
+    unsigned long iterations = getenv("FUZZ_ITERATIONS") ? strtoul(getenv("FUZZ_ITERATIONS"), NULL, 10) : 20000;
+
+    for (size_t i=0; i<sizeof(seedTrees)/sizeof(seedTrees[0]); i++) {
+        err[0] = 0;
+        CC *cond = cc_conditionFromJSONString(seedTrees[i], err);
+        if (!cond) {
+            fprintf(stderr, "bad seed %zu: %s\n", i, err);
+            return 1;
+        }
+        addTreeSeeds(cond, &seeds, &sizes, &count);
+        cc_free(cond);
+    }
+
+    // thresholds wider than ~100 subconditions overflow the fingerprint encoding buffer
+    for (int width=90; width<=110; width+=20) {
+        char json[BUF_SIZE * 2];
+        size_t n = sprintf(json, "{\"type\":\"threshold-sha-256\",\"threshold\":1,\"subfulfillments\":[");
+        for (int i=0; i<width; i++)
+            n += sprintf(json + n, "%s{\"type\":\"eval-sha-256\",\"codehex\":\"%02x\"}", i ? "," : "", i);
+        sprintf(json + n, "]}");
+        CC *cond = cc_conditionFromJSONString(json, err);
+        addTreeSeeds(cond, &seeds, &sizes, &count);
+        cc_free(cond);
+    }
+
+    // test vectors carry their fulfillment and condition as hex
+    for (int i=1; i<argc; i++) {
+        char *text = readFile(argv[i]);
+        cJSON *vector = text ? cJSON_Parse(text) : NULL;
+        const char *keys[] = {"fulfillment", "conditionBinary"};
+        for (int k=0; vector && k<2; k++) {
+            cJSON *item = cJSON_GetObjectItem(vector, keys[k]);
+            if (cJSON_IsString(item)) {
+                uint8_t *bin = cc_hex_decode(item->valuestring);
+                if (bin) addSeed(&seeds, &sizes, &count, bin, strlen(item->valuestring) / 2);
+                free(bin);
+            }
+        }
+        cJSON_Delete(vector);
+        free(text);
+    }
+
+    srand(getenv("FUZZ_SEED") ? atoi(getenv("FUZZ_SEED")) : 1);
+    for (size_t s=0; s<count; s++) {
+        uint8_t buf[BUF_SIZE];
+        checkInput(seeds[s], sizes[s]);
+        for (unsigned long it=0; it<iterations; it++) {
+            size_t size = sizes[s] < sizeof(buf) ? sizes[s] : sizeof(buf);
+            memcpy(buf, seeds[s], size);
+            size = mutate(buf, size, sizeof(buf));
+            checkInput(buf, size);
+        }
+        free(seeds[s]);
+    }
+    free(seeds);
+    free(sizes);
+
+    printf("fuzz_der: %lu fulfillment checks, %lu decoded by the direct reader, %lu left to asn1c\n",
+           nChecked, nAccepted, nDeclined);
+    return 0;
+}
+
+#endif
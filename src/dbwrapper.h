@@ -45,12 +45,22 @@ class CDBBatch
 private:
     const CDBWrapper &parent;
     leveldb::WriteBatch batch;
+    size_t size_estimate;
 
 public:
     /**
      * @param[in] _parent   CDBWrapper that this batch is to be submitted to
      */
-    CDBBatch(const CDBWrapper &_parent) : parent(_parent) { };
+    CDBBatch(const CDBWrapper &_parent) : parent(_parent), size_estimate(0) { };
+
+    void Clear()
+    {
+        batch.Clear();
+        size_estimate = 0;
+    }
+
+    //! Approximate number of bytes the batch takes in memory and in the log
+    size_t SizeEstimate() const { return size_estimate; }
 
     template <typename K, typename V>
     void Write(const K& key, const V& value)
@@ -66,6 +76,8 @@ public:
         leveldb::Slice slValue(&ssValue[0], ssValue.size());
 
         batch.Put(slKey, slValue);
+        // LevelDB serializes a put as a type byte plus varint-prefixed key and value
+        size_estimate += 3 + (slKey.size() > 127) + slKey.size() + (slValue.size() > 127) + slValue.size();
     }
 
     template <typename K>
@@ -77,6 +89,7 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         batch.Delete(slKey);
+        size_estimate += 2 + (slKey.size() > 127) + slKey.size();
     }
 };
 
@@ -148,6 +161,16 @@ public:
         return true;
     }
 
+    bool GetValueDataStream(CDataStream &ssValue) {
+        leveldb::Slice slValue = piter->value();
+        try {
+            ssValue = CDataStream(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        } catch(std::exception &e) {
+            return false;
+        }
+        return true;
+    }
+
     unsigned int GetValueSize() {
         return piter->value().size();
     }
@@ -0,0 +1,363 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_FLATHASHMAP_H
+#define KOMODO_FLATHASHMAP_H
+
+#include "memusage.h"
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/**
+ * Open-addressing hash map used for the coins view caches.
+ *
+ * The table is a power of two array of entry pointers probed linearly, next to
+ * an array with one control byte per slot: 0 for empty, 1 for an erased slot
+ * and otherwise 0x80 with the top 7 hash bits, so a probe reads the small tag
+ * array and only dereferences an entry whose tag matches. Entries are
+ * constructed in pooled chunks of CHUNK_SIZE rather than one node allocation
+ * each, and erased entries are destroyed and their storage reused.
+ *
+ * Semantics follow the subset of boost::unordered_map the caches rely on:
+ * - entries never move, references and pointers to them stay valid until erased;
+ * - erasing never moves other entries, so erasing the current element while
+ *   iterating (the BatchWrite pattern) is safe;
+ * - inserting may rehash; an iterator kept across that still dereferences its
+ *   entry and can still be erased, but must not be advanced.
+ */
+template <typename K, typename T, typename Hasher, size_t CHUNK_SIZE = 1024>
+class CFlatHashMap
+{
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef Hasher hasher;
+
+private:
+    enum { SLOT_EMPTY = 0, SLOT_ERASED = 1 };
+
+    class IteratorBase
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef CFlatHashMap::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+
+        bool operator==(const IteratorBase& b) const { return pentry == b.pentry; }
+        bool operator!=(const IteratorBase& b) const { return pentry != b.pentry; }
+
+    protected:
+        friend class CFlatHashMap;
+
+        IteratorBase() : pmap(NULL), nSlot(0), pentry(NULL) {}
+        IteratorBase(const CFlatHashMap* pmapIn, size_t nSlotIn) :
+            pmap(pmapIn), nSlot(nSlotIn), pentry(nSlotIn < pmapIn->vSlots.size() ? pmapIn->vSlots[nSlotIn] : NULL) {}
+
+        void Next()
+        {
+            do {
+                nSlot++;
+            } while (nSlot < pmap->vSlots.size() && pmap->vSlots[nSlot] == NULL);
+            pentry = nSlot < pmap->vSlots.size() ? pmap->vSlots[nSlot] : NULL;
+        }
+
+        const CFlatHashMap* pmap;
+        size_t nSlot;
+        value_type* pentry;     // NULL for end()
+    };
+
+public:
+    class iterator : public IteratorBase
+    {
+    public:
+        typedef value_type* pointer;
+        typedef value_type& reference;
+
+        iterator() {}
+        value_type& operator*() const { return *this->pentry; }
+        value_type* operator->() const { return this->pentry; }
+        iterator& operator++() { this->Next(); return *this; }
+        iterator operator++(int) { iterator ret(*this); this->Next(); return ret; }
+
+    private:
+        friend class CFlatHashMap;
+        iterator(const CFlatHashMap* pmapIn, size_t nSlotIn) : IteratorBase(pmapIn, nSlotIn) {}
+    };
+
+    class const_iterator : public IteratorBase
+    {
+    public:
+        typedef const value_type* pointer;
+        typedef const value_type& reference;
+
+        const_iterator() {}
+        const_iterator(const iterator& it) : IteratorBase(it) {}
+        const value_type& operator*() const { return *this->pentry; }
+        const value_type* operator->() const { return this->pentry; }
+        const_iterator& operator++() { this->Next(); return *this; }
+        const_iterator operator++(int) { const_iterator ret(*this); this->Next(); return ret; }
+
+    private:
+        friend class CFlatHashMap;
+        const_iterator(const CFlatHashMap* pmapIn, size_t nSlotIn) : IteratorBase(pmapIn, nSlotIn) {}
+    };
+
+    CFlatHashMap() : nSize(0), nErased(0), nUsedInLast(CHUNK_SIZE) {}
+    CFlatHashMap(const CFlatHashMap& other) : hash(other.hash), nSize(0), nErased(0), nUsedInLast(CHUNK_SIZE)
+    {
+        CopyFrom(other);
+    }
+    ~CFlatHashMap() { clear(); }
+
+    CFlatHashMap& operator=(const CFlatHashMap& other)
+    {
+        if (this != &other) {
+            clear();
+            hash = other.hash;
+            CopyFrom(other);
+        }
+        return *this;
+    }
+
+    iterator begin() { return iterator(this, FirstSlot()); }
+    iterator end() { return iterator(this, vSlots.size()); }
+    const_iterator begin() const { return const_iterator(this, FirstSlot()); }
+    const_iterator end() const { return const_iterator(this, vSlots.size()); }
+
+    iterator find(const K& key) { return iterator(this, FindSlot(key)); }
+    const_iterator find(const K& key) const { return const_iterator(this, FindSlot(key)); }
+    size_t count(const K& key) const { return FindSlot(key) != vSlots.size() ? 1 : 0; }
+
+    /** Inserts the entry unless the key is already present; like unordered_map, never overwrites. */
+    template <typename Pair>
+    std::pair<iterator, bool> insert(const Pair& entry)
+    {
+        size_t nHash = hash(entry.first);
+        size_t i = FindSlot(entry.first, nHash);
+        if (i != vSlots.size())
+            return std::make_pair(iterator(this, i), false);
+        return std::make_pair(iterator(this, InsertNew(nHash, entry.first, entry.second)), true);
+    }
+
+    /** Returns the value for key, inserting a default constructed one first if it is missing. */
+    T& operator[](const K& key)
+    {
+        size_t nHash = hash(key);
+        size_t i = FindSlot(key, nHash);
+        if (i == vSlots.size())
+            i = InsertNew(nHash, key, T());
+        return vSlots[i]->second;
+    }
+
+    void erase(const_iterator it)
+    {
+        if (it.pentry == NULL)
+            return;
+        // the slot is stale if the table was rehashed since the iterator was made
+        if (it.nSlot < vSlots.size() && vSlots[it.nSlot] == it.pentry)
+            EraseSlot(it.nSlot);
+        else
+            erase(it.pentry->first);
+    }
+
+    size_t erase(const K& key)
+    {
+        size_t i = FindSlot(key);
+        if (i == vSlots.size())
+            return 0;
+        EraseSlot(i);
+        return 1;
+    }
+
+    /** Destroys every entry and releases all memory. */
+    void clear()
+    {
+        for (size_t i = 0; i < vSlots.size(); i++) {
+            if (vSlots[i] != NULL)
+                vSlots[i]->~value_type();
+        }
+        for (size_t i = 0; i < vChunks.size(); i++)
+            ::operator delete(vChunks[i]);
+        std::vector<value_type*>().swap(vSlots);
+        std::vector<uint8_t>().swap(vTags);
+        std::vector<value_type*>().swap(vChunks);
+        std::vector<value_type*>().swap(vFreeEntries);
+        nSize = 0;
+        nErased = 0;
+        nUsedInLast = CHUNK_SIZE;
+    }
+
+    /** Exchanges contents in constant time; iterators into either map are invalidated. */
+    void swap(CFlatHashMap& other)
+    {
+        std::swap(hash, other.hash);
+        vSlots.swap(other.vSlots);
+        vTags.swap(other.vTags);
+        std::swap(nSize, other.nSize);
+        std::swap(nErased, other.nErased);
+        vChunks.swap(other.vChunks);
+        std::swap(nUsedInLast, other.nUsedInLast);
+        vFreeEntries.swap(other.vFreeEntries);
+    }
+
+    void reserve(size_t nEntries)
+    {
+        size_t nSlots = SlotsFor(nEntries);
+        if (nSlots > vSlots.size())
+            Rehash(nSlots);
+    }
+
+    size_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+
+    /** Heap usage of the table and entry pool; memory owned by the values themselves is not included. */
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(vSlots) + memusage::DynamicUsage(vTags) +
+            memusage::DynamicUsage(vChunks) + memusage::DynamicUsage(vFreeEntries) +
+            memusage::MallocUsage(sizeof(value_type) * CHUNK_SIZE) * vChunks.size();
+    }
+
+private:
+    static const size_t MIN_SLOTS = 16;
+
+    static uint8_t Tag(size_t nHash) { return 0x80 | (nHash >> (sizeof(size_t) * 8 - 7)); }
+
+    /** Smallest table that holds nEntries at a load factor of at most 1/2. */
+    static size_t SlotsFor(size_t nEntries)
+    {
+        size_t nSlots = MIN_SLOTS;
+        while (nSlots < nEntries * 2)
+            nSlots *= 2;
+        return nSlots;
+    }
+
+    size_t FirstSlot() const
+    {
+        size_t i = 0;
+        while (i < vSlots.size() && vSlots[i] == NULL)
+            i++;
+        return i;
+    }
+
+    /** Returns the slot holding key, or vSlots.size() if there is none. */
+    size_t FindSlot(const K& key) const
+    {
+        return vSlots.empty() ? 0 : FindSlot(key, hash(key));
+    }
+
+    size_t FindSlot(const K& key, size_t nHash) const
+    {
+        if (vSlots.empty())
+            return 0;
+        uint8_t nTag = Tag(nHash);
+        size_t nMask = vSlots.size() - 1;
+        for (size_t i = nHash & nMask; vTags[i] != SLOT_EMPTY; i = (i + 1) & nMask) {
+            if (vTags[i] == nTag && vSlots[i]->first == key)
+                return i;
+        }
+        return vSlots.size();
+    }
+
+    /** Puts pentry into the first empty or erased slot of its probe run. Requires a free slot. */
+    size_t PlaceEntry(value_type* pentry, size_t nHash)
+    {
+        size_t nMask = vSlots.size() - 1;
+        size_t i = nHash & nMask;
+        while (vTags[i] > SLOT_ERASED)
+            i = (i + 1) & nMask;
+        if (vTags[i] == SLOT_ERASED)
+            nErased--;
+        vSlots[i] = pentry;
+        vTags[i] = Tag(nHash);
+        return i;
+    }
+
+    void Rehash(size_t nSlots)
+    {
+        std::vector<value_type*> vOld;
+        vOld.swap(vSlots);
+        vSlots.assign(nSlots, NULL);
+        std::vector<uint8_t>(nSlots, SLOT_EMPTY).swap(vTags);
+        nErased = 0;
+        for (size_t i = 0; i < vOld.size(); i++) {
+            if (vOld[i] != NULL)
+                PlaceEntry(vOld[i], hash(vOld[i]->first));
+        }
+    }
+
+    template <typename Value>
+    size_t InsertNew(size_t nHash, const K& key, const Value& value)
+    {
+        // erased slots still lengthen probe runs, so they count towards the 3/4 load factor
+        if ((nSize + nErased + 1) * 4 > vSlots.size() * 3)
+            Rehash(SlotsFor(nSize + 1));
+
+        value_type* pentry;
+        if (!vFreeEntries.empty()) {
+            pentry = vFreeEntries.back();
+            vFreeEntries.pop_back();
+        } else {
+            if (nUsedInLast == CHUNK_SIZE) {
+                vChunks.push_back(static_cast<value_type*>(::operator new(sizeof(value_type) * CHUNK_SIZE)));
+                nUsedInLast = 0;
+            }
+            pentry = vChunks.back() + nUsedInLast++;
+        }
+        new (pentry) value_type(key, value);
+        nSize++;
+        return PlaceEntry(pentry, nHash);
+    }
+
+    void EraseSlot(size_t i)
+    {
+        vSlots[i]->~value_type();
+        vFreeEntries.push_back(vSlots[i]);
+        vSlots[i] = NULL;
+        // a slot followed by an empty one ends every probe run through it and can be emptied outright
+        if (vTags[(i + 1) & (vSlots.size() - 1)] == SLOT_EMPTY) {
+            vTags[i] = SLOT_EMPTY;
+        } else {
+            vTags[i] = SLOT_ERASED;
+            nErased++;
+        }
+        nSize--;
+    }
+
+    void CopyFrom(const CFlatHashMap& other)
+    {
+        reserve(other.size());
+        for (const_iterator it = other.begin(); it != other.end(); ++it)
+            insert(*it);
+    }
+
+    Hasher hash;
+    std::vector<value_type*> vSlots;    // NULL where empty or erased
+    std::vector<uint8_t> vTags;         // SLOT_EMPTY, SLOT_ERASED or 0x80 | top hash bits
+    size_t nSize;
+    size_t nErased;
+
+    std::vector<value_type*> vChunks;       // pooled entry storage
+    size_t nUsedInLast;
+    std::vector<value_type*> vFreeEntries;  // destroyed, ready for reuse
+};
+
+#endif // KOMODO_FLATHASHMAP_H
@@ -5,9 +5,12 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include "arith_uint256.h"
 #include "crypto/equihash.h"
 #include "uint256.h"
 
+#include <thread>
+
 void TestExpandAndCompress(const std::string &scope, size_t bit_len, size_t byte_pad,
                            std::vector<unsigned char> compact,
                            std::vector<unsigned char> expanded)
@@ -80,6 +83,35 @@ TEST(equihash_tests, is_probably_duplicate) {
     ASSERT_TRUE(IsProbablyDuplicate<4>(p3, 4));
 }
 
+TEST(equihash_tests, validator_reuses_scratch_space) {
+    // The validator keeps its buffers per thread, results must not depend on earlier calls
+    std::string I = "Equihash is an asymmetric PoW based on the Generalised Birthday problem.";
+    uint256 V = ArithToUint256(arith_uint256(1));
+    std::vector<eh_index> valid {2261, 15185, 36112, 104243, 23779, 118390, 118332, 130041, 32642, 69878, 76925, 80080, 45858, 116805, 92842, 111026, 15972, 115059, 85191, 90330, 68190, 122819, 81830, 91132, 23460, 49807, 52426, 80391, 69567, 114474, 104973, 122568};
+    std::vector<eh_index> invalid(valid);
+    std::swap(invalid[0], invalid[1]);
+
+    auto validate = [&](const std::vector<eh_index>& indices) {
+        crypto_generichash_blake2b_state state;
+        EhInitialiseState(96, 5, state);
+        crypto_generichash_blake2b_update(&state, (unsigned char*)&I[0], I.size());
+        crypto_generichash_blake2b_update(&state, V.begin(), V.size());
+        bool isValid;
+        EhIsValidSolution(96, 5, state, GetMinimalFromIndices(indices, 96/6), isValid);
+        return isValid;
+    };
+    auto run = [&]() {
+        for (int i = 0; i < 3; i++) {
+            EXPECT_TRUE(validate(valid));
+            EXPECT_FALSE(validate(invalid));
+        }
+    };
+    run();
+    std::thread t1(run), t2(run);
+    t1.join();
+    t2.join();
+}
+
 #ifdef ENABLE_MINING
 TEST(equihash_tests, check_basic_solver_cancelled) {
     Equihash<48,5> Eh48_5;
@@ -18,6 +18,8 @@
 #include "chainparams.h"
 #include "httpserver.h"
 #include "key_io.h"
+#include "perfstats.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
 #include "random.h"
@@ -102,6 +104,46 @@ static bool RPCAuthorized(const std::string& strAuth)
     return TimingResistantEqual(strUserPass, strRPCUserColonPass);
 }
 
+/**
+ * Serializes a JSON-RPC reply straight into the HTTP response. Replies that fit
+ * in one chunk go out as a regular reply; larger ones (big getblock verbosity,
+ * long batches) are sent with chunked transfer encoding as they are written,
+ * so the complete reply text never has to be held in memory.
+ */
+class HTTPReplyStream
+{
+public:
+    explicit HTTPReplyStream(HTTPRequest* reqIn) :
+        req(reqIn), fStarted(false),
+        writer(std::bind(&HTTPReplyStream::WriteChunk, this, std::placeholders::_1)) {}
+
+    CJSONStreamWriter& Writer() { return writer; }
+
+    void Finish()
+    {
+        if (!fStarted) {
+            req->WriteReply(HTTP_OK, writer.TakeBuffer());
+            return;
+        }
+        writer.Flush();
+        req->EndReplyChunked();
+    }
+
+private:
+    void WriteChunk(const std::string& chunk)
+    {
+        if (!fStarted) {
+            req->StartReplyChunked(HTTP_OK);
+            fStarted = true;
+        }
+        req->WriteReplyChunk(chunk);
+    }
+
+    HTTPRequest* req;
+    bool fStarted;
+    CJSONStreamWriter writer;
+};
+
 static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 {
     // JSONRPC handles only POST
@@ -137,7 +179,6 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (!valRequest.read(req->ReadBody()))
             throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
 
-        std::string strReply;
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
@@ -153,17 +194,47 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 
             UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
 
-            // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            // Send reply, same text as JSONRPCReply() without copying result into a reply object
+            req->WriteHeader("Content-Type", "application/json");
+            HTTPReplyStream stream(req);
+            CJSONStreamWriter& writer = stream.Writer();
+            writer.WriteRaw("{");
+            writer.WriteKey("result");
+            writer.Write(result);
+            writer.WriteRaw(",");
+            writer.WriteKey("error");
+            writer.Write(NullUniValue);
+            writer.WriteRaw(",");
+            writer.WriteKey("id");
+            writer.Write(jreq.id);
+            writer.WriteRaw("}\n");
+            RecordRPCBytesOut(jreq.strMethod, writer.GetBytesWritten());
+            stream.Finish();
 
         // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
-        else
-            throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
+        } else if (valRequest.isArray()) {
+            std::vector<UniValue> vReplies;
+            JSONRPCExecBatch(valRequest.get_array(), vReplies);
 
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
+            req->WriteHeader("Content-Type", "application/json");
+            HTTPReplyStream stream(req);
+            CJSONStreamWriter& writer = stream.Writer();
+            writer.WriteRaw("[");
+            const UniValue& vReq = valRequest.get_array();
+            for (size_t i = 0; i < vReplies.size(); i++) {
+                if (i > 0)
+                    writer.WriteRaw(",");
+                size_t nBefore = writer.GetBytesWritten();
+                writer.Write(vReplies[i]);
+                vReplies[i].clear();
+                const UniValue& method = vReq[i].isObject() ? find_value(vReq[i].get_obj(), "method") : NullUniValue;
+                if (method.isStr() && tableRPC[method.get_str()] != NULL)
+                    RecordRPCBytesOut(method.get_str(), writer.GetBytesWritten() - nBefore);
+            }
+            writer.WriteRaw("]\n");
+            stream.Finish();
+        } else
+            throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
     } catch (const UniValue& objError) {
         JSONErrorReply(req, objError, jreq.id);
         return false;
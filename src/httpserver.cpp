@@ -36,6 +36,9 @@
 #endif
 #endif
 
+#include <condition_variable>
+#include <mutex>
+
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
 #include <boost/foreach.hpp>
 #include <boost/scoped_ptr.hpp>
@@ -552,11 +555,16 @@ void HTTPEvent::trigger(struct timeval* tv)
         evtimer_add(ev, tv); // trigger after timeval passed
 }
 HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
-                                                       replySent(false)
+                                                       replySent(false),
+                                                       chunkedReply(false)
 {
 }
 HTTPRequest::~HTTPRequest()
 {
+    if (chunkedReply && req) {
+        LogPrintf("%s: Unterminated chunked reply\n", __func__);
+        EndReplyChunked();
+    }
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
@@ -603,6 +611,22 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
     evhttp_add_header(headers, hdr.c_str(), value.c_str());
 }
 
+/** Re-enable reading from the socket once a reply is complete. This is the
+ * second part of the libevent workaround in http_request_cb.
+ */
+static void ReenableRequestRead(struct evhttp_request* req)
+{
+    if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -618,20 +642,135 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     auto req_copy = req;
     HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
         evhttp_send_reply(req_copy, nStatus, (const char*)NULL, (struct evbuffer *)NULL);
-        // Re-enable reading from the socket. This is the second part of the libevent
-        // workaround above.
-        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
-                }
-            }
-        }
+        ReenableRequestRead(req_copy);
+    });
+    ev->trigger(0);
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
+/** Flow control of a chunked reply, shared by the worker producing it and the
+ * main http thread sending it.
+ */
+struct HTTPChunkedReplyState
+{
+    std::mutex cs;
+    std::condition_variable condDrained;
+    size_t nPosted;     // bytes in chunk events not yet handed to libevent
+    size_t nBuffered;   // bytes handed to libevent since the connection's output buffer last drained
+    bool fClosed;       // the connection is gone, along with the request
+
+    HTTPChunkedReplyState() : nPosted(0), nBuffered(0), fClosed(false) {}
+};
+
+/** Called in the main http thread once the connection's output buffer is empty. */
+static void http_reply_drained_cb(struct evhttp_connection*, void* arg)
+{
+    HTTPChunkedReplyState* state = static_cast<HTTPChunkedReplyState*>(arg);
+    {
+        std::lock_guard<std::mutex> lock(state->cs);
+        state->nBuffered = 0;
+    }
+    state->condDrained.notify_all();
+}
+
+/** Called in the main http thread when the connection of a chunked reply closes
+ * before the reply ended. libevent frees the request with it.
+ */
+static void http_reply_closed_cb(struct evhttp_connection*, void* arg)
+{
+    HTTPChunkedReplyState* state = static_cast<HTTPChunkedReplyState*>(arg);
+    {
+        std::lock_guard<std::mutex> lock(state->cs);
+        state->fClosed = true;
+    }
+    state->condDrained.notify_all();
+}
+
+/** The chunked variants follow the same rule as WriteReply: every libevent call
+ * is made from the main http thread. Events are processed in the order they are
+ * triggered, so the chunks reach the connection in order. The callbacks are
+ * given the shared state, which the events keep alive until EndReplyChunked
+ * has unhooked them.
+ */
+void HTTPRequest::StartReplyChunked(int nStatus)
+{
+    assert(!replySent && req);
+    chunkedState = std::make_shared<HTTPChunkedReplyState>();
+    auto req_copy = req;
+    auto state = chunkedState;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus, state]{
+        evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+        if (conn)
+            evhttp_connection_set_closecb(conn, http_reply_closed_cb, state.get());
+        evhttp_send_reply_start(req_copy, nStatus, (const char*)NULL);
     });
     ev->trigger(0);
     replySent = true;
+    chunkedReply = true; // req stays with us until EndReplyChunked
+}
+
+void HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+    assert(chunkedReply && req);
+    if (strChunk.empty())
+        return;
+    auto state = chunkedState;
+    size_t nSize = strChunk.size();
+    {
+        // stop producing while the client is behind, resumed by http_reply_drained_cb
+        std::unique_lock<std::mutex> lock(state->cs);
+        while (!state->fClosed && state->nPosted + state->nBuffered >= HTTP_CHUNKED_REPLY_HIGH_WATER)
+            state->condDrained.wait(lock);
+        if (state->fClosed)
+            return;
+        state->nPosted += nSize;
+    }
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), nSize);
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, evb, state, nSize]{
+        bool fClosed;
+        {
+            std::lock_guard<std::mutex> lock(state->cs);
+            state->nPosted -= nSize;
+            // without a connection nothing is written and the drain callback never comes
+            if (!state->fClosed && !evhttp_request_get_connection(req_copy))
+                state->fClosed = true;
+            fClosed = state->fClosed;
+            if (!fClosed)
+                state->nBuffered += nSize;
+        }
+        if (fClosed)
+            state->condDrained.notify_all();
+        else
+            evhttp_send_reply_chunk_with_cb(req_copy, evb, http_reply_drained_cb, state.get());
+        evbuffer_free(evb);
+    });
+    ev->trigger(0);
+}
+
+void HTTPRequest::EndReplyChunked()
+{
+    assert(chunkedReply && req);
+    auto req_copy = req;
+    auto state = chunkedState;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, state]{
+        {
+            std::lock_guard<std::mutex> lock(state->cs);
+            if (state->fClosed)
+                return;
+        }
+        evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+        if (conn)
+            evhttp_connection_set_closecb(conn, NULL, NULL);
+        evhttp_send_reply_end(req_copy);
+        ReenableRequestRead(req_copy);
+    });
+    ev->trigger(0);
+    chunkedReply = false;
+    chunkedState.reset();
     req = 0; // transferred back to main thread
 }
 
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_HTTPSERVER_H
 #define BITCOIN_HTTPSERVER_H
 
+#include <memory>
 #include <string>
 #include <stdint.h>
 #ifdef _WIN32
@@ -17,11 +18,14 @@
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+/** Bytes of a chunked reply that may be queued for a connection before WriteReplyChunk waits for it to drain. */
+static const size_t HTTP_CHUNKED_REPLY_HIGH_WATER = 1024 * 1024;
 
 struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPChunkedReplyState;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -63,6 +67,8 @@ private:
     // For test access
 protected:
     bool replySent;
+    bool chunkedReply;
+    std::shared_ptr<HTTPChunkedReplyState> chunkedState;
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -118,6 +124,29 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     virtual void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a reply sent with chunked transfer encoding, for bodies produced
+     * piece by piece. Follow with any number of WriteReplyChunk calls and a
+     * single EndReplyChunked.
+     *
+     * @note Use instead of WriteReply, not in addition to it. Headers must be
+     * written before this call.
+     */
+    virtual void StartReplyChunked(int nStatus);
+
+    /**
+     * Queue one piece of a reply started with StartReplyChunked. Blocks while
+     * more than HTTP_CHUNKED_REPLY_HIGH_WATER bytes wait to be written to the
+     * client; pieces written after the client went away are dropped.
+     */
+    virtual void WriteReplyChunk(const std::string& strChunk);
+
+    /**
+     * Finish a chunked reply. As with WriteReply, the request is given back to
+     * the main thread; do not call any other HTTPRequest methods afterwards.
+     */
+    virtual void EndReplyChunked();
 };
 
 /** Event handler closure.
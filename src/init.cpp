@@ -28,7 +28,9 @@
 #include "primitives/block.h"
 #include "addrman.h"
 #include "amount.h"
+#include "cc/CCcoinselect.h"
 #include "checkpoints.h"
+#include "coinsflush.h"
 #include "compat/sanity.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
@@ -36,6 +38,7 @@
 #include "httprpc.h"
 #include "key.h"
 #include "notarisationdb.h"
+#include "komodo_nSPV_defs.h"
 #include "komodo_version.h"
 
 #ifdef ENABLE_MINING
@@ -45,8 +48,13 @@
 #include "metrics.h"
 #include "miner.h"
 #include "net.h"
+#include "netrelaycache.h"
+#include "notificationqueue.h"
+#include "nspvcache.h"
+#include "nspvscheduler.h"
 #include "rpc/server.h"
 #include "rpc/register.h"
+#include "script/ccsigcache.h"
 #include "script/standard.h"
 #include "scheduler.h"
 #include "txdb.h"
@@ -245,6 +253,10 @@ void Shutdown()
     GenerateBitcoins(false, 0);
  #endif
 #endif
+    if (pnspvscheduler) {
+        delete pnspvscheduler;
+        pnspvscheduler = NULL;
+    }
     StopNode();
     StopTorControl();
     UnregisterNodeSignals(GetNodeSignals());
@@ -267,6 +279,9 @@ void Shutdown()
         }
         delete pcoinsTip;
         pcoinsTip = NULL;
+        // waits for a coins flush still being written
+        delete pcoinsAsyncFlush;
+        pcoinsAsyncFlush = NULL;
         delete pcoinscatcher;
         pcoinscatcher = NULL;
         delete pcoinsdbview;
@@ -279,6 +294,17 @@ void Shutdown()
         pwalletMain->Flush(true);
 #endif
 
+    if (pcoinselectcache) {
+        UnregisterValidationInterface(pcoinselectcache);
+        delete pcoinselectcache;
+        pcoinselectcache = NULL;
+    }
+    if (pnspvcache) {
+        UnregisterValidationInterface(pnspvcache);
+        delete pnspvcache;
+        pnspvcache = NULL;
+    }
+
 #if ENABLE_ZMQ
     if (pzmqNotificationInterface) {
         UnregisterValidationInterface(pzmqNotificationInterface);
@@ -391,6 +417,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    if (showDebug)
+        strUsage += HelpMessageOpt("-dbbatchsize=<n>", strprintf("Maximum size in bytes of each database write when flushing the coins cache (default: %u)", nDefaultDbBatchSize));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-mempooltxinputlimit=<n>", _("[DEPRECATED FROM OVERWINTER] Set the maximum number of transparent inputs in a transaction that the mempool will accept (default: 0 = no limit applied)"));
@@ -410,6 +438,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-oraclesindex", strprintf(_("Maintain an index of oracles data samples by publisher and height, used by oraclessamples (default: %u)"), DEFAULT_ORACLESINDEX));
+    strUsage += HelpMessageOpt("-ccinputscache", strprintf(_("Keep the spendable outputs of the addresses cc transactions are built from in memory (default: %u)"), DEFAULT_CCINPUTSCACHE));
+    strUsage += HelpMessageOpt("-ccinputsreserve=<n>", strprintf(_("Do not add the inputs of a cc transaction built in the last <n> seconds to other transactions until it is sent, 0 = off (default: %u)"), DEFAULT_CCINPUTSRESERVE));
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
     strUsage += HelpMessageOpt("-asmap=<file>", strprintf("Specify asn mapping used for bucketing of the peers (default: %s). Relative paths will be prefixed by the net-specific datadir location.", DEFAULT_ASMAP_FILENAME));
@@ -431,7 +462,11 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), 1));
     strUsage += HelpMessageOpt("-peerbloomfilters", strprintf(_("Support filtering of blocks and transaction with Bloom filters (default: %u)"), 1));
+    strUsage += HelpMessageOpt("-relaycachesize=<n>", strprintf(_("Memory for blocks, transactions and DEX packets kept serialized for relay to many peers, in MiB (default: %u)"), DEFAULT_RELAY_CACHE_SIZE));
     strUsage += HelpMessageOpt("-nspv_msg", strprintf(_("Enable NSPV messages processing (default: %u)"), DEFAULT_NSPV_PROCESSING));
+    strUsage += HelpMessageOpt("-nspvcachesize=<n>", strprintf(_("Memory for nSPV responses shared by light clients until the next block, in MiB, 0 to disable (default: %u)"), DEFAULT_NSPV_CACHE_SIZE));
+    strUsage += HelpMessageOpt("-nspvpeerbudget=<n>", strprintf(_("nSPV request cost a peer may spend per second, requests over it are dropped, 0 for no limit (default: %u)"), DEFAULT_NSPV_PEER_BUDGET));
+    strUsage += HelpMessageOpt("-nspvthreads=<n>", strprintf(_("Number of threads serving nSPV requests in fair order across peers, 0 to serve them on the message handler thread (default: %d)"), DEFAULT_NSPV_THREADS));
     if (showDebug)
         strUsage += HelpMessageOpt("-enforcenodebloom", strprintf("Enforce minimum protocol version to limit use of Bloom filters (default: %u)", 0));
     strUsage += HelpMessageOpt("-port=<port>", strprintf(_("Listen for connections on <port> (default: %u or testnet: %u)"), 7770, 17770));
@@ -477,6 +512,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubccevent=<address>", _("Enable publish decoded cc transactions in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubccaddress=<address>", _("Enable publish decoded cc transactions per output address in <address>"));
 #endif
 
 #if ENABLE_PROTON
@@ -485,6 +522,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-amqppubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-amqppubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-amqppubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-amqppubccevent=<address>", _("Enable publish decoded cc transactions in <address>"));
+    strUsage += HelpMessageOpt("-amqppubccaddress=<address>", _("Enable publish decoded cc transactions per output address in <address>"));
+#endif
+#if ENABLE_ZMQ || ENABLE_PROTON
+    strUsage += HelpMessageOpt("-ccnotifyfilter=<list>", _("Publish cc transactions only for these comma separated hex evalcodes (like f5) and addresses (default: all)"));
+    strUsage += HelpMessageOpt("-notifyqueuepolicy=<policy>", strprintf(_("What to do with notifications when the notification queue is full, block (wait for the notifier) or drop (default: %s)"), DEFAULT_NOTIFY_QUEUE_POLICY));
+    strUsage += HelpMessageOpt("-notifyqueuesize=<n>", strprintf(_("Notifications queued per notification interface before -notifyqueuepolicy applies (default: %u)"), DEFAULT_NOTIFY_QUEUE_SIZE));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -512,6 +556,7 @@ std::string HelpMessage(HelpMessageMode mode)
     {
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", 15));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", 0));
+        strUsage += HelpMessageOpt("-maxccsigcachesize=<n>", strprintf("Limit size of the verified crypto-condition cache to <n> entries (default: %u)", DEFAULT_MAX_CC_SIG_CACHE_SIZE));
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> entries (default: %u)", 50000));
         strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
     }
@@ -565,11 +610,19 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 7771, 17771));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchthreads=<n>", strprintf(_("Set the number of threads used to run read-only entries of a JSON-RPC batch concurrently (default: %d)"), DEFAULT_RPC_BATCH_THREADS));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
 
+#ifdef ENABLE_WEBSOCKETS
+    strUsage += HelpMessageGroup(_("Websockets options:"));
+    strUsage += HelpMessageOpt("-wsport=<port>", strprintf(_("Listen for websocket connections on <port> (default: %u)"), 8192));
+    strUsage += HelpMessageOpt("-wsthreads=<n>", strprintf(_("Set the number of threads serving websocket connections (default: %d)"), ws::DEFAULT_WS_THREADS));
+    strUsage += HelpMessageOpt("-addwsnode=<ip>", _("Add a websocket node to connect to"));
+#endif
+
     // Disabled until we can lock notes and also tune performance of libsnark which by default uses multiple threads
     //strUsage += HelpMessageOpt("-rpcasyncthreads=<n>", strprintf(_("Set the number of threads to service Async RPC calls (default: %d)"), 1));
 
@@ -1399,10 +1452,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using at most %i connections (%i file descriptors available)\n", nMaxConnections, nFD);
     std::ostringstream strErrors;
 
-    LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
+    LogPrintf("Using %u threads for script and Equihash verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i=0; i<nScriptCheckThreads-1; i++)
+        for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadEquihashCheck);
+        }
     }
 
     // Start the lightweight task scheduler thread
@@ -1543,6 +1598,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     fListen = GetBoolArg("-listen", DEFAULT_LISTEN);
     fDiscover = GetBoolArg("-discover", true);
     fNameLookup = GetBoolArg("-dns", true);
+    RelayWireCache().SetMaxBytes(std::max((int64_t)0, GetArg("-relaycachesize", DEFAULT_RELAY_CACHE_SIZE)) * 1024 * 1024);
 
     bool fBound = false;
     if (fListen) {
@@ -1619,6 +1675,19 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         pwalletMain = new CWallet("tmptmp.wallet");
         return !fRequestShutdown;
     }
+
+    if (GetBoolArg("-ccinputscache", DEFAULT_CCINPUTSCACHE)) {
+        pcoinselectcache = new CCoinSelectCache(std::max((int64_t)0, GetArg("-ccinputsreserve", DEFAULT_CCINPUTSRESERVE)));
+        RegisterValidationInterface(pcoinselectcache);
+    }
+    int64_t nNSPVCacheSize = std::max((int64_t)0, GetArg("-nspvcachesize", DEFAULT_NSPV_CACHE_SIZE));
+    if (KOMODO_NSPV_FULLNODE && GetBoolArg("-nspv_msg", DEFAULT_NSPV_PROCESSING) && nNSPVCacheSize > 0) {
+        pnspvcache = new CNSPVResponseCache(nNSPVCacheSize * 1024 * 1024);
+        RegisterValidationInterface(pnspvcache);
+    }
+    int nNSPVThreads = std::min(MAX_NSPV_THREADS, (int)GetArg("-nspvthreads", DEFAULT_NSPV_THREADS));
+    if (KOMODO_NSPV_FULLNODE && GetBoolArg("-nspv_msg", DEFAULT_NSPV_PROCESSING) && nNSPVThreads > 0)
+        pnspvscheduler = new CNSPVScheduler(nNSPVThreads, std::max((int64_t)0, GetArg("-nspvpeerbudget", DEFAULT_NSPV_PEER_BUDGET)), komodo_nSPVreq);
     // ********************************************************* Step 7: load block chain
 
     fReindex = GetBoolArg("-reindex", false);
@@ -1659,7 +1728,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     if ( fReindex == 0 )
     {
-        bool checkval, fAddressIndex, fSpentIndex, fUnspentCCIndexTmp;
+        bool checkval, fAddressIndex, fSpentIndex, fUnspentCCIndexTmp, fOraclesIndexTmp;
         pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
         fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
         checkval = false;  // need to reinit checkval otherwise it might be undefined if ReadFlag returns false
@@ -1689,6 +1758,16 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             fprintf(stderr,"set unspentccindex, will reindex. could take a while.\n");
             fReindex = true;
         }
+
+        fOraclesIndexTmp = GetBoolArg("-oraclesindex", false);
+        checkval = false;
+        pblocktree->ReadFlag("oraclesindex", checkval);
+        if ( checkval != fOraclesIndexTmp && fOraclesIndexTmp != 0 )
+        {
+            pblocktree->WriteFlag("oraclesindex", fOraclesIndexTmp);
+            fprintf(stderr,"set oraclesindex, will reindex. could take a while.\n");
+            fReindex = true;
+        }
     }
 
     bool clearWitnessCaches = false;
@@ -1705,6 +1784,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             try {
                 UnloadBlockIndex();
                 delete pcoinsTip;
+                delete pcoinsAsyncFlush;
                 delete pcoinsdbview;
                 delete pcoinscatcher;
                 delete pblocktree;
@@ -1712,8 +1792,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
+                pcoinsdbview->SetBatchSize(std::max(GetArg("-dbbatchsize", nDefaultDbBatchSize), (int64_t)1));
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
-                pcoinsTip = new CCoinsViewCache(pcoinscatcher);
+                pcoinsAsyncFlush = new CCoinsViewAsyncFlush(pcoinscatcher, pcoinsdbview);
+                pcoinsTip = new CCoinsViewCache(pcoinsAsyncFlush);
                 pnotarisations = new NotarisationDB(100*1024*1024, false, fReindex);
 
 
@@ -1731,6 +1813,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                // Nothing may read coins before a flush that was cut short is undone
+                if (!RecoverInterruptedCoinsFlush(pcoinsdbview)) {
+                    strLoadError = _("Unable to recover the coins database from an interrupted flush");
+                    break;
+                }
+
                 // If the loaded chain has a wrong genesis, bail out immediately
                 // (we're likely using a testnet datadir, or the other way around).
                 if (!mapBlockIndex.empty() && mapBlockIndex.count(chainparams.GetConsensus().hashGenesisBlock) == 0)
@@ -1779,6 +1867,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 }
                 if ( KOMODO_REWIND == 0 )
                 {
+                    // VerifyDB reads the coins database directly
+                    if (!pcoinsAsyncFlush->Sync()) {
+                        strLoadError = _("Error writing the coins database");
+                        break;
+                    }
                     if (!CVerifyDB().VerifyDB(pcoinsdbview, GetArg("-checklevel", 3),
                                               GetArg("-checkblocks", 288))) {
                         strLoadError = _("Corrupted block database detected");
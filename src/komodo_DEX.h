@@ -993,10 +993,18 @@ int32_t komodo_DEXpacketsend(CNode *peer,uint8_t peerpos,struct DEX_datablob *pt
         fprintf(stderr,"illegal datalen.%d\n",ptr->datalen);
         return(-1);
     }
-    packet.resize(ptr->datalen);
-    memcpy(&packet[0],ptr->data,ptr->datalen);
-    packet[0] = resp0;
-    peer->PushMessage("DEX",packet);
+    // the same packet is fanned out to every peer: frame it once and share the buffer
+    uint256 hash; CSerializeDataRef msg;
+    memcpy(hash.begin(),ptr->hash.bytes,sizeof(ptr->hash));
+    if ( (msg= RelayWireCache().Get(RELAYCACHE_DEX | resp0,hash,PROTOCOL_VERSION)) == 0 )
+    {
+        packet.resize(ptr->datalen);
+        memcpy(&packet[0],ptr->data,ptr->datalen);
+        packet[0] = resp0;
+        msg = CNode::MakeWireMessage("DEX",PROTOCOL_VERSION,packet);
+        RelayWireCache().Insert(RELAYCACHE_DEX | resp0,hash,PROTOCOL_VERSION,msg);
+    }
+    peer->PushWireMessage(msg);
     DEX_totalsent++;
     return(ptr->datalen);
 }
@@ -1828,7 +1836,7 @@ UniValue komodo_DEXbroadcast(uint64_t *locatorp,uint8_t funcid,char *hexstr,int3
             return(0);
         }
         {
-            pthread_mutex_lock(&DEX_globalmutex);
+            portable_mutex_lock(&DEX_globalmutex);
             iguana_rwnum(0,&packet[2],sizeof(timestamp),&timestamp);
             modval = (timestamp % KOMODO_DEX_PURGETIME);
             if ( (ptr= _komodo_DEXfind(modval,shorthash)) == 0 )
@@ -1848,7 +1856,7 @@ UniValue komodo_DEXbroadcast(uint64_t *locatorp,uint8_t funcid,char *hexstr,int3
                     fprintf(stderr," cant issue duplicate order modval.%d t.%u %08x %016llx\n",modval,timestamp,shorthash,(long long)hash.ulongs[0]);
                 srand((int32_t)timestamp);
             }
-            pthread_mutex_unlock(&DEX_globalmutex);
+            portable_mutex_unlock(&DEX_globalmutex);
         }
         if ( blastflag == 0 )
             break;
@@ -2186,7 +2194,7 @@ UniValue komodo_DEX_stats()
     static uint32_t lastadd,lasttime;
     UniValue result(UniValue::VOBJ); char str[65],pubstr[67],logstr[1024],recvaddr[64]; int32_t i,total,histo[64]; uint32_t now,totalhash,d;
     pubkey2addr(recvaddr,NOTARY_PUBKEY33);
-    pthread_mutex_lock(&DEX_globalmutex);
+    portable_mutex_lock(&DEX_globalmutex);
     now = (uint32_t)time(NULL);
     bits256_str(pubstr+2,DEX_pubkey);
     pubstr[0] = '0';
@@ -2215,7 +2223,7 @@ UniValue komodo_DEX_stats()
     lasttime = now;
     lastadd = DEX_totaladd;
     result.push_back(Pair((char *)"perfstats",logstr));
-    pthread_mutex_unlock(&DEX_globalmutex);
+    portable_mutex_unlock(&DEX_globalmutex);
     return(result);
 }
 
@@ -2230,9 +2238,9 @@ UniValue komodo_DEXcancel(char *pubkeystr,uint32_t shorthash,char *tagA,char *ta
     {
         len = iguana_rwnum(1,&hex[len],sizeof(shorthash),&shorthash);
         {
-            pthread_mutex_lock(&DEX_globalmutex);
+            portable_mutex_lock(&DEX_globalmutex);
             _komodo_DEX_cancelid(shorthash,DEX_pubkey,(uint32_t)time(NULL));
-            pthread_mutex_unlock(&DEX_globalmutex);
+            portable_mutex_unlock(&DEX_globalmutex);
         }
     }
     else if ( pubkeystr[0] != 0 )
@@ -2248,9 +2256,9 @@ UniValue komodo_DEXcancel(char *pubkeystr,uint32_t shorthash,char *tagA,char *ta
         decode_hex(hex,33,checkstr);
         len = 33;
         {
-            pthread_mutex_lock(&DEX_globalmutex);
+            portable_mutex_lock(&DEX_globalmutex);
             _komodo_DEX_cancelpubkey((char *)"",(char *)"",pub33,(uint32_t)time(NULL));
-            pthread_mutex_unlock(&DEX_globalmutex);
+            portable_mutex_unlock(&DEX_globalmutex);
         }
     }
     else if ( tagA[0] != 0 && tagB[0] != 0 )
@@ -2270,9 +2278,9 @@ UniValue komodo_DEXcancel(char *pubkeystr,uint32_t shorthash,char *tagA,char *ta
         hex[len++] = lenB;
         memcpy(&hex[len],tagB,lenB), len += lenB;
         {
-            pthread_mutex_lock(&DEX_globalmutex);
+            portable_mutex_lock(&DEX_globalmutex);
             _komodo_DEX_cancelpubkey(tagA,tagB,pub33,(uint32_t)time(NULL));
-            pthread_mutex_unlock(&DEX_globalmutex);
+            portable_mutex_unlock(&DEX_globalmutex);
         }
     }
     for (i=0; i<len; i++)
@@ -2287,27 +2295,27 @@ UniValue komodo_DEXcancel(char *pubkeystr,uint32_t shorthash,char *tagA,char *ta
 UniValue komodo_DEXget(uint32_t shorthash)
 {
     UniValue result;
-    pthread_mutex_lock(&DEX_globalmutex);
+    portable_mutex_lock(&DEX_globalmutex);
     result = _komodo_DEXget(shorthash);
-    pthread_mutex_unlock(&DEX_globalmutex);
+    portable_mutex_unlock(&DEX_globalmutex);
     return(result);
 }
 
 UniValue komodo_DEXlist(uint32_t stopat,int32_t minpriority,char *tagA,char *tagB,char *destpub33,char *minA,char *maxA,char *minB,char *maxB,char *stophashstr)
 {
     UniValue result;
-    pthread_mutex_lock(&DEX_globalmutex);
+    portable_mutex_lock(&DEX_globalmutex);
     result = _komodo_DEXlist(stopat,minpriority,tagA,tagB,destpub33,minA,maxA,minB,maxB,stophashstr);
-    pthread_mutex_unlock(&DEX_globalmutex);
+    portable_mutex_unlock(&DEX_globalmutex);
     return(result);
 }
 
 UniValue komodo_DEXorderbook(int32_t revflag,int32_t maxentries,int32_t minpriority,char *tagA,char *tagB,char *destpub33,char *minA,char *maxA,char *minB,char *maxB)
 {
     UniValue result;
-    pthread_mutex_lock(&DEX_globalmutex);
+    portable_mutex_lock(&DEX_globalmutex);
     result = _komodo_DEXorderbook(revflag,maxentries,minpriority,tagA,tagB,destpub33,minA,maxA,minB,maxB);
-    pthread_mutex_unlock(&DEX_globalmutex);
+    portable_mutex_unlock(&DEX_globalmutex);
     return(result);
 }
 
@@ -2410,9 +2418,9 @@ int32_t komodo_DEX_locatorsync(int32_t &needrequest,int32_t &written,FILE *fp,ui
     t = locator >> 32;
     h = locator & 0xffffffff;
     {
-        pthread_mutex_lock(&DEX_globalmutex);
+        portable_mutex_lock(&DEX_globalmutex);
         fragptr = _komodo_DEXfind(t % KOMODO_DEX_PURGETIME,h);
-        pthread_mutex_unlock(&DEX_globalmutex);
+        portable_mutex_unlock(&DEX_globalmutex);
     }
     errflag = 0;
     if ( fragptr != 0 )
@@ -2478,7 +2486,7 @@ UniValue komodo_DEXsubscribe(int32_t &cmpflag,char *origfname,int32_t priority,u
         sprintf(tagBstr,"locators");
     }
     {
-        pthread_mutex_lock(&DEX_globalmutex);
+        portable_mutex_lock(&DEX_globalmutex);
         memset(checkhash.bytes,0,sizeof(checkhash));
         if ( (ptr= _komodo_DEX_latestptr(sliceid == 0 ? (char *)"files" : (char *)"slices",origfname,publisher,offset0)) != 0 )
         {
@@ -2509,7 +2517,7 @@ UniValue komodo_DEXsubscribe(int32_t &cmpflag,char *origfname,int32_t priority,u
                     break;
             }
         }
-        pthread_mutex_unlock(&DEX_globalmutex);
+        portable_mutex_unlock(&DEX_globalmutex);
     }
     if ( ptr == 0 )
     {
@@ -3108,7 +3116,7 @@ UniValue komodo_DEX_notarize(char *coin,int32_t prevheight)
     pubkeystr[1] = '1';
     bits256_str(pubkeystr+2,DEX_pubkey);
     {
-        pthread_mutex_lock(&DEX_globalmutex);
+        portable_mutex_lock(&DEX_globalmutex);
         if ( (ptr= _komodo_DEX_latestptr(coin,(char *)"notarizations",pubkeystr,0)) != 0 )
         {
             if ( (decoded= komodo_DEX_datablobdecrypt(&senderpub,&allocated,&newlen,ptr,DEX_pubkey,coin)) != 0 && newlen == 40 )
@@ -3161,7 +3169,7 @@ UniValue komodo_DEX_notarize(char *coin,int32_t prevheight)
                 free(allocated), allocated = 0;
         }
         //fprintf(stderr,"fname.%s auto search %s %s %s shorthash.%08x sliceid.%d\n",fname,origfname,tagBstr,publisher,shorthash,sliceid);
-         pthread_mutex_unlock(&DEX_globalmutex);
+         portable_mutex_unlock(&DEX_globalmutex);
     }
     return(result);
 }
@@ -3171,9 +3179,9 @@ void komodo_DEXmsg(CNode *pfrom,std::vector<uint8_t> request) // received a pack
     int32_t len; std::vector<uint8_t> response; bits256 hash; uint32_t timestamp = (uint32_t)time(NULL);
     if ( (len= request.size()) > 0 )
     {
-        pthread_mutex_lock(&DEX_globalmutex);
+        portable_mutex_lock(&DEX_globalmutex);
         _komodo_DEXprocess(timestamp,pfrom,&request[0],len);
-        pthread_mutex_unlock(&DEX_globalmutex);
+        portable_mutex_unlock(&DEX_globalmutex);
     }
 }
 
@@ -3183,7 +3191,7 @@ void komodo_DEXpoll(CNode *pto) // from mainloop polling
     std::vector<uint8_t> packet; uint32_t i,now,numiters,shorthash,len,ptime,modval,peerpos;
     now = (uint32_t)time(NULL);
     ptime = now - KOMODO_DEX_PURGETIME + 6;
-    pthread_mutex_lock(&DEX_globalmutex);
+    portable_mutex_lock(&DEX_globalmutex);
     peerpos = _komodo_DEXpeerpos(now,pto->id);
     if ( ptime > purgetime )
     {
@@ -3214,6 +3222,6 @@ void komodo_DEXpoll(CNode *pto) // from mainloop polling
         }
         pto->dexlastping = now;
     }
-    pthread_mutex_unlock(&DEX_globalmutex);
+    portable_mutex_unlock(&DEX_globalmutex);
 }
 
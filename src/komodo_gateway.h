@@ -19,6 +19,7 @@
 
 #include "cc/CCPrices.h"
 #include "cc/pricesfeed.h"
+#include "cc/pricesstore.h"
 
 /*#include "secp256k1/include/secp256k1.h"
 #include "secp256k1/include/secp256k1_schnorrsig.h"
@@ -68,10 +69,10 @@ void pax_keyset(uint8_t *buf,uint256 txid,uint16_t vout,uint8_t type)
 struct pax_transaction *komodo_paxfind(uint256 txid,uint16_t vout,uint8_t type)
 {
     struct pax_transaction *pax; uint8_t buf[35];
-    pthread_mutex_lock(&komodo_mutex);
+    portable_mutex_lock(&komodo_mutex);
     pax_keyset(buf,txid,vout,type);
     HASH_FIND(hh,PAX,buf,sizeof(buf),pax);
-    pthread_mutex_unlock(&komodo_mutex);
+    portable_mutex_unlock(&komodo_mutex);
     return(pax);
 }
 
@@ -87,7 +88,7 @@ struct pax_transaction *komodo_paxfinds(uint256 txid,uint16_t vout)
 struct pax_transaction *komodo_paxmark(int32_t height,uint256 txid,uint16_t vout,uint8_t type,int32_t mark)
 {
     struct pax_transaction *pax; uint8_t buf[35];
-    pthread_mutex_lock(&komodo_mutex);
+    portable_mutex_lock(&komodo_mutex);
     pax_keyset(buf,txid,vout,type);
     HASH_FIND(hh,PAX,buf,sizeof(buf),pax);
     if ( pax == 0 )
@@ -107,16 +108,16 @@ struct pax_transaction *komodo_paxmark(int32_t height,uint256 txid,uint16_t vout
         //    printf("mark ht.%d %.8f %.8f\n",pax->height,dstr(pax->komodoshis),dstr(pax->fiatoshis));
 
     }
-    pthread_mutex_unlock(&komodo_mutex);
+    portable_mutex_unlock(&komodo_mutex);
     return(pax);
 }
 
 void komodo_paxdelete(struct pax_transaction *pax)
 {
     return; // breaks when out of order
-    pthread_mutex_lock(&komodo_mutex);
+    portable_mutex_lock(&komodo_mutex);
     HASH_DELETE(hh,PAX,pax);
-    pthread_mutex_unlock(&komodo_mutex);
+    portable_mutex_unlock(&komodo_mutex);
 }
 
 void komodo_gateway_deposit(char *coinaddr,uint64_t value,char *symbol,uint64_t fiatoshis,uint8_t *rmd160,uint256 txid,uint16_t vout,uint8_t type,int32_t height,int32_t otherheight,char *source,int32_t approved) // assetchain context
@@ -127,7 +128,7 @@ void komodo_gateway_deposit(char *coinaddr,uint64_t value,char *symbol,uint64_t
     //if ( strcmp(symbol,ASSETCHAINS_SYMBOL) != 0 )
     //    return;
     sp = komodo_stateptr(str,dest);
-    pthread_mutex_lock(&komodo_mutex);
+    portable_mutex_lock(&komodo_mutex);
     pax_keyset(buf,txid,vout,type);
     HASH_FIND(hh,PAX,buf,sizeof(buf),pax);
     if ( pax == 0 )
@@ -146,7 +147,7 @@ void komodo_gateway_deposit(char *coinaddr,uint64_t value,char *symbol,uint64_t
             printf(" v.%d [%s] kht.%d ht.%d create pax.%p symbol.%s source.%s\n",vout,ASSETCHAINS_SYMBOL,height,otherheight,pax,symbol,source);
         }
     }
-    pthread_mutex_unlock(&komodo_mutex);
+    portable_mutex_unlock(&komodo_mutex);
     if ( coinaddr != 0 )
     {
         strcpy(pax->coinaddr,coinaddr);
@@ -1604,7 +1605,8 @@ struct komodo_extremeprice
 
 struct komodo_priceinfo
 {
-    FILE *fp;
+    FILE *fp;                            // written by komodo_pricesupdate only
+    CPricesFile view;                    // lock free reads for komodo_priceget
     char symbol[PRICES_MAXNAMELENGTH];   // TODO: it was 64 
 } PRICES[KOMODO_MAXPRICES];
 
@@ -2587,6 +2589,8 @@ int32_t komodo_pricesinit()
                 fputc(0,PRICES[i].fp);
                 fflush(PRICES[i].fp);
             }
+            if ( i > 0 && PRICES[i].view.Open(pricefname.string()) == 0 )
+                fprintf(stderr,"error mapping %s, reading it with stdio\n",pricefname.string().c_str());
         } else fprintf(stderr,"error opening %s createflag.%d\n",pricefname.string().c_str(), createflag);
     }
     if ( i > 0 && PRICES[0].fp != 0 && createflag != 0 )
@@ -2662,19 +2666,24 @@ void komodo_pricesupdate(int32_t height,CBlock *pblock)
                             memcpy(&buf[2],&correlated,sizeof(correlated));
                             if ( fwrite(buf,1,sizeof(buf),PRICES[ind].fp) != sizeof(buf) )
                                 fprintf(stderr,"error fwrite buf for ht.%d ind.%d\n",height,ind);
-                            else if ( height > PRICES_DAYWINDOW*2 )
+                            else
                             {
-                                fseek(PRICES[ind].fp,(height-PRICES_DAYWINDOW+1) * PRICES_MAXDATAPOINTS * sizeof(int64_t),SEEK_SET);
-                                if ( fread(ptr64,sizeof(int64_t),PRICES_DAYWINDOW*PRICES_MAXDATAPOINTS,PRICES[ind].fp) == PRICES_DAYWINDOW*PRICES_MAXDATAPOINTS )
+                                if ( height > PRICES_DAYWINDOW*2 )
                                 {
-                                    if ( (smoothed= komodo_priceave(tmpbuf,&ptr64[(PRICES_DAYWINDOW-1)*PRICES_MAXDATAPOINTS+1],-PRICES_MAXDATAPOINTS)) > 0 )
+                                    fseek(PRICES[ind].fp,(height-PRICES_DAYWINDOW+1) * PRICES_MAXDATAPOINTS * sizeof(int64_t),SEEK_SET);
+                                    if ( fread(ptr64,sizeof(int64_t),PRICES_DAYWINDOW*PRICES_MAXDATAPOINTS,PRICES[ind].fp) == PRICES_DAYWINDOW*PRICES_MAXDATAPOINTS )
                                     {
-                                        fseek(PRICES[ind].fp,(height * PRICES_MAXDATAPOINTS + 2) * sizeof(int64_t),SEEK_SET);
-                                        if ( fwrite(&smoothed,1,sizeof(smoothed),PRICES[ind].fp) != sizeof(smoothed) )
-                                            fprintf(stderr,"error fwrite smoothed for ht.%d ind.%d\n",height,ind);
-                                        else fflush(PRICES[ind].fp);
-                                    } else fprintf(stderr,"error price_smoothed ht.%d ind.%d\n",height,ind);
-                                } else fprintf(stderr,"error fread ptr64 for ht.%d ind.%d\n",height,ind);
+                                        if ( (smoothed= komodo_priceave(tmpbuf,&ptr64[(PRICES_DAYWINDOW-1)*PRICES_MAXDATAPOINTS+1],-PRICES_MAXDATAPOINTS)) > 0 )
+                                        {
+                                            fseek(PRICES[ind].fp,(height * PRICES_MAXDATAPOINTS + 2) * sizeof(int64_t),SEEK_SET);
+                                            if ( fwrite(&smoothed,1,sizeof(smoothed),PRICES[ind].fp) != sizeof(smoothed) )
+                                                fprintf(stderr,"error fwrite smoothed for ht.%d ind.%d\n",height,ind);
+                                        } else fprintf(stderr,"error price_smoothed ht.%d ind.%d\n",height,ind);
+                                    } else fprintf(stderr,"error fread ptr64 for ht.%d ind.%d\n",height,ind);
+                                }
+                                // komodo_priceget reads the record from the mapped file once it is flushed
+                                fflush(PRICES[ind].fp);
+                                PRICES[ind].view.Extend((uint64_t)(height+1) * sizeof(int64_t) * PRICES_MAXDATAPOINTS);
                             }
                         } //else fprintf(stderr,"error komodo_pricecorrelated for ht.%d ind.%d\n",height,ind);
                     }
@@ -2686,9 +2695,16 @@ void komodo_pricesupdate(int32_t height,CBlock *pblock)
     } else fprintf(stderr,"numprices mismatch, height.%d\n",height);
 }
 
+// readers of the synthetic prices call this per height and per index, so the mapped file is read without pricemutex
 int32_t komodo_priceget(int64_t *buf64,int32_t ind,int32_t height,int32_t numblocks)
 {
     FILE *fp; int32_t retval = PRICES_MAXDATAPOINTS;
+    if ( ind > 0 && ind < KOMODO_MAXPRICES && PRICES[ind].view.IsOpen() != 0 )
+    {
+        if ( PRICES[ind].view.Read(buf64,(uint64_t)height * PRICES_MAXDATAPOINTS * sizeof(int64_t),numblocks * PRICES_MAXDATAPOINTS * sizeof(int64_t)) == 0 )
+            retval = -1;
+        return(retval);
+    }
     pthread_mutex_lock(&pricemutex);
     if ( ind < KOMODO_MAXPRICES && (fp= PRICES[ind].fp) != 0 )
     {
@@ -216,6 +216,7 @@ int32_t NSPV_gettransaction(int32_t skipvalidation,int32_t vout,uint256 txid,int
 UniValue NSPV_spend(char *srcaddr,char *destaddr,int64_t satoshis);
 extern uint256 SIG_TXHASH;
 uint32_t NSPV_blocktime(int32_t hdrheight);
+void komodo_nSPVreq(CNode* pfrom, std::vector<uint8_t> request);
 
 // komodo block header
 struct NSPV_equihdr
@@ -28,6 +28,7 @@
 #include "cc/CCinclude.h"
 #include "komodo_nSPV_defs.h"
 #include "komodo_nSPV.h"
+#include "nspvcache.h"
 
 std::map<int32_t, std::string> nspvErrors = {
     { NSPV_ERROR_INVALID_REQUEST_TYPE, "invalid request type" },
@@ -181,7 +182,11 @@ int32_t NSPV_setequihdr(struct NSPV_equihdr *hdr,int32_t height)
         hdr->nTime = pindex->nTime;
         hdr->nBits = pindex->nBits;
         hdr->nNonce = pindex->nNonce;
-        memcpy(hdr->nSolution, pindex->nSolution.data(), sizeof(hdr->nSolution));
+        std::vector<unsigned char> solution;
+        if ( !pindex->ReadSolution(solution) )
+            return(-1);
+        memset(hdr->nSolution, 0, sizeof(hdr->nSolution));
+        memcpy(hdr->nSolution, solution.data(), std::min(solution.size(), sizeof(hdr->nSolution)));
         hdr->nSolutionLen = sizeof(hdr->nSolution);
         return sizeof(*hdr);
     }
@@ -1007,8 +1012,28 @@ static void NSPV_senderror(CNode* pfrom, uint32_t requestId, int32_t err, const
 }
 
 
+// send the response cached for the same request at this tip
+static bool NSPV_sendcached(CNode* pfrom, uint8_t requestType, uint32_t requestId, const std::string &cacheKey, uint8_t *requestData)
+{
+    std::vector<uint8_t> response;
+    if (!pnspvcache->Get(cacheKey, response))
+        return false;
+    memcpy(&response[1], &requestId, sizeof(requestId));
+    if (requestType == NSPV_TXPROOF) {
+        // the unspent value after the txid depends on the mempool, the rest only on the tip
+        uint256 txid;
+        int32_t height, vout;
+        iguana_rwnum(IGUANA_READ, &requestData[sizeof(height)], sizeof(vout), &vout);
+        iguana_rwbignum(IGUANA_READ, &requestData[sizeof(height) + sizeof(vout)], sizeof(txid), (uint8_t*)&txid);
+        int64_t unspentvalue = CCgettxout(txid, vout, 1, 1);
+        iguana_rwnum(IGUANA_WRITE, &response[sizeof(requestType) + sizeof(requestId) + sizeof(txid)], sizeof(unspentvalue), &unspentvalue);
+    }
+    pfrom->PushMessage("nSPV", response);
+    return true;
+}
+
 // processing nspv requests
-void komodo_nSPVreq(CNode* pfrom, std::vector<uint8_t> request) // received a request
+static void NSPV_processreq(CNode* pfrom, std::vector<uint8_t> &request, bool &fCacheHit)
 {
     std::vector<uint8_t> response;
     uint32_t timestamp = (uint32_t)time(NULL);
@@ -1050,6 +1075,22 @@ void komodo_nSPVreq(CNode* pfrom, std::vector<uint8_t> request) // received a re
         }
     }
 
+    // answers that only change with the tip are computed once per block for all peers
+    std::string cacheKey;
+    uint64_t nCacheGeneration = 0;
+    if (pnspvcache != nullptr && CNSPVResponseCache::IsCacheable(requestType)) {
+        cacheKey = CNSPVResponseCache::MakeKey(requestType, requestData, requestDataLen);
+        if (NSPV_sendcached(pfrom, requestType, requestId, cacheKey, requestData)) {
+            pfrom->nspvdata[idata].prevtime = timestamp;
+            pfrom->nspvdata[idata].nreqs++;
+            if (requestType == NSPV_INFO)
+                pfrom->fNspvConnected = true;  // only valid requests have a cached response
+            fCacheHit = true;
+            return;
+        }
+        nCacheGeneration = pnspvcache->GetGeneration();
+    }
+
     switch (requestType) {
     case NSPV_INFO: // info, mandatory first request
         {
@@ -1084,6 +1125,8 @@ void komodo_nSPVreq(CNode* pfrom, std::vector<uint8_t> request) // received a re
                 if (NSPV_rwinforesp(IGUANA_WRITE, &response[nspvHeaderSize], &I) <= respLen) {
                     //fprintf(stderr,"send info resp to id %d\n",(int32_t)pfrom->id);
                     pfrom->PushMessage("nSPV", response);
+                    if (!cacheKey.empty())
+                        pnspvcache->Put(cacheKey, response, nCacheGeneration);
                     pfrom->nspvdata[idata].prevtime = timestamp;
                     pfrom->nspvdata[idata].nreqs++;
                     LogPrint("nspv-details", "NSPV_INFO sent response: version %d to node=%d\n", I.version, pfrom->id);
@@ -1320,6 +1363,8 @@ void komodo_nSPVreq(CNode* pfrom, std::vector<uint8_t> request) // received a re
                     if (respWritten > 0 && respWritten <= respEstimated) {
                         response.resize(nspvHeaderSize + respWritten);
                         pfrom->PushMessage("nSPV", response);
+                        if (!cacheKey.empty())
+                            pnspvcache->Put(cacheKey, response, nCacheGeneration);
                         pfrom->nspvdata[idata].prevtime = timestamp;
                         pfrom->nspvdata[idata].nreqs++;
                         LogPrint("nspv-details", "NSPV_NTZS response: ntz.txid=%s node=%d\n", N.ntz.txid.GetHex(), pfrom->id);
@@ -1357,6 +1402,8 @@ void komodo_nSPVreq(CNode* pfrom, std::vector<uint8_t> request) // received a re
                     if (respWritten > 0) {
                         response.resize(nspvHeaderSize + respWritten);
                         pfrom->PushMessage("nSPV", response);
+                        if (!cacheKey.empty() && P.nexttxidht > 0)  // not for a notarization still in the mempool
+                            pnspvcache->Put(cacheKey, response, nCacheGeneration);
                         pfrom->nspvdata[idata].prevtime = timestamp;
                         pfrom->nspvdata[idata].nreqs++;
                         LogPrint("nspv-details", "NSPV_NTZSPROOF response: nexttxidht=%d node=%d\n", P.nexttxidht, pfrom->id);
@@ -1399,6 +1446,8 @@ void komodo_nSPVreq(CNode* pfrom, std::vector<uint8_t> request) // received a re
                         response.resize(nspvHeaderSize + respWritten);
                         //fprintf(stderr,"send response\n");
                         pfrom->PushMessage("nSPV", response);
+                        if (!cacheKey.empty() && P.txprooflen > 0)  // mempool txns have no proof yet
+                            pnspvcache->Put(cacheKey, response, nCacheGeneration);
                         pfrom->nspvdata[idata].prevtime = timestamp;
                         pfrom->nspvdata[idata].nreqs++;
                         LogPrint("nspv-details", "NSPV_TXPROOF response: txlen=%d txprooflen=%d node=%d\n", P.txlen, P.txprooflen, pfrom->id);
@@ -1640,4 +1689,13 @@ void komodo_nSPVreq(CNode* pfrom, std::vector<uint8_t> request) // received a re
     }
 }
 
+void komodo_nSPVreq(CNode* pfrom, std::vector<uint8_t> request) // received a request
+{
+    int64_t nTimeStart = GetTimeMicros();
+    bool fCacheHit = false;
+    NSPV_processreq(pfrom, request, fCacheHit);
+    if (!request.empty())
+        RecordNSPVRequest(request[0], GetTimeMicros() - nTimeStart, fCacheHit);
+}
+
 #endif // KOMODO_NSPVFULLNODE_H
@@ -12,6 +12,8 @@
  * Removal or modification of this copyright notice is prohibited.            *
  *                                                                            *
  ******************************************************************************/
+#include "crypto/sha256.h"
+#include "hash.h"
 #include "key_io.h"
 #include "net.h"
 #include "util.h"
@@ -32,8 +34,14 @@
 #define dstr(x) ((double)(x) / SATOSHIDEN)
 #define portable_mutex_t pthread_mutex_t
 #define portable_mutex_init(ptr) pthread_mutex_init(ptr,NULL)
+#ifdef DEBUG_LOCKPROFILE
+#include "perfstats.h"
+#define portable_mutex_lock(mutex) ProfiledMutexLock(mutex, #mutex)
+#define portable_mutex_unlock(mutex) ProfiledMutexUnlock(mutex, #mutex)
+#else
 #define portable_mutex_lock pthread_mutex_lock
 #define portable_mutex_unlock pthread_mutex_unlock
+#endif
 
 extern void verus_hash(void *result, const void *data, size_t len);
 
@@ -280,19 +288,17 @@ static inline int32_t sha256_vdone(struct sha256_vstate *md,uint8_t *out)
     return(0);
 }
 
+// CSHA256 gives the same digest on the transform picked by SHA256AutoDetect (SHA-NI where available)
 void vcalc_sha256(char deprecated[(256 >> 3) * 2 + 1],uint8_t hash[256 >> 3],uint8_t *src,int32_t len)
 {
-    struct sha256_vstate md;
-    sha256_vinit(&md);
-    sha256_vprocess(&md,src,len);
-    sha256_vdone(&md,hash);
+    CSHA256().Write(src,len).Finalize(hash);
 }
 
+// variable length input, so this is a plain CHash256 rather than SHA256D64
 bits256 bits256_doublesha256(char *deprecated,uint8_t *data,int32_t datalen)
 {
     bits256 hash,hash2; int32_t i;
-    vcalc_sha256(0,hash.bytes,data,datalen);
-    vcalc_sha256(0,hash2.bytes,hash.bytes,sizeof(hash));
+    CHash256().Write(data,datalen).Finalize(hash2.bytes);
     for (i=0; i<sizeof(hash); i++)
         hash.bytes[i] = hash2.bytes[sizeof(hash) - 1 - i];
     return(hash);
@@ -34,6 +34,7 @@
 #include "utilstrencodings.h"
 #include "univalue.h"
 #include "rpc/server.h"
+#include "notificationqueue.h"
 
 #include "cc/CCupgrades.h"
 
@@ -146,6 +147,10 @@ public:
 
     virtual void close(websocketpp::connection_hdl hdl, websocketpp::close::status::value) = 0;
     virtual void sendWsData(CWsNode *pNode) = 0;
+    // runs the interrupt handler of the connection on its strand, false if the connection is gone
+    virtual bool interrupt(websocketpp::connection_hdl hdl) = 0;
+    // bytes written to the connection and not yet sent by asio
+    virtual size_t bufferedAmount(websocketpp::connection_hdl hdl) = 0;
 };
 
 typedef std::shared_ptr<CWsEndpointWrapper> ws_endpoint_ptr;
@@ -154,7 +159,7 @@ static ws_endpoint_ptr spWebSocketServer;
 class CWsNode : public CNode {
 public:
     CWsNode(SOCKET hSocketIn, const CAddress &addrIn, const std::string &addrNameIn = "", bool fInboundIn = false)
-        : CNode(hSocketIn, addrIn, addrNameIn, fInboundIn)
+        : CNode(hSocketIn, addrIn, addrNameIn, fInboundIn), sendQueue(WS_SEND_QUEUE_SIZE), fFlushQueued(false)
     {        
         closeErrorOnSend = 0;
         closeErrorOnReceive = 0;
@@ -167,6 +172,11 @@ public:
     websocketpp::close::status::value closeErrorOnReceive;
     int64_t nLastRebroadcast; // for rebroacasting local address
 
+    // messages moved from vSendMsg, written as one binary frame each on the io thread of the connection
+    CBoundedQueue<CSerializeDataRef> sendQueue;
+    // set while a flush owns the consumer side of sendQueue
+    std::atomic<bool> fFlushQueued;
+
     void PushWsVersion()
     {
         int nBestHeight = GetNodeSignals().GetHeight().get_value_or(0);
@@ -195,6 +205,11 @@ static CCriticalSection cs_vWsNodes;
 static std::set<CWsNodePtr> vWsNodesDisconnected; // websocket disconnected nodes
 static CCriticalSection cs_vWsNodesDisconnected;
 
+// inbound nodes by connection, so the io threads find a node without cs_vWsNodes
+typedef std::map<websocketpp::connection_hdl, CWsNodePtr, std::owner_less<websocketpp::connection_hdl>> ws_hdl_node_map;
+static ws_hdl_node_map mapWsNodesByHdl;
+static CCriticalSection cs_mapWsNodesByHdl;
+
 class CWebSocketOutbound;
 static std::vector<ws_endpoint_ptr> vOutboundEndpoints; // wait until enpoint opens
 static CCriticalSection cs_vOutboundEndpoints;
@@ -235,11 +250,22 @@ static CWsNodePtr FindWsNode(const CService& addr)
     return NULL;
 }
 
+static CWsNodePtr FindWsNode(websocketpp::connection_hdl hdl)
+{
+    LOCK(cs_mapWsNodesByHdl);
+    ws_hdl_node_map::const_iterator it = mapWsNodesByHdl.find(hdl);
+    return it != mapWsNodesByHdl.end() ? it->second : NULL;
+}
+
 
 static void RemoveWsNode(CWsNodePtr pNode)
 {
     AssertLockHeld(cs_vWsNodes);
     vWsNodes.erase(std::remove(vWsNodes.begin(), vWsNodes.end(), pNode), vWsNodes.end());
+    {
+        LOCK(cs_mapWsNodesByHdl);
+        mapWsNodesByHdl.erase(pNode->m_hdl);
+    }
     LOCK(cs_vWsNodesDisconnected);
     vWsNodesDisconnected.insert(pNode);
 }
@@ -600,70 +626,92 @@ bool SendWsMessages(CWsNode *pto, bool fTrickle)
 
 
 // requires LOCK(cs_vSend)
-void WebSocketSendData(CWsEndpointWrapper *pEndPoint, websocketpp::connection_hdl hdl, CWsNode *pnode)
+// moves the pushed messages to the send queue of the node, the buffers are shared, not copied
+// returns false if the queue is full: the peer does not read what we send
+bool WebSocketSendData(CWsNode *pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
-    pnode->closeErrorOnSend = 0;
+    std::deque<CSerializeDataRef>::iterator it = pnode->vSendMsg.begin();
 
     while (it != pnode->vSendMsg.end()) {
-        const CSerializeData &data = *it;
-        assert(data.size() > pnode->nSendOffset);
-        websocketpp::lib::error_code ec;
-        int nBytes = data.size() - pnode->nSendOffset;
-        pEndPoint->send(hdl, &data[pnode->nSendOffset], nBytes, websocketpp::frame::opcode::binary, ec);  // should not throw ws exception as ec is passed
-
-        if (!ec) {
-            pnode->nLastSend = GetTime();  // needed to prevent inactivity disconnect
-            pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
-            pnode->RecordBytesSent(nBytes);
-            if (pnode->nSendOffset == data.size()) {
-                pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                it++;
-            } else {
-                // could not send full message; stop sending more
-                break;
-            }
-        } else {  // error
-            // int nErr = WSAGetLastError();
-            // if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)  // no similar errs in websocketpp...
-            {
-                LogPrint("websockets", "websocket send error %d %s\n", ec.value(), ec.category().name());
-                pnode->closeErrorOnSend = websocketpp::close::status::try_again_later;
-                pnode->fDisconnect;
-            }
-            // couldn't send anything at all
+        // websocket messages are written whole, there is no partial send
+        assert(pnode->nSendOffset == 0);
+        size_t nBytes = (*it)->size();
+        if (!pnode->sendQueue.TryPush(*it)) {
+            LogPrint("websockets", "websocket send queue full, disconnecting peer %d\n", pnode->id);
+            pnode->closeErrorOnSend = websocketpp::close::status::try_again_later;
+            pnode->fDisconnect = true;
             break;
         }
+        pnode->nLastSend = GetTime();  // needed to prevent inactivity disconnect
+        pnode->nSendBytes += nBytes;
+        pnode->nSendSize -= nBytes;
+        pnode->RecordBytesSent(nBytes);
+        it++;
     }
 
-    if (it == pnode->vSendMsg.end()) {
-        assert(pnode->nSendOffset == 0);
+    bool fQueued = it == pnode->vSendMsg.end();
+    if (fQueued)
         assert(pnode->nSendSize == 0);
-    }
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
+    return fQueued;
+}
+
+// writes the send queue to the connection, called on the strand of the connection by the one
+// thread that set fFlushQueued
+static void FlushWsSendQueue(CWsNode *pnode)
+{
+    do {
+        CSerializeDataRef msg;
+        // leave the rest queued while asio has not sent the previous frames, the peer is slow
+        while (pnode->m_spWsEndpoint->bufferedAmount(pnode->m_hdl) <= SendBufferSize() && pnode->sendQueue.TryPop(msg)) {
+            if (pnode->fDisconnect)
+                continue;
+            websocketpp::lib::error_code ec;
+            pnode->m_spWsEndpoint->send(pnode->m_hdl, msg->data(), msg->size(), websocketpp::frame::opcode::binary, ec);  // should not throw ws exception as ec is passed
+            if (ec) {
+                LogPrint("websockets", "websocket send error %d %s\n", ec.value(), ec.category().name());
+                pnode->closeErrorOnSend = websocketpp::close::status::try_again_later;
+                pnode->fDisconnect = true;
+            }
+        }
+        pnode->fFlushQueued = false;
+        // a message queued after the last pop saw fFlushQueued still set and relies on us
+    } while (pnode->sendQueue.Size() > 0 && pnode->m_spWsEndpoint->bufferedAmount(pnode->m_hdl) <= SendBufferSize() && !pnode->fFlushQueued.exchange(true));
 }
 
+// flushes the send queue on the io thread of the connection, unless a flush is already queued
+static void ScheduleWsFlush(CWsNode *pnode)
+{
+    if (pnode->sendQueue.Size() > 0 && !pnode->fFlushQueued.exchange(true)) {
+        if (!pnode->m_spWsEndpoint->interrupt(pnode->m_hdl))
+            pnode->fFlushQueued = false;  // connection is closed
+    }
+}
+
+// runs on the strand of the connection
 void HandleWebSocketMessage(CWsEndpointWrapper *pEndPoint, CWsNode *pNode, websocketpp::connection_hdl hdl, wsserver::message_ptr msg)
 {
     pNode->closeErrorOnReceive = 0;
 
-    LOCK(pNode->cs_vRecvMsg);
-    if (pNode->ReceiveMsgBytes(msg->get_payload().c_str(), msg->get_payload().size())) {
+    {
+        LOCK(pNode->cs_vRecvMsg);
+        if (!pNode->ReceiveMsgBytes(msg->get_payload().c_str(), msg->get_payload().size())) {
+            LogPrint("websockets", "error websocket message processing, disconnecting peer %d\n", pNode->id);
+            pNode->closeErrorOnReceive = websocketpp::close::status::unsupported_data;
+            pNode->fDisconnect = true;
+            return;
+        }
         pNode->nLastRecv = GetTime(); // needed to prevent inactivity disconnect
         pNode->nRecvBytes += msg->get_payload().size();
         pNode->RecordBytesRecv(msg->get_payload().size());
-        if (ProcessMessages(pNode)) {
-            LOCK(pNode->cs_vSend); 
-            WebSocketSendData(pEndPoint, hdl, pNode);
-        }
-    }
-    else {
-        LogPrint("websockets", "error websocket message processing, disconnecting peer %d\n", pNode->id);
-        pNode->closeErrorOnReceive = websocketpp::close::status::unsupported_data;
-        pNode->fDisconnect = true;
+        if (!ProcessMessages(pNode))
+            return;
+        LOCK(pNode->cs_vSend); 
+        WebSocketSendData(pNode);
     }
+    // already on the strand, write the responses now
+    if (pNode->sendQueue.Size() > 0 && !pNode->fFlushQueued.exchange(true))
+        FlushWsSendQueue(pNode);
 }
 
 
@@ -697,6 +745,7 @@ public:
             m_endpoint.set_close_handler(bind(&CWebSocketServer::on_close, this, _1));
             m_endpoint.set_validate_handler(bind(&CWebSocketServer::on_validate, this, _1));
             m_endpoint.set_fail_handler(bind(&CWebSocketServer::on_fail, this, _1));
+            m_endpoint.set_interrupt_handler(bind(&CWebSocketServer::on_interrupt, this, _1));
 
         } 
         catch (websocketpp::exception const & e) {
@@ -715,9 +764,12 @@ public:
             // Queues a connection accept operation
             m_endpoint.start_accept();
 
-            // Start the Asio io_service run loop
+            // Start the Asio io_service run loop on a pool of threads,
+            // handlers of one connection are serialized by its strand
             //m_endpoint.run();
-            for (int i = 0; i < 4; i ++)
+            int nThreads = std::max((int)GetArg("-wsthreads", DEFAULT_WS_THREADS), 1);
+            LogPrintf("Websockets listener started with %d threads\n", nThreads);
+            for (int i = 0; i < nThreads; i ++)
                 vWsThreads.push_back(websocketpp::lib::make_shared<websocketpp::lib::thread>(&wsserver::run, &m_endpoint));
         } 
         catch (websocketpp::exception const & e) {
@@ -732,10 +784,8 @@ public:
         // write a new message
         //std::cerr << __func__ << " payload=" << HexStr(msg->get_payload()) << std::endl;
         //m_endpoint.send(hdl, msg->get_payload(), msg->get_opcode());
-        CAddress clientAddr = GetClientAddressFromHdl(hdl);
-        LOCK(cs_vWsNodes);
-        CWsNodePtr pNode = FindWsNode(clientAddr);
-        //CWsNode *pNode = m_connections[hdl];
+        // do not lock cs_vWsNodes here, that would serialize all io threads
+        CWsNodePtr pNode = FindWsNode(hdl);
         if (!pNode) {
             return;
         }
@@ -799,6 +849,18 @@ public:
         m_endpoint.send(hdl, payload, len, op, ec);
     }
 
+    virtual bool interrupt(websocketpp::connection_hdl hdl) {
+        websocketpp::lib::error_code ec;
+        m_endpoint.interrupt(hdl, ec);
+        return !ec;
+    }
+
+    virtual size_t bufferedAmount(websocketpp::connection_hdl hdl) {
+        websocketpp::lib::error_code ec;
+        wsserver::connection_ptr con = m_endpoint.get_con_from_hdl(hdl, ec);
+        return ec ? 0 : con->get_buffered_amount();
+    }
+
 private:
     bool on_validate(websocketpp::connection_hdl hdl)
     {
@@ -874,9 +936,7 @@ private:
         std::cout << con->get_remote_close_code() << std::endl;
         std::cout << con->get_remote_close_reason() << std::endl;
         std::cout << con->get_ec() << " - " << con->get_ec().message() << std::endl;*/
-        CAddress clientAddr = GetClientAddressFromHdl(hdl);
-        LOCK(cs_vWsNodes);
-        CWsNodePtr pNode = FindWsNode(clientAddr);
+        CWsNodePtr pNode = FindWsNode(hdl);
         if (!pNode) {
             return;
         }
@@ -898,16 +958,19 @@ private:
             LOCK(cs_vWsNodes);
             vWsNodes.push_back(pNode);
         }
+        {
+            LOCK(cs_mapWsNodesByHdl);
+            mapWsNodesByHdl[hdl] = pNode;
+        }
     }
 
     void on_close(websocketpp::connection_hdl hdl)
     {
-        CAddress clientAddr = GetClientAddressFromHdl(hdl);
-        LOCK(cs_vWsNodes);
-        CWsNodePtr pNode = FindWsNode(clientAddr);
+        CWsNodePtr pNode = FindWsNode(hdl);
         if (!pNode) {
             return;
         }
+        LOCK(cs_vWsNodes);
 
         LogPrint("websockets", "closed inbound connection from ws peer %d\n", pNode->GetId());
 
@@ -921,10 +984,20 @@ private:
         m_endpoint.close(hdl, status, "");
     }
 
+    void on_interrupt(websocketpp::connection_hdl hdl)
+    {
+        CWsNodePtr pNode = FindWsNode(hdl);
+        if (pNode)
+            FlushWsSendQueue(pNode.get());
+    }
+
     virtual void sendWsData(CWsNode *pNode)
     {
-        LOCK(pNode->cs_vSend); 
-        WebSocketSendData(this, pNode->m_hdl, pNode);
+        {
+            LOCK(pNode->cs_vSend); 
+            WebSocketSendData(pNode);
+        }
+        ScheduleWsFlush(pNode);
     }
 
     CAddress GetClientAddressFromHdl(websocketpp::connection_hdl hdl) 
@@ -960,6 +1033,7 @@ public:
         m_endpoint.set_open_handler(bind(&CWebSocketOutbound::on_open,this,::_1));
         m_endpoint.set_close_handler(bind(&CWebSocketOutbound::on_close,this,::_1));
         m_endpoint.set_fail_handler(bind(&CWebSocketOutbound::on_fail,this,::_1));
+        m_endpoint.set_interrupt_handler(bind(&CWebSocketOutbound::on_interrupt,this,::_1));
 
         m_bFailed = false;
     }
@@ -1038,12 +1112,18 @@ public:
         m_pNode->PushWsVersion();
         {
             LOCK(m_pNode->cs_vSend); 
-            WebSocketSendData(this, hdl, m_pNode.get());
+            WebSocketSendData(m_pNode.get());
         }
+        if (m_pNode->sendQueue.Size() > 0 && !m_pNode->fFlushQueued.exchange(true))
+            FlushWsSendQueue(m_pNode.get());
     }
     void on_message(websocketpp::connection_hdl hdl, wsclient::message_ptr msg) {
         HandleWebSocketMessage(this, m_pNode.get(), hdl, msg);
     }
+    void on_interrupt(websocketpp::connection_hdl) {
+        if ((bool)m_pNode)
+            FlushWsSendQueue(m_pNode.get());
+    }
     void on_close(websocketpp::connection_hdl) {
         if ((bool)m_pNode) { 
             LOCK(cs_vWsNodes);
@@ -1066,11 +1146,26 @@ public:
         m_endpoint.send(hdl, payload, len, op, ec);
     }
 
+    virtual bool interrupt(websocketpp::connection_hdl hdl) {
+        websocketpp::lib::error_code ec;
+        m_endpoint.interrupt(hdl, ec);
+        return !ec;
+    }
+
+    virtual size_t bufferedAmount(websocketpp::connection_hdl hdl) {
+        websocketpp::lib::error_code ec;
+        wsclient::connection_ptr con = m_endpoint.get_con_from_hdl(hdl, ec);
+        return ec ? 0 : con->get_buffered_amount();
+    }
+
     virtual void sendWsData(CWsNode*)
     {
         if (m_pNode)    {
-            LOCK(m_pNode->cs_vSend); 
-            WebSocketSendData(this, m_pNode->m_hdl, m_pNode.get());
+            {
+                LOCK(m_pNode->cs_vSend); 
+                WebSocketSendData(m_pNode.get());
+            }
+            ScheduleWsFlush(m_pNode.get());
         }
     }
 
@@ -1188,6 +1283,15 @@ void ThreadWebSocketMessageHandler()
 
         for(auto const & pnode : vWsNodesCopy)
         {
+            // errors on the io threads are closed from here
+            if (pnode->closeErrorOnSend || pnode->closeErrorOnReceive) {
+                try {
+                   pnode->m_spWsEndpoint->close(pnode->m_hdl, (pnode->closeErrorOnSend ? pnode->closeErrorOnSend : pnode->closeErrorOnReceive));              
+                } catch (websocketpp::exception const & e) { // might be already closed from remote site or on a error
+                    LogPrint("websockets", "%s close websocketpp::exception: %s (could be normal)\n", __func__, e.what());
+                }
+                continue;
+            }
             if (pnode->fDisconnect)
                 continue;
 
@@ -1197,18 +1301,12 @@ void ThreadWebSocketMessageHandler()
                 if (lockSend)   {
                     bool fTrickle = pnode == pnodeTrickle || pnode->fWhitelisted;
                     SendWsMessages(pnode.get(), fTrickle);
-                    if (fTrickle) {
-                        WebSocketSendData(pnode->m_spWsEndpoint.get(), pnode->m_hdl, pnode.get());  
-                        if (pnode->closeErrorOnSend || pnode->closeErrorOnReceive) {
-                            try {
-                               pnode->m_spWsEndpoint->close(pnode->m_hdl, (pnode->closeErrorOnSend ? pnode->closeErrorOnSend : pnode->closeErrorOnReceive));              
-                            } catch (websocketpp::exception const & e) { // might be already closed from remote site or on a error
-                                LogPrint("websockets", "%s close websocketpp::exception: %s (could be normal)\n", __func__, e.what());
-                            }
-                        }
-                    }
+                    // queue what any node has pushed, pings of non trickle nodes are not held back
+                    WebSocketSendData(pnode.get());
                 }
             }
+            // the io thread of the connection writes the frames, also those a slow peer has left queued
+            ScheduleWsFlush(pnode.get());
 
             boost::this_thread::interruption_point();
         }
@@ -1629,6 +1727,7 @@ UniValue GetWsPeers()
 {
     UniValue result(UniValue::VARR);
     std::vector<CNodeStats> vstats;
+    std::vector<size_t> vSendQueue;
 
     {
         LOCK(cs_vWsNodes);
@@ -1637,10 +1736,12 @@ UniValue GetWsPeers()
             CNodeStats stats;
             pnode->copyStats(stats, wsaddrman.m_asmap);
             vstats.push_back(stats);
+            vSendQueue.push_back(pnode->sendQueue.Size());
         }
     }
 
-    for (auto const &stats : vstats)    {
+    for (size_t i = 0; i < vstats.size(); i ++)    {
+        const CNodeStats &stats = vstats[i];
         UniValue peer(UniValue::VOBJ);
 
         peer.push_back(Pair("id", stats.nodeid));
@@ -1654,6 +1755,9 @@ UniValue GetWsPeers()
         // their ver message.
         peer.push_back(Pair("subver", stats.cleanSubVer));
         peer.push_back(Pair("inbound", stats.fInbound));
+        peer.push_back(Pair("bytessent", stats.nSendBytes));
+        peer.push_back(Pair("bytesrecv", stats.nRecvBytes));
+        peer.push_back(Pair("sendqueue", (uint64_t)vSendQueue[i]));
 
         result.push_back(peer);
     }
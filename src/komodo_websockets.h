@@ -28,7 +28,9 @@
 #include <websocketpp/client.hpp>
 #include <websocketpp/endpoint.hpp>
 #include <websocketpp/connection.hpp>
-//#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+#ifdef ENABLE_WEBSOCKETS_DEFLATE
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+#endif
 
 //using websocketpp::lib::bind;
 
@@ -38,6 +40,11 @@ namespace ws
 static const int WSADDR_VERSION = 170008;
 #define WEBSOCKETS_TIMEOUT_INTERVAL 120
 
+// threads running the io_service of the listener (-wsthreads)
+static const int DEFAULT_WS_THREADS = 4;
+// messages waiting to be written to a connection before the peer is dropped as too slow
+static const size_t WS_SEND_QUEUE_SIZE = 256;
+
 
 struct wsserver_mt_config : public websocketpp::config::asio {  // no tls
 // struct wsserver_mt_config : public websocketpp::config::asio_tls { // tls
@@ -49,11 +56,13 @@ struct wsserver_mt_config : public websocketpp::config::asio {  // no tls
         static bool const enable_multithreading = true;
     };
 
-    /// permessage_compress extension
-    // struct permessage_deflate_config {};
+#ifdef ENABLE_WEBSOCKETS_DEFLATE
+    /// permessage_compress extension, used with clients that offer it (configure --enable-websockets-deflate)
+    struct permessage_deflate_config {};
 
-    // typedef websocketpp::extensions::permessage_deflate::enabled
-    //     <permessage_deflate_config> permessage_deflate_type;
+    typedef websocketpp::extensions::permessage_deflate::enabled
+        <permessage_deflate_config> permessage_deflate_type;
+#endif
 };
 
 typedef websocketpp::server<wsserver_mt_config> wsserver;   // no tls
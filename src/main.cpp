@@ -29,7 +29,10 @@
 #include "importcoin.h"
 #include "chainparams.h"
 #include "checkpoints.h"
+#include "chainsnapshot.h"
 #include "checkqueue.h"
+#include "blockimport.h"
+#include "coinsflush.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
 #include "deprecation.h"
@@ -38,6 +41,8 @@
 #include "metrics.h"
 #include "notarisationdb.h"
 #include "net.h"
+#include "netrelaycache.h"
+#include "nspvscheduler.h"
 #include "pow.h"
 #include "script/interpreter.h"
 #include "txdb.h"
@@ -88,6 +93,10 @@ int32_t KOMODO_NEWBLOCKS;
 
 
 BlockMap mapBlockIndex;
+/** Owns every CBlockIndex referenced from mapBlockIndex. */
+static CArena<CBlockIndex> blockIndexArena;
+/** Entries written to the block tree database that still hold their solution, see BLOCK_SOLUTION_WINDOW. */
+static std::vector<CBlockIndex*> vBlockSolutionWindow;
 CChain chainActive;
 CBlockIndex *pindexBestHeader = NULL;
 static int64_t nTimeBestReceived = 0;
@@ -111,6 +120,7 @@ size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
 bool fAlerts = DEFAULT_ALERTS;
 bool fUnspentCCIndex = false;
+bool fOraclesIndex = false;
 
 /* If the tip is older than this (in seconds), the node is considered to be in initial block download.
  */
@@ -651,6 +661,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 CCoinsViewCache *pcoinsTip = NULL;
+CCoinsViewAsyncFlush *pcoinsAsyncFlush = NULL;
 CBlockTreeDB *pblocktree = NULL;
 
 // Komodo globals
@@ -2147,6 +2158,10 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
                 if (fUnspentCCIndex) {
                     pool.addUnspentCCIndex(entry, view);  // add mempool unspent cc index for cc vin/vouts
                 }
+
+                if (fOraclesIndex) {
+                    pool.addOraclesDataIndex(entry);
+                }
             }
         }
     }
@@ -2226,6 +2241,18 @@ bool GetUnspentCCIndex(uint160 addressHash, uint256 creationId,
     return true;
 }
 
+bool GetOraclesDataIndex(uint256 oracletxid, uint160 batonHash,
+                         std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue> > &samples, int32_t beginHeight, int32_t endHeight, int64_t maxSamples)
+{
+    if (!fOraclesIndex)
+        return error("oracles data index not enabled");
+
+    if (!pblocktree->ReadOraclesDataIndex(oracletxid, batonHash, samples, beginHeight, endHeight, maxSamples))
+        return error("unable to get samples from oracles data index");
+
+    return true;
+}
+
 struct CompareBlocksByHeightMain
 {
     bool operator()(const CBlockIndex* a, const CBlockIndex* b) const
@@ -3294,6 +3321,7 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
     std::vector<std::pair<CUnspentCCIndexKey, CUnspentCCIndexValue> > unspentCCIndex; // index for cc transactions
+    std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue> > oraclesDataIndex;
 
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
@@ -3480,6 +3508,13 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
         }
     }
 
+    if (fOraclesIndex) {
+        OraclesDataIndexBlock(block, pindex->GetHeight(), false, oraclesDataIndex);  // erase the samples
+        if (!pblocktree->UpdateOraclesDataIndex(oraclesDataIndex)) {
+            return AbortNode(state, "Failed to write oracles data index");
+        }
+    }
+
     return fClean;
 }
 
@@ -3515,6 +3550,44 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CEquihashCheck> equihashcheckqueue(8);
+// the queue serves one batch at a time
+static CCriticalSection cs_equihashcheckqueue;
+
+void ThreadEquihashCheck() {
+    RenameThread("komodo-ehcheck");
+    equihashcheckqueue.Thread();
+}
+
+bool CheckEquihashSolutions(const std::vector<const CBlockHeader*>& vHeaders, const CChainParams& chainparams, bool fUseCache)
+{
+    std::vector<uint256> vHashes;
+    vHashes.reserve(vHeaders.size());
+    BOOST_FOREACH(const CBlockHeader* pheader, vHeaders)
+        vHashes.push_back(pheader->GetHash());
+    return CheckEquihashSolutions(vHeaders, vHashes, chainparams, fUseCache);
+}
+
+bool CheckEquihashSolutions(const std::vector<const CBlockHeader*>& vHeaders, const std::vector<uint256>& vHashes, const CChainParams& chainparams, bool fUseCache)
+{
+    assert(vHashes.size() == vHeaders.size());
+    std::vector<CEquihashCheck> vChecks;
+    vChecks.reserve(vHeaders.size());
+    for (size_t i = 0; i < vHeaders.size(); i++)
+        vChecks.push_back(CEquihashCheck(vHeaders[i], vHashes[i], chainparams, fUseCache));
+    if (nScriptCheckThreads == 0 || vChecks.size() <= 1) {
+        BOOST_FOREACH(CEquihashCheck& check, vChecks)
+            if (!check())
+                return false;
+        return true;
+    }
+
+    LOCK(cs_equihashcheckqueue);
+    CCheckQueueControl<CEquihashCheck> control(&equihashcheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -3743,6 +3816,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
     std::vector<std::pair<CUnspentCCIndexKey, CUnspentCCIndexValue> > unspentCCIndex; // index for cc transactions
+    std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue> > oraclesDataIndex;
 
     // Construct the incremental merkle tree at the current
     // block position,
@@ -4099,6 +4173,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
     }
 
+    if (fOraclesIndex)    {
+        OraclesDataIndexBlock(block, pindex->GetHeight(), true, oraclesDataIndex);
+        if (!pblocktree->UpdateOraclesDataIndex(oraclesDataIndex)) {
+            return AbortNode(state, "Failed to write oracles data index");
+        }
+    }
+
     if (fSpentIndex)
         if (!pblocktree->UpdateSpentIndex(spentIndex))
             return AbortNode(state, "Failed to write transaction index");
@@ -4157,6 +4238,22 @@ enum FlushStateMode {
     FLUSH_STATE_ALWAYS
 };
 
+/** Drop the in-memory solutions of written entries that fell out of BLOCK_SOLUTION_WINDOW, requires cs_main. */
+static void TrimBlockSolutions()
+{
+    int nKeepHeight = (pindexBestHeader != NULL ? pindexBestHeader->GetHeight() : 0) - (int)BLOCK_SOLUTION_WINDOW;
+    std::sort(vBlockSolutionWindow.begin(), vBlockSolutionWindow.end());
+    vBlockSolutionWindow.erase(std::unique(vBlockSolutionWindow.begin(), vBlockSolutionWindow.end()), vBlockSolutionWindow.end());
+    std::vector<CBlockIndex*>::iterator itKeep = vBlockSolutionWindow.begin();
+    for (std::vector<CBlockIndex*>::iterator it = vBlockSolutionWindow.begin(); it != vBlockSolutionWindow.end(); it++) {
+        if ((*it)->GetHeight() < nKeepHeight)
+            (*it)->TrimSolution();
+        else
+            *itKeep++ = *it;
+    }
+    vBlockSolutionWindow.erase(itKeep, vBlockSolutionWindow.end());
+}
+
 /**
  * Update the on-disk chain state.
  * The caches and indexes are flushed depending on the mode we're called with
@@ -4193,6 +4290,8 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         if (nLastSetChain == 0) {
             nLastSetChain = nNow;
         }
+        if (pcoinsAsyncFlush && !pcoinsAsyncFlush->IsHealthy())
+            return AbortNode(state, "Failed to write to coin database");
         size_t cacheSize = pcoinsTip->DynamicMemoryUsage();
         // The cache is large and close to the limit, but we have time now (not in the middle of a block processing).
         bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize * (10.0/9) > nCoinCacheUsage;
@@ -4229,10 +4328,18 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                     return AbortNode(state, "Files to write to block index database");
                 }
-            }
-            // Finally remove any pruned files
-            if (fFlushForPrune)
+                // The solutions are on disk now, keep only those near the best header for getheaders
+                for (size_t i = 0; i < vBlocks.size(); i++)
+                    vBlockSolutionWindow.push_back(const_cast<CBlockIndex*>(vBlocks[i]));
+                TrimBlockSolutions();
+            }
+            // Finally remove any pruned files. A coins flush still being written may
+            // need their blocks and undo data for recovery, so let it finish first.
+            if (fFlushForPrune) {
+                if (pcoinsAsyncFlush && !pcoinsAsyncFlush->Sync())
+                    return AbortNode(state, "Failed to write to coin database");
                 UnlinkPrunedFiles(setFilesToPrune);
+            }
             nLastWrite = nNow;
         }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -4244,9 +4351,13 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
             // overwrite one. Still, use a conservative safety factor of 2.
             if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
-            // Flush the chainstate (which may refer to block index entries).
+            // Flush the chainstate (which may refer to block index entries). The
+            // write itself happens in the background unless everything must be
+            // on disk when we return.
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            if (mode == FLUSH_STATE_ALWAYS && pcoinsAsyncFlush && !pcoinsAsyncFlush->Sync())
+                return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
         }
         if ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000) {
@@ -4272,10 +4383,130 @@ void PruneAndFlush() {
     FlushStateToDisk(state, FLUSH_STATE_NONE);
 }
 
+namespace {
+
+/** Undo the coin changes of a block without requiring the coins to be in their post-block state. */
+bool RollbackCoinsForRecovery(const CBlockIndex* pindex, CCoinsViewCache& view)
+{
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, false))
+        return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+    CBlockUndo blockUndo;
+    CDiskBlockPos pos = pindex->GetUndoPos();
+    if (pos.IsNull() || !UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash()))
+        return error("%s: no undo data for block %s", __func__, pindex->GetBlockHash().ToString());
+    if (blockUndo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent", __func__);
+
+    for (int i = block.vtx.size() - 1; i >= 0; i--) {
+        const CTransaction &tx = block.vtx[i];
+        view.ModifyCoins(tx.GetHash())->Clear();
+
+        if (!tx.IsMint()) {
+            CTxUndo txundo = blockUndo.vtxundo[i-1];
+            if (tx.IsPegsImport()) txundo.vprevout.insert(txundo.vprevout.begin(),CTxInUndo());
+            if (txundo.vprevout.size() != tx.vin.size())
+                return error("%s: transaction and undo data inconsistent", __func__);
+            for (unsigned int j = tx.vin.size(); j-- > 0;) {
+                if (tx.IsPegsImport() && j==0)  continue;
+                // Unlike ApplyTxInUndo the output may already be present, if this
+                // part of the flush never reached the disk.
+                const COutPoint &out = tx.vin[j].prevout;
+                const CTxInUndo &undo = txundo.vprevout[j];
+                CCoinsModifier coins = view.ModifyCoins(out.hash);
+                if (undo.nHeight != 0) {
+                    coins->fCoinBase = undo.fCoinBase;
+                    coins->nHeight = undo.nHeight;
+                    coins->nVersion = undo.nVersion;
+                }
+                if (coins->vout.size() < out.n+1)
+                    coins->vout.resize(out.n+1);
+                coins->vout[out.n] = undo.txout;
+            }
+        }
+        else if (tx.IsCoinImport() || tx.IsPegsImport())
+        {
+            RemoveImportTombstone(tx, view);
+        }
+    }
+    return true;
+}
+
+/** Apply the coin changes of a block, skipping spends that are already on disk. */
+bool RollforwardCoinsForRecovery(const CBlockIndex* pindex, CCoinsViewCache& view)
+{
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, false))
+        return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+
+    for (const CTransaction& tx : block.vtx) {
+        if (!tx.IsMint()) {
+            for (const CTxIn& txin : tx.vin) {
+                if (tx.IsPegsImport() && txin.prevout.n==10e8) continue;
+                view.ModifyCoins(txin.prevout.hash)->Spend(txin.prevout.n);
+            }
+        }
+        view.ModifyCoins(tx.GetHash())->FromTx(tx, pindex->GetHeight());
+        if (tx.IsCoinImport() || tx.IsPegsImport()) {
+            RemoveImportTombstone(tx, view);
+            AddImportTombstone(tx, view, pindex->GetHeight());
+        }
+    }
+    return true;
+}
+
+} // anon namespace
+
+bool RecoverInterruptedCoinsFlush(CCoinsViewDB* coinsdb)
+{
+    LOCK(cs_main);
+    std::vector<uint256> vHashHeadBlocks = coinsdb->GetHeadBlocks();
+    if (vHashHeadBlocks.empty())
+        return true;
+    if (vHashHeadBlocks.size() != 2)
+        return error("%s: unknown coins flush marker", __func__);
+
+    // The coins written so far belong to the new best block, everything else
+    // (including the best block marker) is still at the old one. Undo the new
+    // branch down to the fork point and redo the old branch from there, which
+    // leaves the coins the flush touched at the old best block.
+    BlockMap::iterator itNew = mapBlockIndex.find(vHashHeadBlocks[0]);
+    if (itNew == mapBlockIndex.end())
+        return error("%s: flushed block %s is not in the block index", __func__, vHashHeadBlocks[0].ToString());
+    CBlockIndex* pindexNew = itNew->second;
+    CBlockIndex* pindexOld = NULL;
+    if (!vHashHeadBlocks[1].IsNull()) {
+        BlockMap::iterator itOld = mapBlockIndex.find(vHashHeadBlocks[1]);
+        if (itOld == mapBlockIndex.end())
+            return error("%s: best block %s is not in the block index", __func__, vHashHeadBlocks[1].ToString());
+        pindexOld = itOld->second;
+    }
+    const CBlockIndex* pindexFork = pindexOld ? LastCommonAncestor(pindexOld, pindexNew) : NULL;
+    LogPrintf("Recovering coins from an interrupted flush: rolling back from height %d to %d\n",
+              pindexNew->GetHeight(), pindexOld ? pindexOld->GetHeight() : 0);
+
+    CCoinsViewCache cache(coinsdb);
+    // the genesis block is never applied to the coins
+    for (const CBlockIndex* pindex = pindexNew; pindex != pindexFork && pindex->pprev; pindex = pindex->pprev) {
+        if (!RollbackCoinsForRecovery(pindex, cache))
+            return false;
+    }
+    std::vector<const CBlockIndex*> vRedo;
+    for (const CBlockIndex* pindex = pindexOld; pindex != pindexFork && pindex->pprev; pindex = pindex->pprev)
+        vRedo.push_back(pindex);
+    for (std::vector<const CBlockIndex*>::reverse_iterator it = vRedo.rbegin(); it != vRedo.rend(); ++it) {
+        if (!RollforwardCoinsForRecovery(*it, cache))
+            return false;
+    }
+    // the best block marker is unchanged; the final batch clears the flush marker
+    return cache.Flush();
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew) {
     const CChainParams& chainParams = Params();
     chainActive.SetTip(pindexNew);
+    PublishChainSnapshot(pindexNew);
 
     // New best block
     nTimeBestReceived = GetTime();
@@ -4423,6 +4654,8 @@ bool static DisconnectTip(CValidationState &state, bool fBare = false) {
 #endif
         } else SyncWithWallets(tx, NULL);
     }
+    if ( KOMODO_NSPV_FULLNODE && ASSETCHAINS_CBOPRET != 0 && ASSETCHAINS_CC != 0 )
+        PricesBlockDisconnected(block,pindexDelete);
     // Update cached incremental witnesses
     GetMainSignals().ChainTip(pindexDelete, &block, newSproutTree, newSaplingTree, false);
     return true;
@@ -4684,7 +4917,11 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
     if ( KOMODO_NSPV_FULLNODE )
     {
         if ( ASSETCHAINS_CBOPRET != 0 )
+        {
             komodo_pricesupdate(pindexNew->GetHeight(),pblock);
+            if ( ASSETCHAINS_CC != 0 )
+                PricesBlockConnected(*pblock,pindexNew);
+        }
         if ( ASSETCHAINS_SAPLING <= 0 && pindexNew->nTime > KOMODO_SAPLING_ACTIVATION - 24*3600 )
             komodo_activate_sapling(pindexNew);
         if ( ASSETCHAINS_CC != 0 && KOMODO_SNAPSHOT_INTERVAL != 0 && (pindexNew->GetHeight() % KOMODO_SNAPSHOT_INTERVAL) == 0 && pindexNew->GetHeight() >= KOMODO_SNAPSHOT_INTERVAL )
@@ -5101,8 +5338,7 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
         }
     }
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
-    assert(pindexNew);
+    CBlockIndex* pindexNew = blockIndexArena.Allocate(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -5440,7 +5676,9 @@ bool CheckBlockHeader(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,
     // Check Equihash solution is valid
     if ( fCheckPOW )
     {
-        if ( !CheckEquihashSolution(&blockhdr, Params()) )
+        // when given, pindex is the entry of this header (ConnectBlock), reuse its hash
+        bool fValid = pindex != NULL && pindex->phashBlock != NULL ? CheckEquihashSolution(&blockhdr, pindex->GetBlockHash(), Params()) : CheckEquihashSolution(&blockhdr, Params());
+        if ( !fValid )
             return state.DoS(100, error("CheckBlockHeader(): Equihash solution invalid"),REJECT_INVALID, "invalid-solution");
     }
     // Check proof of work matches claimed amount
@@ -5688,6 +5926,10 @@ bool CheckBlock(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,const C
                     if (fUnspentCCIndex) {
                         mempool.addUnspentCCIndex(e, view);  // add mempool unspent cc index for cc vin/vouts
                     }
+
+                    if (fOraclesIndex) {
+                        mempool.addOraclesDataIndex(e);
+                    }
                 }
                 else
                 {
@@ -6096,9 +6338,7 @@ CBlockIndex *oldkomodo_ensure(CBlock *pblock, uint256 hash)
     CBlockIndex *pindex=0,*previndex=0;
     if ( (pindex = komodo_getblockindex(hash)) == 0 )
     {
-        pindex = new CBlockIndex();
-        if (!pindex)
-            throw runtime_error("komodo_ensure: new CBlockIndex failed");
+        pindex = blockIndexArena.Allocate();
         BlockMap::iterator mi = mapBlockIndex.insert(make_pair(hash, pindex)).first;
         pindex->phashBlock = &((*mi).first);
     }
@@ -6445,9 +6685,7 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    if (!pindexNew)
-        throw runtime_error("LoadBlockIndex(): new CBlockIndex failed");
+    CBlockIndex* pindexNew = blockIndexArena.Allocate();
     mi = mapBlockIndex.insert(make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
     //fprintf(stderr,"inserted to block index %s\n",hash.ToString().c_str());
@@ -6455,13 +6693,41 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
     return pindexNew;
 }
 
+CBlockIndexMemoryStats GetBlockIndexMemoryStats()
+{
+    AssertLockHeld(cs_main);
+    CBlockIndexMemoryStats stats;
+    stats.nEntries = mapBlockIndex.size();
+    stats.nSolutions = 0;
+    stats.nSolutionBytes = 0;
+    for (BlockMap::const_iterator it = mapBlockIndex.begin(); it != mapBlockIndex.end(); ++it) {
+        size_t nBytes = it->second != NULL ? it->second->SolutionMemoryUsage() : 0;
+        if (nBytes != 0) {
+            stats.nSolutions++;
+            stats.nSolutionBytes += nBytes;
+        }
+    }
+    stats.nArenaBytes = blockIndexArena.DynamicMemoryUsage();
+    stats.nMapBytes = mapBlockIndex.DynamicMemoryUsage();
+
+    std::vector<unsigned char> vchSolution;
+    if (chainActive.Tip() != NULL)
+        chainActive.Tip()->ReadSolution(vchSolution);
+    size_t nSolutionSize = vchSolution.size();
+    stats.nLegacyBytes = stats.nEntries * (memusage::MallocUsage(sizeof(CBlockIndex)) +
+                                           memusage::MallocUsage(nSolutionSize) +
+                                           memusage::MallocUsage(sizeof(memusage::boost_unordered_node<BlockMap::value_type>)) +
+                                           sizeof(void*));
+    return stats;
+}
+
 //void komodo_pindex_init(CBlockIndex *pindex,int32_t height);
 
 bool static LoadBlockIndexDB()
 {
     const CChainParams& chainparams = Params();
     LogPrintf("%s: start loading guts\n", __func__);
-    if (!pblocktree->LoadBlockIndexGuts())
+    if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex))
         return false;
     LogPrintf("%s: loaded guts\n", __func__);
     boost::this_thread::interruption_point();
@@ -6533,6 +6799,11 @@ bool static LoadBlockIndexDB()
             pindexBestHeader = pindex;
         //komodo_pindex_init(pindex,(int32_t)pindex->GetHeight());
     }
+    // Solutions near the best header are served with getheaders, read them back once
+    for (CBlockIndex *pindex = pindexBestHeader; pindex != NULL && vBlockSolutionWindow.size() < BLOCK_SOLUTION_WINDOW; pindex = pindex->pprev) {
+        if (pindex->LoadSolution())
+            vBlockSolutionWindow.push_back(pindex);
+    }
     //fprintf(stderr,"load blockindexDB chained %u\n",(uint32_t)time(NULL));
 
     // Load block file info
@@ -6600,6 +6871,9 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("unspentccindex", fUnspentCCIndex);
     LogPrintf("%s: unspent cc index %s\n", __func__, fUnspentCCIndex ? "enabled" : "disabled");
 
+    pblocktree->ReadFlag("oraclesindex", fOraclesIndex);
+    LogPrintf("%s: oracles data index %s\n", __func__, fOraclesIndex ? "enabled" : "disabled");
+
     // Fill in-memory data
     BOOST_FOREACH(const PAIRTYPE(uint256, CBlockIndex*)& item, mapBlockIndex)
     {
@@ -6621,6 +6895,7 @@ bool static LoadBlockIndexDB()
         return true;
 
     chainActive.SetTip(it->second);
+    PublishChainSnapshot(it->second);
 
     // Set hashFinalSproutRoot for the end of best chain
     it->second->hashFinalSproutRoot = pcoinsTip->GetBestAnchor(SPROUT);
@@ -6897,6 +7172,7 @@ void UnloadBlockIndex()
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    PublishChainSnapshot(NULL);
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
     mempool.clear();
@@ -6917,10 +7193,9 @@ void UnloadBlockIndex()
     mapNodeState.clear();
     recentRejects.reset(NULL);
 
-    BOOST_FOREACH(BlockMap::value_type& entry, mapBlockIndex) {
-        delete entry.second;
-    }
+    vBlockSolutionWindow.clear();
     mapBlockIndex.clear();
+    blockIndexArena.Clear();
     fHavePruned = false;
 }
 
@@ -6971,6 +7246,9 @@ bool InitBlockIndex() {
         pblocktree->WriteFlag("unspentccindex", fUnspentCCIndex);
         fprintf(stderr, "fUnspentCCIndex.%d\n", fUnspentCCIndex);
 
+        fOraclesIndex = GetBoolArg("-oraclesindex", DEFAULT_ORACLESINDEX);
+        pblocktree->WriteFlag("oraclesindex", fOraclesIndex);
+
         LogPrintf("Initializing databases...\n");
     }
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -7015,46 +7293,24 @@ bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos *dbp)
 
     int nLoaded = 0;
     try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        //CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
-        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE(10000000), MAX_BLOCK_SIZE(10000000)+8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
+        // This takes over fileIn. Blocks are read, deserialized and checked for
+        // Equihash and merkle root validity ahead of this thread, and come out in file order.
+        CBlockFilePrefetcher blkdat(fileIn, chainparams, MAX_BLOCK_SIZE(10000000));
+        CBlockFileEntry* pentry;
+        while ((pentry = blkdat.Next()) != NULL) {
             boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(Params().MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE(10000000))
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
+            CBlock& block = pentry->block;
+            uint256 hash = pentry->hash;
+            if (!pentry->fValid) {
+                LogPrintf("%s: Block %s failed context-free checks: %s\n", __func__, hash.ToString(), pentry->strError);
+                continue;
             }
             try {
-                // read block
-                CBlock block;
-                uint64_t nBlockPos = blkdat.GetPos();
                 if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                blkdat >> block;
-                
-                nRewind = blkdat.GetPos();
+                    dbp->nPos = pentry->nPos;
+
                 // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
                 if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
                     LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
                              block.hashPrevBlock.ToString());
@@ -7442,9 +7698,20 @@ void static ProcessGetData(CNode* pfrom)
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
                 {
+                    // Full blocks are served from the relay cache, so a block requested by
+                    // many peers is read from disk and serialized once.
+                    int nSendVersion = std::min(pfrom->nVersion, PROTOCOL_VERSION);
+                    CSerializeDataRef msgBlock;
+                    if (inv.type == MSG_BLOCK)
+                        msgBlock = RelayWireCache().Get(RELAYCACHE_BLOCK, inv.hash, nSendVersion);
+
                     // Send block from disk
                     CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second,1))
+                    if (msgBlock)
+                    {
+                        pfrom->PushWireMessage(msgBlock);
+                    }
+                    else if (!ReadBlockFromDisk(block, (*mi).second,1))
                     {
                         assert(!"cannot load block from disk");
                     }
@@ -7457,7 +7724,9 @@ void static ProcessGetData(CNode* pfrom)
                             //for (z=31; z>=0; z--)
                             //    fprintf(stderr,"%02x",((uint8_t *)&hash)[z]);
                             //fprintf(stderr," send block %d\n",komodo_block2height(&block));
-                            pfrom->PushMessage("block", block);
+                            msgBlock = CNode::MakeWireMessage("block", nSendVersion, block);
+                            RelayWireCache().Insert(RELAYCACHE_BLOCK, inv.hash, nSendVersion, msgBlock);
+                            pfrom->PushWireMessage(msgBlock);
                         }
                         else // MSG_FILTERED_BLOCK)
                         {
@@ -7499,18 +7768,22 @@ void static ProcessGetData(CNode* pfrom)
                 // Send stream from relay memory
                 bool pushed = false;
                 {
-                    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                    bool found = false;
+                    // mapRelay holds the payload already serialized; the framed message is
+                    // kept in the relay cache so it is not copied and checksummed again per peer
+                    CSerializeDataRef msg;
                     {
                         LOCK(cs_mapRelay);
                         map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
                         if (mi != mapRelay.end())  {
-                            ss = ((*mi).second);
-                            found = true;
+                            msg = RelayWireCache().Get(RELAYCACHE_TX, inv.hash, PROTOCOL_VERSION);
+                            if (!msg) {
+                                msg = CNode::MakeWireMessage(inv.GetCommand(), PROTOCOL_VERSION, (*mi).second);
+                                RelayWireCache().Insert(RELAYCACHE_TX, inv.hash, PROTOCOL_VERSION, msg);
+                            }
                         }
                     }
-                    if (found) {
-                        pfrom->PushMessage(inv.GetCommand(), ss);
+                    if (msg) {
+                        pfrom->PushWireMessage(msg);
                         pushed = true;
                     }
                 }
@@ -7954,7 +8227,11 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         vRecv >> payload;
 
         if (strCommand == "getnSPV" && KOMODO_NSPV_FULLNODE) {
-            komodo_nSPVreq(pfrom, payload);
+            // websocket peers are served on their own handler thread
+            if (pnspvscheduler != NULL && pfrom->hSocket != INVALID_SOCKET)
+                pnspvscheduler->Submit(pfrom, payload);
+            else
+                komodo_nSPVreq(pfrom, payload);
         } else if (strCommand == "nSPV" && KOMODO_NSPV_SUPERLITE) {
             komodo_nSPVresp(pfrom, payload);
         }
@@ -8090,57 +8367,62 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         uint256 hashStop;
         vRecv >> locator >> hashStop;
 
-        LOCK(cs_main);
-
-        if (chainActive.LastTip() != 0 && chainActive.LastTip()->GetHeight() > 100000 && IsInitialBlockDownload())
+        // Entries never go away, so the solutions of trimmed ones are read after releasing cs_main
+        vector<CBlockIndex*> vIndex;
         {
-            //fprintf(stderr,"dont process getheaders during initial download\n");
-            return true;
-        }
-        CBlockIndex* pindex = NULL;
-        if (locator.IsNull())
-        {
-            // If locator is null, return the hashStop block
-            BlockMap::iterator mi = mapBlockIndex.find(hashStop);
-            if (mi == mapBlockIndex.end())
+            LOCK(cs_main);
+
+            if (chainActive.LastTip() != 0 && chainActive.LastTip()->GetHeight() > 100000 && IsInitialBlockDownload())
             {
-                //fprintf(stderr,"mi == end()\n");
+                //fprintf(stderr,"dont process getheaders during initial download\n");
                 return true;
             }
-            pindex = (*mi).second;
-        }
-        else
-        {
-            // Find the last block the caller has in the main chain
-            pindex = FindForkInGlobalIndex(chainActive, locator);
-            if (pindex)
-                pindex = chainActive.Next(pindex);
-        }
+            CBlockIndex* pindex = NULL;
+            if (locator.IsNull())
+            {
+                // If locator is null, return the hashStop block
+                BlockMap::iterator mi = mapBlockIndex.find(hashStop);
+                if (mi == mapBlockIndex.end())
+                {
+                    //fprintf(stderr,"mi == end()\n");
+                    return true;
+                }
+                pindex = (*mi).second;
+            }
+            else
+            {
+                // Find the last block the caller has in the main chain
+                pindex = FindForkInGlobalIndex(chainActive, locator);
+                if (pindex)
+                    pindex = chainActive.Next(pindex);
+            }
 
-        // we must use CNetworkBlockHeader, as CBlockHeader won't include the 0x00 nTx count at the end for compatibility
-        vector<CNetworkBlockHeader> vHeaders;
-        int nLimit = MAX_HEADERS_RESULTS;
-        LogPrint("net", "getheaders %d to %s from peer=%d\n", (pindex ? pindex->GetHeight() : -1), hashStop.ToString(), pfrom->id);
-        //if ( pfrom->lasthdrsreq >= chainActive.Height()-MAX_HEADERS_RESULTS || pfrom->lasthdrsreq != (int32_t)(pindex ? pindex->GetHeight() : -1) )// no need to ever suppress this
-        {
+            int nLimit = MAX_HEADERS_RESULTS;
+            LogPrint("net", "getheaders %d to %s from peer=%d\n", (pindex ? pindex->GetHeight() : -1), hashStop.ToString(), pfrom->id);
             pfrom->lasthdrsreq = (int32_t)(pindex ? pindex->GetHeight() : -1);
             for (; pindex; pindex = chainActive.Next(pindex))
             {
-                CBlockHeader h = pindex->GetBlockHeader();
-                //printf("size.%i, solution size.%i\n", (int)sizeof(h), (int)h.nSolution.size());
-                //printf("hash.%s prevhash.%s nonce.%s\n", h.GetHash().ToString().c_str(), h.hashPrevBlock.ToString().c_str(), h.nNonce.ToString().c_str());
-                vHeaders.push_back(pindex->GetBlockHeader());
+                vIndex.push_back(pindex);
                 if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
                     break;
             }
-            pfrom->PushMessage("headers", vHeaders);
         }
-        /*else if ( IS_KOMODO_NOTARY != 0 )
+
+        // we must use CNetworkBlockHeader, as CBlockHeader won't include the 0x00 nTx count at the end for compatibility
+        vector<CNetworkBlockHeader> vHeaders;
+        vHeaders.reserve(vIndex.size());
+        for (size_t i = 0; i < vIndex.size(); i++)
         {
-            static uint32_t counter;
-            if ( counter++ < 3 )
-                fprintf(stderr,"you can ignore redundant getheaders from peer.%d %d prev.%d\n",(int32_t)pfrom->id,(int32_t)(pindex ? pindex->GetHeight() : -1),pfrom->lasthdrsreq);
-        }*/
+            CBlockHeader header;
+            if (!vIndex[i]->ReadBlockHeader(header))
+            {
+                // the peer asks again from the last header it got
+                LogPrintf("getheaders: failed to read the solution of %s, sending %u headers to peer=%d\n", vIndex[i]->GetBlockHash().ToString(), (unsigned int)vHeaders.size(), pfrom->id);
+                break;
+            }
+            vHeaders.push_back(header);
+        }
+        pfrom->PushMessage("headers", vHeaders);
     }
 
 
@@ -8296,6 +8578,22 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
+        // Verify the Equihash solutions of the headers we don't know yet as one batch,
+        // spread over the check threads and without holding cs_main.
+        std::vector<const CBlockHeader*> vNewHeaders;
+        std::vector<uint256> vNewHashes;
+        {
+            LOCK(cs_main);
+            BOOST_FOREACH(const CBlockHeader& header, headers) {
+                uint256 hash = header.GetHash();
+                if (mapBlockIndex.count(hash) == 0) {
+                    vNewHeaders.push_back(&header);
+                    vNewHashes.push_back(hash);
+                }
+            }
+        }
+        bool fSolutionsValid = CheckEquihashSolutions(vNewHeaders, vNewHashes, Params());
+
         LOCK(cs_main);
 
         if (nCount == 0) {
@@ -8303,6 +8601,11 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             return true;
         }
 
+        if (!fSolutionsValid) {
+            Misbehaving(pfrom->GetId(), 20);
+            return error("headers with an invalid Equihash solution received");
+        }
+
         bool hasNewHeaders = true;
 
         // only KMD have checkpoints in sources, so, using IsInitialBlockDownload() here is
@@ -8980,10 +9283,9 @@ public:
     CMainCleanup() {}
     ~CMainCleanup() {
         // block headers
-        BlockMap::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
+        vBlockSolutionWindow.clear();
         mapBlockIndex.clear();
+        blockIndexArena.Clear();
 
         // orphan transactions
         mapOrphanTransactions.clear();
@@ -26,12 +26,14 @@
 #endif
 
 #include "amount.h"
+#include "blockmap.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "coins.h"
 #include "consensus/consensus.h"
 #include "consensus/upgrades.h"
 #include "net.h"
+#include "oraclesindex.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "script/script.h"
@@ -59,6 +61,8 @@
 class CBlockIndex;
 class CBlockTreeDB;
 class CBloomFilter;
+class CCoinsViewAsyncFlush;
+class CCoinsViewDB;
 class CInv;
 class CScriptCheck;
 class CValidationInterface;
@@ -110,6 +114,9 @@ static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
  *  less than this number, we reached its tip. Changing this value is a protocol upgrade. */
 static const unsigned int MAX_HEADERS_RESULTS = 160;
+/** Equihash solutions of block index entries this close to the best header stay in memory after they are
+ *  written, so getheaders from synced peers does not go to the block tree database. */
+static const unsigned int BLOCK_SOLUTION_WINDOW = 2000;
 /** Size of the "block download window": how far ahead of our current height do we fetch?
  *  Larger windows tolerate larger download speed differences between peer, but increase the potential
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
@@ -132,6 +139,9 @@ static const bool DEFAULT_NSPV_PROCESSING = true;
 /** Default unspent cc enabled for Tokel */
 static const bool DEFAULT_UNSPENTCCINDEX = true;
 
+/** Default oracles data samples index enabled for Tokel */
+static const bool DEFAULT_ORACLESINDEX = true;
+
 static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const unsigned int DEFAULT_DB_MAX_OPEN_FILES = 1000;
 static const bool DEFAULT_DB_COMPRESSION = true;
@@ -144,16 +154,11 @@ BOOST_STATIC_ASSERT(DEFAULT_BLOCK_PRIORITY_SIZE <= DEFAULT_BLOCK_MAX_SIZE);
     ((CBlockHeader::HEADER_SIZE + equihash_solution_size(N, K))*MAX_HEADERS_RESULTS < \
      MAX_PROTOCOL_MESSAGE_LENGTH-1000)
 
-struct BlockHasher
-{
-    size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
-};
-
 extern unsigned int expiryDelta;
 extern CScript COINBASE_FLAGS;
 extern CCriticalSection cs_main;
 extern CTxMemPool mempool;
-typedef boost::unordered_map<uint256, CBlockIndex*, BlockHasher> BlockMap;
+typedef CBlockMap BlockMap;
 extern BlockMap mapBlockIndex;
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
@@ -236,6 +241,18 @@ bool InitBlockIndex();
 bool LoadBlockIndex();
 /** Unload database information */
 void UnloadBlockIndex();
+
+struct CBlockIndexMemoryStats
+{
+    uint64_t nEntries;          // entries in mapBlockIndex
+    uint64_t nSolutions;        // entries still holding their Equihash solution
+    uint64_t nArenaBytes;       // CBlockIndex objects
+    uint64_t nMapBytes;         // mapBlockIndex table and entries
+    uint64_t nSolutionBytes;    // solutions held in memory
+    uint64_t nLegacyBytes;      // estimate for one heap CBlockIndex per entry with its solution, in a boost::unordered_map
+};
+/** Memory used by the block index, requires cs_main */
+CBlockIndexMemoryStats GetBlockIndexMemoryStats();
 /** Process protocol messages received from a given node */
 bool ProcessMessages(CNode* pfrom);
 /**
@@ -247,6 +264,15 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto, bool fSendTrickle);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the Equihash checking thread */
+void ThreadEquihashCheck();
+/**
+ * Verify the Equihash solutions of a batch of headers, spread over the Equihash
+ * checking threads. Returns false if any solution is invalid.
+ */
+bool CheckEquihashSolutions(const std::vector<const CBlockHeader*>& vHeaders, const CChainParams& chainparams, bool fUseCache = true);
+/** As above, with vHashes[i] = vHeaders[i]->GetHash() already computed by the caller. */
+bool CheckEquihashSolutions(const std::vector<const CBlockHeader*>& vHeaders, const std::vector<uint256>& vHashes, const CChainParams& chainparams, bool fUseCache = true);
 /** Try to detect Partition (network isolation) attacks against us */
 void PartitionCheck(bool (*initialDownloadCheck)(), CCriticalSection& cs, const CBlockIndex *const &bestHeader, int64_t nPowTargetSpacing);
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
@@ -295,6 +321,12 @@ void Misbehaving(NodeId nodeid, int howmuch);
 void FlushStateToDisk();
 /** Prune block files and flush state to disk. */
 void PruneAndFlush();
+/**
+ * Put the coins database back to its recorded best block if the process
+ * stopped while a flush was split across several batches. Requires the block
+ * index to be loaded.
+ */
+bool RecoverInterruptedCoinsFlush(CCoinsViewDB* coinsdb);
 
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
@@ -840,6 +872,10 @@ bool GetAddressUnspent(uint160 addressHash, int type,
 bool GetUnspentCCIndex(uint160 addressHash, uint256 creationId,
                        std::vector<std::pair<CUnspentCCIndexKey, CUnspentCCIndexValue> > &unspentOutputs, int32_t beginHeight, int32_t endHeight, int64_t maxOutputs);
 
+// get oracles data samples of a publisher baton, newest first
+bool GetOraclesDataIndex(uint256 oracletxid, uint160 batonHash,
+                         std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue> > &samples, int32_t beginHeight, int32_t endHeight, int64_t maxSamples);
+
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos,bool checkPOW);
@@ -969,6 +1005,9 @@ extern CChain chainActive;
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
+/** Layer below pcoinsTip that writes flushed coins in the background (protected by cs_main) */
+extern CCoinsViewAsyncFlush *pcoinsAsyncFlush;
+
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
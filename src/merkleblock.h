@@ -85,8 +85,11 @@ protected:
     /** calculate the hash of a node in the merkle tree (at leaf level: the txid itself) */
     uint256 CalcHash(int height, unsigned int pos, const std::vector<uint256> &vTxid);
 
-    /** recursive function that traverses tree nodes, storing the data as bits and hashes */
-    void TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256> &vTxid, const std::vector<bool> &vMatch);
+    /**
+     * recursive function that traverses tree nodes, storing the data as bits and hashes.
+     * vTree holds every level of the full tree as laid out by BuildMerkleTree.
+     */
+    void TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256> &vTree, const std::vector<bool> &vMatch);
 
     /**
      * recursive function that traverses tree nodes, consuming the bits and hashes produced by TraverseAndBuild.
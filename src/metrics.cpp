@@ -22,6 +22,7 @@
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "main.h"
+#include "perfstats.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "utiltime.h"
@@ -30,6 +31,7 @@
 
 #include <boost/thread.hpp>
 #include <boost/thread/synchronized_value.hpp>
+#include <algorithm>
 #include <string>
 #ifdef _WIN32
 #include <io.h>
@@ -404,6 +406,51 @@ int printMetrics(size_t cols, bool mining)
     return lines;
 }
 
+/** Busiest RPC commands, and locks when profiling is compiled in, ranked by total time. */
+int printPerfStats()
+{
+    static const size_t MAX_ROWS = 3;
+
+    std::map<std::string, CRPCPerfStats> mapRPC = GetRPCPerfStats();
+    if (mapRPC.empty()) {
+        return 0;
+    }
+
+    int lines = 2;
+    std::vector<std::pair<uint64_t, std::string>> vRPC;
+    for (const auto& entry : mapRPC) {
+        vRPC.push_back(std::make_pair(entry.second.latency.nTotalMicros, entry.first));
+    }
+    std::sort(vRPC.rbegin(), vRPC.rend());
+    std::cout << _("Slowest RPC commands (total time):") << std::endl;
+    for (size_t i = 0; i < vRPC.size() && i < MAX_ROWS; i++) {
+        const CRPCPerfStats& stats = mapRPC[vRPC[i].second];
+        std::cout << "- " << strprintf("%-24s %8u calls  p50 %8u us  p99 %8u us",
+            vRPC[i].second, stats.latency.nCount, stats.latency.Percentile(50), stats.latency.Percentile(99)) << std::endl;
+        lines++;
+    }
+
+    if (LockProfilingEnabled()) {
+        std::map<std::string, CLockPerfStats> mapLocks = GetLockPerfStats();
+        std::vector<std::pair<uint64_t, std::string>> vLocks;
+        for (const auto& entry : mapLocks) {
+            vLocks.push_back(std::make_pair(entry.second.wait.nTotalMicros, entry.first));
+        }
+        std::sort(vLocks.rbegin(), vLocks.rend());
+        std::cout << _("Most contended locks (total wait):") << std::endl;
+        lines++;
+        for (size_t i = 0; i < vLocks.size() && i < MAX_ROWS; i++) {
+            const CLockPerfStats& stats = mapLocks[vLocks[i].second];
+            std::cout << "- " << strprintf("%-24s %8u waits  wait p99 %8u us  hold p99 %8u us",
+                vLocks[i].second, stats.nContended, stats.wait.Percentile(99), stats.hold.Percentile(99)) << std::endl;
+            lines++;
+        }
+    }
+    std::cout << std::endl;
+
+    return lines;
+}
+
 int printMessageBox(size_t cols)
 {
     boost::strict_lock_ptr<std::list<std::string>> u = messageBox.synchronize();
@@ -545,6 +592,7 @@ void ThreadShowMetricsScreen()
             lines += printMiningStatus(mining);
         }
         lines += printMetrics(cols, mining);
+        lines += printPerfStats();
         lines += printMessageBox(cols);
         lines += printInitMessage();
 
@@ -614,7 +614,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() ||
             vRecvMsg.back().complete())
-            vRecvMsg.push_back(CNetMessage(Params().MessageStart(), SER_NETWORK, nRecvVersion));
+            vRecvMsg.emplace_back(Params().MessageStart(), SER_NETWORK, nRecvVersion);
 
         CNetMessage& msg = vRecvMsg.back();
 
@@ -645,26 +645,63 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
     return true;
 }
 
+CNetMessage::CNetMessage(CNetMessage&& other) :
+    in_data(other.in_data), hdr(other.hdr), nHdrPos(other.nHdrPos), vRecv(std::move(other.vRecv)),
+    nDataPos(other.nDataPos), nTime(other.nTime)
+{
+    memcpy(hdrbuf, other.hdrbuf, sizeof(hdrbuf));
+    // the read position is copied, not moved; reset it so the destructor sees a valid empty stream
+    other.vRecv.clear();
+    other.nDataPos = 0;
+}
+
+CNetMessage& CNetMessage::operator=(CNetMessage&& other)
+{
+    if (this != &other) {
+        CSerializeData vch;
+        vRecv.SwapBuffer(vch);
+        NetBufferPool().Release(vch);
+
+        in_data = other.in_data;
+        memcpy(hdrbuf, other.hdrbuf, sizeof(hdrbuf));
+        hdr = other.hdr;
+        nHdrPos = other.nHdrPos;
+        vRecv = std::move(other.vRecv);
+        nDataPos = other.nDataPos;
+        nTime = other.nTime;
+        other.vRecv.clear();
+        other.nDataPos = 0;
+    }
+    return *this;
+}
+
+CNetMessage::~CNetMessage()
+{
+    CSerializeData vch;
+    vRecv.SwapBuffer(vch);
+    if (vch.capacity() == 0)
+        return;
+    NetBufferPool().Release(vch);
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
-    unsigned int nRemaining = 24 - nHdrPos;
+    unsigned int nRemaining = CMessageHeader::HEADER_SIZE - nHdrPos;
     unsigned int nCopy = std::min(nRemaining, nBytes);
 
     memcpy(&hdrbuf[nHdrPos], pch, nCopy);
     nHdrPos += nCopy;
 
     // if header incomplete, exit
-    if (nHdrPos < 24)
+    if (nHdrPos < CMessageHeader::HEADER_SIZE)
         return nCopy;
 
-    // deserialize to CMessageHeader
-    try {
-        hdrbuf >> hdr;
-    }
-    catch (const std::exception&) {
-        return -1;
-    }
+    // decode CMessageHeader in place, field by field in wire order
+    memcpy(hdr.pchMessageStart, &hdrbuf[0], MESSAGE_START_SIZE);
+    memcpy(hdr.pchCommand, &hdrbuf[MESSAGE_START_SIZE], CMessageHeader::COMMAND_SIZE);
+    hdr.nMessageSize = ReadLE32((const unsigned char*)&hdrbuf[CMessageHeader::MESSAGE_SIZE_OFFSET]);
+    hdr.nChecksum = ReadLE32((const unsigned char*)&hdrbuf[CMessageHeader::CHECKSUM_OFFSET]);
 
     // reject messages larger than MAX_SIZE
     if (hdr.nMessageSize > MAX_SIZE)
@@ -683,11 +720,25 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 
     if (vRecv.size() < nDataPos + nCopy) {
         // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+        unsigned int nWanted = std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024);
+        CSerializeData vch;
+        vRecv.SwapBuffer(vch);
+        if (vch.capacity() < nWanted) {
+            // move to a pooled buffer of the next slab rather than letting the vector reallocate
+            CSerializeData vchLarger;
+            NetBufferPool().Acquire(vchLarger, nWanted);
+            vchLarger.insert(vchLarger.end(), vch.begin(), vch.begin() + nDataPos);
+            NetBufferPool().RecordCopy(nDataPos);
+            NetBufferPool().Release(vch);
+            vch.swap(vchLarger);
+        }
+        vch.resize(nWanted);
+        vRecv.SwapBuffer(vch);
     }
 
     memcpy(&vRecv[nDataPos], pch, nCopy);
     nDataPos += nCopy;
+    NetBufferPool().RecordCopy(nCopy);
 
     return nCopy;
 }
@@ -697,10 +748,10 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 // requires LOCK(cs_vSend)
 void SocketSendData(CNode *pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
+    std::deque<CSerializeDataRef>::iterator it = pnode->vSendMsg.begin();
 
     while (it != pnode->vSendMsg.end()) {
-        const CSerializeData &data = *it;
+        const CSerializeData &data = **it;
         assert(data.size() > pnode->nSendOffset);
         int nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
         if (nBytes > 0) {
@@ -2221,7 +2272,7 @@ void CNode::BeginMessage(const char* pszCommand) EXCLUSIVE_LOCK_FUNCTION(cs_vSen
 {
     ENTER_CRITICAL_SECTION(cs_vSend);
     assert(ssSend.size() == 0);
-    ssSend << CMessageHeader(Params().MessageStart(), pszCommand, 0);
+    BeginWireMessage(ssSend, pszCommand);
     LogPrint("net", "sending: %s ", SanitizeString(pszCommand));
 }
 
@@ -2253,28 +2304,20 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
         LEAVE_CRITICAL_SECTION(cs_vSend);
         return;
     }
-    // Set the size
     unsigned int nSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
-    WriteLE32((uint8_t*)&ssSend[CMessageHeader::MESSAGE_SIZE_OFFSET], nSize);
-
-    // Set the checksum
-    uint256 hash = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
-    unsigned int nChecksum = 0;
-    memcpy(&nChecksum, &hash, sizeof(nChecksum));
-    assert(ssSend.size () >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
-    memcpy((char*)&ssSend[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
-
     LogPrint("net", "(%d bytes) peer=%d\n", nSize, id);
 
-    std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-    ssSend.GetAndClear(*it);
-    nSendSize += (*it).size();
+    // Hand the serialized buffer itself to the send queue instead of copying the
+    // message out of ssSend.
+    CSerializeDataRef msg = EndWireMessage(ssSend);
+    vSendMsg.push_back(msg);
+    nSendSize += msg->size();
 
 #ifdef ENABLE_WEBSOCKETS
     if (this->hSocket != INVALID_SOCKET)    {
 #endif
         // If write queue empty, attempt "optimistic write"
-        if (it == vSendMsg.begin())
+        if (vSendMsg.size() == 1)
             SocketSendData(this);
 #ifdef ENABLE_WEBSOCKETS
     }
@@ -2283,6 +2326,58 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
     LEAVE_CRITICAL_SECTION(cs_vSend);
 }
 
+void CNode::PushWireMessage(const CSerializeDataRef& msg)
+{
+    LOCK(cs_vSend);
+    const char* pszCommand = &(*msg)[MESSAGE_START_SIZE];
+    LogPrint("net", "sending: %s (%d bytes, shared) peer=%d\n",
+        SanitizeString(std::string(pszCommand, strnlen(pszCommand, CMessageHeader::COMMAND_SIZE))),
+        msg->size() - CMessageHeader::HEADER_SIZE, id);
+
+    vSendMsg.push_back(msg);
+    nSendSize += msg->size();
+    NetBufferPool().RecordSharedSend();
+
+#ifdef ENABLE_WEBSOCKETS
+    if (this->hSocket != INVALID_SOCKET)    {
+#endif
+        // If write queue empty, attempt "optimistic write"
+        if (vSendMsg.size() == 1)
+            SocketSendData(this);
+#ifdef ENABLE_WEBSOCKETS
+    }
+#endif
+}
+
+void CNode::BeginWireMessage(CDataStream& ss, const char* pszCommand)
+{
+    CSerializeData vch;
+    NetBufferPool().Acquire(vch, CMessageHeader::HEADER_SIZE);
+    ss.SwapBuffer(vch);
+    // whatever the stream held before, e.g. ssSend's buffer after AbortMessage
+    NetBufferPool().Release(vch);
+    ss << CMessageHeader(Params().MessageStart(), pszCommand, 0);
+}
+
+CSerializeDataRef CNode::EndWireMessage(CDataStream& ss)
+{
+    // Set the size
+    unsigned int nSize = ss.size() - CMessageHeader::HEADER_SIZE;
+    WriteLE32((uint8_t*)&ss[CMessageHeader::MESSAGE_SIZE_OFFSET], nSize);
+
+    // Set the checksum
+    uint256 hash = Hash(ss.begin() + CMessageHeader::HEADER_SIZE, ss.end());
+    unsigned int nChecksum = 0;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    assert(ss.size () >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
+    memcpy((char*)&ss[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
+
+    // Detach the buffer; the stream gets a new pooled one in BeginWireMessage
+    CSerializeData vchMsg;
+    ss.SwapBuffer(vchMsg);
+    return NetBufferPool().MakeRef(vchMsg);
+}
+
 void CopyNodeStats(std::vector<CNodeStats>& vstats)
 {
     vstats.clear();
@@ -26,6 +26,7 @@
 #include "hash.h"
 #include "limitedmap.h"
 #include "mruset.h"
+#include "netbufferpool.h"
 #include "netbase.h"
 #include "protocol.h"
 #include "random.h"
@@ -222,23 +223,31 @@ class CNetMessage {
 public:
     bool in_data;                   // parsing header (false) or data (true)
 
-    CDataStream hdrbuf;             // partially received header
+    char hdrbuf[CMessageHeader::HEADER_SIZE]; // partially received header
     CMessageHeader hdr;             // complete header
     unsigned int nHdrPos;
 
-    CDataStream vRecv;              // received message data
+    CDataStream vRecv;              // received message data, backed by a NetBufferPool() buffer
     unsigned int nDataPos;
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
-    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
-        hdrbuf.resize(24);
+    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         in_data = false;
         nHdrPos = 0;
         nDataPos = 0;
         nTime = 0;
     }
 
+    // Messages are moved, never copied, so a receive buffer is returned to the pool exactly once.
+    // The moved-from message is left with an empty stream.
+    CNetMessage(CNetMessage&& other);
+    CNetMessage& operator=(CNetMessage&& other);
+    CNetMessage(const CNetMessage&) = delete;
+    CNetMessage& operator=(const CNetMessage&) = delete;
+
+    ~CNetMessage();
+
     bool complete() const
     {
         if (!in_data)
@@ -248,7 +257,6 @@ public:
 
     void SetVersion(int nVersionIn)
     {
-        hdrbuf.SetVersion(nVersionIn);
         vRecv.SetVersion(nVersionIn);
     }
 
@@ -271,7 +279,7 @@ public:
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<CSerializeData> vSendMsg;
+    std::deque<CSerializeDataRef> vSendMsg;
     CCriticalSection cs_vSend;
 
     std::deque<CInv> vRecvGetData;
@@ -474,6 +482,25 @@ public:
 
     void PushVersion();
 
+    /**
+     * Queue an already serialized wire message (see MakeWireMessage). The buffer is
+     * shared, not copied, so one serialization can be fanned out to many peers.
+     */
+    void PushWireMessage(const CSerializeDataRef& msg);
+
+    /** Serialize a complete wire message (header, payload and checksum) for PushWireMessage. */
+    template<typename... Args>
+    static CSerializeDataRef MakeWireMessage(const char* pszCommand, int nVersionIn, const Args&... args)
+    {
+        CDataStream ss(SER_NETWORK, nVersionIn);
+        BeginWireMessage(ss, pszCommand);
+        ::SerializeMany(ss, args...);
+        return EndWireMessage(ss);
+    }
+
+    static void BeginWireMessage(CDataStream& ss, const char* pszCommand);
+    static CSerializeDataRef EndWireMessage(CDataStream& ss);
+
 
     void PushMessage(const char* pszCommand)
     {
@@ -0,0 +1,117 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "netbufferpool.h"
+
+// The largest slab holds a maximum size block (4 MiB) together with its message header.
+const size_t CNetBufferPool::SLAB_SIZES[CNetBufferPool::SLAB_COUNT] = {
+    1024, 16 * 1024, 256 * 1024, 1024 * 1024, 4096 * 1024 + 1024
+};
+
+CNetBufferPool::CNetBufferPool(size_t nMaxPooledBytesIn) :
+    nMaxPooledBytes(nMaxPooledBytesIn), nPooledBytes(0),
+    nAllocated(0), nReused(0), nDiscarded(0), nBytesCopied(0), nSharedSends(0)
+{
+}
+
+void CNetBufferPool::Acquire(CSerializeData& vch, size_t nCapacity)
+{
+    if (nCapacity == 0)
+        return;
+
+    size_t nSlab = 0;
+    while (nSlab < SLAB_COUNT && SLAB_SIZES[nSlab] < nCapacity)
+        nSlab++;
+
+    if (nSlab < SLAB_COUNT) {
+        std::lock_guard<std::mutex> lock(cs);
+        // the next slab is fine too, it only means the buffer will not have to grow;
+        // anything larger would tie up a block buffer for a small message
+        for (size_t i = nSlab; i < SLAB_COUNT && i <= nSlab + 1; i++) {
+            if (!vFree[i].empty()) {
+                nPooledBytes -= vFree[i].back().capacity();
+                vch.swap(vFree[i].back());
+                vFree[i].pop_back();
+                ++nReused;
+                return;
+            }
+        }
+    }
+
+    ++nAllocated;
+    vch.reserve(nSlab < SLAB_COUNT ? SLAB_SIZES[nSlab] : nCapacity);
+}
+
+void CNetBufferPool::Release(CSerializeData& vch)
+{
+    size_t nCapacity = vch.capacity();
+    if (nCapacity < SLAB_SIZES[0])
+    {
+        CSerializeData().swap(vch);
+        return;
+    }
+
+    size_t nSlab = SLAB_COUNT - 1;
+    while (SLAB_SIZES[nSlab] > nCapacity)
+        nSlab--;
+
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (nPooledBytes + nCapacity <= nMaxPooledBytes) {
+            vch.clear();
+            nPooledBytes += nCapacity;
+            vFree[nSlab].push_back(CSerializeData());
+            vFree[nSlab].back().swap(vch);
+            return;
+        }
+    }
+
+    ++nDiscarded;
+    CSerializeData().swap(vch);
+}
+
+CSerializeDataRef CNetBufferPool::MakeRef(CSerializeData& vch)
+{
+    CSerializeData* pvch = new CSerializeData();
+    pvch->swap(vch);
+    return CSerializeDataRef(pvch, [this](const CSerializeData* p) {
+        CSerializeData* pmut = const_cast<CSerializeData*>(p);
+        Release(*pmut);
+        delete pmut;
+    });
+}
+
+CNetBufferPoolStats CNetBufferPool::GetStats() const
+{
+    CNetBufferPoolStats stats;
+    stats.nAllocated = nAllocated;
+    stats.nReused = nReused;
+    stats.nDiscarded = nDiscarded;
+    stats.nBytesCopied = nBytesCopied;
+    stats.nSharedSends = nSharedSends;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        stats.nPooledBytes = nPooledBytes;
+    }
+    return stats;
+}
+
+CNetBufferPool& NetBufferPool()
+{
+    // Intentionally never destroyed: CNode objects may still be released from
+    // static destructors (CNetCleanup) after function-local statics are gone.
+    static CNetBufferPool* pool = new CNetBufferPool();
+    return *pool;
+}
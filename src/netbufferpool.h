@@ -0,0 +1,89 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_NETBUFFERPOOL_H
+#define KOMODO_NETBUFFERPOOL_H
+
+#include "support/allocators/zeroafterfree.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+/** Complete wire message (header + payload) shared by the send queues of several peers. */
+typedef std::shared_ptr<const CSerializeData> CSerializeDataRef;
+
+/** Default upper bound on the capacity kept in the free lists of the network buffer pool. */
+static const size_t DEFAULT_NETBUFFERPOOL_MAX_BYTES = 32 * 1024 * 1024;
+
+struct CNetBufferPoolStats
+{
+    uint64_t nAllocated;    // buffers that had to be allocated from the heap
+    uint64_t nReused;       // buffers served from a free list
+    uint64_t nDiscarded;    // buffers freed because their slab was full or they were too large
+    uint64_t nPooledBytes;  // capacity currently parked in the free lists
+    uint64_t nBytesCopied;  // bytes memcpy'd into message buffers (receive and regrowth)
+    uint64_t nSharedSends;  // messages queued to a peer by reference to an already serialized buffer
+};
+
+/**
+ * Slab allocator for network message buffers.
+ *
+ * Buffers are bucketed by capacity into a few fixed size classes. A released
+ * buffer keeps its heap block and is handed out again to the next message that
+ * fits, so the steady state of block, inv and DEX traffic does not touch the
+ * allocator at all.
+ */
+class CNetBufferPool
+{
+public:
+    static const size_t SLAB_COUNT = 5;
+    static const size_t SLAB_SIZES[SLAB_COUNT];
+
+    explicit CNetBufferPool(size_t nMaxPooledBytesIn = DEFAULT_NETBUFFERPOOL_MAX_BYTES);
+
+    /** Swap an empty buffer with capacity of at least nCapacity into vch; vch must be empty. Leaves vch alone for 0. */
+    void Acquire(CSerializeData& vch, size_t nCapacity);
+
+    /** Return vch's heap block to the pool. vch is left empty with no capacity. */
+    void Release(CSerializeData& vch);
+
+    /** Take ownership of vch's contents; the block goes back to the pool with the last reference. */
+    CSerializeDataRef MakeRef(CSerializeData& vch);
+
+    void RecordCopy(size_t nBytes) { nBytesCopied += nBytes; }
+    void RecordSharedSend() { ++nSharedSends; }
+
+    CNetBufferPoolStats GetStats() const;
+
+private:
+    mutable std::mutex cs;
+    std::vector<CSerializeData> vFree[SLAB_COUNT];
+    size_t nMaxPooledBytes;
+    size_t nPooledBytes;
+
+    std::atomic<uint64_t> nAllocated;
+    std::atomic<uint64_t> nReused;
+    std::atomic<uint64_t> nDiscarded;
+    std::atomic<uint64_t> nBytesCopied;
+    std::atomic<uint64_t> nSharedSends;
+};
+
+/** Process-wide pool used by CNode for receive and send buffers. */
+CNetBufferPool& NetBufferPool();
+
+#endif // KOMODO_NETBUFFERPOOL_H
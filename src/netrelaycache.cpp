@@ -0,0 +1,89 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "netrelaycache.h"
+
+CRelayWireCache::CRelayWireCache(size_t nMaxBytesIn) :
+    nMaxBytes(nMaxBytesIn), nBytes(0), nHits(0), nMisses(0), nEvictions(0)
+{
+}
+
+CSerializeDataRef CRelayWireCache::Get(int nType, const uint256& hash, int nVersion)
+{
+    Key key = { nType, nVersion, hash };
+    std::lock_guard<std::mutex> lock(cs);
+    EntryMap::iterator it = mapEntries.find(key);
+    if (it == mapEntries.end()) {
+        nMisses++;
+        return CSerializeDataRef();
+    }
+    nHits++;
+    lru.splice(lru.begin(), lru, it->second.second);
+    return it->second.first;
+}
+
+void CRelayWireCache::Insert(int nType, const uint256& hash, int nVersion, const CSerializeDataRef& msg)
+{
+    // a single message that would flush most of the cache is not worth keeping
+    if (!msg || msg->size() > nMaxBytes / 4)
+        return;
+
+    Key key = { nType, nVersion, hash };
+    std::lock_guard<std::mutex> lock(cs);
+    if (mapEntries.count(key))
+        return;
+    lru.push_front(key);
+    mapEntries.insert(std::make_pair(key, std::make_pair(msg, lru.begin())));
+    nBytes += msg->size();
+    EvictIfNeeded();
+}
+
+void CRelayWireCache::SetMaxBytes(size_t nMaxBytesIn)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    nMaxBytes = nMaxBytesIn;
+    EvictIfNeeded();
+}
+
+// requires cs
+void CRelayWireCache::EvictIfNeeded()
+{
+    while (nBytes > nMaxBytes && !lru.empty()) {
+        EntryMap::iterator it = mapEntries.find(lru.back());
+        nBytes -= it->second.first->size();
+        mapEntries.erase(it);
+        lru.pop_back();
+        nEvictions++;
+    }
+}
+
+CRelayCacheStats CRelayWireCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    CRelayCacheStats stats;
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+    stats.nEvictions = nEvictions;
+    stats.nEntries = mapEntries.size();
+    stats.nBytes = nBytes;
+    return stats;
+}
+
+CRelayWireCache& RelayWireCache()
+{
+    // Never destroyed, cached buffers release into NetBufferPool() which outlives everything
+    static CRelayWireCache* cache = new CRelayWireCache();
+    return *cache;
+}
@@ -0,0 +1,103 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_NETRELAYCACHE_H
+#define KOMODO_NETRELAYCACHE_H
+
+#include "netbufferpool.h"
+#include "uint256.h"
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+
+/** Default memory bound (in MiB) for serialized messages kept by the relay cache, see -relaycachesize. */
+static const unsigned int DEFAULT_RELAY_CACHE_SIZE = 64;
+
+/** Kinds of payload kept in the relay cache; DEX entries also encode the routing byte they were sent with. */
+enum RelayCacheType
+{
+    RELAYCACHE_BLOCK = 1,
+    RELAYCACHE_TX = 2,
+    RELAYCACHE_DEX = 0x100,     // | relay byte
+};
+
+struct CRelayCacheStats
+{
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nEvictions;
+    uint64_t nEntries;
+    uint64_t nBytes;
+};
+
+/**
+ * Serialize-once cache of complete wire messages keyed by payload hash.
+ *
+ * Blocks served to several peers, relayed transactions and DEX packets fanned
+ * out to every connection are serialized a single time; each peer's send queue
+ * then holds a reference to the same buffer (see CNode::PushWireMessage).
+ * Entries are evicted least-recently-used first once nMaxBytes is exceeded.
+ * Evicting an entry only drops the cache's reference, buffers still queued to
+ * peers stay valid until sent.
+ */
+class CRelayWireCache
+{
+public:
+    explicit CRelayWireCache(size_t nMaxBytesIn = DEFAULT_RELAY_CACHE_SIZE * 1024 * 1024);
+
+    /** Returns the cached message or an empty reference. */
+    CSerializeDataRef Get(int nType, const uint256& hash, int nVersion);
+    void Insert(int nType, const uint256& hash, int nVersion, const CSerializeDataRef& msg);
+
+    void SetMaxBytes(size_t nMaxBytesIn);
+    CRelayCacheStats GetStats() const;
+
+private:
+    struct Key
+    {
+        int nType;
+        int nVersion;
+        uint256 hash;
+
+        bool operator<(const Key& b) const
+        {
+            if (nType != b.nType)
+                return nType < b.nType;
+            if (nVersion != b.nVersion)
+                return nVersion < b.nVersion;
+            return hash < b.hash;
+        }
+    };
+    typedef std::list<Key> LruList;
+    typedef std::map<Key, std::pair<CSerializeDataRef, LruList::iterator> > EntryMap;
+
+    void EvictIfNeeded();
+
+    mutable std::mutex cs;
+    EntryMap mapEntries;
+    LruList lru;                // most recently used at the front
+    size_t nMaxBytes;
+    size_t nBytes;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nEvictions;
+};
+
+/** Process-wide relay cache shared by block, transaction and DEX relay. */
+CRelayWireCache& RelayWireCache();
+
+#endif // KOMODO_NETRELAYCACHE_H
@@ -0,0 +1,314 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "notificationqueue.h"
+
+#include "chain.h"
+#include "consensus/validation.h"
+#include "main.h"
+#include "primitives/block.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <set>
+
+static std::mutex csQueues;
+static std::set<CNotificationQueue*> setQueues;
+
+bool ParseNotificationQueuePolicy(const std::string& strPolicy, NotificationQueuePolicy& policy)
+{
+    if (strPolicy == "block")
+        policy = NOTIFY_QUEUE_BLOCK;
+    else if (strPolicy == "drop")
+        policy = NOTIFY_QUEUE_DROP;
+    else
+        return false;
+    return true;
+}
+
+CNotificationQueue::CNotificationQueue(const std::string& strNameIn, size_t nCapacity, NotificationQueuePolicy policyIn, const Handler& handlerIn) :
+    strName(strNameIn), policy(policyIn), handler(handlerIn), queue(nCapacity), fSleeping(false), nWaiting(0), fStop(false), fBacklogged(false),
+    nMaxDepth(0), nQueued(0), nProcessed(0), nDropped(0), nBlocked(0), nBlockedMicros(0)
+{
+    dispatcher = std::thread(&CNotificationQueue::ThreadDispatch, this);
+    std::lock_guard<std::mutex> lock(csQueues);
+    setQueues.insert(this);
+}
+
+CNotificationQueue::~CNotificationQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(csQueues);
+        setQueues.erase(this);
+    }
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    condItems.notify_all();
+    condRoom.notify_all();
+    dispatcher.join();
+}
+
+void CNotificationQueue::WakeDispatcher()
+{
+    // pairs with the dispatcher setting fSleeping before it looks at the queue a last time
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (fSleeping.load()) {
+        std::lock_guard<std::mutex> lock(cs);
+        condItems.notify_one();
+    }
+}
+
+bool CNotificationQueue::Push(CValidationNotification& notification)
+{
+    notification.nTimeQueued = GetTimeMicros();
+    bool fPushed = queue.TryPush(notification);
+    if (!fPushed && policy == NOTIFY_QUEUE_BLOCK && !fStop) {
+        int64_t nStart = GetTimeMicros();
+        std::unique_lock<std::mutex> lock(cs);
+        nWaiting++;
+        while (!fStop && !(fPushed = queue.TryPush(notification))) {
+            condItems.notify_one();
+            condRoom.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        nWaiting--;
+        nBlocked++;
+        nBlockedMicros += GetTimeMicros() - nStart;
+    }
+    if (!fPushed) {
+        nDropped++;
+        LogPrint(strName.c_str(), "%s: %s: queue full, notification dropped\n", __func__, strName);
+        return false;
+    }
+    nQueued++;
+
+    size_t nDepth = queue.Size();
+    size_t nMax = nMaxDepth.load();
+    while (nDepth > nMax && !nMaxDepth.compare_exchange_weak(nMax, nDepth))
+        ;
+    if (nDepth > queue.Capacity() / 4 * 3) {
+        std::lock_guard<std::mutex> lock(cs);
+        if (!fBacklogged)
+            LogPrintf("%s: notification queue %s is %u/%u full, subscribers are falling behind\n", __func__, strName, (unsigned int)nDepth, (unsigned int)queue.Capacity());
+        fBacklogged = true;
+    }
+    WakeDispatcher();
+    return true;
+}
+
+void CNotificationQueue::ThreadDispatch()
+{
+    RenameThread(("komodo-" + strName).c_str());
+    CValidationNotification notification;
+    while (true) {
+        while (queue.TryPop(notification)) {
+            try {
+                handler(notification);
+            } catch (const std::exception& e) {
+                LogPrintf("%s: %s: %s\n", __func__, strName, e.what());
+            }
+            int64_t nLatency = GetTimeMicros() - notification.nTimeQueued;
+            notification = CValidationNotification();
+            nProcessed++;
+            {
+                std::lock_guard<std::mutex> lock(csLatency);
+                latency.Add(nLatency);
+            }
+            if (nWaiting.load() > 0) {
+                std::lock_guard<std::mutex> lock(cs);
+                condRoom.notify_all();
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(cs);
+        if (fBacklogged && queue.Size() < queue.Capacity() / 4) {
+            LogPrintf("%s: notification queue %s caught up\n", __func__, strName);
+            fBacklogged = false;
+        }
+        fSleeping = true;
+        // what was pushed before fSleeping was set is seen here, later pushes notify
+        if (queue.Size() == 0) {
+            if (fStop)
+                return;
+            condItems.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        fSleeping = false;
+    }
+}
+
+CNotificationQueueStats CNotificationQueue::GetStats() const
+{
+    CNotificationQueueStats stats;
+    stats.strName = strName;
+    stats.strPolicy = policy == NOTIFY_QUEUE_BLOCK ? "block" : "drop";
+    stats.nCapacity = queue.Capacity();
+    stats.nDepth = queue.Size();
+    stats.nMaxDepth = nMaxDepth;
+    stats.nQueued = nQueued;
+    stats.nProcessed = nProcessed;
+    stats.nDropped = nDropped;
+    stats.nBlocked = nBlocked;
+    stats.nBlockedMicros = nBlockedMicros;
+    std::lock_guard<std::mutex> lock(csLatency);
+    stats.latency = latency;
+    return stats;
+}
+
+std::vector<CNotificationQueueStats> GetNotificationQueueStats()
+{
+    std::vector<CNotificationQueueStats> vStats;
+    std::lock_guard<std::mutex> lock(csQueues);
+    for (std::set<CNotificationQueue*>::const_iterator it = setQueues.begin(); it != setQueues.end(); it++)
+        vStats.push_back((*it)->GetStats());
+    return vStats;
+}
+
+CQueuedNotificationInterface::~CQueuedNotificationInterface()
+{
+    StopQueue();
+}
+
+bool CQueuedNotificationInterface::StartQueue(const std::string& strName, const std::map<std::string, std::string>& args)
+{
+    size_t nCapacity = DEFAULT_NOTIFY_QUEUE_SIZE;
+    std::map<std::string, std::string>::const_iterator it = args.find("-notifyqueuesize");
+    if (it != args.end())
+        nCapacity = std::max((int64_t)1, std::min((int64_t)MAX_NOTIFY_QUEUE_SIZE, atoi64(it->second)));
+
+    NotificationQueuePolicy policy;
+    it = args.find("-notifyqueuepolicy");
+    std::string strPolicy = it != args.end() ? it->second : DEFAULT_NOTIFY_QUEUE_POLICY;
+    if (!ParseNotificationQueuePolicy(strPolicy, policy)) {
+        LogPrintf("%s: Invalid -notifyqueuepolicy %s\n", strName, strPolicy);
+        return false;
+    }
+
+    queue.reset(new CNotificationQueue(strName, nCapacity, policy, std::bind(&CQueuedNotificationInterface::Dispatch, this, std::placeholders::_1)));
+    return true;
+}
+
+void CQueuedNotificationInterface::StopQueue()
+{
+    queue.reset();
+}
+
+void CQueuedNotificationInterface::Push(CValidationNotification& notification)
+{
+    if (!queue)
+        return;
+    if (fGap.load()) {
+        std::lock_guard<std::mutex> lock(csGap);
+        notification.gap = pendingGap;
+        pendingGap.reset();
+        fGap = false;
+    }
+    if (queue->Push(notification))
+        return;
+
+    // the next queued notification carries the gap of this one and of those dropped before it
+    std::lock_guard<std::mutex> lock(csGap);
+    std::shared_ptr<CNotificationGap> gap = std::make_shared<CNotificationGap>();
+    if (notification.gap)
+        gap->Add(*notification.gap);
+    if (pendingGap)
+        gap->Add(*pendingGap);
+    AddDropped(notification, *gap);
+    pendingGap = gap;
+    fGap = true;
+}
+
+void CQueuedNotificationInterface::AddDropped(const CValidationNotification& notification, CNotificationGap& gap)
+{
+    switch (notification.type) {
+    case CValidationNotification::BLOCK_TIP:
+        gap.nBlockTips++;
+        break;
+    case CValidationNotification::BLOCK_CHECKED:
+        gap.nCheckedBlocks++;
+        break;
+    case CValidationNotification::TRANSACTION: {
+        gap.nTransactions++;
+        CCEvent event;
+        if (fCCEvents && DecodeCCEvent(*notification.tx, notification.block.get(), event))
+            gap.cc.Add(event, ccfilter);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+std::shared_ptr<const CBlock> CQueuedNotificationInterface::ShareBlock(const CBlock *pblock)
+{
+    std::lock_guard<std::mutex> lock(csBlock);
+    // a block is signalled for each of its txns, compare the header instead of hashing it every time
+    if (pblock != pLastBlock || !lastBlock || pblock->hashPrevBlock != lastBlock->hashPrevBlock ||
+        pblock->hashMerkleRoot != lastBlock->hashMerkleRoot || pblock->nNonce != lastBlock->nNonce) {
+        lastBlock = std::make_shared<const CBlock>(*pblock);
+        hashLastBlock = lastBlock->GetHash();
+        pLastBlock = pblock;
+    }
+    return lastBlock;
+}
+
+void CQueuedNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+{
+    CValidationNotification notification;
+    notification.type = CValidationNotification::TRANSACTION;
+    notification.tx = std::make_shared<const CTransaction>(tx);
+    if (pblock != NULL)
+        notification.block = ShareBlock(pblock);
+    Push(notification);
+}
+
+void CQueuedNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+{
+    CValidationNotification notification;
+    notification.type = CValidationNotification::BLOCK_TIP;
+    notification.pindex = pindex;
+    {
+        std::lock_guard<std::mutex> lock(csBlock);
+        if (lastBlock && hashLastBlock == pindex->GetBlockHash())
+            notification.block = lastBlock;
+    }
+    if (!notification.block) {
+        // only if the tip was connected before this interface was registered
+        std::shared_ptr<CBlock> block = std::make_shared<CBlock>();
+        LOCK(cs_main);
+        if (ReadBlockFromDisk(*block, pindex, 1))
+            notification.block = block;
+        else
+            LogPrintf("%s: can't read block %s from disk\n", __func__, pindex->GetBlockHash().GetHex());
+    }
+    Push(notification);
+}
+
+void CQueuedNotificationInterface::BlockChecked(const CBlock& block, const CValidationState& state)
+{
+    if (!fCheckedBlocks || state.IsInvalid())
+        return;
+    CValidationNotification notification;
+    notification.type = CValidationNotification::BLOCK_CHECKED;
+    notification.block = ShareBlock(&block);
+    Push(notification);
+}
+
+void CQueuedNotificationInterface::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added)
+{
+    // keep the connected block for UpdatedBlockTip, blocks without txns are not seen by SyncTransaction
+    if (added && pblock != NULL)
+        ShareBlock(pblock);
+}
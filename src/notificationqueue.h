@@ -0,0 +1,298 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_NOTIFICATIONQUEUE_H
+#define KOMODO_NOTIFICATIONQUEUE_H
+
+#include "perfstats.h"
+#include "uint256.h"
+#include "cc/CCevents.h"
+#include "validationinterface.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+class CTransaction;
+
+static const size_t DEFAULT_NOTIFY_QUEUE_SIZE = 16384;
+static const size_t MAX_NOTIFY_QUEUE_SIZE = 1 << 22;
+static const char DEFAULT_NOTIFY_QUEUE_POLICY[] = "block";
+
+/**
+ * Bounded multi producer, multi consumer ring buffer. Push and pop never take
+ * a lock: each slot has a sequence number that tells whether it is free for
+ * the producer of a given position or filled for its consumer. The capacity
+ * is rounded up to a power of two.
+ */
+template <typename T>
+class CBoundedQueue
+{
+public:
+    explicit CBoundedQueue(size_t nCapacityIn) : nCapacity(RoundUp(nCapacityIn)), vSlots(new Slot[nCapacity]), nPushPos(0), nPopPos(0)
+    {
+        for (size_t i = 0; i < nCapacity; i++)
+            vSlots[i].nSequence.store(i, std::memory_order_relaxed);
+    }
+
+    /** Moves item into the queue, false (item untouched) when it is full. */
+    bool TryPush(T& item)
+    {
+        size_t nPos = nPushPos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = vSlots[nPos & (nCapacity - 1)];
+            intptr_t nDiff = (intptr_t)slot.nSequence.load(std::memory_order_acquire) - (intptr_t)nPos;
+            if (nDiff == 0) {
+                if (nPushPos.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed)) {
+                    slot.item = std::move(item);
+                    slot.nSequence.store(nPos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (nDiff < 0) {
+                return false;
+            } else {
+                nPos = nPushPos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(T& item)
+    {
+        size_t nPos = nPopPos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = vSlots[nPos & (nCapacity - 1)];
+            intptr_t nDiff = (intptr_t)slot.nSequence.load(std::memory_order_acquire) - (intptr_t)(nPos + 1);
+            if (nDiff == 0) {
+                if (nPopPos.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed)) {
+                    item = std::move(slot.item);
+                    slot.item = T();
+                    slot.nSequence.store(nPos + nCapacity, std::memory_order_release);
+                    return true;
+                }
+            } else if (nDiff < 0) {
+                return false;
+            } else {
+                nPos = nPopPos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t Capacity() const { return nCapacity; }
+    /** Exact when no push or pop is in progress. */
+    size_t Size() const
+    {
+        size_t nPop = nPopPos.load(std::memory_order_acquire);
+        size_t nPush = nPushPos.load(std::memory_order_acquire);
+        return nPush > nPop ? nPush - nPop : 0;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> nSequence;
+        T item;
+    };
+
+    static size_t RoundUp(size_t n)
+    {
+        size_t nRounded = 2;
+        while (nRounded < n)
+            nRounded <<= 1;
+        return nRounded;
+    }
+
+    const size_t nCapacity;
+    std::unique_ptr<Slot[]> vSlots;
+    // producers and the consumer each write their own cache line
+    alignas(64) std::atomic<size_t> nPushPos;
+    alignas(64) std::atomic<size_t> nPopPos;
+};
+
+/**
+ * Messages that notifications dropped under NOTIFY_QUEUE_DROP would have
+ * published. It travels with the next queued notification and the notifiers
+ * skip their sequence numbers by it before publishing that one, so
+ * subscribers see a gap where notifications were lost.
+ */
+struct CNotificationGap
+{
+    uint64_t nBlockTips;        // hashblock and rawblock
+    uint64_t nCheckedBlocks;
+    uint64_t nTransactions;     // hashtx and rawtx
+    CCEventGap cc;
+
+    CNotificationGap() : nBlockTips(0), nCheckedBlocks(0), nTransactions(0) {}
+
+    void Add(const CNotificationGap& gap)
+    {
+        nBlockTips += gap.nBlockTips;
+        nCheckedBlocks += gap.nCheckedBlocks;
+        nTransactions += gap.nTransactions;
+        cc.Add(gap.cc);
+    }
+};
+
+/**
+ * A validation signal as handed to the notifier thread. Blocks are shared
+ * copies made once on the validation thread, so notifiers never read them
+ * back from disk or take cs_main.
+ */
+struct CValidationNotification
+{
+    enum Type { NONE, BLOCK_TIP, BLOCK_CHECKED, TRANSACTION };
+
+    Type type;
+    const CBlockIndex *pindex;                  // BLOCK_TIP
+    std::shared_ptr<const CBlock> block;        // the block of all types, null for mempool txns
+    std::shared_ptr<const CTransaction> tx;     // TRANSACTION
+    std::shared_ptr<const CNotificationGap> gap;    // dropped before this one, null if none
+    int64_t nTimeQueued;
+
+    CValidationNotification() : type(NONE), pindex(NULL), nTimeQueued(0) {}
+};
+
+/** What a producer does when the queue is full. */
+enum NotificationQueuePolicy
+{
+    NOTIFY_QUEUE_BLOCK,     // wait for the notifier thread, nothing is lost
+    NOTIFY_QUEUE_DROP,      // drop the new notification, validation never waits
+};
+
+bool ParseNotificationQueuePolicy(const std::string& strPolicy, NotificationQueuePolicy& policy);
+
+struct CNotificationQueueStats
+{
+    std::string strName;
+    std::string strPolicy;
+    size_t nCapacity;
+    size_t nDepth;
+    size_t nMaxDepth;
+    uint64_t nQueued;
+    uint64_t nProcessed;
+    uint64_t nDropped;
+    uint64_t nBlocked;          // pushes that found the queue full and waited
+    uint64_t nBlockedMicros;
+    CLatencyHistogram latency;  // time from queueing to the end of dispatch
+
+    CNotificationQueueStats() : nCapacity(0), nDepth(0), nMaxDepth(0), nQueued(0), nProcessed(0), nDropped(0), nBlocked(0), nBlockedMicros(0) {}
+};
+
+/**
+ * Queue of validation notifications with a single thread dispatching them,
+ * so the sockets of a notification interface are only used from that thread.
+ * Queues are listed by getperfstats.
+ */
+class CNotificationQueue
+{
+public:
+    typedef std::function<void(const CValidationNotification&)> Handler;
+
+    CNotificationQueue(const std::string& strNameIn, size_t nCapacity, NotificationQueuePolicy policyIn, const Handler& handlerIn);
+    /** Dispatches what is queued, then stops the thread. */
+    ~CNotificationQueue();
+
+    /** False if the notification was dropped. */
+    bool Push(CValidationNotification& notification);
+    CNotificationQueueStats GetStats() const;
+
+private:
+    void ThreadDispatch();
+    void WakeDispatcher();
+
+    const std::string strName;
+    const NotificationQueuePolicy policy;
+    const Handler handler;
+    CBoundedQueue<CValidationNotification> queue;
+
+    std::mutex cs;
+    std::condition_variable condItems;      // the dispatcher waits for notifications
+    std::condition_variable condRoom;       // blocked producers wait for room
+    std::atomic<bool> fSleeping;
+    std::atomic<int> nWaiting;
+    std::atomic<bool> fStop;
+    bool fBacklogged;                       // with cs, logged once per backlog
+
+    std::atomic<size_t> nMaxDepth;
+    std::atomic<uint64_t> nQueued;
+    std::atomic<uint64_t> nProcessed;
+    std::atomic<uint64_t> nDropped;
+    std::atomic<uint64_t> nBlocked;
+    std::atomic<uint64_t> nBlockedMicros;
+    mutable std::mutex csLatency;
+    CLatencyHistogram latency;
+
+    std::thread dispatcher;
+};
+
+std::vector<CNotificationQueueStats> GetNotificationQueueStats();
+
+/**
+ * Validation interface that queues its signals and handles them on its own
+ * thread, off the validation thread and without cs_main. Subclasses
+ * implement Dispatch.
+ */
+class CQueuedNotificationInterface : public CValidationInterface
+{
+public:
+    CQueuedNotificationInterface() : fCheckedBlocks(false), fCCEvents(false), fGap(false), pLastBlock(NULL) {}
+    virtual ~CQueuedNotificationInterface();
+
+protected:
+    /** Reads -notifyqueuesize and -notifyqueuepolicy. */
+    bool StartQueue(const std::string& strName, const std::map<std::string, std::string>& args);
+    /** Dispatches what is queued, then stops. Subclasses stop the queue before their notifiers go away. */
+    void StopQueue();
+
+    virtual void Dispatch(const CValidationNotification& notification) = 0;
+
+    // CValidationInterface
+    void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
+    void UpdatedBlockTip(const CBlockIndex *pindex);
+    void BlockChecked(const CBlock& block, const CValidationState& state);
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added);
+
+    bool fCheckedBlocks;    // queue BlockChecked, which copies every checked block
+    bool fCCEvents;         // dropped txns are decoded for the ccevent and ccaddress gaps
+    CCEventFilter ccfilter;
+
+private:
+    std::shared_ptr<const CBlock> ShareBlock(const CBlock *pblock);
+    void Push(CValidationNotification& notification);
+    /** Adds the messages of a dropped notification to gap. */
+    void AddDropped(const CValidationNotification& notification, CNotificationGap& gap);
+
+    std::unique_ptr<CNotificationQueue> queue;
+
+    // dropped since the last queued notification
+    std::mutex csGap;
+    std::atomic<bool> fGap;
+    std::shared_ptr<CNotificationGap> pendingGap;
+
+    // the block of the last signal, shared by the notifications of its txns
+    std::mutex csBlock;
+    const CBlock *pLastBlock;
+    uint256 hashLastBlock;
+    std::shared_ptr<const CBlock> lastBlock;
+};
+
+#endif // KOMODO_NOTIFICATIONQUEUE_H
@@ -0,0 +1,187 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "nspvcache.h"
+
+#include "komodo_nSPV_defs.h"
+#include "tinyformat.h"
+
+#include <mutex>
+
+CNSPVResponseCache *pnspvcache = NULL;
+
+// map node and list node of an entry
+static const size_t NSPV_CACHE_ENTRY_OVERHEAD = 128;
+
+CNSPVResponseCache::CNSPVResponseCache(size_t nMaxBytesIn) :
+    nMaxBytes(nMaxBytesIn), nBytes(0), nGeneration(0), nHits(0), nMisses(0), nEvictions(0), nInvalidations(0)
+{
+}
+
+bool CNSPVResponseCache::IsCacheable(uint8_t requestType)
+{
+    switch (requestType) {
+    case NSPV_INFO:
+    case NSPV_NTZS:
+    case NSPV_NTZSPROOF:
+    case NSPV_TXPROOF:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::string CNSPVResponseCache::MakeKey(uint8_t requestType, const uint8_t *requestData, size_t requestDataLen)
+{
+    std::string key(1, (char)requestType);
+    key.append((const char*)requestData, requestDataLen);
+    return key;
+}
+
+size_t CNSPVResponseCache::EntryBytes(const std::string &key, const std::vector<uint8_t> &response)
+{
+    return key.size() * 2 + response.size() + NSPV_CACHE_ENTRY_OVERHEAD;
+}
+
+bool CNSPVResponseCache::Get(const std::string &key, std::vector<uint8_t> &response)
+{
+    LOCK(cs);
+    EntryMap::iterator it = mapEntries.find(key);
+    if (it == mapEntries.end()) {
+        nMisses++;
+        return false;
+    }
+    nHits++;
+    lru.splice(lru.begin(), lru, it->second.second);
+    response = it->second.first;
+    return true;
+}
+
+uint64_t CNSPVResponseCache::GetGeneration()
+{
+    LOCK(cs);
+    return nGeneration;
+}
+
+void CNSPVResponseCache::Put(const std::string &key, const std::vector<uint8_t> &response, uint64_t nGenerationIn)
+{
+    // a single response that would flush most of the cache is not worth keeping
+    size_t nEntryBytes = EntryBytes(key, response);
+    if (response.empty() || nEntryBytes > nMaxBytes / 8)
+        return;
+
+    LOCK(cs);
+    if (nGenerationIn != nGeneration || mapEntries.count(key))
+        return;
+    lru.push_front(key);
+    mapEntries.insert(std::make_pair(key, std::make_pair(response, lru.begin())));
+    nBytes += nEntryBytes;
+    EvictIfNeeded();
+}
+
+// requires cs
+void CNSPVResponseCache::EvictIfNeeded()
+{
+    while (nBytes > nMaxBytes && !lru.empty()) {
+        EntryMap::iterator it = mapEntries.find(lru.back());
+        nBytes -= EntryBytes(it->first, it->second.first);
+        mapEntries.erase(it);
+        lru.pop_back();
+        nEvictions++;
+    }
+}
+
+void CNSPVResponseCache::Clear()
+{
+    LOCK(cs);
+    nGeneration++;
+    if (!mapEntries.empty())
+        nInvalidations++;
+    mapEntries.clear();
+    lru.clear();
+    nBytes = 0;
+}
+
+CNSPVCacheStats CNSPVResponseCache::GetStats()
+{
+    LOCK(cs);
+    CNSPVCacheStats stats;
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+    stats.nEvictions = nEvictions;
+    stats.nInvalidations = nInvalidations;
+    stats.nEntries = mapEntries.size();
+    stats.nBytes = nBytes;
+    stats.nMaxBytes = nMaxBytes;
+    return stats;
+}
+
+void CNSPVResponseCache::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added)
+{
+    // signalled after the tip moved, requests computed before are stopped by the generation
+    Clear();
+}
+
+static std::mutex csRequestStats;
+static std::map<uint8_t, CNSPVRequestStats> mapRequestStats;
+
+void RecordNSPVRequest(uint8_t requestType, int64_t nMicros, bool fCacheHit)
+{
+    std::lock_guard<std::mutex> lock(csRequestStats);
+    CNSPVRequestStats &stats = mapRequestStats[requestType];
+    stats.latency.Add(nMicros);
+    if (fCacheHit) {
+        stats.nHits++;
+        stats.hitLatency.Add(nMicros);
+    }
+}
+
+void RecordNSPVRequestWait(uint8_t requestType, int64_t nMicros)
+{
+    std::lock_guard<std::mutex> lock(csRequestStats);
+    mapRequestStats[requestType].wait.Add(nMicros);
+}
+
+std::map<uint8_t, CNSPVRequestStats> GetNSPVRequestStats()
+{
+    std::lock_guard<std::mutex> lock(csRequestStats);
+    return mapRequestStats;
+}
+
+void ResetNSPVRequestStats()
+{
+    std::lock_guard<std::mutex> lock(csRequestStats);
+    mapRequestStats.clear();
+}
+
+std::string NSPVRequestName(uint8_t requestType)
+{
+    switch (requestType) {
+    case NSPV_INFO:             return "info";
+    case NSPV_UTXOS:            return "utxos";
+    case NSPV_NTZS:             return "ntzs";
+    case NSPV_NTZSPROOF:        return "ntzsproof";
+    case NSPV_TXPROOF:          return "txproof";
+    case NSPV_SPENTINFO:        return "spentinfo";
+    case NSPV_BROADCAST:        return "broadcast";
+    case NSPV_TXIDS:            return "txids";
+    case NSPV_MEMPOOL:          return "mempool";
+    case NSPV_CCMODULEUTXOS:    return "ccmoduleutxos";
+    case NSPV_REMOTERPC:        return "remoterpc";
+    case NSPV_TRANSACTIONS:     return "transactions";
+    case NSPV_TXIDS_V2:         return "txids_v2";
+    default:                    return strprintf("0x%02x", (int)requestType);
+    }
+}
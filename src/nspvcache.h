@@ -0,0 +1,113 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_NSPVCACHE_H
+#define KOMODO_NSPVCACHE_H
+
+#include "perfstats.h"
+#include "sync.h"
+#include "validationinterface.h"
+
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Default memory bound (in MiB) for nSPV responses kept until the next block, see -nspvcachesize. */
+static const unsigned int DEFAULT_NSPV_CACHE_SIZE = 32;
+
+struct CNSPVCacheStats
+{
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nEvictions;
+    uint64_t nInvalidations;    // tip changes that dropped cached responses
+    uint64_t nEntries;
+    uint64_t nBytes;
+    uint64_t nMaxBytes;
+};
+
+/**
+ * Serialized nSPV responses of the full node, keyed by request type and
+ * request parameters, so light clients asking the same question at the same
+ * tip share one computation of the answer (getinfo headers, notarization
+ * scans, tx and notarization proofs).
+ *
+ * Entries hold the complete response message, the request id is overwritten
+ * when it is sent. Every tip change clears the cache; a response computed
+ * while the tip moved is not stored, see GetGeneration(). Entries are evicted
+ * least-recently-used first once nMaxBytes is exceeded.
+ */
+class CNSPVResponseCache : public CValidationInterface
+{
+public:
+    explicit CNSPVResponseCache(size_t nMaxBytesIn);
+
+    /** Whether responses to requests of this type only change with the tip. */
+    static bool IsCacheable(uint8_t requestType);
+    static std::string MakeKey(uint8_t requestType, const uint8_t *requestData, size_t requestDataLen);
+
+    bool Get(const std::string &key, std::vector<uint8_t> &response);
+    /** Read before computing a response and passed to Put, which drops it if the tip changed since. */
+    uint64_t GetGeneration();
+    void Put(const std::string &key, const std::vector<uint8_t> &response, uint64_t nGeneration);
+
+    void Clear();
+    CNSPVCacheStats GetStats();
+
+protected:
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added);
+
+private:
+    typedef std::list<std::string> LruList;
+    typedef std::map<std::string, std::pair<std::vector<uint8_t>, LruList::iterator> > EntryMap;
+
+    static size_t EntryBytes(const std::string &key, const std::vector<uint8_t> &response);
+    void EvictIfNeeded();
+
+    CCriticalSection cs;
+    EntryMap mapEntries;
+    LruList lru;                // most recently used at the front
+    const size_t nMaxBytes;
+    size_t nBytes;
+    uint64_t nGeneration;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nEvictions;
+    uint64_t nInvalidations;
+};
+
+/** Set by init when -nspvcachesize is not 0 and nSPV requests are served, NULL otherwise. */
+extern CNSPVResponseCache *pnspvcache;
+
+struct CNSPVRequestStats
+{
+    uint64_t nHits;
+    CLatencyHistogram latency;      // all requests of the type, time to serve them after any wait
+    CLatencyHistogram hitLatency;   // requests answered from the response cache
+    CLatencyHistogram wait;         // time queued for a worker, see CNSPVScheduler
+
+    CNSPVRequestStats() : nHits(0) {}
+};
+
+void RecordNSPVRequest(uint8_t requestType, int64_t nMicros, bool fCacheHit);
+void RecordNSPVRequestWait(uint8_t requestType, int64_t nMicros);
+std::map<uint8_t, CNSPVRequestStats> GetNSPVRequestStats();
+void ResetNSPVRequestStats();
+/** Name of a request type as listed by getnspvstats. */
+std::string NSPVRequestName(uint8_t requestType);
+
+#endif // KOMODO_NSPVCACHE_H
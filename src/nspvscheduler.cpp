@@ -0,0 +1,264 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "nspvscheduler.h"
+
+#include "komodo_nSPV_defs.h"
+#include "net.h"
+#include "nspvcache.h"
+#include "util.h"
+#include "utiltime.h"
+
+CNSPVScheduler *pnspvscheduler = NULL;
+
+// idle peers with a full budget are forgotten this often
+static const int64_t NSPV_PRUNE_INTERVAL = 10 * 1000000;
+
+int64_t NSPVRequestCost(uint8_t requestType)
+{
+    switch (requestType) {
+    case NSPV_INFO:             return 1;   // usually from the response cache
+    case NSPV_NTZS:             return 2;
+    case NSPV_NTZSPROOF:        return 4;   // headers of the notarized range
+    case NSPV_TXPROOF:          return 4;   // block read and merkle proof
+    case NSPV_SPENTINFO:        return 2;
+    case NSPV_BROADCAST:        return 8;   // mempool acceptance
+    case NSPV_UTXOS:            return 10;  // address index scans
+    case NSPV_TXIDS:
+    case NSPV_TXIDS_V2:         return 10;
+    case NSPV_REMOTERPC:        return 10;
+    case NSPV_CCMODULEUTXOS:    return 20;
+    default:                    return 1;   // rejected early
+    }
+}
+
+CNSPVFairQueue::CNSPVFairQueue(int64_t nPeerBudgetIn, size_t nMaxPeerQueueIn) :
+    nPeerBudget(nPeerBudgetIn), nMaxPeerQueue(nMaxPeerQueueIn), dVirtualTime(0), nQueued(0), nLastPrune(0)
+{
+}
+
+void CNSPVFairQueue::Refill(Peer &peer, int64_t nNow)
+{
+    double dCapacity = (double)(nPeerBudget * NSPV_PEER_BUDGET_BURST);
+    if (peer.nLastRefill == 0)
+        peer.dTokens = dCapacity;
+    else if (nNow > peer.nLastRefill)
+        peer.dTokens = std::min(dCapacity, peer.dTokens + (nNow - peer.nLastRefill) * 1e-6 * nPeerBudget);
+    peer.nLastRefill = nNow;
+}
+
+void CNSPVFairQueue::PruneIdle(int64_t nNow)
+{
+    for (std::map<NodeId, Peer>::iterator it = mapPeers.begin(); it != mapPeers.end(); ) {
+        Peer &peer = it->second;
+        if (!peer.fBusy && peer.queue.empty()) {
+            Refill(peer, nNow);
+            if (nPeerBudget <= 0 || peer.dTokens >= nPeerBudget * NSPV_PEER_BUDGET_BURST) {
+                mapPeers.erase(it++);
+                continue;
+            }
+        }
+        it++;
+    }
+}
+
+CNSPVFairQueue::PushResult CNSPVFairQueue::Push(CNSPVRequest &request, double dWeight, int64_t nNow)
+{
+    if (nNow - nLastPrune > NSPV_PRUNE_INTERVAL) {
+        PruneIdle(nNow);
+        nLastPrune = nNow;
+    }
+
+    Peer &peer = mapPeers[request.peer];
+    if (peer.queue.size() >= nMaxPeerQueue)
+        return PEER_QUEUE_FULL;
+    if (nPeerBudget > 0) {
+        Refill(peer, nNow);
+        if (peer.dTokens < request.nCost)
+            return OVER_BUDGET;
+        peer.dTokens -= request.nCost;
+    }
+
+    request.dStart = std::max(dVirtualTime, peer.dLastFinish);
+    request.dFinish = request.dStart + request.nCost / dWeight;
+    peer.dLastFinish = request.dFinish;
+    if (!peer.fBusy && peer.queue.empty())
+        setReady.insert(std::make_pair(request.dFinish, request.peer));
+    peer.queue.push_back(std::move(request));
+    nQueued++;
+    return QUEUED;
+}
+
+bool CNSPVFairQueue::Pop(CNSPVRequest &request)
+{
+    if (setReady.empty())
+        return false;
+    NodeId id = setReady.begin()->second;
+    setReady.erase(setReady.begin());
+    Peer &peer = mapPeers[id];
+    request = std::move(peer.queue.front());
+    peer.queue.pop_front();
+    peer.fBusy = true;
+    nQueued--;
+    dVirtualTime = std::max(dVirtualTime, request.dStart);
+    return true;
+}
+
+void CNSPVFairQueue::Done(NodeId id)
+{
+    std::map<NodeId, Peer>::iterator it = mapPeers.find(id);
+    if (it == mapPeers.end())
+        return;
+    it->second.fBusy = false;
+    if (!it->second.queue.empty())
+        setReady.insert(std::make_pair(it->second.queue.front().dFinish, id));
+}
+
+void CNSPVFairQueue::Clear(std::vector<CNSPVRequest> &vRemoved)
+{
+    for (std::map<NodeId, Peer>::iterator it = mapPeers.begin(); it != mapPeers.end(); it++) {
+        for (CNSPVRequest &request : it->second.queue)
+            vRemoved.push_back(std::move(request));
+        it->second.queue.clear();
+    }
+    setReady.clear();
+    nQueued = 0;
+}
+
+static void ReleaseNode(CNode *pnode)
+{
+    LOCK(cs_vNodes);
+    pnode->Release();
+}
+
+CNSPVScheduler::CNSPVScheduler(int nThreadsIn, int64_t nPeerBudget, const Handler &handlerIn) :
+    nThreads(nThreadsIn), handler(handlerIn), queue(nPeerBudget, NSPV_MAX_PEER_QUEUE), fStop(false),
+    nMaxDepth(0), nQueuedTotal(0), nProcessed(0), nDroppedQueueFull(0), nDroppedBudget(0)
+{
+    for (int i = 0; i < nThreads; i++)
+        vWorkers.push_back(std::thread(&CNSPVScheduler::ThreadWorker, this));
+}
+
+CNSPVScheduler::~CNSPVScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    condRequests.notify_all();
+    for (std::thread &worker : vWorkers)
+        worker.join();
+
+    std::vector<CNSPVRequest> vRemoved;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        queue.Clear(vRemoved);
+    }
+    for (CNSPVRequest &request : vRemoved)
+        ReleaseNode(request.pnode);
+}
+
+bool CNSPVScheduler::Submit(CNode *pnode, std::vector<uint8_t> &data)
+{
+    if (data.empty())
+        return false;
+
+    CNSPVRequest request;
+    request.peer = pnode->GetId();
+    request.pnode = pnode;
+    request.nCost = NSPVRequestCost(data[0]);
+    request.nTimeQueued = GetTimeMicros();
+    request.data.swap(data);
+    uint8_t requestType = request.data[0];
+    {
+        LOCK(cs_vNodes);
+        pnode->AddRef();
+    }
+
+    CNSPVFairQueue::PushResult result = CNSPVFairQueue::PEER_QUEUE_FULL;
+    bool fStopped;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        // requests refused while stopping are not counted as dropped
+        fStopped = fStop;
+        if (!fStopped) {
+            result = queue.Push(request, pnode->fWhitelisted ? NSPV_WHITELIST_WEIGHT : 1.0, request.nTimeQueued);
+            if (result == CNSPVFairQueue::QUEUED) {
+                nQueuedTotal++;
+                nMaxDepth = std::max(nMaxDepth, (uint64_t)queue.Size());
+            } else if (result == CNSPVFairQueue::OVER_BUDGET) {
+                nDroppedBudget++;
+            } else {
+                nDroppedQueueFull++;
+            }
+        }
+    }
+    if (result == CNSPVFairQueue::QUEUED) {
+        condRequests.notify_one();
+        return true;
+    }
+    LogPrint("nspv", "%s: request type 0x%02x from peer %d dropped, %s\n", __func__, (int)requestType, pnode->GetId(),
+        fStopped ? "shutting down" : result == CNSPVFairQueue::OVER_BUDGET ? "over its budget" : "too many queued");
+    ReleaseNode(pnode);
+    return false;
+}
+
+void CNSPVScheduler::ThreadWorker()
+{
+    RenameThread("komodo-nspv");
+    while (true) {
+        CNSPVRequest request;
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            while (!fStop && !queue.Pop(request))
+                condRequests.wait(lock);
+            if (fStop)
+                return;
+        }
+
+        uint8_t requestType = request.data[0];
+        RecordNSPVRequestWait(requestType, GetTimeMicros() - request.nTimeQueued);
+        if (!request.pnode->fDisconnect) {
+            try {
+                handler(request.pnode, std::move(request.data));
+            } catch (const std::exception& e) {
+                LogPrintf("%s: request type 0x%02x from peer %d: %s\n", __func__, (int)requestType, request.peer, e.what());
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            queue.Done(request.peer);
+            nProcessed++;
+        }
+        // the peer's next request may be ready now
+        condRequests.notify_one();
+        ReleaseNode(request.pnode);
+    }
+}
+
+CNSPVSchedulerStats CNSPVScheduler::GetStats()
+{
+    std::lock_guard<std::mutex> lock(cs);
+    CNSPVSchedulerStats stats;
+    stats.nThreads = nThreads;
+    stats.nDepth = queue.Size();
+    stats.nMaxDepth = nMaxDepth;
+    stats.nPeers = queue.PeerCount();
+    stats.nQueued = nQueuedTotal;
+    stats.nProcessed = nProcessed;
+    stats.nDroppedQueueFull = nDroppedQueueFull;
+    stats.nDroppedBudget = nDroppedBudget;
+    return stats;
+}
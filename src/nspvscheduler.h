@@ -0,0 +1,169 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_NSPVSCHEDULER_H
+#define KOMODO_NSPVSCHEDULER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+class CNode;
+typedef int NodeId;
+
+/** Threads serving nSPV requests, 0 to serve them on the message handler thread, see -nspvthreads. */
+static const int DEFAULT_NSPV_THREADS = 2;
+static const int MAX_NSPV_THREADS = 16;
+/** Request cost units a peer may spend per second, see -nspvpeerbudget and NSPVRequestCost(). */
+static const int64_t DEFAULT_NSPV_PEER_BUDGET = 100;
+/** A peer may burst this many seconds of its budget after being idle. */
+static const int64_t NSPV_PEER_BUDGET_BURST = 2;
+/** Requests queued per peer, more are dropped. */
+static const size_t NSPV_MAX_PEER_QUEUE = 64;
+/** Share of the workers given to whitelisted peers relative to others. */
+static const double NSPV_WHITELIST_WEIGHT = 4.0;
+
+/** Estimated relative cost of serving a request of this type. */
+int64_t NSPVRequestCost(uint8_t requestType);
+
+struct CNSPVRequest
+{
+    NodeId peer;
+    CNode *pnode;               // referenced while queued
+    std::vector<uint8_t> data;
+    int64_t nCost;
+    int64_t nTimeQueued;
+    double dStart;              // virtual time tags
+    double dFinish;
+
+    CNSPVRequest() : peer(-1), pnode(NULL), nCost(0), nTimeQueued(0), dStart(0), dFinish(0) {}
+};
+
+/**
+ * Weighted fair queue of nSPV requests across peers. Each request is tagged
+ * with a virtual start time, the later of the current virtual time and the
+ * finish time of the peer's previous request, and a finish time, its start
+ * plus its cost over the peer weight. The ready peer whose head request has
+ * the earliest finish tag is served next (so a cheap request is not held up
+ * by an expensive one started earlier) and the virtual time advances to the
+ * start tag of the request served: a peer sending many or expensive requests
+ * only delays its own. A peer has at most one request being served, so its
+ * requests run in order.
+ *
+ * Each peer also has a token bucket of request cost; requests over the budget
+ * are refused. Not thread safe, CNSPVScheduler locks it.
+ */
+class CNSPVFairQueue
+{
+public:
+    enum PushResult { QUEUED, PEER_QUEUE_FULL, OVER_BUDGET };
+
+    CNSPVFairQueue(int64_t nPeerBudgetIn, size_t nMaxPeerQueueIn);
+
+    /** Moves request into the queue if it is QUEUED. */
+    PushResult Push(CNSPVRequest &request, double dWeight, int64_t nNow);
+    /** Next request to serve, its peer is busy until Done. */
+    bool Pop(CNSPVRequest &request);
+    void Done(NodeId peer);
+    /** Removes all queued requests. */
+    void Clear(std::vector<CNSPVRequest> &vRemoved);
+
+    size_t Size() const { return nQueued; }
+    size_t PeerCount() const { return mapPeers.size(); }
+
+private:
+    struct Peer
+    {
+        std::deque<CNSPVRequest> queue;
+        bool fBusy;
+        double dLastFinish;
+        double dTokens;
+        int64_t nLastRefill;
+
+        Peer() : fBusy(false), dLastFinish(0), dTokens(0), nLastRefill(0) {}
+    };
+
+    void Refill(Peer &peer, int64_t nNow);
+    void PruneIdle(int64_t nNow);
+
+    const int64_t nPeerBudget;
+    const size_t nMaxPeerQueue;
+    std::map<NodeId, Peer> mapPeers;
+    std::set<std::pair<double, NodeId> > setReady;  // finish tag of the head of each ready peer
+    double dVirtualTime;
+    size_t nQueued;
+    int64_t nLastPrune;
+};
+
+struct CNSPVSchedulerStats
+{
+    int nThreads;
+    uint64_t nDepth;
+    uint64_t nMaxDepth;
+    uint64_t nPeers;
+    uint64_t nQueued;
+    uint64_t nProcessed;
+    uint64_t nDroppedQueueFull;
+    uint64_t nDroppedBudget;
+};
+
+/**
+ * Serves the nSPV requests of network peers on a pool of worker threads in
+ * fair queuing order, so expensive requests never hold up the message
+ * handler thread and block relay. Responses are pushed to the peer from the
+ * worker. Queued requests keep a reference to their node.
+ */
+class CNSPVScheduler
+{
+public:
+    typedef std::function<void(CNode*, std::vector<uint8_t>)> Handler;
+
+    CNSPVScheduler(int nThreadsIn, int64_t nPeerBudget, const Handler &handlerIn);
+    /** Stops the workers, requests still queued are dropped. */
+    ~CNSPVScheduler();
+
+    /** False if the request was dropped for the peer's queue or budget, or the workers are stopping. */
+    bool Submit(CNode *pnode, std::vector<uint8_t> &request);
+    CNSPVSchedulerStats GetStats();
+
+private:
+    void ThreadWorker();
+
+    const int nThreads;
+    const Handler handler;
+
+    std::mutex cs;
+    std::condition_variable condRequests;
+    CNSPVFairQueue queue;
+    bool fStop;
+    uint64_t nMaxDepth;
+    uint64_t nQueuedTotal;
+    uint64_t nProcessed;
+    uint64_t nDroppedQueueFull;
+    uint64_t nDroppedBudget;
+
+    std::vector<std::thread> vWorkers;
+};
+
+/** Set by init when nSPV requests are served with -nspvthreads above 0, NULL otherwise. */
+extern CNSPVScheduler *pnspvscheduler;
+
+#endif // KOMODO_NSPVSCHEDULER_H
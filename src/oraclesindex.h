@@ -0,0 +1,153 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef ORACLESINDEX_H
+#define ORACLESINDEX_H
+
+#include "uint256.h"
+#include "pubkey.h"
+#include "serialize.h"
+
+#include <vector>
+
+// oracles data samples are stored newest first: the height is serialized big endian and inverted
+// so a cursor seeking to (oracletxid, baton) reads the last samples of a publisher in order
+static inline uint32_t OraclesIndexHeight(int32_t height) { return 0xffffffff - (uint32_t)height; }
+
+// oracles data index key
+struct COraclesDataIndexKey {
+    uint256 oracletxid;
+    uint160 batonHash;   // hash of the publisher baton cc address, one per publisher and oracle
+    int32_t blockHeight;
+    uint256 txhash;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return sizeof(uint256) + sizeof(uint160) + sizeof(uint32_t) + sizeof(uint256);
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        oracletxid.Serialize(s);
+        batonHash.Serialize(s);
+        ser_writedata32be(s, OraclesIndexHeight(blockHeight));
+        txhash.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        oracletxid.Unserialize(s);
+        batonHash.Unserialize(s);
+        blockHeight = (int32_t)OraclesIndexHeight((int32_t)ser_readdata32be(s));
+        txhash.Unserialize(s);
+    }
+
+    COraclesDataIndexKey(uint256 _oracletxid, uint160 _batonHash, int32_t _height, uint256 _txid) {
+        oracletxid = _oracletxid;
+        batonHash = _batonHash;
+        blockHeight = _height;
+        txhash = _txid;
+    }
+
+    COraclesDataIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        oracletxid.SetNull();
+        batonHash.SetNull();
+        blockHeight = 0;
+        txhash.SetNull();
+    }
+};
+
+// partial key for oracletxid+baton, optionally starting at a height
+struct COraclesDataIndexKeyBaton {
+    uint256 oracletxid;
+    uint160 batonHash;
+    int32_t blockHeight;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return sizeof(uint256) + sizeof(uint160) + (blockHeight >= 0 ? sizeof(uint32_t) : 0);
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        oracletxid.Serialize(s);
+        batonHash.Serialize(s);
+        if (blockHeight >= 0)
+            ser_writedata32be(s, OraclesIndexHeight(blockHeight));
+    }
+
+    COraclesDataIndexKeyBaton(uint256 _oracletxid, uint160 _batonHash, int32_t _height = -1) {
+        oracletxid = _oracletxid;
+        batonHash = _batonHash;
+        blockHeight = _height;
+    }
+};
+
+// oracles data index value, the decoded sample
+struct COraclesDataIndexValue {
+    CPubKey publisher;
+    uint256 batontxid;
+    std::vector<uint8_t> data;
+    bool fNull;  // not serialized, a null value erases its key in UpdateOraclesDataIndex
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(publisher);
+        READWRITE(batontxid);
+        READWRITE(data);
+        if (ser_action.ForRead())
+            fNull = false;
+    }
+
+    COraclesDataIndexValue(const CPubKey &_publisher, uint256 _batontxid, const std::vector<uint8_t> &_data) {
+        publisher = _publisher;
+        batontxid = _batontxid;
+        data = _data;
+        fNull = false;
+    }
+
+    COraclesDataIndexValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        publisher = CPubKey();
+        batontxid.SetNull();
+        data.clear();
+        fNull = true;
+    }
+
+    bool IsNull() const {
+        return fNull;
+    }
+};
+
+// same order as the db keys: newest samples of a publisher first
+struct COraclesDataIndexKeyCompare
+{
+    bool operator()(const COraclesDataIndexKey& a, const COraclesDataIndexKey& b) const
+    {
+        if (a.oracletxid != b.oracletxid)
+            return a.oracletxid < b.oracletxid;
+        if (a.batonHash != b.batonHash)
+            return a.batonHash < b.batonHash;
+        if (a.blockHeight != b.blockHeight)
+            return a.blockHeight > b.blockHeight;
+        return a.txhash < b.txhash;
+    }
+};
+
+#endif // #ifndef ORACLESINDEX_H
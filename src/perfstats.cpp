@@ -0,0 +1,283 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "perfstats.h"
+
+#include <cmath>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+CLatencyHistogram::CLatencyHistogram() : nCount(0), nTotalMicros(0), nMaxMicros(0)
+{
+    for (int i = 0; i < BUCKETS; i++)
+        vBuckets[i] = 0;
+}
+
+void CLatencyHistogram::Add(int64_t nMicros)
+{
+    uint64_t n = nMicros > 0 ? nMicros : 0;
+    int nBucket = 0;
+    while (nBucket < BUCKETS - 1 && (n >> nBucket) != 0)
+        nBucket++;
+    vBuckets[nBucket]++;
+    nCount++;
+    nTotalMicros += n;
+    if (n > nMaxMicros)
+        nMaxMicros = n;
+}
+
+void CLatencyHistogram::Merge(const CLatencyHistogram& other)
+{
+    for (int i = 0; i < BUCKETS; i++)
+        vBuckets[i] += other.vBuckets[i];
+    nCount += other.nCount;
+    nTotalMicros += other.nTotalMicros;
+    if (other.nMaxMicros > nMaxMicros)
+        nMaxMicros = other.nMaxMicros;
+}
+
+uint64_t CLatencyHistogram::Percentile(double dPercent) const
+{
+    if (nCount == 0)
+        return 0;
+    // nearest rank, zero based
+    uint64_t nRank = (uint64_t)std::ceil(dPercent / 100.0 * nCount);
+    nRank = nRank > 0 ? nRank - 1 : 0;
+    if (nRank >= nCount)
+        nRank = nCount - 1;
+    uint64_t nSeen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        nSeen += vBuckets[i];
+        if (nSeen > nRank) {
+            uint64_t nUpper = (uint64_t)1 << i;
+            return nUpper < nMaxMicros ? nUpper : nMaxMicros;
+        }
+    }
+    return nMaxMicros;
+}
+
+void CRPCPerfStats::Merge(const CRPCPerfStats& other)
+{
+    latency.Merge(other.latency);
+    nErrors += other.nErrors;
+    nBytesOut += other.nBytesOut;
+}
+
+void CLockPerfStats::Merge(const CLockPerfStats& other)
+{
+    wait.Merge(other.wait);
+    hold.Merge(other.hold);
+    nContended += other.nContended;
+}
+
+int64_t PerfTimeMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+namespace {
+
+/** Counters of one thread. cs is only contended while a reader merges them. */
+struct CPerfThreadData
+{
+    std::mutex cs;
+    std::map<std::string, CRPCPerfStats> mapRPC;
+    std::unordered_map<const char*, CLockPerfStats> mapLocks;
+};
+
+/** Live threads plus whatever threads that already exited left behind. */
+struct CPerfRegistry
+{
+    std::mutex cs;
+    std::set<CPerfThreadData*> setThreads;
+    CPerfThreadData retired;
+};
+
+CPerfRegistry& Registry()
+{
+    // never destroyed, threads may still retire their counters during shutdown
+    static CPerfRegistry* registry = new CPerfRegistry();
+    return *registry;
+}
+
+void MergeInto(CPerfThreadData& to, CPerfThreadData& from)
+{
+    for (auto& entry : from.mapRPC)
+        to.mapRPC[entry.first].Merge(entry.second);
+    for (auto& entry : from.mapLocks)
+        to.mapLocks[entry.first].Merge(entry.second);
+}
+
+struct CPerfThreadHolder
+{
+    CPerfThreadData* pdata;
+
+    CPerfThreadHolder() : pdata(new CPerfThreadData())
+    {
+        CPerfRegistry& registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.cs);
+        registry.setThreads.insert(pdata);
+    }
+
+    ~CPerfThreadHolder()
+    {
+        CPerfRegistry& registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.cs);
+        registry.setThreads.erase(pdata);
+        {
+            std::lock_guard<std::mutex> lockData(pdata->cs);
+            MergeInto(registry.retired, *pdata);
+        }
+        delete pdata;
+    }
+};
+
+CPerfThreadData& ThreadData()
+{
+    static thread_local CPerfThreadHolder holder;
+    return *holder.pdata;
+}
+
+} // namespace
+
+void RecordRPCCall(const std::string& strMethod, int64_t nMicros, bool fError)
+{
+    CPerfThreadData& data = ThreadData();
+    std::lock_guard<std::mutex> lock(data.cs);
+    CRPCPerfStats& stats = data.mapRPC[strMethod];
+    stats.latency.Add(nMicros);
+    if (fError)
+        stats.nErrors++;
+}
+
+void RecordRPCBytesOut(const std::string& strMethod, uint64_t nBytes)
+{
+    CPerfThreadData& data = ThreadData();
+    std::lock_guard<std::mutex> lock(data.cs);
+    data.mapRPC[strMethod].nBytesOut += nBytes;
+}
+
+void RecordLockWait(const char* pszName, int64_t nMicros, bool fContended)
+{
+    CPerfThreadData& data = ThreadData();
+    std::lock_guard<std::mutex> lock(data.cs);
+    CLockPerfStats& stats = data.mapLocks[pszName];
+    stats.wait.Add(nMicros);
+    if (fContended)
+        stats.nContended++;
+}
+
+void RecordLockHold(const char* pszName, int64_t nMicros)
+{
+    CPerfThreadData& data = ThreadData();
+    std::lock_guard<std::mutex> lock(data.cs);
+    data.mapLocks[pszName].hold.Add(nMicros);
+}
+
+std::map<std::string, CRPCPerfStats> GetRPCPerfStats()
+{
+    std::map<std::string, CRPCPerfStats> result;
+    CPerfRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.cs);
+    std::vector<CPerfThreadData*> vData(registry.setThreads.begin(), registry.setThreads.end());
+    vData.push_back(&registry.retired);
+    for (CPerfThreadData* pdata : vData) {
+        std::lock_guard<std::mutex> lockData(pdata->cs);
+        for (auto& entry : pdata->mapRPC)
+            result[entry.first].Merge(entry.second);
+    }
+    return result;
+}
+
+std::map<std::string, CLockPerfStats> GetLockPerfStats()
+{
+    // the same lock is named from many call sites, merge them by name
+    std::map<std::string, CLockPerfStats> result;
+    CPerfRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.cs);
+    std::vector<CPerfThreadData*> vData(registry.setThreads.begin(), registry.setThreads.end());
+    vData.push_back(&registry.retired);
+    for (CPerfThreadData* pdata : vData) {
+        std::lock_guard<std::mutex> lockData(pdata->cs);
+        for (auto& entry : pdata->mapLocks) {
+            std::string strName(entry.first);
+            if (!strName.empty() && strName[0] == '&')
+                strName.erase(0, 1);
+            result[strName].Merge(entry.second);
+        }
+    }
+    return result;
+}
+
+void ResetPerfStats()
+{
+    CPerfRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.cs);
+    registry.retired.mapRPC.clear();
+    registry.retired.mapLocks.clear();
+    for (CPerfThreadData* pdata : registry.setThreads) {
+        std::lock_guard<std::mutex> lockData(pdata->cs);
+        pdata->mapRPC.clear();
+        pdata->mapLocks.clear();
+    }
+}
+
+bool LockProfilingEnabled()
+{
+#ifdef DEBUG_LOCKPROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef DEBUG_LOCKPROFILE
+// pthread mutexes are not recursive, a small per-thread stack is enough to pair unlocks with locks
+static thread_local std::vector<std::pair<pthread_mutex_t*, int64_t> > vHeldMutexes;
+
+int ProfiledMutexLock(pthread_mutex_t* mutex, const char* pszName)
+{
+    int64_t nStart = PerfTimeMicros();
+    bool fContended = false;
+    int ret = pthread_mutex_trylock(mutex);
+    if (ret != 0) {
+        fContended = true;
+        ret = pthread_mutex_lock(mutex);
+    }
+    int64_t nLocked = PerfTimeMicros();
+    if (ret == 0) {
+        RecordLockWait(pszName, nLocked - nStart, fContended);
+        vHeldMutexes.push_back(std::make_pair(mutex, nLocked));
+    }
+    return ret;
+}
+
+int ProfiledMutexUnlock(pthread_mutex_t* mutex, const char* pszName)
+{
+    for (size_t i = vHeldMutexes.size(); i-- > 0; ) {
+        if (vHeldMutexes[i].first == mutex) {
+            RecordLockHold(pszName, PerfTimeMicros() - vHeldMutexes[i].second);
+            vHeldMutexes.erase(vHeldMutexes.begin() + i);
+            break;
+        }
+    }
+    return pthread_mutex_unlock(mutex);
+}
+#endif // DEBUG_LOCKPROFILE
@@ -0,0 +1,93 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_PERFSTATS_H
+#define KOMODO_PERFSTATS_H
+
+#include <map>
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * Latency histogram with power of two buckets: bucket 0 counts samples below
+ * 1us, bucket i samples in [2^(i-1), 2^i) us. Percentiles are reported as the
+ * upper bound of the bucket they fall in, capped by the largest sample seen.
+ */
+class CLatencyHistogram
+{
+public:
+    static const int BUCKETS = 40;
+
+    uint64_t nCount;
+    uint64_t nTotalMicros;
+    uint64_t nMaxMicros;
+    uint64_t vBuckets[BUCKETS];
+
+    CLatencyHistogram();
+    void Add(int64_t nMicros);
+    void Merge(const CLatencyHistogram& other);
+    uint64_t Percentile(double dPercent) const;
+};
+
+struct CRPCPerfStats
+{
+    CLatencyHistogram latency;
+    uint64_t nErrors;
+    uint64_t nBytesOut;
+
+    CRPCPerfStats() : nErrors(0), nBytesOut(0) {}
+    void Merge(const CRPCPerfStats& other);
+};
+
+struct CLockPerfStats
+{
+    CLatencyHistogram wait;
+    CLatencyHistogram hold;
+    uint64_t nContended;
+
+    CLockPerfStats() : nContended(0) {}
+    void Merge(const CLockPerfStats& other);
+};
+
+/** Monotonic clock used for all samples. */
+int64_t PerfTimeMicros();
+
+/**
+ * Samples are added to counters owned by the calling thread, so recording
+ * never contends with other threads; readers merge every thread's counters.
+ * RPC statistics are always collected. Lock statistics are collected by
+ * LOCK() and the instrumented pthread mutexes only in builds with
+ * -DDEBUG_LOCKPROFILE, like DEBUG_LOCKCONTENTION.
+ */
+void RecordRPCCall(const std::string& strMethod, int64_t nMicros, bool fError);
+void RecordRPCBytesOut(const std::string& strMethod, uint64_t nBytes);
+/** pszName must be a string literal (the LOCK() argument), it is kept as the key. */
+void RecordLockWait(const char* pszName, int64_t nMicros, bool fContended);
+void RecordLockHold(const char* pszName, int64_t nMicros);
+
+std::map<std::string, CRPCPerfStats> GetRPCPerfStats();
+std::map<std::string, CLockPerfStats> GetLockPerfStats();
+void ResetPerfStats();
+
+/** Whether this binary records lock statistics. */
+bool LockProfilingEnabled();
+
+#ifdef DEBUG_LOCKPROFILE
+int ProfiledMutexLock(pthread_mutex_t* mutex, const char* pszName);
+int ProfiledMutexUnlock(pthread_mutex_t* mutex, const char* pszName);
+#endif
+
+#endif // KOMODO_PERFSTATS_H
@@ -32,6 +32,10 @@
 
 #include "sodium.h"
 
+#include <boost/thread.hpp>
+#include <deque>
+#include <set>
+
 #ifdef ENABLE_RUST
 #include "librustzcash.h"
 #endif // ENABLE_RUST
@@ -648,7 +652,7 @@ uint32_t lwmaGetNextPOSRequired(const CBlockIndex* pindexLast, const Consensus::
         if (!pindexFirst)
             return nProofOfStakeLimit;
 
-        CBlockHeader hdr = pindexFirst->GetBlockHeader();
+        CBlockHeader hdr = pindexFirst->GetBlockHeaderWithoutSolution();
 
         if (hdr.IsVerusPOSBlock())
         {
@@ -674,7 +678,7 @@ uint32_t lwmaGetNextPOSRequired(const CBlockIndex* pindexLast, const Consensus::
             if (!pindexFirst)
                 return nProofOfStakeLimit;
 
-            CBlockHeader hdr = pindexFirst->GetBlockHeader();
+            CBlockHeader hdr = pindexFirst->GetBlockHeaderWithoutSolution();
             if (hdr.IsVerusPOSBlock())
             {
                 nBits = hdr.GetVerusPOSTarget();
@@ -754,42 +758,118 @@ uint32_t lwmaGetNextPOSRequired(const CBlockIndex* pindexLast, const Consensus::
     return nextTarget.GetCompact();
 }
 
-bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams& params)
+namespace {
+
+/**
+ * Hashes of headers whose Equihash solution was found valid. The block hash covers
+ * the solution, so a hit means this very header was verified before: a block checked
+ * ahead by the import workers (see blockimport.h) or one that goes through
+ * ProcessNewBlock, AcceptBlock and ConnectBlock is verified once.
+ */
+class CEquihashCache
 {
-    if (ASSETCHAINS_ALGO != ASSETCHAINS_EQUIHASH)
-        return true;
-    
-    if ( ASSETCHAINS_NK[0] != 0 && ASSETCHAINS_NK[1] != 0 && pblock->GetHash().ToString() == "027e3758c3a65b12aa1046462b486d0a63bfa1beae327897f56c5cfb7daaae71" )
-        return true;
+private:
+    static const size_t MAX_ENTRIES = 16384;
+    std::set<uint256> setValid;
+    std::deque<uint256> vOrder;     // oldest first, for eviction
+    boost::shared_mutex cs_equihashcache;
+
+public:
+    bool Get(const uint256& hash)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_equihashcache);
+        return setValid.count(hash) != 0;
+    }
 
-    unsigned int n = params.EquihashN();
-    unsigned int k = params.EquihashK();
+    void Set(const uint256& hash)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_equihashcache);
+        if (!setValid.insert(hash).second)
+            return;
+        vOrder.push_back(hash);
+        if (vOrder.size() > MAX_ENTRIES) {
+            setValid.erase(vOrder.front());
+            vOrder.pop_front();
+        }
+    }
+};
 
-    if ( Params().NetworkIDString() == "regtest" )
-        return(true);
-    // Hash state
-    crypto_generichash_blake2b_state state;
-    EhInitialiseState(n, k, state);
+CEquihashCache equihashCache;
+
+/** Equihash state of one verifying thread, reused for every header it checks. */
+struct CEquihashScratch
+{
+    unsigned int n;
+    unsigned int k;
+    crypto_generichash_blake2b_state baseState;
+    CDataStream ss;
+
+    CEquihashScratch() : n(0), k(0), ss(SER_NETWORK, PROTOCOL_VERSION) {}
+};
+
+bool VerifyEquihashSolution(const CBlockHeader *pblock, unsigned int n, unsigned int k)
+{
+    static thread_local CEquihashScratch scratch;
+    if (scratch.n != n || scratch.k != k) {
+        // The personalised initial state only depends on the parameters
+        EhInitialiseState(n, k, scratch.baseState);
+        scratch.n = n;
+        scratch.k = k;
+    }
+    crypto_generichash_blake2b_state state = scratch.baseState;
 
     // I = the block header minus nonce and solution.
     CEquihashInput I{*pblock};
     // I||V
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss << I;
-    ss << pblock->nNonce;
+    scratch.ss.clear();
+    scratch.ss << I;
+    scratch.ss << pblock->nNonce;
 
     // H(I||V||...
-    crypto_generichash_blake2b_update(&state, (unsigned char*)&ss[0], ss.size());
+    crypto_generichash_blake2b_update(&state, (unsigned char*)&scratch.ss[0], scratch.ss.size());
 
     bool isValid;
     EhIsValidSolution(n, k, state, pblock->nSolution, isValid);
+    return isValid;
+}
 
-    if (!isValid)
+} // anon namespace
+
+bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams& params, bool fUseCache)
+{
+    if (ASSETCHAINS_ALGO != ASSETCHAINS_EQUIHASH)
+        return true;
+    return CheckEquihashSolution(pblock, pblock->GetHash(), params, fUseCache);
+}
+
+bool CheckEquihashSolution(const CBlockHeader *pblock, const uint256& hash, const CChainParams& params, bool fUseCache)
+{
+    if (ASSETCHAINS_ALGO != ASSETCHAINS_EQUIHASH)
+        return true;
+    
+    if ( ASSETCHAINS_NK[0] != 0 && ASSETCHAINS_NK[1] != 0 && hash.ToString() == "027e3758c3a65b12aa1046462b486d0a63bfa1beae327897f56c5cfb7daaae71" )
+        return true;
+
+    unsigned int n = params.EquihashN();
+    unsigned int k = params.EquihashK();
+
+    if ( Params().NetworkIDString() == "regtest" )
+        return(true);
+    if (fUseCache && equihashCache.Get(hash))
+        return true;
+
+    if (!VerifyEquihashSolution(pblock, n, k))
         return error("CheckEquihashSolution(): invalid solution");
 
+    equihashCache.Set(hash);
     return true;
 }
 
+bool CEquihashCheck::operator()()
+{
+    return CheckEquihashSolution(pblock, hash, *params, fUseCache);
+}
+
 int32_t komodo_chosennotary(int32_t *notaryidp,int32_t height,uint8_t *pubkey33,uint32_t timestamp);
 int32_t komodo_is_special(uint8_t pubkeys[66][33],int32_t mids[66],uint32_t blocktimes[66],int32_t height,uint8_t pubkey33[33],uint32_t blocktime);
 int32_t komodo_currentheight();
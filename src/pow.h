@@ -24,6 +24,7 @@
 #include "chain.h"
 #include "consensus/params.h"
 
+#include <algorithm>
 #include <stdint.h>
 
 class CBlockHeader;
@@ -39,8 +40,40 @@ unsigned int CalculateNextWorkRequired(arith_uint256 bnAvg,
 
 unsigned int lwmaGetNextPOSRequired(const CBlockIndex* pindexLast, const Consensus::Params& params);
 
-/** Check whether the Equihash solution in a block header is valid */
-bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams&);
+/**
+ * Check whether the Equihash solution in a block header is valid. Valid headers are
+ * remembered, fUseCache = false verifies the solution even if it was seen before.
+ */
+bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams&, bool fUseCache = true);
+/** As above, for callers that already computed hash = pblock->GetHash(). */
+bool CheckEquihashSolution(const CBlockHeader *pblock, const uint256& hash, const CChainParams&, bool fUseCache = true);
+
+/**
+ * Closure representing one Equihash solution to verify on a check queue thread,
+ * see CheckEquihashSolutions in main.h. The header must outlive the check.
+ */
+class CEquihashCheck
+{
+private:
+    const CBlockHeader *pblock;
+    uint256 hash;
+    const CChainParams *params;
+    bool fUseCache;
+
+public:
+    CEquihashCheck() : pblock(NULL), params(NULL), fUseCache(true) {}
+    CEquihashCheck(const CBlockHeader *pblockIn, const uint256& hashIn, const CChainParams& paramsIn, bool fUseCacheIn = true) :
+        pblock(pblockIn), hash(hashIn), params(&paramsIn), fUseCache(fUseCacheIn) {}
+
+    bool operator()();
+
+    void swap(CEquihashCheck &check) {
+        std::swap(pblock, check.pblock);
+        std::swap(hash, check.hash);
+        std::swap(params, check.params);
+        std::swap(fUseCache, check.fUseCache);
+    }
+};
 
 /** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
 bool CheckProofOfWork(const CBlockHeader &blkHeader, uint8_t *pubkey33, int32_t height, const Consensus::Params& params);
@@ -21,6 +21,7 @@
 #include "amount.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "chainsnapshot.h"
 #include "checkpoints.h"
 #include "crosschain.h"
 #include "base58.h"
@@ -123,6 +124,21 @@ static UniValue ValuePoolDesc(
     return rv;
 }
 
+/** mapBlockIndex lookup for handlers that otherwise run without cs_main; entries are never freed, so the pointer stays valid. */
+static CBlockIndex* LookupBlockIndexRPC(const uint256& hash)
+{
+    LOCK(cs_main);
+    BlockMap::const_iterator it = mapBlockIndex.find(hash);
+    return it != mapBlockIndex.end() ? it->second : NULL;
+}
+
+/** komodo_segid needs cs_main, take it just for that; the result is cached in the block index after the first call. */
+static int8_t BlockSegid(int32_t nHeight)
+{
+    LOCK(cs_main);
+    return komodo_segid(0, nHeight);
+}
+
 UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 {
     UniValue result(UniValue::VOBJ);
@@ -131,14 +147,13 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
         result.push_back(Pair("error", "null blockhash"));
         return(result);
     }
-    uint256 notarized_hash, notarized_desttxid; int32_t prevMoMheight, notarized_height;
-    notarized_height = komodo_notarized_height(&prevMoMheight, &notarized_hash, &notarized_desttxid);
-    result.push_back(Pair("last_notarized_height", notarized_height));
+    CChainSnapshotRef chain = GetChainSnapshot();
+    result.push_back(Pair("last_notarized_height", chain->nNotarizedHeight));
     result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->GetHeight() + 1;
+    if (chain->Contains(blockindex))
+        confirmations = chain->nHeight - blockindex->GetHeight() + 1;
     result.push_back(Pair("confirmations", komodo_dpowconfs(blockindex->GetHeight(), confirmations)));
     result.push_back(Pair("rawconfirmations", confirmations));
     result.push_back(Pair("height", blockindex->GetHeight()));
@@ -147,15 +162,15 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     result.push_back(Pair("finalsaplingroot", blockindex->hashFinalSaplingRoot.GetHex()));
     result.push_back(Pair("time", (int64_t)blockindex->nTime));
     result.push_back(Pair("nonce", blockindex->nNonce.GetHex()));
-    result.push_back(Pair("solution", HexStr(blockindex->nSolution)));
+    result.push_back(Pair("solution", HexStr(blockindex->GetSolution())));
     result.push_back(Pair("bits", strprintf("%08x", blockindex->nBits)));
     result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
     result.push_back(Pair("chainwork", blockindex->chainPower.chainWork.GetHex()));
-    result.push_back(Pair("segid", (int)komodo_segid(0, blockindex->GetHeight())));
+    result.push_back(Pair("segid", (int)BlockSegid(blockindex->GetHeight())));
 
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    CBlockIndex *pnext = chain->Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
     return result;
@@ -165,10 +180,11 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
 {
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", block.GetHash().GetHex()));
+    CChainSnapshotRef chain = GetChainSnapshot();
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex)) {
-        confirmations = chainActive.Height() - blockindex->GetHeight() + 1;
+    if (chain->Contains(blockindex)) {
+        confirmations = chain->nHeight - blockindex->GetHeight() + 1;
     }
     else {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block is an orphan");
@@ -179,7 +195,7 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
     result.push_back(Pair("height", blockindex->GetHeight()));
     result.push_back(Pair("version", block.nVersion));
     result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
-    result.push_back(Pair("segid", (int)komodo_segid(0, blockindex->GetHeight())));
+    result.push_back(Pair("segid", (int)BlockSegid(blockindex->GetHeight())));
 
     UniValue deltas(UniValue::VARR);
 
@@ -278,7 +294,7 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
 
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    CBlockIndex *pnext = chain->Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
     return result;
@@ -287,21 +303,20 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
 {
     UniValue result(UniValue::VOBJ);
-    uint256 notarized_hash, notarized_desttxid; int32_t prevMoMheight, notarized_height;
-    notarized_height = komodo_notarized_height(&prevMoMheight, &notarized_hash, &notarized_desttxid);
-    result.push_back(Pair("last_notarized_height", notarized_height));
+    CChainSnapshotRef chain = GetChainSnapshot();
+    result.push_back(Pair("last_notarized_height", chain->nNotarizedHeight));
     result.push_back(Pair("hash", block.GetHash().GetHex()));
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->GetHeight() + 1;
+    if (chain->Contains(blockindex))
+        confirmations = chain->nHeight - blockindex->GetHeight() + 1;
     result.push_back(Pair("confirmations", komodo_dpowconfs(blockindex->GetHeight(), confirmations)));
     result.push_back(Pair("rawconfirmations", confirmations));
     result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
     result.push_back(Pair("height", blockindex->GetHeight()));
     result.push_back(Pair("version", block.nVersion));
     result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
-    result.push_back(Pair("segid", (int)komodo_segid(0, blockindex->GetHeight())));
+    result.push_back(Pair("segid", (int)BlockSegid(blockindex->GetHeight())));
     result.push_back(Pair("finalsaplingroot", block.hashFinalSaplingRoot.GetHex()));
     UniValue txs(UniValue::VARR);
     BOOST_FOREACH(const CTransaction&tx, block.vtx)
@@ -332,7 +347,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    CBlockIndex *pnext = chain->Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
     return result;
@@ -351,8 +366,7 @@ UniValue getblockcount(const UniValue& params, bool fHelp, const CPubKey& mypk)
             + HelpExampleRpc("getblockcount", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return GetChainSnapshot()->nHeight;
 }
 
 UniValue getbestblockhash(const UniValue& params, bool fHelp, const CPubKey& mypk)
@@ -368,8 +382,7 @@ UniValue getbestblockhash(const UniValue& params, bool fHelp, const CPubKey& myp
             + HelpExampleRpc("getbestblockhash", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.LastTip()->GetBlockHash().GetHex();
+    return GetChainSnapshot()->hashTip.GetHex();
 }
 
 UniValue getdifficulty(const UniValue& params, bool fHelp, const CPubKey& mypk)
@@ -648,13 +661,13 @@ UniValue getblockhash(const UniValue& params, bool fHelp, const CPubKey& mypk)
             + HelpExampleRpc("getblockhash", "1000")
         );
 
-    LOCK(cs_main);
+    CChainSnapshotRef chain = GetChainSnapshot();
 
     int nHeight = params[0].get_int();
-    if (nHeight < 0 || nHeight > chainActive.Height())
+    if (nHeight < 0 || nHeight > chain->nHeight)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
 
-    CBlockIndex* pblockindex = chainActive[nHeight];
+    CBlockIndex* pblockindex = (*chain)[nHeight];
     return pblockindex->GetBlockHash().GetHex();
 }
 
@@ -767,8 +780,6 @@ UniValue getblockheader(const UniValue& params, bool fHelp, const CPubKey& mypk)
             + HelpExampleRpc("getblockheader", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
         );
 
-    LOCK(cs_main);
-
     std::string strHash = params[0].get_str();
     uint256 hash(uint256S(strHash));
 
@@ -776,11 +787,10 @@ UniValue getblockheader(const UniValue& params, bool fHelp, const CPubKey& mypk)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
+    CBlockIndex* pblockindex = LookupBlockIndexRPC(hash);
+    if (pblockindex == NULL)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
     if (!fVerbose)
     {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
@@ -841,8 +851,7 @@ UniValue getblock(const UniValue& params, bool fHelp, const CPubKey& mypk)
             + HelpExampleRpc("getblock", "12800")
         );
 
-    LOCK(cs_main);
-
+    CChainSnapshotRef chain = GetChainSnapshot();
     std::string strHash = params[0].get_str();
 
     // If height is supplied, find the hash
@@ -861,10 +870,10 @@ UniValue getblock(const UniValue& params, bool fHelp, const CPubKey& mypk)
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
         }
 
-        if (nHeight < 0 || nHeight > chainActive.Height()) {
+        if (nHeight < 0 || nHeight > chain->nHeight) {
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
         }
-        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
+        strHash = (*chain)[nHeight]->GetBlockHash().GetHex();
     }
 
     uint256 hash(uint256S(strHash));
@@ -883,15 +892,18 @@ UniValue getblock(const UniValue& params, bool fHelp, const CPubKey& mypk)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 0 to 2");
     }
 
-    if (mapBlockIndex.count(hash) == 0)
+    CBlockIndex* pblockindex = LookupBlockIndexRPC(hash);
+    if (pblockindex == NULL)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+    {
+        LOCK(cs_main);
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+    }
 
+    // reading and formatting the block, the expensive part, runs without cs_main
+    CBlock block;
     if (!ReadBlockFromDisk(block, pblockindex, 1))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
@@ -1231,8 +1243,6 @@ UniValue gettxout(const UniValue& params, bool fHelp, const CPubKey& mypk)
             + HelpExampleRpc("gettxout", "\"txid\", 1")
         );
 
-    LOCK(cs_main);
-
     UniValue ret(UniValue::VOBJ);
 
     std::string strHash = params[0].get_str();
@@ -1242,23 +1252,31 @@ UniValue gettxout(const UniValue& params, bool fHelp, const CPubKey& mypk)
     if (params.size() > 2)
         fMempool = params[2].get_bool();
 
+    // cs_main covers the coins lookup only, formatting the output does not need it
     CCoins coins;
-    if (fMempool) {
-        LOCK(mempool.cs);
-        CCoinsViewMemPool view(pcoinsTip, mempool);
-        if (!view.GetCoins(hash, coins))
-            return NullUniValue;
-        mempool.pruneSpent(hash, coins); // TODO: this should be done by the CCoinsViewMemPool
-    }
-    else {
-        if (!pcoinsTip->GetCoins(hash, coins))
+    CBlockIndex *pindex;
+    uint64_t interest;
+    {
+        LOCK(cs_main);
+        if (fMempool) {
+            LOCK(mempool.cs);
+            CCoinsViewMemPool view(pcoinsTip, mempool);
+            if (!view.GetCoins(hash, coins))
+                return NullUniValue;
+            mempool.pruneSpent(hash, coins); // TODO: this should be done by the CCoinsViewMemPool
+        }
+        else {
+            if (!pcoinsTip->GetCoins(hash, coins))
+                return NullUniValue;
+        }
+        if (n<0 || (unsigned int)n >= coins.vout.size() || coins.vout[n].IsNull())
             return NullUniValue;
-    }
-    if (n<0 || (unsigned int)n >= coins.vout.size() || coins.vout[n].IsNull())
-        return NullUniValue;
 
-    BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
-    CBlockIndex *pindex = it->second;
+        BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
+        pindex = it->second;
+        int32_t txheight; uint32_t locktime;
+        interest = komodo_accrued_interest(&txheight, &locktime, hash, n, coins.nHeight, coins.vout[n].nValue, (int32_t)pindex->GetHeight());
+    }
     ret.push_back(Pair("bestblock", pindex->GetBlockHash().GetHex()));
     if ((unsigned int)coins.nHeight == MEMPOOL_HEIGHT) {
         ret.push_back(Pair("confirmations", 0));
@@ -1269,8 +1287,7 @@ UniValue gettxout(const UniValue& params, bool fHelp, const CPubKey& mypk)
         ret.push_back(Pair("rawconfirmations", pindex->GetHeight() - coins.nHeight + 1));
     }
     ret.push_back(Pair("value", ValueFromAmount(coins.vout[n].nValue)));
-    uint64_t interest; int32_t txheight; uint32_t locktime;
-    if ((interest = komodo_accrued_interest(&txheight, &locktime, hash, n, coins.nHeight, coins.vout[n].nValue, (int32_t)pindex->GetHeight())) != 0)
+    if (interest != 0)
         ret.push_back(Pair("interest", ValueFromAmount(interest)));
     UniValue o(UniValue::VOBJ);
     ScriptPubKeyToJSON(coins.vout[n].scriptPubKey, o, true);
@@ -1812,18 +1829,18 @@ UniValue reconsiderblock(const UniValue& params, bool fHelp, const CPubKey& mypk
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
-    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true },
-{ "blockchain",         "getbestblockhash",       &getbestblockhash,       true },
-{ "blockchain",         "getblockcount",          &getblockcount,          true },
-{ "blockchain",         "getblock",               &getblock,               true },
-{ "blockchain",         "getblockhash",           &getblockhash,           true },
-{ "blockchain",         "getblockheader",         &getblockheader,         true },
-{ "blockchain",         "getchaintips",           &getchaintips,           true },
+    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true,  true  },
+{ "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  true,  true  },
+{ "blockchain",         "getblockcount",          &getblockcount,          true,  true,  true  },
+{ "blockchain",         "getblock",               &getblock,               true,  true,  true  },
+{ "blockchain",         "getblockhash",           &getblockhash,           true,  true,  true  },
+{ "blockchain",         "getblockheader",         &getblockheader,         true,  true,  true  },
+{ "blockchain",         "getchaintips",           &getchaintips,           true,  true  },
 { "blockchain",         "getchaintxstats",        &getchaintxstats,        true },
-{ "blockchain",         "getdifficulty",          &getdifficulty,          true },
-{ "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true },
-{ "blockchain",         "getrawmempool",          &getrawmempool,          true },
-{ "blockchain",         "gettxout",               &gettxout,               true },
+{ "blockchain",         "getdifficulty",          &getdifficulty,          true,  true  },
+{ "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  true  },
+{ "blockchain",         "getrawmempool",          &getrawmempool,          true,  true  },
+{ "blockchain",         "gettxout",               &gettxout,               true,  true  },
 { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true },
 { "blockchain",         "verifychain",            &verifychain,            true },
 
@@ -0,0 +1,91 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "rpc/jsonwriter.h"
+
+CJSONStreamWriter::CJSONStreamWriter(const ChunkSink& sinkIn, size_t nChunkSizeIn) :
+    sink(sinkIn), nChunkSize(nChunkSizeIn), nWritten(0)
+{
+    buf.reserve(nChunkSize + 1024);
+}
+
+void CJSONStreamWriter::Write(const UniValue& value)
+{
+    switch (value.getType()) {
+    case UniValue::VARR: {
+        const std::vector<UniValue>& values = value.getValues();
+        buf += '[';
+        for (size_t i = 0; i < values.size(); i++) {
+            if (i != 0)
+                buf += ',';
+            Write(values[i]);
+        }
+        buf += ']';
+        break;
+    }
+    case UniValue::VOBJ: {
+        const std::vector<std::string>& keys = value.getKeys();
+        const std::vector<UniValue>& values = value.getValues();
+        buf += '{';
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (i != 0)
+                buf += ',';
+            WriteKey(keys[i]);
+            Write(values[i]);
+        }
+        buf += '}';
+        break;
+    }
+    default:
+        // scalars: let UniValue do the number formatting and string escaping
+        buf += value.write();
+        break;
+    }
+    MaybeFlush();
+}
+
+void CJSONStreamWriter::WriteRaw(const std::string& str)
+{
+    buf += str;
+    MaybeFlush();
+}
+
+void CJSONStreamWriter::WriteKey(const std::string& key)
+{
+    buf += UniValue(key).write();
+    buf += ':';
+}
+
+void CJSONStreamWriter::MaybeFlush()
+{
+    if (buf.size() >= nChunkSize)
+        Flush();
+}
+
+void CJSONStreamWriter::Flush()
+{
+    if (buf.empty())
+        return;
+    sink(buf);
+    nWritten += buf.size();
+    buf.clear();
+}
+
+std::string CJSONStreamWriter::TakeBuffer()
+{
+    std::string ret;
+    ret.swap(buf);
+    return ret;
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_RPC_JSONWRITER_H
+#define KOMODO_RPC_JSONWRITER_H
+
+#include <functional>
+#include <string>
+
+#include <univalue.h>
+
+/** Size of the pieces a streamed JSON-RPC reply is sent in. */
+static const size_t JSON_STREAM_CHUNK_SIZE = 256 * 1024;
+
+/**
+ * Incremental JSON serializer producing the same compact text as
+ * UniValue::write(), but handing it to a sink in pieces of about nChunkSize
+ * bytes instead of building one string for the whole document.
+ *
+ * The sink is only called once a piece is full; whatever is left when the
+ * caller is done is returned by TakeBuffer(), so a small document never
+ * reaches the sink at all.
+ */
+class CJSONStreamWriter
+{
+public:
+    typedef std::function<void(const std::string&)> ChunkSink;
+
+    CJSONStreamWriter(const ChunkSink& sinkIn, size_t nChunkSizeIn = JSON_STREAM_CHUNK_SIZE);
+
+    void Write(const UniValue& value);
+    /** Append already formatted JSON text. */
+    void WriteRaw(const std::string& str);
+    /** Key of the next object member, including the separating colon. */
+    void WriteKey(const std::string& key);
+
+    /** Hand the buffered text to the sink now, if there is any. */
+    void Flush();
+    /** Return and clear the buffered text without calling the sink. */
+    std::string TakeBuffer();
+
+    size_t GetBytesWritten() const { return nWritten + buf.size(); }
+
+private:
+    void MaybeFlush();
+
+    ChunkSink sink;
+    size_t nChunkSize;
+    size_t nWritten;
+    std::string buf;
+};
+
+#endif // KOMODO_RPC_JSONWRITER_H
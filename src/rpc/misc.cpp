@@ -18,12 +18,17 @@
  *                                                                            *
  ******************************************************************************/
 
+#include "chainsnapshot.h"
 #include "clientversion.h"
 #include "init.h"
 #include "key_io.h"
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
+#include "notificationqueue.h"
+#include "nspvcache.h"
+#include "nspvscheduler.h"
+#include "perfstats.h"
 #include "rpc/server.h"
 #include "txmempool.h"
 #include "util.h"
@@ -1074,9 +1079,9 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp, const CPubKey& mypk
         UniValue result(UniValue::VOBJ);
         result.push_back(Pair("utxos", utxos));
 
-        LOCK(cs_main);
-        result.push_back(Pair("hash", chainActive.LastTip()->GetBlockHash().GetHex()));
-        result.push_back(Pair("height", (int)chainActive.Height()));
+        CChainSnapshotRef chain = GetChainSnapshot();
+        result.push_back(Pair("hash", chain->hashTip.GetHex()));
+        result.push_back(Pair("height", chain->nHeight));
         return result;
     } else {
         return utxos;
@@ -1650,14 +1655,243 @@ UniValue decodeccopret(const UniValue& params, bool fHelp, const CPubKey& mypk)
     return result;
 }
 
+static void HistogramToJSON(const CLatencyHistogram& histogram, const std::string& strPrefix, UniValue& obj)
+{
+    obj.push_back(Pair(strPrefix + "total_us", (uint64_t)histogram.nTotalMicros));
+    obj.push_back(Pair(strPrefix + "p50_us", (uint64_t)histogram.Percentile(50)));
+    obj.push_back(Pair(strPrefix + "p99_us", (uint64_t)histogram.Percentile(99)));
+    obj.push_back(Pair(strPrefix + "max_us", (uint64_t)histogram.nMaxMicros));
+}
+
+UniValue getperfstats(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getperfstats ( reset )\n"
+            "\nReturns per-command RPC latency, in builds with lock profiling per-lock wait and hold times,\n"
+            "the memory used by the block index and the state of the ZMQ and AMQP notification queues.\n"
+            "Percentiles are upper bounds of power of two microsecond buckets.\n"
+            "\nArguments:\n"
+            "1. reset          (boolean, optional, default=false) Clear all statistics after reading them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"rpc\": {\n"
+            "    \"method\": {\n"
+            "      \"count\": n,         (numeric) Number of calls\n"
+            "      \"errors\": n,        (numeric) Calls that returned an error\n"
+            "      \"total_us\": n,      (numeric) Total time spent executing the command\n"
+            "      \"p50_us\": n,        (numeric) Median latency\n"
+            "      \"p99_us\": n,        (numeric) 99th percentile latency\n"
+            "      \"max_us\": n,        (numeric) Largest latency seen\n"
+            "      \"bytes_out\": n      (numeric) Bytes of JSON sent in replies\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"lockprofiling\": true|false, (boolean) Whether this build records lock statistics (-DDEBUG_LOCKPROFILE)\n"
+            "  \"locks\": {\n"
+            "    \"name\": {\n"
+            "      \"count\": n,         (numeric) Number of acquisitions\n"
+            "      \"contended\": n,     (numeric) Acquisitions that had to wait\n"
+            "      \"wait_total_us\": n, \"wait_p50_us\": n, \"wait_p99_us\": n, \"wait_max_us\": n,\n"
+            "      \"hold_total_us\": n, \"hold_p50_us\": n, \"hold_p99_us\": n, \"hold_max_us\": n\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"blockindex\": {\n"
+            "    \"entries\": n,          (numeric) Block index entries\n"
+            "    \"solutions\": n,        (numeric) Entries whose Equihash solution is still in memory\n"
+            "    \"index_bytes\": n,      (numeric) Memory used by the entries\n"
+            "    \"map_bytes\": n,        (numeric) Memory used by the hash table over them\n"
+            "    \"solution_bytes\": n,   (numeric) Memory used by in-memory solutions\n"
+            "    \"total_bytes\": n,      (numeric) Sum of the above\n"
+            "    \"legacy_bytes\": n      (numeric) Estimate for the same entries allocated one by one with their solutions\n"
+            "  },\n"
+            "  \"notifications\": {\n"
+            "    \"name\": {            (string) zmq or amqp\n"
+            "      \"policy\": \"xxx\",    (string) block or drop, see -notifyqueuepolicy\n"
+            "      \"capacity\": n,      (numeric) Queue size\n"
+            "      \"depth\": n,         (numeric) Notifications waiting for the notifiers\n"
+            "      \"max_depth\": n,     (numeric) Largest depth seen\n"
+            "      \"queued\": n,        (numeric) Notifications queued\n"
+            "      \"processed\": n,     (numeric) Notifications handed to the notifiers\n"
+            "      \"dropped\": n,       (numeric) Notifications dropped because the queue was full\n"
+            "      \"blocked\": n,       (numeric) Times validation waited for room in the queue\n"
+            "      \"blocked_us\": n,    (numeric) Total time validation waited\n"
+            "      \"total_us\": n, \"p50_us\": n, \"p99_us\": n, \"max_us\": n  Time from queueing to published\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getperfstats", "")
+            + HelpExampleCli("getperfstats", "true")
+            + HelpExampleRpc("getperfstats", "")
+        );
+
+    bool fReset = params.size() > 0 && params[0].get_bool();
+
+    UniValue rpc(UniValue::VOBJ);
+    for (const auto& entry : GetRPCPerfStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("count", (uint64_t)entry.second.latency.nCount));
+        obj.push_back(Pair("errors", (uint64_t)entry.second.nErrors));
+        HistogramToJSON(entry.second.latency, "", obj);
+        obj.push_back(Pair("bytes_out", (uint64_t)entry.second.nBytesOut));
+        rpc.push_back(Pair(entry.first, obj));
+    }
+
+    UniValue locks(UniValue::VOBJ);
+    for (const auto& entry : GetLockPerfStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("count", (uint64_t)entry.second.wait.nCount));
+        obj.push_back(Pair("contended", (uint64_t)entry.second.nContended));
+        HistogramToJSON(entry.second.wait, "wait_", obj);
+        HistogramToJSON(entry.second.hold, "hold_", obj);
+        locks.push_back(Pair(entry.first, obj));
+    }
+
+    if (fReset)
+        ResetPerfStats();
+
+    CBlockIndexMemoryStats indexStats;
+    {
+        LOCK(cs_main);
+        indexStats = GetBlockIndexMemoryStats();
+    }
+    UniValue blockindex(UniValue::VOBJ);
+    blockindex.push_back(Pair("entries", indexStats.nEntries));
+    blockindex.push_back(Pair("solutions", indexStats.nSolutions));
+    blockindex.push_back(Pair("index_bytes", indexStats.nArenaBytes));
+    blockindex.push_back(Pair("map_bytes", indexStats.nMapBytes));
+    blockindex.push_back(Pair("solution_bytes", indexStats.nSolutionBytes));
+    blockindex.push_back(Pair("total_bytes", indexStats.nArenaBytes + indexStats.nMapBytes + indexStats.nSolutionBytes));
+    blockindex.push_back(Pair("legacy_bytes", indexStats.nLegacyBytes));
+
+    UniValue notifications(UniValue::VOBJ);
+    for (const CNotificationQueueStats& queueStats : GetNotificationQueueStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("policy", queueStats.strPolicy));
+        obj.push_back(Pair("capacity", (uint64_t)queueStats.nCapacity));
+        obj.push_back(Pair("depth", (uint64_t)queueStats.nDepth));
+        obj.push_back(Pair("max_depth", (uint64_t)queueStats.nMaxDepth));
+        obj.push_back(Pair("queued", queueStats.nQueued));
+        obj.push_back(Pair("processed", queueStats.nProcessed));
+        obj.push_back(Pair("dropped", queueStats.nDropped));
+        obj.push_back(Pair("blocked", queueStats.nBlocked));
+        obj.push_back(Pair("blocked_us", queueStats.nBlockedMicros));
+        HistogramToJSON(queueStats.latency, "", obj);
+        notifications.push_back(Pair(queueStats.strName, obj));
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("rpc", rpc));
+    result.push_back(Pair("lockprofiling", LockProfilingEnabled()));
+    result.push_back(Pair("locks", locks));
+    result.push_back(Pair("blockindex", blockindex));
+    result.push_back(Pair("notifications", notifications));
+    return result;
+}
+
+UniValue getnspvstats(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getnspvstats ( reset )\n"
+            "\nReturns the latency of the nSPV requests served to light clients, per request type, the state\n"
+            "of the queue of requests waiting for the nSPV threads (see -nspvthreads) and of the cache of\n"
+            "responses kept until the next block (see -nspvcachesize).\n"
+            "Percentiles are upper bounds of power of two microsecond buckets.\n"
+            "\nArguments:\n"
+            "1. reset          (boolean, optional, default=false) Clear the request statistics after reading them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"requests\": {\n"
+            "    \"type\": {            (string) info, ntzs, ntzsproof, txproof, utxos, ...\n"
+            "      \"count\": n,         (numeric) Requests received\n"
+            "      \"cache_hits\": n,    (numeric) Requests answered from the response cache\n"
+            "      \"total_us\": n, \"p50_us\": n, \"p99_us\": n, \"max_us\": n  Time to queue the response, all requests\n"
+            "      \"hit_total_us\": n, \"hit_p50_us\": n, \"hit_p99_us\": n, \"hit_max_us\": n  Same for cache hits\n"
+            "      \"wait_total_us\": n, \"wait_p50_us\": n, \"wait_p99_us\": n, \"wait_max_us\": n  Time queued for a thread\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"scheduler\": {         (json object, only when requests are served by nSPV threads)\n"
+            "    \"threads\": n,        (numeric) Threads serving requests\n"
+            "    \"depth\": n,          (numeric) Requests waiting for a thread\n"
+            "    \"max_depth\": n,      (numeric) Largest depth seen\n"
+            "    \"peers\": n,          (numeric) Peers with queued requests or a spent budget\n"
+            "    \"queued\": n,         (numeric) Requests queued\n"
+            "    \"processed\": n,      (numeric) Requests served\n"
+            "    \"dropped_queue\": n,  (numeric) Requests dropped because the peer had too many queued\n"
+            "    \"dropped_budget\": n  (numeric) Requests dropped because the peer was over -nspvpeerbudget\n"
+            "  },\n"
+            "  \"cache\": {             (json object, only when the cache is enabled)\n"
+            "    \"hits\": n,           (numeric) Responses served from the cache\n"
+            "    \"misses\": n,         (numeric) Cacheable requests that had to be computed\n"
+            "    \"evictions\": n,      (numeric) Entries dropped to stay within -nspvcachesize\n"
+            "    \"invalidations\": n,  (numeric) Tip changes that cleared cached responses\n"
+            "    \"entries\": n,        (numeric) Responses currently cached\n"
+            "    \"bytes\": n,          (numeric) Memory used by the cached responses\n"
+            "    \"max_bytes\": n       (numeric) Memory bound\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getnspvstats", "")
+            + HelpExampleCli("getnspvstats", "true")
+            + HelpExampleRpc("getnspvstats", "")
+        );
+
+    bool fReset = params.size() > 0 && params[0].get_bool();
+
+    UniValue requests(UniValue::VOBJ);
+    for (const auto& entry : GetNSPVRequestStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("count", (uint64_t)entry.second.latency.nCount));
+        obj.push_back(Pair("cache_hits", entry.second.nHits));
+        HistogramToJSON(entry.second.latency, "", obj);
+        HistogramToJSON(entry.second.hitLatency, "hit_", obj);
+        HistogramToJSON(entry.second.wait, "wait_", obj);
+        requests.push_back(Pair(NSPVRequestName(entry.first), obj));
+    }
+    if (fReset)
+        ResetNSPVRequestStats();
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("requests", requests));
+    if (pnspvscheduler != NULL) {
+        CNSPVSchedulerStats schedulerStats = pnspvscheduler->GetStats();
+        UniValue scheduler(UniValue::VOBJ);
+        scheduler.push_back(Pair("threads", schedulerStats.nThreads));
+        scheduler.push_back(Pair("depth", schedulerStats.nDepth));
+        scheduler.push_back(Pair("max_depth", schedulerStats.nMaxDepth));
+        scheduler.push_back(Pair("peers", schedulerStats.nPeers));
+        scheduler.push_back(Pair("queued", schedulerStats.nQueued));
+        scheduler.push_back(Pair("processed", schedulerStats.nProcessed));
+        scheduler.push_back(Pair("dropped_queue", schedulerStats.nDroppedQueueFull));
+        scheduler.push_back(Pair("dropped_budget", schedulerStats.nDroppedBudget));
+        result.push_back(Pair("scheduler", scheduler));
+    }
+    if (pnspvcache != NULL) {
+        CNSPVCacheStats cacheStats = pnspvcache->GetStats();
+        UniValue cache(UniValue::VOBJ);
+        cache.push_back(Pair("hits", cacheStats.nHits));
+        cache.push_back(Pair("misses", cacheStats.nMisses));
+        cache.push_back(Pair("evictions", cacheStats.nEvictions));
+        cache.push_back(Pair("invalidations", cacheStats.nInvalidations));
+        cache.push_back(Pair("entries", cacheStats.nEntries));
+        cache.push_back(Pair("bytes", cacheStats.nBytes));
+        cache.push_back(Pair("max_bytes", cacheStats.nMaxBytes));
+        result.push_back(Pair("cache", cache));
+    }
+    return result;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
-    { "control",            "getinfo",                &getinfo,                true  }, /* uses wallet if enabled */
-    { "util",               "validateaddress",        &validateaddress,        true  }, /* uses wallet if enabled */
+    { "control",            "getinfo",                &getinfo,                true,  true  }, /* uses wallet if enabled */
+    { "util",               "validateaddress",        &validateaddress,        true,  true  }, /* uses wallet if enabled */
     { "util",               "z_validateaddress",      &z_validateaddress,      true  }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         true  },
-    { "util",               "verifymessage",          &verifymessage,          true  },
+    { "util",               "verifymessage",          &verifymessage,          true,  true  },
+    { "control",            "getperfstats",           &getperfstats,           true,  true  },
+    { "control",            "getnspvstats",           &getnspvstats,           true,  true  },
 
     /* Not shown in help */
     { "hidden",             "setmocktime",            &setmocktime,            true  },
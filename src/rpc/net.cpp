@@ -23,6 +23,7 @@
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
+#include "netrelaycache.h"
 #include "protocol.h"
 #include "sync.h"
 #include "util.h"
@@ -371,7 +372,22 @@ UniValue getnettotals(const UniValue& params, bool fHelp, const CPubKey& mypk)
             "{\n"
             "  \"totalbytesrecv\": n,   (numeric) Total bytes received\n"
             "  \"totalbytessent\": n,   (numeric) Total bytes sent\n"
-            "  \"timemillis\": t        (numeric) Total cpu time\n"
+            "  \"timemillis\": t,       (numeric) Total cpu time\n"
+            "  \"messagebuffers\": {    (json object) network message buffer pool\n"
+            "    \"allocated\": n,      (numeric) Buffers allocated from the heap\n"
+            "    \"reused\": n,         (numeric) Buffers served from the pool\n"
+            "    \"discarded\": n,      (numeric) Buffers freed because the pool was full\n"
+            "    \"pooledbytes\": n,    (numeric) Capacity currently held by the pool\n"
+            "    \"bytescopied\": n,    (numeric) Bytes copied into message buffers\n"
+            "    \"sharedsends\": n     (numeric) Messages queued by reference to a shared buffer\n"
+            "  },\n"
+            "  \"relaycache\": {        (json object) serialize-once cache for relayed blocks, txs and DEX packets\n"
+            "    \"hits\": n,           (numeric) Messages served from the cache\n"
+            "    \"misses\": n,         (numeric) Lookups that had to serialize the payload\n"
+            "    \"evictions\": n,      (numeric) Entries dropped to stay within -relaycachesize\n"
+            "    \"entries\": n,        (numeric) Messages currently cached\n"
+            "    \"bytes\": n           (numeric) Size of the cached messages\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getnettotals", "")
@@ -382,6 +398,25 @@ UniValue getnettotals(const UniValue& params, bool fHelp, const CPubKey& mypk)
     obj.push_back(Pair("totalbytesrecv", CNode::GetTotalBytesRecv()));
     obj.push_back(Pair("totalbytessent", CNode::GetTotalBytesSent()));
     obj.push_back(Pair("timemillis", GetTimeMillis()));
+
+    CNetBufferPoolStats poolStats = NetBufferPool().GetStats();
+    UniValue bufObj(UniValue::VOBJ);
+    bufObj.push_back(Pair("allocated", poolStats.nAllocated));
+    bufObj.push_back(Pair("reused", poolStats.nReused));
+    bufObj.push_back(Pair("discarded", poolStats.nDiscarded));
+    bufObj.push_back(Pair("pooledbytes", poolStats.nPooledBytes));
+    bufObj.push_back(Pair("bytescopied", poolStats.nBytesCopied));
+    bufObj.push_back(Pair("sharedsends", poolStats.nSharedSends));
+    obj.push_back(Pair("messagebuffers", bufObj));
+
+    CRelayCacheStats cacheStats = RelayWireCache().GetStats();
+    UniValue cacheObj(UniValue::VOBJ);
+    cacheObj.push_back(Pair("hits", cacheStats.nHits));
+    cacheObj.push_back(Pair("misses", cacheStats.nMisses));
+    cacheObj.push_back(Pair("evictions", cacheStats.nEvictions));
+    cacheObj.push_back(Pair("entries", cacheStats.nEntries));
+    cacheObj.push_back(Pair("bytes", cacheStats.nBytes));
+    obj.push_back(Pair("relaycache", cacheObj));
     return obj;
 }
 
@@ -609,17 +644,17 @@ UniValue clearbanned(const UniValue& params, bool fHelp, const CPubKey& mypk)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
-    { "network",            "getconnectioncount",     &getconnectioncount,     true  },
+    { "network",            "getconnectioncount",     &getconnectioncount,     true,  true  },
     { "network",            "getdeprecationinfo",     &getdeprecationinfo,     true  },
     { "network",            "ping",                   &ping,                   true  },
-    { "network",            "getpeerinfo",            &getpeerinfo,            true  },
+    { "network",            "getpeerinfo",            &getpeerinfo,            true,  true  },
     { "network",            "addnode",                &addnode,                true  },
     { "network",            "disconnectnode",         &disconnectnode,         true  },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true  },
-    { "network",            "getnettotals",           &getnettotals,           true  },
-    { "network",            "getnetworkinfo",         &getnetworkinfo,         true  },
+    { "network",            "getnettotals",           &getnettotals,           true,  true  },
+    { "network",            "getnetworkinfo",         &getnetworkinfo,         true,  true  },
     { "network",            "setban",                 &setban,                 true  },
-    { "network",            "listbanned",             &listbanned,             true  },
+    { "network",            "listbanned",             &listbanned,             true,  true  },
     { "network",            "clearbanned",            &clearbanned,            true  },
 };
 
@@ -371,3 +371,16 @@ UniValue pricesrefillfund(const UniValue& params, bool fHelp, const CPubKey& myp
     return PricesRefillFund(amount);
 }
 
+// pricesliquidations rpc implementation
+UniValue pricesliquidations(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error("pricesliquidations\n"
+            "lists the open bets by the synthetic price they get rekt at, for each expression\n");
+    LOCK(cs_main);
+
+    if (ASSETCHAINS_CBOPRET == 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "only -ac_cbopret chains have prices");
+
+    return PricesLiquidations();
+}
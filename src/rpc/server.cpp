@@ -21,8 +21,10 @@
 
 #include "rpc/server.h"
 
+#include "chainsnapshot.h"
 #include "init.h"
 #include "key_io.h"
+#include "perfstats.h"
 #include "random.h"
 #include "sync.h"
 #include "ui_interface.h"
@@ -30,7 +32,12 @@
 #include "utilstrencodings.h"
 #include "asyncrpcqueue.h"
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include <univalue.h>
 
@@ -289,8 +296,8 @@ UniValue stop(const UniValue& params, bool fHelp, const CPubKey& mypk)
  * Call Table
  */
 static const CRPCCommand vRPCCommands[] =
-{ //  category              name                      actor (function)         okSafeMode
-  //  --------------------- ------------------------  -----------------------  ----------
+{ //  category              name                      actor (function)         okSafeMode readOnly chainSnapshot
+  //  --------------------- ------------------------  -----------------------  ---------- -------- -------------
     /* Overall control/query calls */
     { "control",            "help",                   &help,                   true  },
     { "control",            "getiguanajson",          &getiguanajson,          true  },
@@ -299,40 +306,40 @@ static const CRPCCommand vRPCCommands[] =
     { "control",            "stop",                   &stop,                   true  },
 
     /* P2P networking */
-    { "network",            "getnetworkinfo",         &getnetworkinfo,         true  },
+    { "network",            "getnetworkinfo",         &getnetworkinfo,         true,  true  },
     { "network",            "getdeprecationinfo",     &getdeprecationinfo,     true  },
     { "network",            "addnode",                &addnode,                true  },
     { "network",            "disconnectnode",         &disconnectnode,         true  },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true  },
-    { "network",            "getconnectioncount",     &getconnectioncount,     true  },
-    { "network",            "getnettotals",           &getnettotals,           true  },
-    { "network",            "getpeerinfo",            &getpeerinfo,            true  },
+    { "network",            "getconnectioncount",     &getconnectioncount,     true,  true  },
+    { "network",            "getnettotals",           &getnettotals,           true,  true  },
+    { "network",            "getpeerinfo",            &getpeerinfo,            true,  true  },
     { "network",            "ping",                   &ping,                   true  },
     { "network",            "setban",                 &setban,                 true  },
-    { "network",            "listbanned",             &listbanned,             true  },
+    { "network",            "listbanned",             &listbanned,             true,  true  },
     { "network",            "clearbanned",            &clearbanned,            true  },
 
     /* Block chain and UTXO */
     { "blockchain",         "coinsupply",             &coinsupply,             true  },
-    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
-    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
-    { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
-    { "blockchain",         "getblockdeltas",         &getblockdeltas,         false },
-    { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
-    { "blockchain",         "getblockhash",           &getblockhash,           true  },
-    { "blockchain",         "getblockheader",         &getblockheader,         true  },
+    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true,  true  },
+    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  true,  true  },
+    { "blockchain",         "getblockcount",          &getblockcount,          true,  true,  true  },
+    { "blockchain",         "getblock",               &getblock,               true,  true,  true  },
+    { "blockchain",         "getblockdeltas",         &getblockdeltas,         false, true  },
+    { "blockchain",         "getblockhashes",         &getblockhashes,         true,  true  },
+    { "blockchain",         "getblockhash",           &getblockhash,           true,  true,  true  },
+    { "blockchain",         "getblockheader",         &getblockheader,         true,  true,  true  },
     { "blockchain",         "getlastsegidstakes",     &getlastsegidstakes,     true  },
-    { "blockchain",         "getchaintips",           &getchaintips,           true  },
-    { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
-    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
-    { "blockchain",         "gettxout",               &gettxout,               true  },
-    { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
-    { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
+    { "blockchain",         "getchaintips",           &getchaintips,           true,  true  },
+    { "blockchain",         "getdifficulty",          &getdifficulty,          true,  true  },
+    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  true  },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true,  true  },
+    { "blockchain",         "gettxout",               &gettxout,               true,  true  },
+    { "blockchain",         "gettxoutproof",          &gettxoutproof,          true,  true  },
+    { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true,  true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
-    { "blockchain",         "getspentinfo",           &getspentinfo,           false },
+    { "blockchain",         "getspentinfo",           &getspentinfo,           false, true  },
     //{ "blockchain",         "paxprice",               &paxprice,               true  },
     //{ "blockchain",         "paxpending",             &paxpending,             true  },
     //{ "blockchain",         "paxprices",              &paxprices,              true  },
@@ -396,9 +403,9 @@ static const CRPCCommand vRPCCommands[] =
 
     /* Raw transactions */
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true  },
-    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
-    { "rawtransactions",    "decodescript",           &decodescript,           true  },
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
+    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true,  true  },
+    { "rawtransactions",    "decodescript",           &decodescript,           true,  true  },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,  true  },
     { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false },
     { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false }, /* uses wallet if enabled */
 #ifdef ENABLE_WALLET
@@ -507,6 +514,7 @@ static const CRPCCommand vRPCCommands[] =
     { "prices",       "pricesaddfunding",         &pricesaddfunding,         true },
     { "prices",       "pricesgetorderbook",         &pricesgetorderbook,         true },
     { "prices",       "pricesrefillfund",         &pricesrefillfund,         true },
+    { "prices",       "pricesliquidations",         &pricesliquidations,         true },
 
     // Pegs
     { "pegs",       "pegsaddress",   &pegsaddress,      true },
@@ -522,6 +530,7 @@ static const CRPCCommand vRPCCommands[] =
     { "payments",       "paymentsfund",      &payments_fund,         true },
     { "payments",       "paymentsmerge",     &payments_merge,        true },
     { "payments",       "paymentsrelease",   &payments_release,      true },
+    { "payments",       "paymentsreleaseasync", &payments_releaseasync, true },
 
     { "CClib",       "cclibaddress",   &cclibaddress,      true },
     { "CClib",       "cclibinfo",   &cclibinfo,      true },
@@ -568,19 +577,19 @@ static const CRPCCommand vRPCCommands[] =
     { "pegs",       "pegsinfo",         &pegsinfo,      true },
     
     /* Address index */
-    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true  },
-    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false },
+    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true,  true  },
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false, true,  true  },
     { "addressindex",       "checknotarization",      &checknotarization,      false },
     { "addressindex",       "getnotarypayinfo",       &getnotarypayinfo,       false },
-    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false },
-    { "addressindex",       "getaddresstxids",        &getaddresstxids,        false },
-    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false },
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false, true  },
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        false, true  },
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false, true  },
     { "addressindex",       "getsnapshot",            &getsnapshot,            false },
 
     /* Utility functions */
     { "util",               "createmultisig",         &createmultisig,         true  },
-    { "util",               "validateaddress",        &validateaddress,        true  }, /* uses wallet if enabled */
-    { "util",               "verifymessage",          &verifymessage,          true  },
+    { "util",               "validateaddress",        &validateaddress,        true,  true  }, /* uses wallet if enabled */
+    { "util",               "verifymessage",          &verifymessage,          true,  true  },
     { "util",               "txnotarizedconfirmed",   &txnotarizedconfirmed,   true  },
     { "util",               "decodeccopret",   &decodeccopret,   true  },
     { "util",               "estimatefee",            &estimatefee,            true  },
@@ -708,12 +717,87 @@ bool CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
     return true;
 }
 
+/**
+ * Fixed set of threads that help the HTTP workers run the read-only entries of
+ * batches. It is shared by all batches, so concurrent batches never add more
+ * than -rpcbatchthreads - 1 threads between them; helpers that find nothing
+ * left to do return at once.
+ */
+class CRPCBatchPool
+{
+public:
+    explicit CRPCBatchPool(size_t nThreadsIn) : fStop(false)
+    {
+        for (size_t i = 0; i < nThreadsIn; i++)
+            vThreads.emplace_back(&CRPCBatchPool::ThreadHelper, this);
+    }
+
+    /** Waits for running tasks, queued ones are dropped. */
+    ~CRPCBatchPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            fStop = true;
+        }
+        cond.notify_all();
+        for (std::thread& thread : vThreads)
+            thread.join();
+    }
+
+    size_t Size() const { return vThreads.size(); }
+
+    void Post(const std::function<void()>& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            if (fStop)
+                return;
+            queue.push_back(task);
+        }
+        cond.notify_one();
+    }
+
+private:
+    void ThreadHelper()
+    {
+        RenameThread("komodo-rpcbatch");
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(cs);
+                while (!fStop && queue.empty())
+                    cond.wait(lock);
+                if (fStop)
+                    return;
+                task = std::move(queue.front());
+                queue.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex cs;
+    std::condition_variable cond;
+    std::deque<std::function<void()> > queue;
+    bool fStop;
+    std::vector<std::thread> vThreads;
+};
+
+static std::mutex cs_rpcBatchPool;
+static std::shared_ptr<CRPCBatchPool> rpcBatchPool;
+
 bool StartRPC()
 {
     LogPrint("rpc", "Starting RPC\n");
     fRPCRunning = true;
     g_rpcSignals.Started();
 
+    int64_t nBatchThreads = GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS);
+    if (nBatchThreads > 1) {
+        std::lock_guard<std::mutex> lock(cs_rpcBatchPool);
+        rpcBatchPool = std::make_shared<CRPCBatchPool>(nBatchThreads - 1);
+    }
+
     // Launch one async rpc worker.  The ability to launch multiple workers is not recommended at present and thus the option is disabled.
     getAsyncRPCQueue()->addWorker();
 /*
@@ -744,6 +828,15 @@ void StopRPC()
     deadlineTimers.clear();
     g_rpcSignals.Stopped();
 
+    // joins the helpers, or leaves that to the last batch still holding the pool;
+    // batches running meanwhile finish their entries on their own threads
+    std::shared_ptr<CRPCBatchPool> pool;
+    {
+        std::lock_guard<std::mutex> lock(cs_rpcBatchPool);
+        pool.swap(rpcBatchPool);
+    }
+    pool.reset();
+
     // Tells async queue to cancel all operations and shutdown.
     LogPrintf("%s: waiting for async rpc workers to stop\n", __func__);
     getAsyncRPCQueue()->closeAndWait();
@@ -829,11 +922,112 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
+static bool IsReadOnlyRequest(const UniValue& req)
+{
+    if (!req.isObject())
+        return false;
+    const UniValue& method = find_value(req.get_obj(), "method");
+    if (!method.isStr())
+        return false;
+    const CRPCCommand *pcmd = tableRPC[method.get_str()];
+    return pcmd != NULL && pcmd->readOnly;
+}
+
+/** Entries vReq[nNext, nEnd) of a batch, claimed one at a time by the caller and helpers. */
+struct CRPCBatchRange
+{
+    const UniValue& vReq;
+    std::vector<UniValue>& vReplies;
+    std::mutex cs;
+    std::condition_variable condIdle;
+    size_t nNext;
+    size_t nEnd;
+    size_t nActive;     // entries claimed and still running
+
+    CRPCBatchRange(const UniValue& vReqIn, std::vector<UniValue>& vRepliesIn, size_t nBegin, size_t nEndIn) :
+        vReq(vReqIn), vReplies(vRepliesIn), nNext(nBegin), nEnd(nEndIn), nActive(0) {}
+};
+
+// vReq and vReplies are only touched for a claimed entry, so a helper starting
+// after the caller returned finds the range empty and never dereferences them.
+static void JSONRPCExecRange(CRPCBatchRange& range)
+{
+    std::unique_lock<std::mutex> lock(range.cs);
+    while (range.nNext < range.nEnd) {
+        size_t i = range.nNext++;
+        range.nActive++;
+        lock.unlock();
+        UniValue reply;
+        try {
+            reply = JSONRPCExecOne(range.vReq[i]);
+        } catch (...) {
+            // must not escape a helper thread; JSONRPCExecOne already handles the expected cases
+            reply = JSONRPCReplyObj(NullUniValue, JSONRPCError(RPC_INTERNAL_ERROR, "Internal error"), NullUniValue);
+        }
+        lock.lock();
+        range.vReplies[i] = reply;
+        range.nActive--;
+    }
+    if (range.nActive == 0)
+        range.condIdle.notify_all();
+}
+
+/** Execute vReq[nBegin, nEnd) on the calling thread and any idle threads of the batch pool. */
+static void JSONRPCExecParallel(const UniValue& vReq, std::vector<UniValue>& vReplies, size_t nBegin, size_t nEnd)
+{
+    std::shared_ptr<CRPCBatchPool> pool;
+    {
+        std::lock_guard<std::mutex> lock(cs_rpcBatchPool);
+        pool = rpcBatchPool;
+    }
+
+    std::shared_ptr<CRPCBatchRange> range = std::make_shared<CRPCBatchRange>(vReq, vReplies, nBegin, nEnd);
+    if (pool) {
+        for (size_t t = 0; t < pool->Size() && t + 1 < nEnd - nBegin; t++)
+            pool->Post([range]() { JSONRPCExecRange(*range); });
+    }
+    JSONRPCExecRange(*range);
+
+    std::unique_lock<std::mutex> lock(range->cs);
+    while (range->nActive > 0)
+        range->condIdle.wait(lock);
+}
+
+void JSONRPCExecBatch(const UniValue& vReq, std::vector<UniValue>& vReplies)
+{
+    bool fParallel;
+    {
+        std::lock_guard<std::mutex> lock(cs_rpcBatchPool);
+        fParallel = rpcBatchPool != nullptr;
+    }
+    vReplies.assign(vReq.size(), NullUniValue);
+
+    // Entries that may change state act as barriers: everything before them has
+    // completed and nothing after them has started when they run, so a batch
+    // still observes its own writes in order.
+    size_t reqIdx = 0;
+    while (reqIdx < vReq.size()) {
+        size_t nEnd = reqIdx;
+        while (nEnd < vReq.size() && IsReadOnlyRequest(vReq[nEnd]))
+            nEnd++;
+        if (nEnd - reqIdx > 1 && fParallel) {
+            JSONRPCExecParallel(vReq, vReplies, reqIdx, nEnd);
+            reqIdx = nEnd;
+        } else {
+            vReplies[reqIdx] = JSONRPCExecOne(vReq[reqIdx]);
+            reqIdx++;
+        }
+    }
+}
+
 std::string JSONRPCExecBatch(const UniValue& vReq)
 {
+    std::vector<UniValue> vReplies;
+    JSONRPCExecBatch(vReq, vReplies);
+
     UniValue ret(UniValue::VARR);
-    for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    for (size_t reqIdx = 0; reqIdx < vReplies.size(); reqIdx++)
+        ret.push_back(vReplies[reqIdx]);
 
     return ret.write() + "\n";
 }
@@ -856,13 +1050,27 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
 
     g_rpcSignals.PreCommand(*pcmd);
 
+    int64_t nStart = PerfTimeMicros();
     try
     {
+        // One tip for the whole call, however many times the handler asks for it
+        std::unique_ptr<CChainSnapshotScope> snapshotScope;
+        if (pcmd->chainSnapshot)
+            snapshotScope.reset(new CChainSnapshotScope());
+
         // Execute
-        return pcmd->actor(params, false, CPubKey());
+        UniValue result = pcmd->actor(params, false, CPubKey());
+        RecordRPCCall(strMethod, PerfTimeMicros() - nStart, false);
+        return result;
+    }
+    catch (const UniValue& objError)
+    {
+        RecordRPCCall(strMethod, PerfTimeMicros() - nStart, true);
+        throw;
     }
     catch (const std::exception& e)
     {
+        RecordRPCCall(strMethod, PerfTimeMicros() - nStart, true);
         throw JSONRPCError(RPC_MISC_ERROR, e.what());
     }
 
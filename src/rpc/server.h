@@ -42,6 +42,9 @@
 class AsyncRPCQueue;
 class CRPCCommand;
 
+/** Threads used to run the read-only entries of a JSON-RPC batch concurrently, see -rpcbatchthreads */
+static const int DEFAULT_RPC_BATCH_THREADS = 4;
+
 namespace RPCServer
 {
     void OnStarted(boost::function<void ()> slot);
@@ -145,6 +148,8 @@ public:
     std::string name;
     rpcfn_type actor;
     bool okSafeMode;
+    bool readOnly;      // does not change node or wallet state, so batch entries may run concurrently
+    bool chainSnapshot; // reads the chain through a CChainSnapshot pinned for the call instead of holding cs_main
 };
 
 /**
@@ -211,6 +216,8 @@ bool StartRPC();
 void InterruptRPC();
 void StopRPC();
 std::string JSONRPCExecBatch(const UniValue& vReq);
+/** Execute a batch, running consecutive read-only entries in parallel. vReplies keeps the request order. */
+void JSONRPCExecBatch(const UniValue& vReq, std::vector<UniValue>& vReplies);
 
 std::string experimentalDisabledHelpMsg(const std::string& rpc, const std::string& enableArg);
 
@@ -276,6 +283,7 @@ UniValue pricesinfo(const UniValue& params, bool fHelp, const CPubKey& mypk);
 UniValue pegsaddress(const UniValue& params, bool fHelp, const CPubKey& mypk);
 UniValue paymentsaddress(const UniValue& params, bool fHelp, const CPubKey& mypk);
 UniValue payments_release(const UniValue& params, bool fHelp, const CPubKey& mypk);
+UniValue payments_releaseasync(const UniValue& params, bool fHelp, const CPubKey& mypk);
 UniValue payments_fund(const UniValue& params, bool fHelp, const CPubKey& mypk);
 UniValue payments_merge(const UniValue& params, bool fHelp, const CPubKey& mypk);
 UniValue payments_txidopret(const UniValue& params, bool fHelp, const CPubKey& mypk);
@@ -540,6 +548,7 @@ UniValue pricesrekt(const UniValue& params, bool fHelp, const CPubKey& mypk);
 UniValue pricesaddfunding(const UniValue& params, bool fHelp, const CPubKey& mypk);
 UniValue pricesgetorderbook(const UniValue& params, bool fHelp, const CPubKey& mypk);
 UniValue pricesrefillfund(const UniValue& params, bool fHelp, const CPubKey& mypk);
+UniValue pricesliquidations(const UniValue& params, bool fHelp, const CPubKey& mypk);
 
 
 
@@ -1426,20 +1426,20 @@ static const CRPCCommand commands[] =
 	{ "tokens",       "assetsindexkey",    &assetsindexkey,      true },
 	{ "tokens v2",       "assetsv2indexkey",    &assetsv2indexkey,      true },
 
-    { "tokens",       "tokeninfo",        &tokeninfo,         true },
-    { "tokens v2",       "tokenv2info",      &tokenv2info,         true },
-    { "tokens",       "tokenlist",        &tokenlist,         true },
-    { "tokens v2",       "tokenv2list",      &tokenv2list,         true },
-    { "tokens",       "tokenorders",      &tokenorders,       true },
-    { "tokens v2",       "tokenv2orders",      &tokenv2orders,       true },
+    { "tokens",       "tokeninfo",        &tokeninfo,         true, true },
+    { "tokens v2",       "tokenv2info",      &tokenv2info,         true, true },
+    { "tokens",       "tokenlist",        &tokenlist,         true, true },
+    { "tokens v2",       "tokenv2list",      &tokenv2list,         true, true },
+    { "tokens",       "tokenorders",      &tokenorders,       true, true },
+    { "tokens v2",       "tokenv2orders",      &tokenv2orders,       true, true },
     { "tokens",       "mytokenorders",    &mytokenorders,     true },
     { "tokens v2",       "mytokenv2orders",    &mytokenv2orders,     true },
     { "tokens",       "tokenindexkey",     &tokenindexkey,      true },
     { "tokens v2",       "tokenv2indexkey",   &tokenv2indexkey,      true },
-    { "tokens",       "tokenbalance",     &tokenbalance,      true },
-    { "tokens v2",       "tokenv2balance",   &tokenv2balance,      true },
-    { "tokens",       "tokenallbalances",     &tokenallbalances,      true },
-    { "tokens v2",       "tokenv2allbalances",   &tokenv2allbalances,      true },
+    { "tokens",       "tokenbalance",     &tokenbalance,      true, true },
+    { "tokens v2",       "tokenv2balance",   &tokenv2balance,      true, true },
+    { "tokens",       "tokenallbalances",     &tokenallbalances,      true, true },
+    { "tokens v2",       "tokenv2allbalances",   &tokenv2allbalances,      true, true },
     { "tokens",       "tokencreate",      &tokencreate,       true },
     { "tokens v2",       "tokenv2create",    &tokenv2create,       true },
     { "tokens",       "tokentransfer",    &tokentransfer,     true },
@@ -1466,8 +1466,8 @@ static const CRPCCommand commands[] =
     { "ccutils",       "addccv2signature", &addccv2signature, true },
     { "tokens",       "tokencreatetokel",      &tokencreatetokel,       true },
     { "tokens v2",       "tokenv2createtokel",    &tokenv2createtokel,       true },
-    { "tokens",       "tokeninfotokel",        &tokeninfotokel,         true },
-    { "tokens v2",       "tokenv2infotokel",      &tokenv2infotokel,         true },
+    { "tokens",       "tokeninfotokel",        &tokeninfotokel,         true, true },
+    { "tokens v2",       "tokenv2infotokel",      &tokenv2infotokel,         true, true },
     { "tokens",       "tokenburn",        &tokenburn,         true },
     { "tokens v2",       "tokenv2burn",      &tokenv2burn,         true },
     { "nspv",       "tokenv2addccinputs",      &tokenv2addccinputs,         true },
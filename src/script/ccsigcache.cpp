@@ -0,0 +1,87 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "script/ccsigcache.h"
+
+#include "crypto/sha256.h"
+#include "random.h"
+#include "util.h"
+
+CCryptoConditionCache::CCryptoConditionCache(size_t nMaxEntriesIn)
+{
+    SetMaxEntries(nMaxEntriesIn);
+}
+
+uint256 CCryptoConditionCache::ComputeKey(const std::vector<unsigned char>& ffillBin, const std::vector<unsigned char>& condBin, const uint256& sighash)
+{
+    // lengths are included so moving bytes between the two blobs changes the key
+    uint64_t nFfillLen = ffillBin.size(), nCondLen = condBin.size();
+    uint256 key;
+    CSHA256()
+        .Write((const unsigned char*)&nFfillLen, sizeof(nFfillLen))
+        .Write(ffillBin.data(), ffillBin.size())
+        .Write((const unsigned char*)&nCondLen, sizeof(nCondLen))
+        .Write(condBin.data(), condBin.size())
+        .Write(sighash.begin(), sighash.size())
+        .Finalize(key.begin());
+    return key;
+}
+
+bool CCryptoConditionCache::Get(const uint256& key)
+{
+    Stripe& stripe = GetStripe(key);
+    boost::shared_lock<boost::shared_mutex> lock(stripe.cs);
+    return stripe.setValid.count(key) != 0;
+}
+
+void CCryptoConditionCache::Set(const uint256& key)
+{
+    if (nMaxPerStripe == 0)
+        return;
+
+    Stripe& stripe = GetStripe(key);
+    boost::unique_lock<boost::shared_mutex> lock(stripe.cs);
+    while (stripe.setValid.size() >= nMaxPerStripe)
+    {
+        // Evict a random entry, as the signature cache does, so a set of
+        // pre-generated conditions cannot be used to keep flushing it
+        std::set<uint256>::iterator it = stripe.setValid.lower_bound(GetRandHash());
+        if (it == stripe.setValid.end())
+            it = stripe.setValid.begin();
+        stripe.setValid.erase(it);
+    }
+    stripe.setValid.insert(key);
+}
+
+void CCryptoConditionCache::SetMaxEntries(size_t nMaxEntriesIn)
+{
+    nMaxPerStripe = (nMaxEntriesIn + STRIPES - 1) / STRIPES;
+}
+
+size_t CCryptoConditionCache::Size()
+{
+    size_t nSize = 0;
+    for (unsigned int i = 0; i < STRIPES; i++) {
+        boost::shared_lock<boost::shared_mutex> lock(vStripes[i].cs);
+        nSize += vStripes[i].setValid.size();
+    }
+    return nSize;
+}
+
+CCryptoConditionCache& CryptoConditionCache()
+{
+    static CCryptoConditionCache* cache = new CCryptoConditionCache(GetArg("-maxccsigcachesize", DEFAULT_MAX_CC_SIG_CACHE_SIZE));
+    return *cache;
+}
@@ -0,0 +1,72 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_SCRIPT_CCSIGCACHE_H
+#define KOMODO_SCRIPT_CCSIGCACHE_H
+
+#include "uint256.h"
+
+#include <boost/thread/shared_mutex.hpp>
+
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+/** Default number of entries kept by the crypto-condition cache, see -maxccsigcachesize. */
+static const unsigned int DEFAULT_MAX_CC_SIG_CACHE_SIZE = 50000;
+
+/**
+ * Cache of crypto-conditions whose fingerprint and secp256k1 / ed25519 /
+ * threshold signatures were already verified, so a transaction checked at
+ * mempool acceptance does not pay for it again in ConnectBlock. Only that
+ * part is cached: eval nodes depend on chain state and always run.
+ *
+ * Entries are spread over independently locked stripes so script check
+ * threads rarely wait on each other. Like the signature cache, each stripe is
+ * bounded and evicts a random entry when full.
+ */
+class CCryptoConditionCache
+{
+public:
+    static const unsigned int STRIPES = 16;
+
+    explicit CCryptoConditionCache(size_t nMaxEntriesIn = DEFAULT_MAX_CC_SIG_CACHE_SIZE);
+
+    /** Key over everything the cached checks depend on: the signed condition tree, its expected condition and the message. */
+    static uint256 ComputeKey(const std::vector<unsigned char>& ffillBin, const std::vector<unsigned char>& condBin, const uint256& sighash);
+
+    bool Get(const uint256& key);
+    void Set(const uint256& key);
+
+    void SetMaxEntries(size_t nMaxEntriesIn);
+    size_t Size();
+
+private:
+    struct Stripe
+    {
+        boost::shared_mutex cs;
+        std::set<uint256> setValid;
+    };
+
+    Stripe& GetStripe(const uint256& key) { return vStripes[*key.begin() % STRIPES]; }
+
+    Stripe vStripes[STRIPES];
+    size_t nMaxPerStripe;
+};
+
+/** Process-wide cache used by ServerTransactionSignatureChecker. */
+CCryptoConditionCache& CryptoConditionCache();
+
+#endif // KOMODO_SCRIPT_CCSIGCACHE_H
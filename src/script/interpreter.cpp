@@ -1391,14 +1391,26 @@ int TransactionSignatureChecker::CheckCryptoCondition(
     };
 
     //fprintf(stderr,"%s non-checker path\n", __func__);
-    int out = cc_verifyMaybeMixed(
-            cond, sighash, condBin.data(), condBin.size(), eval, (void*)this);
+    int out = VerifyCryptoCondition(cond, condBin, ffillBin, sighash) &&
+              cc_verifyEval(cond, eval, (void*)this);
     //fprintf(stderr,"%s out.%d from cc_verify\n", __func__, (int32_t)out);
     cc_free(cond);
     return out;
 }
 
 
+bool TransactionSignatureChecker::VerifyCryptoCondition(
+        const CC *cond,
+        const std::vector<unsigned char>& condBin,
+        const std::vector<unsigned char>& ffillBin,
+        const uint256& sighash) const
+{
+    // evals are left to the caller, which runs them whether or not this result was cached
+    VerifyEval skipEval = [] (CC *cond, void *checker) { return 1; };
+    return cc_verifyMaybeMixed(cond, sighash, condBin.data(), condBin.size(), skipEval, NULL) != 0;
+}
+
+
 int TransactionSignatureChecker::CheckEvalCondition(const CC *cond) const
 {
     //fprintf(stderr, "Cannot check crypto-condition Eval outside of server, returning true in pre-checks\n");
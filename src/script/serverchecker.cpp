@@ -20,6 +20,7 @@
 
 #include "serverchecker.h"
 #include "script/cc.h"
+#include "script/ccsigcache.h"
 #include "cc/eval.h"
 
 #include "pubkey.h"
@@ -107,6 +108,22 @@ bool ServerTransactionSignatureChecker::VerifySignature(const std::vector<unsign
     return true;
 }
 
+bool ServerTransactionSignatureChecker::VerifyCryptoCondition(const CC *cond, const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin, const uint256& sighash) const
+{
+    CCryptoConditionCache& ccCache = CryptoConditionCache();
+    uint256 key = CCryptoConditionCache::ComputeKey(ffillBin, condBin, sighash);
+
+    if (ccCache.Get(key))
+        return true;
+
+    if (!TransactionSignatureChecker::VerifyCryptoCondition(cond, condBin, ffillBin, sighash))
+        return false;
+
+    if (store)
+        ccCache.Set(key);
+    return true;
+}
+
 /*
  * The reason that these functions are here is that the what used to be the
  * CachingTransactionSignatureChecker, now the ServerTransactionSignatureChecker,
@@ -41,6 +41,7 @@ public:
     ServerTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nIn, const CAmount& amount, bool storeIn) : TransactionSignatureChecker(txToIn, nIn, amount), store(storeIn), nTime(0), nHeight(0) {}
 
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
+    bool VerifyCryptoCondition(const CC *cond, const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin, const uint256& sighash) const;
     int CheckEvalCondition(const CC *cond) const;
     int CheckCryptoConditionSpk(const std::vector<unsigned char> &condBin, ScriptError *serror) const;
 };
@@ -0,0 +1,209 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "script/sigbatch.h"
+
+#include "cryptoconditions/include/cryptoconditions.h"
+
+#include <secp256k1.h>
+#include <secp256k1_schnorrsig.h>
+
+#include <algorithm>
+#include <map>
+
+namespace {
+
+const secp256k1_context* VerifyContext()
+{
+    // Separate from the ECCVerifyHandle context so a batch can be checked from any thread at any time, never destroyed
+    static secp256k1_context* ctx = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+    return ctx;
+}
+
+/** Parses each distinct public key of a batch once. */
+class CParsedPubKeys
+{
+public:
+    const secp256k1_pubkey* Get(const secp256k1_context* ctx, const std::vector<unsigned char>& vchPubKey)
+    {
+        std::map<std::vector<unsigned char>, std::pair<bool, secp256k1_pubkey> >::iterator it = mapParsed.find(vchPubKey);
+        if (it == mapParsed.end()) {
+            std::pair<bool, secp256k1_pubkey> parsed;
+            parsed.first = !vchPubKey.empty() &&
+                secp256k1_ec_pubkey_parse(ctx, &parsed.second, vchPubKey.data(), vchPubKey.size());
+            it = mapParsed.insert(std::make_pair(vchPubKey, parsed)).first;
+        }
+        return it->second.first ? &it->second.second : NULL;
+    }
+
+private:
+    std::map<std::vector<unsigned char>, std::pair<bool, secp256k1_pubkey> > mapParsed;
+};
+
+bool VerifyECDSA(const secp256k1_context* ctx, CSignatureBatch::EntryType nType, const std::vector<unsigned char>& vchSig,
+                 const uint256& msg, const secp256k1_pubkey& pubkey)
+{
+    secp256k1_ecdsa_signature sig;
+    if (nType == CSignatureBatch::SIG_ECDSA_DER) {
+        if (vchSig.empty() || !secp256k1_ecdsa_signature_parse_der(ctx, &sig, vchSig.data(), vchSig.size()))
+            return false;
+        secp256k1_ecdsa_signature_normalize(ctx, &sig, &sig);
+    } else {
+        // crypto-conditions only accept lower S signatures, no normalization
+        if (!secp256k1_ecdsa_signature_parse_compact(ctx, &sig, vchSig.data()))
+            return false;
+    }
+    return secp256k1_ecdsa_verify(ctx, &sig, msg.begin(), &pubkey);
+}
+
+bool VerifySchnorr(const secp256k1_context* ctx, const std::vector<unsigned char>& vchSig,
+                   const uint256& msg, const secp256k1_pubkey& pubkey)
+{
+    secp256k1_schnorrsig sig;
+    return secp256k1_schnorrsig_parse(ctx, &sig, vchSig.data()) &&
+        secp256k1_schnorrsig_verify(ctx, &sig, msg.begin(), &pubkey);
+}
+
+void CollectCryptoCondition(const uint8_t* publicKey, const uint8_t* signature, const uint8_t* msg32, void* context)
+{
+    static_cast<CSignatureBatch*>(context)->AddECDSACompact(publicKey, signature, msg32);
+}
+
+}
+
+void CSignatureBatch::Add(EntryType nType, const unsigned char* pubkey, size_t nPubKeyLen,
+                          const unsigned char* sig, size_t nSigLen, const unsigned char* msg32)
+{
+    vEntries.push_back(Entry());
+    Entry& entry = vEntries.back();
+    entry.nType = nType;
+    entry.vchPubKey.assign(pubkey, pubkey + nPubKeyLen);
+    entry.vchSig.assign(sig, sig + nSigLen);
+    std::copy(msg32, msg32 + 32, entry.msg.begin());
+}
+
+void CSignatureBatch::AddECDSA(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const uint256& hash)
+{
+    // an invalid key stays in the batch with an empty encoding so it is reported as failing
+    Add(SIG_ECDSA_DER, pubkey.begin(), pubkey.IsValid() ? pubkey.size() : 0, vchSig.data(), vchSig.size(), hash.begin());
+}
+
+void CSignatureBatch::AddECDSACompact(const unsigned char* pubkey33, const unsigned char* sig64, const unsigned char* msg32)
+{
+    Add(SIG_ECDSA_COMPACT, pubkey33, 33, sig64, 64, msg32);
+}
+
+void CSignatureBatch::AddSchnorr(const unsigned char* pubkey33, const unsigned char* sig64, const unsigned char* msg32)
+{
+    Add(SIG_SCHNORR, pubkey33, 33, sig64, 64, msg32);
+}
+
+bool CSignatureBatch::AddCryptoCondition(const CC* cond, const uint256& sighash)
+{
+    size_t nPrevSize = vEntries.size();
+    if (!cc_secp256k1CollectTreeMsg32(cond, sighash.begin(), CollectCryptoCondition, this)) {
+        vEntries.resize(nPrevSize);
+        return false;
+    }
+    return true;
+}
+
+bool CSignatureBatch::Verify(std::vector<size_t>* pvInvalid) const
+{
+    const secp256k1_context* ctx = VerifyContext();
+    CParsedPubKeys pubkeys;
+    bool fValid = true;
+
+    std::vector<size_t> vSchnorr;
+    std::vector<secp256k1_schnorrsig> vSchnorrSigs;
+    std::vector<secp256k1_pubkey> vSchnorrKeys;
+    for (size_t i = 0; i < vEntries.size(); i++) {
+        const Entry& entry = vEntries[i];
+        const secp256k1_pubkey* pubkey = pubkeys.Get(ctx, entry.vchPubKey);
+        if (pubkey != NULL) {
+            if (entry.nType != SIG_SCHNORR) {
+                if (VerifyECDSA(ctx, entry.nType, entry.vchSig, entry.msg, *pubkey))
+                    continue;
+            } else {
+                secp256k1_schnorrsig sig;
+                if (secp256k1_schnorrsig_parse(ctx, &sig, entry.vchSig.data())) {
+                    vSchnorr.push_back(i);
+                    vSchnorrSigs.push_back(sig);
+                    vSchnorrKeys.push_back(*pubkey);
+                    continue;
+                }
+            }
+        }
+        if (pvInvalid == NULL)
+            return false;
+        fValid = false;
+        pvInvalid->push_back(i);
+    }
+
+    if (vSchnorr.empty())
+        return fValid;
+
+    std::vector<const secp256k1_schnorrsig*> vpSigs(vSchnorr.size());
+    std::vector<const unsigned char*> vpMsgs(vSchnorr.size());
+    std::vector<const secp256k1_pubkey*> vpKeys(vSchnorr.size());
+    for (size_t j = 0; j < vSchnorr.size(); j++) {
+        vpSigs[j] = &vSchnorrSigs[j];
+        vpMsgs[j] = vEntries[vSchnorr[j]].msg.begin();
+        vpKeys[j] = &vSchnorrKeys[j];
+    }
+
+    int fBatchValid = 0;
+    secp256k1_scratch_space* scratch = secp256k1_scratch_space_create(ctx, SIG_BATCH_SCRATCH_SIZE);
+    if (scratch != NULL) {
+        fBatchValid = secp256k1_schnorrsig_verify_batch(ctx, scratch, vpSigs.data(), vpMsgs.data(), vpKeys.data(), vSchnorr.size());
+        secp256k1_scratch_space_destroy(scratch);
+    }
+    if (fBatchValid)
+        return fValid;
+
+    // Either a signature is bad or there was no scratch space, only single verification can tell which
+    for (size_t j = 0; j < vSchnorr.size(); j++) {
+        if (secp256k1_schnorrsig_verify(ctx, vpSigs[j], vpMsgs[j], vpKeys[j]))
+            continue;
+        if (pvInvalid == NULL)
+            return false;
+        fValid = false;
+        pvInvalid->push_back(vSchnorr[j]);
+    }
+    if (pvInvalid != NULL)
+        std::sort(pvInvalid->begin(), pvInvalid->end());
+    return fValid;
+}
+
+bool CSignatureBatch::VerifySequential(std::vector<size_t>* pvInvalid) const
+{
+    const secp256k1_context* ctx = VerifyContext();
+    bool fValid = true;
+    for (size_t i = 0; i < vEntries.size(); i++) {
+        const Entry& entry = vEntries[i];
+        secp256k1_pubkey pubkey;
+        if (!entry.vchPubKey.empty() &&
+            secp256k1_ec_pubkey_parse(ctx, &pubkey, entry.vchPubKey.data(), entry.vchPubKey.size())) {
+            if (entry.nType == SIG_SCHNORR ? VerifySchnorr(ctx, entry.vchSig, entry.msg, pubkey)
+                                           : VerifyECDSA(ctx, entry.nType, entry.vchSig, entry.msg, pubkey))
+                continue;
+        }
+        if (pvInvalid == NULL)
+            return false;
+        fValid = false;
+        pvInvalid->push_back(i);
+    }
+    return fValid;
+}
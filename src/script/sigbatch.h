@@ -0,0 +1,91 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_SCRIPT_SIGBATCH_H
+#define KOMODO_SCRIPT_SIGBATCH_H
+
+#include "pubkey.h"
+#include "uint256.h"
+
+#include <stdint.h>
+#include <vector>
+
+struct CC;
+
+/** Upper bound for the scratch space of one multi-scalar Schnorr pass, larger batches are split by libsecp256k1. */
+static const size_t SIG_BATCH_SCRATCH_SIZE = 1024 * 1024;
+
+/**
+ * Collects the secp256k1 signature checks of a transaction or block so they
+ * can be verified together.
+ *
+ * Schnorr entries are checked in a single multi-scalar multiplication
+ * (secp256k1_schnorrsig_verify_batch). ECDSA entries can not be combined that
+ * way, a signature only commits to the x coordinate of R, so they are still
+ * verified one at a time; the batch does parse every distinct public key only
+ * once, which helps notarizations and CC threshold trees where the same keys
+ * sign many inputs.
+ */
+class CSignatureBatch
+{
+public:
+    enum EntryType
+    {
+        SIG_ECDSA_DER,          // strict DER, high S normalized like CPubKey::Verify
+        SIG_ECDSA_COMPACT,      // 64 byte lower S signature of a secp256k1 crypto-condition
+        SIG_SCHNORR,            // 64 byte BIP-schnorr signature
+    };
+
+    void AddECDSA(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const uint256& hash);
+    void AddECDSACompact(const unsigned char* pubkey33, const unsigned char* sig64, const unsigned char* msg32);
+    void AddSchnorr(const unsigned char* pubkey33, const unsigned char* sig64, const unsigned char* msg32);
+
+    /**
+     * Adds every fulfilled secp256k1 and secp256k1hash node of a crypto-condition.
+     * Returns false for trees the secp256k1 verifiers reject outright (prefix conditions)
+     * or that hold a node without a key or signature.
+     */
+    bool AddCryptoCondition(const CC* cond, const uint256& sighash);
+
+    size_t size() const { return vEntries.size(); }
+    bool empty() const { return vEntries.empty(); }
+    void clear() { vEntries.clear(); }
+
+    /**
+     * Returns true if every entry is valid. When pvInvalid is given it receives the
+     * (ascending) indexes of the failing entries, which for Schnorr means falling back
+     * to single verification once the combined check failed.
+     */
+    bool Verify(std::vector<size_t>* pvInvalid = NULL) const;
+
+    /** Same result as Verify, checking every entry on its own. Used as the benchmark baseline. */
+    bool VerifySequential(std::vector<size_t>* pvInvalid = NULL) const;
+
+private:
+    struct Entry
+    {
+        EntryType nType;
+        std::vector<unsigned char> vchPubKey;
+        std::vector<unsigned char> vchSig;
+        uint256 msg;
+    };
+
+    void Add(EntryType nType, const unsigned char* pubkey, size_t nPubKeyLen,
+             const unsigned char* sig, size_t nSigLen, const unsigned char* msg32);
+
+    std::vector<Entry> vEntries;
+};
+
+#endif // KOMODO_SCRIPT_SIGBATCH_H
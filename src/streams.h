@@ -365,6 +365,12 @@ public:
         d.insert(d.end(), begin(), end());
         clear();
     }
+
+    /** Exchange the underlying buffer with vchOther without copying; unread data is compacted first. */
+    void SwapBuffer(vector_type &vchOther) {
+        Compact();
+        vch.swap(vchOther);
+    }
 };
 
 class CDataStream : public CBaseDataStream<CSerializeData>
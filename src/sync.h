@@ -23,6 +23,10 @@
 
 #include "threadsafety.h"
 
+#ifdef DEBUG_LOCKPROFILE
+#include "perfstats.h"
+#endif
+
 #undef __cpuid
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
@@ -121,17 +125,40 @@ class SCOPED_LOCKABLE CMutexLock
 {
 private:
     boost::unique_lock<Mutex> lock;
+#ifdef DEBUG_LOCKPROFILE
+    const char* pszProfileName = NULL;
+    int64_t nLockedMicros = 0;
+
+    void ProfileLocked(const char* pszName, int64_t nWaitStart, bool fContended)
+    {
+        pszProfileName = pszName;
+        nLockedMicros = PerfTimeMicros();
+        RecordLockWait(pszName, nLockedMicros - nWaitStart, fContended);
+    }
+#endif
 
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
-#ifdef DEBUG_LOCKCONTENTION
+#ifdef DEBUG_LOCKPROFILE
+        int64_t nWaitStart = PerfTimeMicros();
+        bool fContended = false;
+#endif
+#if defined(DEBUG_LOCKCONTENTION) || defined(DEBUG_LOCKPROFILE)
         if (!lock.try_lock()) {
+#endif
+#ifdef DEBUG_LOCKCONTENTION
             PrintLockContention(pszName, pszFile, nLine);
+#endif
+#ifdef DEBUG_LOCKPROFILE
+            fContended = true;
 #endif
             lock.lock();
-#ifdef DEBUG_LOCKCONTENTION
+#if defined(DEBUG_LOCKCONTENTION) || defined(DEBUG_LOCKPROFILE)
         }
+#endif
+#ifdef DEBUG_LOCKPROFILE
+        ProfileLocked(pszName, nWaitStart, fContended);
 #endif
     }
 
@@ -141,6 +168,10 @@ private:
         lock.try_lock();
         if (!lock.owns_lock())
             LeaveCritical();
+#ifdef DEBUG_LOCKPROFILE
+        else
+            ProfileLocked(pszName, PerfTimeMicros(), false);
+#endif
         return lock.owns_lock();
     }
 
@@ -166,8 +197,12 @@ public:
 
     ~CMutexLock() UNLOCK_FUNCTION()
     {
-        if (lock.owns_lock())
+        if (lock.owns_lock()) {
+#ifdef DEBUG_LOCKPROFILE
+            RecordLockHold(pszProfileName, PerfTimeMicros() - nLockedMicros);
+#endif
             LeaveCritical();
+        }
     }
 
     operator bool()
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include "blockimport.h"
+#include "chainparams.h"
+#include "clientversion.h"
+
+namespace TestBlockImport {
+
+    class TestBlockImport : public ::testing::Test {};
+
+    // Appends a block record the way WriteBlockToDisk does, returns the offset of the block
+    static uint64_t WriteRecord(CAutoFile& file, const CBlock& block)
+    {
+        file << FLATDATA(Params().MessageStart()) << (unsigned int)GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+        uint64_t nPos = ftell(file.Get());
+        file << block;
+        return nPos;
+    }
+
+    TEST(TestBlockImport, blocks_come_out_in_file_order)
+    {
+        CBlock genesis = Params().GenesisBlock();
+        CBlock badroot = genesis;
+        badroot.hashMerkleRoot = uint256S("1234");
+
+        FILE* fp = tmpfile();
+        ASSERT_TRUE(fp != NULL);
+        CAutoFile file(fp, SER_DISK, CLIENT_VERSION);
+        std::vector<uint64_t> vPos;
+        std::vector<bool> vValid;
+        // enough blocks for several batches, with junk between records
+        for (int i = 0; i < 300; i++) {
+            const CBlock& block = i % 7 == 3 ? badroot : genesis;
+            vPos.push_back(WriteRecord(file, block));
+            vValid.push_back(i % 7 != 3);
+            if (i % 11 == 0)
+                file << (uint32_t)0xdeadbeef;
+        }
+        // a record cut short by a crash is ignored
+        file << FLATDATA(Params().MessageStart()) << (unsigned int)1000 << (uint32_t)0;
+        rewind(fp);
+
+        CBlockFilePrefetcher prefetcher(file.release(), Params(), 2000000, 3);
+        CBlockFileEntry* pentry;
+        size_t n = 0;
+        while ((pentry = prefetcher.Next()) != NULL) {
+            ASSERT_LT(n, vPos.size());
+            ASSERT_EQ(pentry->nPos, vPos[n]);
+            ASSERT_EQ(pentry->fValid, vValid[n]);
+            ASSERT_EQ(pentry->hash, pentry->block.GetHash());
+            if (!vValid[n]) {
+                ASSERT_EQ(pentry->strError, "bad-txnmrklroot");
+            }
+            n++;
+        }
+        ASSERT_EQ(n, vPos.size());
+        ASSERT_TRUE(prefetcher.Next() == NULL);
+    }
+
+    TEST(TestBlockImport, rescans_after_malformed_block)
+    {
+        CBlock genesis = Params().GenesisBlock();
+        unsigned int nBlockSize = GetSerializeSize(genesis, SER_DISK, CLIENT_VERSION);
+
+        FILE* fp = tmpfile();
+        ASSERT_TRUE(fp != NULL);
+        CAutoFile file(fp, SER_DISK, CLIENT_VERSION);
+        // a record whose length covers a complete record, its solution length is too large to decode
+        std::vector<unsigned char> vJunk(140, 0);
+        vJunk.push_back(0xfe);
+        vJunk.insert(vJunk.end(), 4, 0xff);
+        vJunk.insert(vJunk.end(), 5, 0);
+        file << FLATDATA(Params().MessageStart()) << (unsigned int)(vJunk.size() + 8 + nBlockSize);
+        file.write((const char*)&vJunk[0], vJunk.size());
+        uint64_t nPos = WriteRecord(file, genesis);
+        rewind(fp);
+
+        CBlockFilePrefetcher prefetcher(file.release(), Params(), 2000000, 2);
+        CBlockFileEntry* pentry = prefetcher.Next();
+        ASSERT_TRUE(pentry != NULL);
+        ASSERT_EQ(pentry->nPos, nPos);
+        ASSERT_TRUE(pentry->fValid);
+        ASSERT_TRUE(prefetcher.Next() == NULL);
+    }
+
+    TEST(TestBlockImport, stops_early)
+    {
+        FILE* fp = tmpfile();
+        ASSERT_TRUE(fp != NULL);
+        CAutoFile file(fp, SER_DISK, CLIENT_VERSION);
+        for (int i = 0; i < 1000; i++)
+            WriteRecord(file, Params().GenesisBlock());
+        rewind(fp);
+
+        // the reader and workers are stopped and joined with blocks still queued
+        CBlockFilePrefetcher prefetcher(file.release(), Params(), 2000000, 2);
+        ASSERT_TRUE(prefetcher.Next() != NULL);
+    }
+
+}
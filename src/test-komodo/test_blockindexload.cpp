@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "chain.h"
+#include "main.h"
+#include "random.h"
+#include "txdb.h"
+
+namespace TestBlockIndexLoad {
+
+    class TestBlockIndexLoad : public ::testing::Test {};
+
+    // Writes a chain of nBlocks headers, keeps their hashes in vHashes
+    static void WriteChain(CBlockTreeDB& db, size_t nBlocks, std::vector<uint256>& vHashes)
+    {
+        vHashes.resize(nBlocks);
+        std::vector<CBlockIndex> vIndex(nBlocks);
+        std::vector<const CBlockIndex*> blockinfo;
+        for (size_t i = 0; i < nBlocks; i++) {
+            CBlockHeader header;
+            header.nVersion = 4;
+            header.hashPrevBlock = i ? vHashes[i-1] : uint256();
+            header.nTime = 1000 + i;
+            header.nNonce = GetRandHash();
+            header.nSolution.assign(1344, i & 0xff);
+            vHashes[i] = header.GetHash();
+            vIndex[i] = CBlockIndex(header);
+            vIndex[i].phashBlock = &vHashes[i];
+            vIndex[i].pprev = i ? &vIndex[i-1] : NULL;
+            vIndex[i].SetHeight(i);
+            vIndex[i].nTx = 1;
+            blockinfo.push_back(&vIndex[i]);
+        }
+        ASSERT_TRUE(db.WriteBatchSync(std::vector<std::pair<int, const CBlockFileInfo*> >(), 0, blockinfo));
+    }
+
+    static bool Load(CBlockTreeDB& db, int nThreads, BlockMap& mapLoaded)
+    {
+        return db.LoadBlockIndexGuts([&mapLoaded](const uint256& hash) -> CBlockIndex* {
+            if (hash.IsNull())
+                return NULL;
+            BlockMap::iterator mi = mapLoaded.find(hash);
+            if (mi == mapLoaded.end()) {
+                mi = mapLoaded.insert(std::make_pair(hash, new CBlockIndex())).first;
+                mi->second->phashBlock = &mi->first;
+            }
+            return mi->second;
+        }, nThreads);
+    }
+
+    static void Free(BlockMap& mapLoaded)
+    {
+        for (BlockMap::iterator it = mapLoaded.begin(); it != mapLoaded.end(); ++it)
+            delete it->second;
+        mapLoaded.clear();
+    }
+
+    TEST(TestBlockIndexLoad, parallel_load_matches_sequential)
+    {
+        CBlockTreeDB db(1 << 20, true, true);
+        std::vector<uint256> vHashes;
+        // spans several worker batches
+        WriteChain(db, 10000, vHashes);
+
+        BlockMap mapSeq, mapPar;
+        ASSERT_TRUE(Load(db, 1, mapSeq));
+        ASSERT_TRUE(Load(db, 4, mapPar));
+        ASSERT_EQ(mapSeq.size(), vHashes.size());
+        ASSERT_EQ(mapPar.size(), vHashes.size());
+        for (size_t i = 0; i < vHashes.size(); i++) {
+            CBlockIndex* pindex = mapPar[vHashes[i]];
+            ASSERT_EQ(pindex->GetHeight(), (int)i);
+            ASSERT_EQ(pindex->nTx, 1);
+            ASSERT_EQ(pindex->nNonce, mapSeq[vHashes[i]]->nNonce);
+            if (i)
+                ASSERT_EQ(pindex->pprev, mapPar[vHashes[i-1]]);
+            // solutions are verified but stay on disk
+            ASSERT_FALSE(pindex->HasSolution());
+        }
+        CDiskBlockIndex diskindex;
+        ASSERT_TRUE(db.ReadDiskBlockIndex(vHashes[42], diskindex));
+        ASSERT_EQ(diskindex.nSolution, std::vector<unsigned char>(1344, 42));
+        Free(mapSeq);
+        Free(mapPar);
+    }
+
+    TEST(TestBlockIndexLoad, detects_header_inconsistency)
+    {
+        CBlockTreeDB db(1 << 20, true, true);
+        std::vector<uint256> vHashes;
+        WriteChain(db, 100, vHashes);
+
+        // an entry stored under a key that is not its header hash
+        CBlockIndex index;
+        CBlockHeader header;
+        header.nSolution.assign(1344, 0x55);
+        uint256 hash = header.GetHash();
+        index = CBlockIndex(header);
+        index.phashBlock = &hash;
+        ASSERT_TRUE(db.Write(std::make_pair('b' /* DB_BLOCK_INDEX */, GetRandHash()), CDiskBlockIndex(&index)));
+
+        BlockMap mapLoaded;
+        ASSERT_FALSE(Load(db, 4, mapLoaded));
+        Free(mapLoaded);
+        ASSERT_FALSE(Load(db, 1, mapLoaded));
+        Free(mapLoaded);
+    }
+
+}
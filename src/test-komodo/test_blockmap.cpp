@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "blockmap.h"
+#include "random.h"
+
+#include <map>
+
+namespace TestBlockMap {
+
+    class TestBlockMap : public ::testing::Test {};
+
+    TEST(TestBlockMap, matches_std_map)
+    {
+        CBlockMap map;
+        std::map<uint256, CBlockIndex*> ref;
+        std::vector<uint256> vKeys;
+
+        for (int i = 0; i < 20000; i++) {
+            uint256 key;
+            if (!vKeys.empty() && insecure_rand() % 2) {
+                key = vKeys[insecure_rand() % vKeys.size()];
+            } else {
+                key = GetRandHash();
+                // share the low bits so that probe runs get long
+                if (insecure_rand() % 4 == 0)
+                    memset(key.begin(), 0, 2);
+                vKeys.push_back(key);
+            }
+            CBlockIndex* value = reinterpret_cast<CBlockIndex*>(static_cast<intptr_t>(i + 1));
+            switch (insecure_rand() % 4) {
+            case 0: {
+                std::pair<CBlockMap::iterator, bool> ret = map.insert(std::make_pair(key, value));
+                ASSERT_EQ(ret.second, ref.insert(std::make_pair(key, value)).second);
+                ASSERT_EQ(ret.first->second, ref[key]);
+                break;
+            }
+            case 1:
+                ASSERT_EQ(map.erase(key), ref.erase(key));
+                break;
+            case 2:
+                map[key] = value;
+                ref[key] = value;
+                break;
+            default: {
+                CBlockMap::const_iterator it = map.find(key);
+                ASSERT_EQ(it == map.end(), ref.count(key) == 0);
+                if (it != map.end())
+                    ASSERT_EQ(it->second, ref[key]);
+            }
+            }
+        }
+
+        ASSERT_EQ(map.size(), ref.size());
+        size_t n = 0;
+        for (const CBlockMap::value_type& entry : map) {
+            ASSERT_EQ(entry.second, ref[entry.first]);
+            n++;
+        }
+        ASSERT_EQ(n, ref.size());
+    }
+
+    TEST(TestBlockMap, entries_keep_their_address)
+    {
+        CBlockMap map;
+        uint256 first = GetRandHash();
+        const uint256* phash = &map.insert(std::make_pair(first, (CBlockIndex*)NULL)).first->first;
+
+        // grow through several rehashes and erase around the entry
+        std::vector<uint256> vKeys;
+        for (int i = 0; i < 10000; i++) {
+            vKeys.push_back(GetRandHash());
+            map[vKeys.back()] = NULL;
+        }
+        for (size_t i = 0; i < vKeys.size(); i += 2)
+            map.erase(vKeys[i]);
+
+        ASSERT_EQ(&map.find(first)->first, phash);
+        ASSERT_EQ(*phash, first);
+        ASSERT_EQ(map.size(), 5001);
+
+        map.clear();
+        ASSERT_TRUE(map.empty());
+        ASSERT_TRUE(map.begin() == map.end());
+    }
+
+    TEST(TestBlockMap, arena_constructs_and_destroys)
+    {
+        static int nLive = 0;
+        struct Counted {
+            int n;
+            explicit Counted(int nIn) : n(nIn) { nLive++; }
+            ~Counted() { nLive--; }
+        };
+
+        CArena<Counted, 16> arena;
+        std::vector<Counted*> v;
+        for (int i = 0; i < 100; i++)
+            v.push_back(arena.Allocate(i));
+        ASSERT_EQ(nLive, 100);
+        ASSERT_EQ(arena.size(), 100);
+        for (int i = 0; i < 100; i++)
+            ASSERT_EQ(v[i]->n, i);
+        arena.Clear();
+        ASSERT_EQ(nLive, 0);
+        ASSERT_EQ(arena.size(), 0);
+    }
+
+}
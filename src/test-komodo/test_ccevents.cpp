@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "cc/CCevents.h"
+#include "cc/CCinclude.h"
+#include "key.h"
+#include "primitives/transaction.h"
+#include "random.h"
+#include "streams.h"
+#include "version.h"
+
+namespace TestCCEvents {
+
+    class TestCCEvents : public ::testing::Test {};
+
+    TEST(TestCCEvents, token_transfer_is_decoded)
+    {
+        CKey key;
+        key.MakeNewKey(true);
+        CPubKey pk = key.GetPubKey();
+        uint256 tokenid = GetRandHash();
+
+        CMutableTransaction mtx;
+        mtx.vin.push_back(CTxIn(COutPoint(GetRandHash(), 0), CScript()));
+        mtx.vout.push_back(MakeCC1vout(EVAL_TOKENS, 10, pk));
+        mtx.vout.push_back(CTxOut(10000, CScript() << ToByteVector(pk) << OP_CHECKSIG));
+        mtx.vout.push_back(CTxOut(0, EncodeTokenOpRetV1(tokenid, { pk }, { vscript_t{ 0xe3, 's', 0x01 } })));
+
+        CCEvent event;
+        ASSERT_TRUE(DecodeCCEvent(mtx, NULL, event));
+        EXPECT_EQ(event.txid, mtx.GetHash());
+        EXPECT_TRUE(event.blockhash.IsNull());
+        EXPECT_EQ(event.evalcode, EVAL_TOKENS);
+        EXPECT_EQ(event.funcid, 't');
+        EXPECT_EQ(event.tokenid, tokenid);
+        EXPECT_EQ(event.moduleEvalcode, 0xe3);
+        EXPECT_EQ(event.moduleFuncid, 's');
+        ASSERT_EQ(event.vout.size(), 2);  // the opreturn is left out
+        EXPECT_TRUE(event.vout[0].fCC);
+        EXPECT_FALSE(event.vout[1].fCC);
+        EXPECT_EQ(event.GetAddresses().size(), 2);
+
+        // the body is the version, the sequence and the event
+        std::vector<unsigned char> body = SerializeCCEvent(event, 7);
+        CDataStream ss(body, SER_NETWORK, PROTOCOL_VERSION);
+        uint8_t version;
+        uint64_t nSequence;
+        CCEvent decoded;
+        ss >> version >> nSequence >> decoded;
+        EXPECT_EQ(version, CCEVENT_VERSION);
+        EXPECT_EQ(nSequence, 7);
+        EXPECT_EQ(decoded.tokenid, tokenid);
+        EXPECT_EQ(decoded.vout[1].address, event.vout[1].address);
+        EXPECT_TRUE(ss.empty());
+
+        // not a cc tx
+        mtx.vout.erase(mtx.vout.begin());
+        EXPECT_FALSE(DecodeCCEvent(mtx, NULL, event));
+    }
+
+    TEST(TestCCEvents, filter_and_sequences)
+    {
+        CCEvent event;
+        event.evalcode = 0xf5;
+        event.vout.push_back(CCEventOutput(0, 1, true, "RAddress"));
+
+        CCEventFilter all;
+        EXPECT_TRUE(all.Parse(""));
+        EXPECT_TRUE(all.Match(event));
+
+        CCEventFilter evalcodes;
+        EXPECT_TRUE(evalcodes.Parse("f2, e3"));
+        EXPECT_FALSE(evalcodes.Match(event));
+        event.moduleEvalcode = 0xe3;
+        EXPECT_TRUE(evalcodes.Match(event));
+        EXPECT_TRUE(evalcodes.MatchAddress("RAddress"));
+
+        CCEventFilter addresses;
+        EXPECT_TRUE(addresses.Parse("RAddress,ROther"));
+        EXPECT_TRUE(addresses.Match(event));
+        EXPECT_TRUE(addresses.MatchAddress("ROther"));
+        EXPECT_FALSE(addresses.MatchAddress("RThird"));
+        EXPECT_FALSE(addresses.Parse(std::string(100, 'R')));
+
+        CCEventSequences sequences;
+        EXPECT_EQ(sequences.NextEvalcode(0xf5), 0);
+        EXPECT_EQ(sequences.NextEvalcode(0xf5), 1);
+        EXPECT_EQ(sequences.NextEvalcode(0xf2), 0);
+        EXPECT_EQ(sequences.NextAddress("RAddress"), 0);
+        EXPECT_EQ(sequences.NextAddress("RAddress"), 1);
+    }
+
+    TEST(TestCCEvents, ccaddress_applies_evalcode_filter)
+    {
+        CCEvent event;
+        event.evalcode = 0xf2;
+        event.vout.push_back(CCEventOutput(0, 1, true, "RAddress"));
+        event.vout.push_back(CCEventOutput(1, 1, false, "ROther"));
+
+        // -ccnotifyfilter=f5 publishes no addresses of other modules
+        CCEventFilter evalcodes;
+        EXPECT_TRUE(evalcodes.Parse("f5"));
+        EXPECT_TRUE(evalcodes.MatchAddresses(event).empty());
+        event.evalcode = 0xf5;
+        std::vector<std::string> addresses = evalcodes.MatchAddresses(event);
+        ASSERT_EQ(addresses.size(), 2);
+        EXPECT_EQ(addresses[0], "RAddress");
+        EXPECT_EQ(addresses[1], "ROther");
+
+        CCEventFilter listed;
+        EXPECT_TRUE(listed.Parse("ROther"));
+        addresses = listed.MatchAddresses(event);
+        ASSERT_EQ(addresses.size(), 1);
+        EXPECT_EQ(addresses[0], "ROther");
+    }
+
+    TEST(TestCCEvents, dropped_events_skip_sequences)
+    {
+        CCEvent event;
+        event.evalcode = 0xf5;
+        event.vout.push_back(CCEventOutput(0, 1, true, "RAddress"));
+
+        CCEventFilter all, other;
+        EXPECT_TRUE(other.Parse("f2"));
+        CCEventGap gap;
+        gap.Add(event, all);
+        gap.Add(event, all);
+        gap.Add(event, other);  // not published, no gap
+        EXPECT_EQ(gap.nEvents, 2);
+        EXPECT_EQ(gap.nAddressEvents, 2);
+
+        CCEventSequences sequences;
+        EXPECT_EQ(sequences.NextEvalcode(0xf5), 0);
+        sequences.SkipEvalcodes(gap);
+        sequences.SkipAddresses(gap);
+        EXPECT_EQ(sequences.NextEvalcode(0xf5), 3);
+        EXPECT_EQ(sequences.NextEvalcode(0xf2), 0);
+        EXPECT_EQ(sequences.NextAddress("RAddress"), 2);
+    }
+
+}
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include "script/ccsigcache.h"
+
+namespace TestCCSigCache {
+
+    class TestCCSigCache : public ::testing::Test {};
+
+    TEST(TestCCSigCache, key_covers_all_inputs)
+    {
+        std::vector<unsigned char> ffill(10, 0x01), cond(10, 0x02);
+        uint256 sighash = uint256S("0x1234");
+        uint256 key = CCryptoConditionCache::ComputeKey(ffill, cond, sighash);
+
+        ASSERT_EQ(key, CCryptoConditionCache::ComputeKey(ffill, cond, sighash));
+        ASSERT_NE(key, CCryptoConditionCache::ComputeKey(ffill, cond, uint256S("0x1235")));
+        ASSERT_NE(key, CCryptoConditionCache::ComputeKey(cond, ffill, sighash));
+
+        // the same bytes split differently between fulfillment and condition
+        std::vector<unsigned char> ffill2(ffill), cond2(cond.begin() + 1, cond.end());
+        ffill2.push_back(cond[0]);
+        ASSERT_NE(key, CCryptoConditionCache::ComputeKey(ffill2, cond2, sighash));
+    }
+
+    TEST(TestCCSigCache, stores_and_bounds_entries)
+    {
+        CCryptoConditionCache cache(CCryptoConditionCache::STRIPES * 2);
+        std::vector<unsigned char> ffill(1, 0), cond(1, 0);
+
+        uint256 first = CCryptoConditionCache::ComputeKey(ffill, cond, uint256());
+        ASSERT_FALSE(cache.Get(first));
+        cache.Set(first);
+        ASSERT_TRUE(cache.Get(first));
+
+        for (int i = 0; i < 1000; i++) {
+            ffill[0] = i & 0xff;
+            cond[0] = i >> 8;
+            cache.Set(CCryptoConditionCache::ComputeKey(ffill, cond, uint256()));
+        }
+        ASSERT_LE(cache.Size(), CCryptoConditionCache::STRIPES * 2);
+    }
+
+    TEST(TestCCSigCache, zero_size_disables_cache)
+    {
+        CCryptoConditionCache cache(0);
+        uint256 key = uint256S("0xabcd");
+        cache.Set(key);
+        ASSERT_FALSE(cache.Get(key));
+        ASSERT_EQ(cache.Size(), 0);
+    }
+
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "chain.h"
+#include "chainsnapshot.h"
+
+#include <vector>
+
+namespace TestChainSnapshot {
+
+    class TestChainSnapshot : public ::testing::Test {};
+
+    static void BuildChain(std::vector<CBlockIndex>& vIndex, CBlockIndex* pfork = NULL)
+    {
+        for (size_t i = 0; i < vIndex.size(); i++) {
+            CBlockIndex* pprev = (i == 0) ? pfork : &vIndex[i - 1];
+            vIndex[i].SetHeight(pprev ? pprev->GetHeight() + 1 : 0);
+            vIndex[i].pprev = pprev;
+            vIndex[i].BuildSkip();
+        }
+    }
+
+    static CChainSnapshot MakeSnapshot(CBlockIndex* pindexTip)
+    {
+        CChainSnapshot snapshot;
+        snapshot.pindexTip = pindexTip;
+        snapshot.nHeight = pindexTip->GetHeight();
+        return snapshot;
+    }
+
+    TEST(TestChainSnapshot, walks_from_tip)
+    {
+        std::vector<CBlockIndex> vIndex(1000);
+        BuildChain(vIndex);
+        CChainSnapshot snapshot = MakeSnapshot(&vIndex[999]);
+
+        ASSERT_EQ(snapshot[0], &vIndex[0]);
+        ASSERT_EQ(snapshot[500], &vIndex[500]);
+        ASSERT_EQ(snapshot[999], &vIndex[999]);
+        ASSERT_EQ(snapshot[1000], nullptr);
+        ASSERT_EQ(snapshot[-1], nullptr);
+        ASSERT_EQ(snapshot.Next(&vIndex[10]), &vIndex[11]);
+        ASSERT_EQ(snapshot.Next(&vIndex[999]), nullptr);
+    }
+
+    TEST(TestChainSnapshot, stale_snapshot_keeps_its_chain)
+    {
+        std::vector<CBlockIndex> vMain(100), vFork(20);
+        BuildChain(vMain);
+        BuildChain(vFork, &vMain[79]);
+
+        // a reader holding the old snapshot still sees the main chain after a reorg to the fork
+        CChainSnapshot before = MakeSnapshot(&vMain[99]);
+        CChainSnapshot after = MakeSnapshot(&vFork[19]);
+
+        ASSERT_TRUE(before.Contains(&vMain[90]));
+        ASSERT_FALSE(before.Contains(&vFork[0]));
+        ASSERT_FALSE(after.Contains(&vMain[90]));
+        ASSERT_TRUE(after.Contains(&vFork[0]));
+        ASSERT_TRUE(after.Contains(&vMain[79]));
+        ASSERT_EQ(before.Next(&vMain[79]), &vMain[80]);
+        ASSERT_EQ(after.Next(&vMain[79]), &vFork[0]);
+    }
+
+    TEST(TestChainSnapshot, empty_snapshot)
+    {
+        CChainSnapshot snapshot;
+        ASSERT_EQ(snapshot.nHeight, -1);
+        ASSERT_EQ(snapshot[0], nullptr);
+        ASSERT_FALSE(snapshot.Contains(NULL));
+    }
+
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "cc/CCcoinselect.h"
+#include "cc/CCinclude.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "utiltime.h"
+
+namespace TestCoinSelect {
+
+    class TestCoinSelect : public ::testing::Test {};
+
+    // notified directly, the wallets of the test binary do not see these txns
+    class CTestCoinSelectCache : public CCoinSelectCache
+    {
+    public:
+        explicit CTestCoinSelectCache(int64_t nReserveTime) : CCoinSelectCache(nReserveTime) {}
+        using CCoinSelectCache::SyncTransaction;
+        using CCoinSelectCache::ChainTip;
+    };
+
+    static CScript AddressScript()
+    {
+        uint160 hash;
+        GetRandBytes(hash.begin(), hash.size());
+        return CScript() << OP_DUP << OP_HASH160 << ToByteVector(hash) << OP_EQUALVERIFY << OP_CHECKSIG;
+    }
+
+    static CMutableTransaction PayTo(const CScript &script, const COutPoint &prevout, CAmount nValue)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.push_back(CTxIn(prevout, CScript()));
+        mtx.vout.push_back(CTxOut(nValue, script));
+        return mtx;
+    }
+
+    TEST(TestCoinSelect, pool_follows_notifications)
+    {
+        CTestCoinSelectCache cache(0);
+
+        CScript script = AddressScript();
+        char coinaddr[KOMODO_ADDRESS_BUFSIZE];
+        ASSERT_TRUE(Getscriptaddress(coinaddr, script));
+        CCoinSelectKey key(coinaddr, zeroid, 0, true);
+
+        CTransaction funding = PayTo(script, COutPoint(GetRandHash(), 0), 10 * COIN);
+        int nLoads = 0;
+        CCoinSelectCache::Loader loader = [&](std::vector<CCoinCandidate> &loaded) {
+            nLoads++;
+            loaded.push_back(CCoinCandidate(COutPoint(funding.GetHash(), 0), 10 * COIN, script, false, CCoinCandidate::SPENDABLE));
+        };
+
+        std::vector<CCoinCandidate> candidates;
+        EXPECT_TRUE(cache.GetCandidates(key, loader, false, true, candidates));
+        EXPECT_FALSE(cache.GetCandidates(key, loader, false, true, candidates));
+        EXPECT_EQ(nLoads, 1);
+        ASSERT_EQ(candidates.size(), 1);
+
+        // a block tx spends the output and pays back to the address
+        CBlock block;
+        CTransaction spend = PayTo(script, COutPoint(funding.GetHash(), 0), 9 * COIN);
+        cache.SyncTransaction(spend, &block);
+        cache.GetCandidates(key, loader, false, true, candidates);
+        EXPECT_EQ(nLoads, 1);
+        ASSERT_EQ(candidates.size(), 1);
+        EXPECT_EQ(candidates[0].outpoint, COutPoint(spend.GetHash(), 0));
+        EXPECT_EQ(candidates[0].nValue, 9 * COIN);
+        EXPECT_EQ(candidates[0].nStatus, CCoinCandidate::SPENDABLE);
+
+        // a late mempool notification does not bring the spent output back
+        cache.SyncTransaction(funding, NULL);
+        cache.GetCandidates(key, loader, false, true, candidates);
+        ASSERT_EQ(candidates.size(), 1);
+
+        // reorgs drop the pools
+        cache.ChainTip(NULL, &block, SproutMerkleTree(), SaplingMerkleTree(), false);
+        EXPECT_EQ(cache.PoolCount(), 0);
+    }
+
+    TEST(TestCoinSelect, reservations_are_all_or_none)
+    {
+        CTestCoinSelectCache cache(60);
+
+        CScript script = AddressScript();
+        COutPoint a(GetRandHash(), 0), b(GetRandHash(), 1);
+        CCoinSelectKey key("address", zeroid, 0, false);
+        CCoinSelectCache::Loader loader = [&](std::vector<CCoinCandidate> &loaded) {
+            loaded.push_back(CCoinCandidate(a, COIN, script, false, CCoinCandidate::SPENDABLE));
+            loaded.push_back(CCoinCandidate(b, COIN, script, false, CCoinCandidate::SPENDABLE));
+        };
+
+        int64_t nNow = GetTime();
+        EXPECT_TRUE(cache.Reserve({ a }, nNow));
+        EXPECT_FALSE(cache.Reserve({ a, b }, nNow));
+        EXPECT_FALSE(cache.IsReserved(b, nNow));
+        EXPECT_TRUE(cache.Reserve({ b }, nNow));
+
+        // reserved outputs are left out for builders but counted for balances
+        std::vector<CCoinCandidate> candidates;
+        cache.GetCandidates(key, loader, false, true, candidates);
+        EXPECT_EQ(candidates.size(), 0);
+        cache.GetCandidates(key, loader, false, false, candidates);
+        EXPECT_EQ(candidates.size(), 2);
+
+        // spending ends the reservation, so does expiry
+        CTransaction spend = PayTo(AddressScript(), a, COIN);
+        cache.SyncTransaction(spend, NULL);
+        EXPECT_FALSE(cache.IsReserved(a, nNow));
+        EXPECT_TRUE(cache.IsReserved(b, nNow));
+        EXPECT_FALSE(cache.IsReserved(b, nNow + 60));
+        EXPECT_TRUE(cache.Reserve({ b }, nNow + 60));
+    }
+
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include "coinsflush.h"
+#include "random.h"
+#include "txdb.h"
+
+namespace TestCoinsFlush {
+
+    class TestCoinsFlush : public ::testing::Test {};
+
+    // Adds one single-output coin per txid to the cache
+    static void AddCoins(CCoinsViewCache& cache, const std::vector<uint256>& vTxids)
+    {
+        for (size_t i = 0; i < vTxids.size(); i++) {
+            CCoinsModifier coins = cache.ModifyCoins(vTxids[i]);
+            coins->nVersion = 1;
+            coins->nHeight = 1;
+            coins->vout.resize(1);
+            coins->vout[0].nValue = i + 1;
+            coins->vout[0].scriptPubKey = CScript() << OP_TRUE;
+        }
+    }
+
+    TEST(TestCoinsFlush, frozen_layer_stays_readable)
+    {
+        CCoinsViewDB db(1 << 20, true, true);
+        CCoinsViewAsyncFlush async(&db, &db);
+        CCoinsViewCache cache(&async);
+
+        std::vector<uint256> vTxids;
+        for (int i = 0; i < 2000; i++)
+            vTxids.push_back(GetRandHash());
+        AddCoins(cache, vTxids);
+        uint256 hashBlock = GetRandHash();
+        cache.SetBestBlock(hashBlock);
+        ASSERT_TRUE(cache.Flush());
+        ASSERT_EQ(cache.GetCacheSize(), 0);
+
+        // whether the write is done or not, the layer below the cache sees the flushed state
+        ASSERT_EQ(async.GetBestBlock(), hashBlock);
+        for (size_t i = 0; i < vTxids.size(); i++) {
+            CCoins coins;
+            ASSERT_TRUE(async.GetCoins(vTxids[i], coins));
+            ASSERT_EQ(coins.vout[0].nValue, i + 1);
+        }
+
+        // spending everything flushes erasures that must win over the older write
+        for (size_t i = 0; i < vTxids.size(); i++)
+            ASSERT_TRUE(cache.ModifyCoins(vTxids[i])->Spend(0));
+        cache.SetBestBlock(GetRandHash());
+        ASSERT_TRUE(cache.Flush());
+        ASSERT_FALSE(async.HaveCoins(vTxids[0]));
+
+        ASSERT_TRUE(async.Sync());
+        ASSERT_FALSE(async.IsWriting());
+        ASSERT_EQ(db.GetBestBlock(), cache.GetBestBlock());
+        for (size_t i = 0; i < vTxids.size(); i++)
+            ASSERT_FALSE(db.HaveCoins(vTxids[i]));
+    }
+
+    TEST(TestCoinsFlush, split_write_clears_marker)
+    {
+        CCoinsViewDB db(1 << 20, true, true);
+        // a few coins per batch
+        db.SetBatchSize(256);
+        CCoinsViewCache cache(&db);
+
+        std::vector<uint256> vTxids;
+        for (int i = 0; i < 500; i++)
+            vTxids.push_back(GetRandHash());
+        AddCoins(cache, vTxids);
+        uint256 hashBlock = GetRandHash();
+        cache.SetBestBlock(hashBlock);
+        ASSERT_TRUE(cache.Flush());
+
+        ASSERT_TRUE(db.GetHeadBlocks().empty());
+        ASSERT_EQ(db.GetBestBlock(), hashBlock);
+        for (size_t i = 0; i < vTxids.size(); i++) {
+            CCoins coins;
+            ASSERT_TRUE(db.GetCoins(vTxids[i], coins));
+            ASSERT_EQ(coins.vout[0].nValue, i + 1);
+        }
+    }
+
+}
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include "flathashmap.h"
+#include "random.h"
+
+#include <map>
+
+namespace TestFlatHashMap {
+
+    class TestFlatHashMap : public ::testing::Test {};
+
+    struct CheapHasher
+    {
+        size_t operator()(const uint256& key) const { return key.GetCheapHash(); }
+    };
+
+    typedef CFlatHashMap<uint256, int, CheapHasher> IntMap;
+
+    TEST(TestFlatHashMap, matches_std_map)
+    {
+        IntMap map;
+        std::map<uint256, int> ref;
+        std::vector<uint256> vKeys;
+
+        for (int i = 0; i < 20000; i++) {
+            uint256 key;
+            if (!vKeys.empty() && insecure_rand() % 2) {
+                key = vKeys[insecure_rand() % vKeys.size()];
+            } else {
+                key = GetRandHash();
+                // share the low bits so that probe runs get long
+                if (insecure_rand() % 4 == 0)
+                    memset(key.begin(), 0, 2);
+                vKeys.push_back(key);
+            }
+            switch (insecure_rand() % 5) {
+            case 0: {
+                std::pair<IntMap::iterator, bool> ret = map.insert(std::make_pair(key, i));
+                ASSERT_EQ(ret.second, ref.insert(std::make_pair(key, i)).second);
+                ASSERT_EQ(ret.first->second, ref[key]);
+                break;
+            }
+            case 1:
+                ASSERT_EQ(map.erase(key), ref.erase(key));
+                break;
+            case 2: {
+                IntMap::iterator it = map.find(key);
+                if (it != map.end()) {
+                    map.erase(it);
+                    ref.erase(key);
+                }
+                break;
+            }
+            case 3:
+                map[key] = i;
+                ref[key] = i;
+                break;
+            default: {
+                IntMap::const_iterator it = map.find(key);
+                ASSERT_EQ(it == map.end(), ref.count(key) == 0);
+                if (it != map.end()) {
+                    ASSERT_EQ(it->second, ref[key]);
+                }
+            }
+            }
+            ASSERT_EQ(map.size(), ref.size());
+        }
+
+        std::map<uint256, int> iterated;
+        for (IntMap::const_iterator it = map.begin(); it != map.end(); ++it)
+            ASSERT_TRUE(iterated.insert(*it).second);
+        ASSERT_EQ(iterated, ref);
+    }
+
+    TEST(TestFlatHashMap, erase_while_iterating)
+    {
+        IntMap map;
+        for (int i = 0; i < 5000; i++)
+            map[GetRandHash()] = i;
+
+        // the pattern CCoinsViewCache::BatchWrite uses to drain a child cache
+        size_t nVisited = 0;
+        for (IntMap::iterator it = map.begin(); it != map.end();) {
+            IntMap::iterator itOld = it++;
+            map.erase(itOld);
+            nVisited++;
+        }
+        ASSERT_EQ(nVisited, 5000);
+        ASSERT_TRUE(map.empty());
+        ASSERT_TRUE(map.begin() == map.end());
+    }
+
+    TEST(TestFlatHashMap, entries_keep_their_address)
+    {
+        IntMap map;
+        uint256 first = GetRandHash();
+        int* pvalue = &map[first];
+        IntMap::iterator it = map.find(first);
+
+        // growing the table rehashes but must not move entries
+        for (int i = 0; i < 10000; i++)
+            map[GetRandHash()] = i;
+        ASSERT_EQ(&map[first], pvalue);
+        ASSERT_EQ(&it->second, pvalue);
+
+        // an iterator that outlived a rehash can still erase its entry
+        map.erase(it);
+        ASSERT_EQ(map.count(first), 0);
+        ASSERT_EQ(map.size(), 10000);
+    }
+
+    TEST(TestFlatHashMap, destroys_values_and_releases_memory)
+    {
+        typedef CFlatHashMap<uint256, std::vector<unsigned char>, CheapHasher> VectorMap;
+        VectorMap map;
+        std::vector<uint256> vKeys;
+        for (int i = 0; i < 3000; i++) {
+            vKeys.push_back(GetRandHash());
+            map[vKeys.back()].resize(100);
+        }
+        size_t nUsage = map.DynamicMemoryUsage();
+        ASSERT_GE(nUsage, 3000 * sizeof(VectorMap::value_type));
+
+        // erased storage is reused instead of growing the pool
+        const VectorMap::value_type* pentry = &*map.find(vKeys[0]);
+        map.erase(vKeys[0]);
+        uint256 key = GetRandHash();
+        map[key].resize(100);
+        ASSERT_EQ(&*map.find(key), pentry);
+
+        VectorMap copy(map);
+        ASSERT_EQ(copy.size(), map.size());
+        ASSERT_EQ(copy[vKeys[2000]].size(), 100);
+
+        map.clear();
+        ASSERT_EQ(map.size(), 0);
+        ASSERT_EQ(map.DynamicMemoryUsage(), 0);
+        ASSERT_EQ(map.count(vKeys[2000]), 0);
+    }
+
+}
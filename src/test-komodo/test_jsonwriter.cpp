@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "rpc/jsonwriter.h"
+
+#include <vector>
+
+namespace TestJSONWriter {
+
+    class TestJSONWriter : public ::testing::Test {};
+
+    static UniValue MakeDocument()
+    {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("string", "quote \" backslash \\ newline \n"));
+        obj.push_back(Pair("int", -42));
+        obj.push_back(Pair("amount", 12.5));
+        obj.push_back(Pair("flag", true));
+        obj.push_back(Pair("none", NullUniValue));
+        obj.push_back(Pair("empty", UniValue(UniValue::VARR)));
+
+        UniValue arr(UniValue::VARR);
+        for (int i = 0; i < 100; i++) {
+            UniValue entry(UniValue::VOBJ);
+            entry.push_back(Pair("n", i));
+            entry.push_back(Pair("hex", "00ff"));
+            arr.push_back(entry);
+        }
+        obj.push_back(Pair("entries", arr));
+        return obj;
+    }
+
+    TEST(TestJSONWriter, matches_univalue_write)
+    {
+        UniValue doc = MakeDocument();
+        std::vector<std::string> chunks;
+        CJSONStreamWriter writer([&](const std::string& chunk) { chunks.push_back(chunk); });
+        writer.Write(doc);
+
+        // small documents stay buffered
+        ASSERT_TRUE(chunks.empty());
+        ASSERT_EQ(writer.TakeBuffer(), doc.write());
+        ASSERT_EQ(writer.TakeBuffer(), "");
+    }
+
+    TEST(TestJSONWriter, splits_into_chunks)
+    {
+        UniValue doc = MakeDocument();
+        std::string strExpected = "[" + doc.write() + "," + doc.write() + "]\n";
+
+        std::vector<std::string> chunks;
+        CJSONStreamWriter writer([&](const std::string& chunk) { chunks.push_back(chunk); }, 64);
+        writer.WriteRaw("[");
+        writer.Write(doc);
+        writer.WriteRaw(",");
+        writer.Write(doc);
+        writer.WriteRaw("]\n");
+        writer.Flush();
+
+        ASSERT_GT(chunks.size(), 1);
+        std::string strJoined;
+        for (const std::string& chunk : chunks)
+            strJoined += chunk;
+        ASSERT_EQ(strJoined, strExpected);
+        ASSERT_EQ(writer.GetBytesWritten(), strExpected.size());
+    }
+
+    TEST(TestJSONWriter, writes_object_keys)
+    {
+        CJSONStreamWriter writer([](const std::string&) {});
+        writer.WriteRaw("{");
+        writer.WriteKey("result");
+        writer.Write(UniValue("a\tb"));
+        writer.WriteRaw(",");
+        writer.WriteKey("id");
+        writer.Write(UniValue(7));
+        writer.WriteRaw("}");
+
+        UniValue expected(UniValue::VOBJ);
+        expected.push_back(Pair("result", "a\tb"));
+        expected.push_back(Pair("id", 7));
+        ASSERT_EQ(writer.TakeBuffer(), expected.write());
+    }
+
+}
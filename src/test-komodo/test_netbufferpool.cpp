@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include "netbufferpool.h"
+#include "net.h"
+
+namespace TestNetBufferPool {
+
+    class TestNetBufferPool : public ::testing::Test {};
+
+    TEST(TestNetBufferPool, reuses_released_buffers)
+    {
+        CNetBufferPool pool(1024 * 1024);
+
+        CSerializeData vch;
+        pool.Acquire(vch, 100);
+        ASSERT_TRUE(vch.empty());
+        ASSERT_GE(vch.capacity(), CNetBufferPool::SLAB_SIZES[0]);
+        const char *pBlock = vch.data();
+
+        vch.resize(100);
+        pool.Release(vch);
+        ASSERT_EQ(vch.capacity(), 0);
+        ASSERT_EQ(pool.GetStats().nPooledBytes, CNetBufferPool::SLAB_SIZES[0]);
+
+        // the same heap block comes back, already cleared
+        CSerializeData vch2;
+        pool.Acquire(vch2, 500);
+        ASSERT_TRUE(vch2.empty());
+        ASSERT_EQ(vch2.data(), pBlock);
+
+        CNetBufferPoolStats stats = pool.GetStats();
+        ASSERT_EQ(stats.nAllocated, 1);
+        ASSERT_EQ(stats.nReused, 1);
+        ASSERT_EQ(stats.nPooledBytes, 0);
+    }
+
+    TEST(TestNetBufferPool, picks_slab_by_capacity)
+    {
+        CNetBufferPool pool(64 * 1024 * 1024);
+
+        CSerializeData small, large;
+        pool.Acquire(small, 10);
+        pool.Acquire(large, 300 * 1024);
+        ASSERT_GE(large.capacity(), 300 * 1024);
+        pool.Release(small);
+        pool.Release(large);
+
+        // a request that does not fit the small buffer must not get it
+        CSerializeData vch;
+        pool.Acquire(vch, 200 * 1024);
+        ASSERT_GE(vch.capacity(), 200 * 1024);
+        ASSERT_EQ(pool.GetStats().nReused, 1);
+    }
+
+    TEST(TestNetBufferPool, respects_memory_bound)
+    {
+        CNetBufferPool pool(CNetBufferPool::SLAB_SIZES[0]);
+
+        CSerializeData a, b;
+        pool.Acquire(a, 1);
+        pool.Acquire(b, 1);
+        pool.Release(a);
+        pool.Release(b);
+
+        CNetBufferPoolStats stats = pool.GetStats();
+        ASSERT_EQ(stats.nPooledBytes, CNetBufferPool::SLAB_SIZES[0]);
+        ASSERT_EQ(stats.nDiscarded, 1);
+    }
+
+    TEST(TestNetBufferPool, shared_ref_returns_to_pool)
+    {
+        CNetBufferPool pool(1024 * 1024);
+
+        CSerializeData vch;
+        pool.Acquire(vch, 64);
+        vch.assign(64, 'x');
+        {
+            CSerializeDataRef ref = pool.MakeRef(vch);
+            ASSERT_TRUE(vch.empty());
+            CSerializeDataRef ref2 = ref;
+            ASSERT_EQ(ref2->size(), 64);
+            ASSERT_EQ(pool.GetStats().nPooledBytes, 0);
+        }
+        ASSERT_EQ(pool.GetStats().nPooledBytes, CNetBufferPool::SLAB_SIZES[0]);
+    }
+
+    TEST(TestNetBufferPool, zero_capacity_is_not_pooled)
+    {
+        CNetBufferPool pool(64 * 1024 * 1024);
+
+        CSerializeData large;
+        pool.Acquire(large, 4 * 1024 * 1024);
+        pool.Release(large);
+
+        // neither an empty request nor a small one takes the block buffer
+        CSerializeData vch;
+        pool.Acquire(vch, 0);
+        ASSERT_EQ(vch.capacity(), 0);
+        pool.Acquire(vch, 24);
+        ASSERT_LT(vch.capacity(), CNetBufferPool::SLAB_SIZES[CNetBufferPool::SLAB_COUNT - 1]);
+        ASSERT_EQ(pool.GetStats().nReused, 0);
+    }
+
+    TEST(TestNetBufferPool, moved_from_message_is_empty)
+    {
+        CMessageHeader::MessageStartChars start = {1, 2, 3, 4};
+        CNetMessage msg(start, SER_NETWORK, PROTOCOL_VERSION);
+        msg.in_data = true;
+        msg.hdr.nMessageSize = 8;
+        char data[8] = {0};
+        ASSERT_EQ(msg.readData(data, sizeof(data)), 8);
+        uint32_t n;
+        msg.vRecv >> n;     // leaves a read position behind
+
+        CNetMessage moved(std::move(msg));
+        ASSERT_EQ(moved.vRecv.size(), 4);
+        ASSERT_TRUE(msg.vRecv.empty());
+        ASSERT_EQ(msg.nDataPos, 0);
+
+        CNetMessage assigned(start, SER_NETWORK, PROTOCOL_VERSION);
+        assigned = std::move(moved);
+        ASSERT_EQ(assigned.vRecv.size(), 4);
+        ASSERT_TRUE(moved.vRecv.empty());
+    }
+
+}
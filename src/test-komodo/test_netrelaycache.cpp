@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "netrelaycache.h"
+
+namespace TestNetRelayCache {
+
+    class TestNetRelayCache : public ::testing::Test {};
+
+    static CSerializeDataRef MakeMessage(size_t nSize)
+    {
+        CSerializeData vch(nSize, 'x');
+        return NetBufferPool().MakeRef(vch);
+    }
+
+    TEST(TestNetRelayCache, hit_and_miss)
+    {
+        CRelayWireCache cache(1024 * 1024);
+        uint256 hash = uint256S("01");
+
+        ASSERT_FALSE(cache.Get(RELAYCACHE_BLOCK, hash, 170009));
+        CSerializeDataRef msg = MakeMessage(100);
+        cache.Insert(RELAYCACHE_BLOCK, hash, 170009, msg);
+
+        // same buffer comes back, keyed by type and version as well as hash
+        ASSERT_EQ(cache.Get(RELAYCACHE_BLOCK, hash, 170009), msg);
+        ASSERT_FALSE(cache.Get(RELAYCACHE_TX, hash, 170009));
+        ASSERT_FALSE(cache.Get(RELAYCACHE_BLOCK, hash, 170002));
+        ASSERT_FALSE(cache.Get(RELAYCACHE_DEX | 1, hash, 170009));
+
+        CRelayCacheStats stats = cache.GetStats();
+        ASSERT_EQ(stats.nHits, 1);
+        ASSERT_EQ(stats.nMisses, 4);
+        ASSERT_EQ(stats.nEntries, 1);
+        ASSERT_EQ(stats.nBytes, 100);
+    }
+
+    TEST(TestNetRelayCache, evicts_least_recently_used)
+    {
+        CRelayWireCache cache(1000);
+        uint256 h1 = uint256S("01"), h2 = uint256S("02"), h3 = uint256S("03");
+
+        cache.Insert(RELAYCACHE_TX, h1, 0, MakeMessage(200));
+        cache.Insert(RELAYCACHE_TX, h2, 0, MakeMessage(200));
+        cache.Insert(RELAYCACHE_TX, h3, 0, MakeMessage(200));
+        ASSERT_TRUE(cache.Get(RELAYCACHE_TX, h1, 0));   // h2 is now the oldest
+
+        cache.SetMaxBytes(450);
+        ASSERT_TRUE(cache.Get(RELAYCACHE_TX, h1, 0));
+        ASSERT_FALSE(cache.Get(RELAYCACHE_TX, h2, 0));
+        ASSERT_TRUE(cache.Get(RELAYCACHE_TX, h3, 0));
+        ASSERT_EQ(cache.GetStats().nEvictions, 1);
+        ASSERT_EQ(cache.GetStats().nBytes, 400);
+    }
+
+    TEST(TestNetRelayCache, evicted_buffer_outlives_cache_entry)
+    {
+        CRelayWireCache cache(1000);
+        uint256 hash = uint256S("01");
+
+        CSerializeDataRef queued = MakeMessage(200);
+        cache.Insert(RELAYCACHE_DEX, hash, 0, queued);
+        cache.SetMaxBytes(0);
+        ASSERT_FALSE(cache.Get(RELAYCACHE_DEX, hash, 0));
+        ASSERT_EQ(queued->size(), 200);
+
+        // oversized messages are not cached at all
+        cache.SetMaxBytes(1000);
+        cache.Insert(RELAYCACHE_DEX, hash, 0, MakeMessage(600));
+        ASSERT_EQ(cache.GetStats().nEntries, 0);
+    }
+
+}
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+#include "notificationqueue.h"
+#include "primitives/transaction.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace TestNotificationQueue {
+
+    class TestNotificationQueue : public ::testing::Test {};
+
+    TEST(TestNotificationQueue, bounded_queue_is_fifo_and_bounded)
+    {
+        CBoundedQueue<int> queue(3);
+        EXPECT_EQ(queue.Capacity(), 4);
+
+        for (int i = 0; i < 4; i++)
+            EXPECT_TRUE(queue.TryPush(i));
+        int n = 4;
+        EXPECT_FALSE(queue.TryPush(n));
+        EXPECT_EQ(queue.Size(), 4);
+
+        int out;
+        for (int i = 0; i < 4; i++) {
+            ASSERT_TRUE(queue.TryPop(out));
+            EXPECT_EQ(out, i);
+        }
+        EXPECT_FALSE(queue.TryPop(out));
+
+        // several producers, nothing lost or doubled
+        CBoundedQueue<int> shared(64);
+        const int nThreads = 4, nPerThread = 2000;
+        std::vector<std::thread> producers;
+        for (int t = 0; t < nThreads; t++) {
+            producers.emplace_back([&shared, t] {
+                for (int i = 0; i < nPerThread; i++) {
+                    int value = t * nPerThread + i;
+                    while (!shared.TryPush(value))
+                        std::this_thread::yield();
+                }
+            });
+        }
+        std::vector<int> seen(nThreads * nPerThread, 0);
+        for (int nPopped = 0; nPopped < nThreads * nPerThread; ) {
+            if (shared.TryPop(out)) {
+                seen[out]++;
+                nPopped++;
+            }
+        }
+        for (std::thread& producer : producers)
+            producer.join();
+        for (int count : seen)
+            ASSERT_EQ(count, 1);
+    }
+
+    static CValidationNotification TxNotification()
+    {
+        CValidationNotification notification;
+        notification.type = CValidationNotification::TRANSACTION;
+        notification.tx = std::make_shared<const CTransaction>();
+        return notification;
+    }
+
+    TEST(TestNotificationQueue, policies_when_full)
+    {
+        std::atomic<bool> fRelease(false);
+        std::atomic<int> nHandled(0);
+        CNotificationQueue::Handler handler = [&](const CValidationNotification& notification) {
+            EXPECT_EQ(notification.type, CValidationNotification::TRANSACTION);
+            while (!fRelease)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            nHandled++;
+        };
+
+        int nPushed = 0;
+        {
+            // the handler holds the first notification, two more fill the queue
+            CNotificationQueue queue("testdrop", 2, NOTIFY_QUEUE_DROP, handler);
+            for (int i = 0; i < 10; i++) {
+                CValidationNotification notification = TxNotification();
+                nPushed += queue.Push(notification);
+            }
+            EXPECT_GE(nPushed, 2);
+            EXPECT_LE(nPushed, 3);
+
+            CNotificationQueueStats stats = queue.GetStats();
+            EXPECT_EQ(stats.strPolicy, "drop");
+            EXPECT_EQ(stats.nQueued, nPushed);
+            EXPECT_EQ(stats.nDropped, 10 - nPushed);
+            EXPECT_EQ(stats.nMaxDepth, 2);
+            fRelease = true;
+        }
+        // the destructor dispatched what was queued
+        EXPECT_EQ(nHandled, nPushed);
+
+        fRelease = false;
+        nHandled = 0;
+        {
+            CNotificationQueue queue("testblock", 2, NOTIFY_QUEUE_BLOCK, handler);
+            std::thread release([&fRelease] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                fRelease = true;
+            });
+            for (int i = 0; i < 10; i++) {
+                CValidationNotification notification = TxNotification();
+                EXPECT_TRUE(queue.Push(notification));
+            }
+            release.join();
+
+            CNotificationQueueStats stats = queue.GetStats();
+            EXPECT_EQ(stats.nQueued, 10);
+            EXPECT_EQ(stats.nDropped, 0);
+            EXPECT_GE(stats.nBlocked, 1);
+            EXPECT_GT(stats.nBlockedMicros, 0);
+            EXPECT_EQ(GetNotificationQueueStats().size(), 1);
+        }
+        EXPECT_EQ(nHandled, 10);
+        EXPECT_EQ(GetNotificationQueueStats().size(), 0);
+    }
+
+    // publishes one message per transaction, like hashtx
+    class GapInterface : public CQueuedNotificationInterface
+    {
+    public:
+        std::atomic<bool> fRelease;
+        std::vector<uint64_t> vSequences;
+        uint64_t nSequence;
+
+        GapInterface() : fRelease(false), nSequence(0) {}
+        ~GapInterface() { StopQueue(); }
+
+        bool Start()
+        {
+            std::map<std::string, std::string> args;
+            args["-notifyqueuesize"] = "2";
+            args["-notifyqueuepolicy"] = "drop";
+            return StartQueue("testgap", args);
+        }
+        void Stop() { StopQueue(); }
+        void Notify() { SyncTransaction(CTransaction(), NULL); }
+
+    protected:
+        void Dispatch(const CValidationNotification& notification)
+        {
+            while (!fRelease)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (notification.gap)
+                nSequence += notification.gap->nTransactions;
+            vSequences.push_back(nSequence++);
+        }
+    };
+
+    TEST(TestNotificationQueue, dropped_notifications_leave_a_gap)
+    {
+        GapInterface notifier;
+        ASSERT_TRUE(notifier.Start());
+        for (int i = 0; i < 10; i++)
+            notifier.Notify();
+        notifier.fRelease = true;
+
+        CNotificationQueueStats stats;
+        do {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            std::vector<CNotificationQueueStats> vStats = GetNotificationQueueStats();
+            ASSERT_EQ(vStats.size(), 1);
+            stats = vStats[0];
+        } while (stats.nProcessed < stats.nQueued);
+        ASSERT_GT(stats.nDropped, 0);
+
+        // the next queued notification carries the gap of the dropped ones
+        notifier.Notify();
+        notifier.Stop();
+        ASSERT_EQ(notifier.vSequences.size(), stats.nQueued + 1);
+        EXPECT_EQ(notifier.vSequences.back(), 10);
+        EXPECT_EQ(notifier.vSequences.back() - notifier.vSequences[notifier.vSequences.size() - 2], stats.nDropped + 1);
+    }
+
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "nspvcache.h"
+#include "komodo_nSPV_defs.h"
+
+namespace TestNSPVCache {
+
+    class TestNSPVCache : public ::testing::Test {};
+
+    static std::string Key(uint8_t requestType, uint32_t param)
+    {
+        return CNSPVResponseCache::MakeKey(requestType, (const uint8_t*)&param, sizeof(param));
+    }
+
+    TEST(TestNSPVCache, hit_miss_and_invalidation)
+    {
+        EXPECT_TRUE(CNSPVResponseCache::IsCacheable(NSPV_INFO));
+        EXPECT_TRUE(CNSPVResponseCache::IsCacheable(NSPV_TXPROOF));
+        EXPECT_FALSE(CNSPVResponseCache::IsCacheable(NSPV_UTXOS));
+        EXPECT_FALSE(CNSPVResponseCache::IsCacheable(NSPV_BROADCAST));
+
+        CNSPVResponseCache cache(1024 * 1024);
+        std::vector<uint8_t> response(100, 0x05), out;
+        ASSERT_FALSE(cache.Get(Key(NSPV_NTZS, 10), out));
+
+        cache.Put(Key(NSPV_NTZS, 10), response, cache.GetGeneration());
+        ASSERT_TRUE(cache.Get(Key(NSPV_NTZS, 10), out));
+        EXPECT_EQ(out, response);
+        // keyed by type and parameters
+        EXPECT_FALSE(cache.Get(Key(NSPV_NTZS, 11), out));
+        EXPECT_FALSE(cache.Get(Key(NSPV_INFO, 10), out));
+
+        // a response computed before the tip moved is not stored
+        uint64_t nGeneration = cache.GetGeneration();
+        cache.Clear();
+        EXPECT_FALSE(cache.Get(Key(NSPV_NTZS, 10), out));
+        cache.Put(Key(NSPV_NTZS, 10), response, nGeneration);
+        EXPECT_FALSE(cache.Get(Key(NSPV_NTZS, 10), out));
+
+        CNSPVCacheStats stats = cache.GetStats();
+        EXPECT_EQ(stats.nHits, 1);
+        EXPECT_EQ(stats.nMisses, 5);
+        EXPECT_EQ(stats.nInvalidations, 1);
+        EXPECT_EQ(stats.nEntries, 0);
+        EXPECT_EQ(stats.nBytes, 0);
+    }
+
+    TEST(TestNSPVCache, bounded_and_evicts_least_recently_used)
+    {
+        CNSPVResponseCache cache(5000);
+        uint64_t nGeneration = cache.GetGeneration();
+
+        // more than an eighth of the bound is not kept
+        cache.Put(Key(NSPV_TXPROOF, 1), std::vector<uint8_t>(1000), nGeneration);
+        EXPECT_EQ(cache.GetStats().nEntries, 0);
+
+        for (uint32_t i = 0; i < 10; i++) {
+            cache.Put(Key(NSPV_TXPROOF, i), std::vector<uint8_t>(400), nGeneration);
+            std::vector<uint8_t> out;
+            EXPECT_TRUE(cache.Get(Key(NSPV_TXPROOF, 0), out));  // keep the first one in use
+        }
+        CNSPVCacheStats stats = cache.GetStats();
+        EXPECT_LE(stats.nBytes, stats.nMaxBytes);
+        EXPECT_GT(stats.nEvictions, 0);
+        EXPECT_EQ(stats.nEntries + stats.nEvictions, 10);
+
+        std::vector<uint8_t> out;
+        EXPECT_TRUE(cache.Get(Key(NSPV_TXPROOF, 0), out));
+        EXPECT_FALSE(cache.Get(Key(NSPV_TXPROOF, 1), out));
+        EXPECT_TRUE(cache.Get(Key(NSPV_TXPROOF, 9), out));
+    }
+
+    TEST(TestNSPVCache, request_stats)
+    {
+        ResetNSPVRequestStats();
+        RecordNSPVRequest(NSPV_INFO, 100, false);
+        RecordNSPVRequest(NSPV_INFO, 5, true);
+        RecordNSPVRequest(NSPV_UTXOS, 300, false);
+
+        std::map<uint8_t, CNSPVRequestStats> stats = GetNSPVRequestStats();
+        ASSERT_EQ(stats.size(), 2);
+        EXPECT_EQ(stats[NSPV_INFO].latency.nCount, 2);
+        EXPECT_EQ(stats[NSPV_INFO].nHits, 1);
+        EXPECT_EQ(stats[NSPV_INFO].hitLatency.nMaxMicros, 5);
+        EXPECT_EQ(stats[NSPV_UTXOS].nHits, 0);
+        EXPECT_EQ(NSPVRequestName(NSPV_INFO), "info");
+        EXPECT_EQ(NSPVRequestName(0x42), "0x42");
+
+        ResetNSPVRequestStats();
+        EXPECT_TRUE(GetNSPVRequestStats().empty());
+    }
+
+}
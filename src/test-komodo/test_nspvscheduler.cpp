@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include "nspvscheduler.h"
+#include "komodo_nSPV_defs.h"
+
+#include <algorithm>
+
+namespace TestNSPVScheduler {
+
+    class TestNSPVScheduler : public ::testing::Test {};
+
+    static CNSPVRequest Request(NodeId peer, uint8_t requestType)
+    {
+        CNSPVRequest request;
+        request.peer = peer;
+        request.data.push_back(requestType);
+        request.nCost = NSPVRequestCost(requestType);
+        return request;
+    }
+
+    static CNSPVFairQueue::PushResult Push(CNSPVFairQueue &queue, NodeId peer, uint8_t requestType, int64_t nNow, double dWeight = 1.0)
+    {
+        CNSPVRequest request = Request(peer, requestType);
+        return queue.Push(request, dWeight, nNow);
+    }
+
+    // serve with a single worker, returns the peers in the order they were served
+    static std::vector<NodeId> Serve(CNSPVFairQueue &queue, size_t nCount)
+    {
+        std::vector<NodeId> vServed;
+        CNSPVRequest request;
+        while (vServed.size() < nCount && queue.Pop(request)) {
+            vServed.push_back(request.peer);
+            queue.Done(request.peer);
+        }
+        return vServed;
+    }
+
+    TEST(TestNSPVScheduler, expensive_peer_does_not_starve_others)
+    {
+        EXPECT_GT(NSPVRequestCost(NSPV_CCMODULEUTXOS), NSPVRequestCost(NSPV_TXPROOF));
+        EXPECT_GT(NSPVRequestCost(NSPV_TXIDS), NSPVRequestCost(NSPV_INFO));
+
+        CNSPVFairQueue queue(0, 64);
+        for (int i = 0; i < 10; i++)
+            ASSERT_EQ(Push(queue, 1, NSPV_UTXOS, 1000000), CNSPVFairQueue::QUEUED);
+        for (int i = 0; i < 3; i++)
+            ASSERT_EQ(Push(queue, 2, NSPV_INFO, 1000000), CNSPVFairQueue::QUEUED);
+        EXPECT_EQ(queue.Size(), 13);
+        EXPECT_EQ(queue.PeerCount(), 2);
+
+        // the cheap requests queued last are served before the backlog of the first peer
+        std::vector<NodeId> vServed = Serve(queue, 13);
+        ASSERT_EQ(vServed.size(), 13);
+        EXPECT_EQ(vServed[0], 2);
+        EXPECT_EQ(vServed[1], 2);
+        EXPECT_EQ(vServed[2], 2);
+        EXPECT_EQ(std::count(vServed.begin(), vServed.end(), 1), 10);
+        EXPECT_EQ(queue.Size(), 0);
+
+        // with equal costs a whitelisted peer gets a larger share
+        for (int i = 0; i < 8; i++) {
+            Push(queue, 1, NSPV_TXPROOF, 2000000);
+            Push(queue, 3, NSPV_TXPROOF, 2000000, NSPV_WHITELIST_WEIGHT);
+        }
+        vServed = Serve(queue, 8);
+        EXPECT_GE(std::count(vServed.begin(), vServed.end(), 3), 6);
+    }
+
+    TEST(TestNSPVScheduler, one_request_per_peer_at_a_time)
+    {
+        CNSPVFairQueue queue(0, 64);
+        Push(queue, 1, NSPV_INFO, 1000000);
+        Push(queue, 1, NSPV_NTZS, 1000000);
+
+        CNSPVRequest first, second;
+        ASSERT_TRUE(queue.Pop(first));
+        EXPECT_EQ(first.data[0], NSPV_INFO);
+        EXPECT_FALSE(queue.Pop(second));    // the peer is busy
+        queue.Done(1);
+        ASSERT_TRUE(queue.Pop(second));
+        EXPECT_EQ(second.data[0], NSPV_NTZS);
+        queue.Done(1);
+        EXPECT_FALSE(queue.Pop(second));
+    }
+
+    TEST(TestNSPVScheduler, peer_budget_and_queue_bound)
+    {
+        // 10 units a second, bursts of NSPV_PEER_BUDGET_BURST seconds
+        CNSPVFairQueue queue(10, 64);
+        int64_t nNow = 1000000;
+        ASSERT_EQ(NSPVRequestCost(NSPV_UTXOS), 10);
+        for (int64_t i = 0; i < NSPV_PEER_BUDGET_BURST; i++)
+            EXPECT_EQ(Push(queue, 1, NSPV_UTXOS, nNow), CNSPVFairQueue::QUEUED);
+        EXPECT_EQ(Push(queue, 1, NSPV_UTXOS, nNow), CNSPVFairQueue::OVER_BUDGET);
+        EXPECT_EQ(Push(queue, 2, NSPV_UTXOS, nNow), CNSPVFairQueue::QUEUED);   // other peers have their own
+        EXPECT_EQ(Push(queue, 1, NSPV_UTXOS, nNow + 1000000), CNSPVFairQueue::QUEUED);
+
+        CNSPVFairQueue bounded(0, 2);
+        EXPECT_EQ(Push(bounded, 1, NSPV_INFO, nNow), CNSPVFairQueue::QUEUED);
+        EXPECT_EQ(Push(bounded, 1, NSPV_INFO, nNow), CNSPVFairQueue::QUEUED);
+        EXPECT_EQ(Push(bounded, 1, NSPV_INFO, nNow), CNSPVFairQueue::PEER_QUEUE_FULL);
+
+        std::vector<CNSPVRequest> vRemoved;
+        bounded.Clear(vRemoved);
+        EXPECT_EQ(vRemoved.size(), 2);
+        EXPECT_EQ(bounded.Size(), 0);
+        CNSPVRequest request;
+        EXPECT_FALSE(bounded.Pop(request));
+    }
+
+}
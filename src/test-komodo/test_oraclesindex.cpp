@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "cc/CCinclude.h"
+#include "oraclesindex.h"
+#include "key.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "streams.h"
+#include "clientversion.h"
+#include "txdb.h"
+#include "utilstrencodings.h"
+
+#include <algorithm>
+
+CScript EncodeOraclesData(uint8_t funcid, uint256 oracletxid, uint256 batontxid, CPubKey pk, std::vector<uint8_t> data);
+
+namespace TestOraclesIndex {
+
+    class TestOraclesIndex : public ::testing::Test {};
+
+    template <typename T>
+    static std::string Bytes(const T& obj)
+    {
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << obj;
+        return ss.str();
+    }
+
+    TEST(TestOraclesIndex, keys_sort_newest_first)
+    {
+        uint256 oracletxid = GetRandHash();
+        uint160 baton;
+        baton.SetHex("1234");
+        std::vector<COraclesDataIndexKey> keys;
+        for (int i = 0; i < 200; i++)
+            keys.push_back(COraclesDataIndexKey(oracletxid, baton, (int32_t)GetRand(1000000), GetRandHash()));
+
+        // the db orders the serialized keys bytewise, newest sample first
+        std::vector<COraclesDataIndexKey> sorted(keys);
+        std::sort(sorted.begin(), sorted.end(), [](const COraclesDataIndexKey& a, const COraclesDataIndexKey& b) { return Bytes(a) < Bytes(b); });
+        for (size_t i = 1; i < sorted.size(); i++)
+            ASSERT_GE(sorted[i - 1].blockHeight, sorted[i].blockHeight);
+
+        // a seek to a height lands on the first sample at or below it
+        int32_t height = sorted[100].blockHeight;
+        std::string seek = Bytes(COraclesDataIndexKeyBaton(oracletxid, baton, height));
+        size_t first = std::lower_bound(sorted.begin(), sorted.end(), seek, [](const COraclesDataIndexKey& a, const std::string& s) { return Bytes(a) < s; }) - sorted.begin();
+        ASSERT_LE(sorted[first].blockHeight, height);
+        ASSERT_TRUE(first == 0 || sorted[first - 1].blockHeight > height);
+
+        // the partial key is a prefix of all keys of the publisher
+        std::string prefix = Bytes(COraclesDataIndexKeyBaton(oracletxid, baton));
+        for (const COraclesDataIndexKey& key : keys)
+            ASSERT_EQ(Bytes(key).compare(0, prefix.size(), prefix), 0);
+    }
+
+    TEST(TestOraclesIndex, serialize_roundtrip)
+    {
+        COraclesDataIndexKey key(GetRandHash(), uint160(), 123456, GetRandHash());
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << key;
+        COraclesDataIndexKey key2;
+        ss >> key2;
+        ASSERT_EQ(key2.oracletxid, key.oracletxid);
+        ASSERT_EQ(key2.blockHeight, 123456);
+        ASSERT_EQ(key2.txhash, key.txhash);
+
+        std::vector<uint8_t> data = { 1, 2, 3 };
+        COraclesDataIndexValue sample(CPubKey(ParseHex("02c4d1d5bd4ee8f2a3b9e7f86dd5bb3f4f0a1e6c4bf9c56f1f6a1e8a4e6b3d2c11")), GetRandHash(), data);
+        ss << sample;
+        COraclesDataIndexValue sample2;
+        ss >> sample2;
+        ASSERT_FALSE(sample2.IsNull());
+        ASSERT_EQ(sample2.data, data);
+        ASSERT_TRUE(COraclesDataIndexValue().IsNull());
+    }
+
+    TEST(TestOraclesIndex, connect_disconnect_block)
+    {
+        CBlockTreeDB db(1 << 20, true, true);
+        CKey key;
+        key.MakeNewKey(true);
+        uint256 oracletxid = GetRandHash();
+        std::vector<uint8_t> data = { 4, 5, 6 };
+
+        // a data tx with the baton marker in vout 1, its publisher pubkey does not parse
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout.hash = GetRandHash();
+        mtx.vout.push_back(CTxOut(10000, CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG));
+        mtx.vout.push_back(MakeCC1vout(EVAL_ORACLES, 10000, key.GetPubKey()));
+        mtx.vout.push_back(CTxOut(0, EncodeOraclesData('D', oracletxid, GetRandHash(), CPubKey(), data)));
+        CBlock block;
+        block.vtx.push_back(CTransaction(mtx));
+
+        COraclesDataIndexKey indexKey;
+        COraclesDataIndexValue sample;
+        ASSERT_TRUE(OraclesDataIndexEntry(block.vtx[0], 100, indexKey, sample));
+        ASSERT_FALSE(sample.publisher.IsValid());
+
+        std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue> > vect, samples;
+        OraclesDataIndexBlock(block, 100, true, vect);
+        ASSERT_TRUE(db.UpdateOraclesDataIndex(vect));
+        ASSERT_TRUE(db.ReadOraclesDataIndex(oracletxid, indexKey.batonHash, samples, -1, 1000, 0));
+        ASSERT_EQ(samples.size(), 1);
+        ASSERT_EQ(samples[0].first.txhash, block.vtx[0].GetHash());
+        ASSERT_EQ(samples[0].first.blockHeight, 100);
+        ASSERT_EQ(samples[0].second.data, data);
+
+        vect.clear();
+        samples.clear();
+        OraclesDataIndexBlock(block, 100, false, vect);
+        ASSERT_TRUE(db.UpdateOraclesDataIndex(vect));
+        ASSERT_TRUE(db.ReadOraclesDataIndex(oracletxid, indexKey.batonHash, samples, -1, 1000, 0));
+        ASSERT_EQ(samples.size(), 0);
+    }
+
+}
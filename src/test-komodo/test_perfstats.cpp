@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include "perfstats.h"
+
+#include <thread>
+
+namespace TestPerfStats {
+
+    class TestPerfStats : public ::testing::Test {};
+
+    TEST(TestPerfStats, histogram_percentiles)
+    {
+        CLatencyHistogram hist;
+        for (int i = 0; i < 99; i++)
+            hist.Add(300);
+        hist.Add(5000);
+
+        ASSERT_EQ(hist.nCount, 100);
+        ASSERT_EQ(hist.nTotalMicros, 99 * 300 + 5000);
+        ASSERT_EQ(hist.nMaxMicros, 5000);
+        // 300us falls in [256, 512)
+        ASSERT_EQ(hist.Percentile(50), 512);
+        ASSERT_EQ(hist.Percentile(99), 512);
+        // capped by the largest sample rather than the 8192 bucket bound
+        ASSERT_EQ(hist.Percentile(100), 5000);
+        ASSERT_EQ(CLatencyHistogram().Percentile(50), 0);
+    }
+
+    TEST(TestPerfStats, merges_samples_from_all_threads)
+    {
+        ResetPerfStats();
+        RecordRPCCall("perftest", 10, false);
+        std::thread t([] {
+            RecordRPCCall("perftest", 20, true);
+            RecordRPCBytesOut("perftest", 128);
+        });
+        t.join();
+
+        std::map<std::string, CRPCPerfStats> stats = GetRPCPerfStats();
+        ASSERT_EQ(stats.count("perftest"), 1);
+        ASSERT_EQ(stats["perftest"].latency.nCount, 2);
+        ASSERT_EQ(stats["perftest"].latency.nTotalMicros, 30);
+        ASSERT_EQ(stats["perftest"].nErrors, 1);
+        ASSERT_EQ(stats["perftest"].nBytesOut, 128);
+
+        ResetPerfStats();
+        ASSERT_EQ(GetRPCPerfStats().count("perftest"), 0);
+    }
+
+}
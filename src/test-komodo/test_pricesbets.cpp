@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "cc/CCPrices.h"
+#include "chain.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "utilstrencodings.h"
+
+CScript prices_betopret(CPubKey mypk,int32_t height,int64_t amount,int16_t leverage,int64_t firstprice,std::vector<uint16_t> vec,uint256 tokenid);
+CScript prices_addopret(uint256 bettxid,CPubKey mypk,int64_t amount);
+CScript prices_finalopret(bool isRekt, uint256 bettxid, CPubKey pk, int32_t lastheight, int64_t costbasis, int64_t lastprice, int64_t liquidationprice, int64_t equity, int64_t exitfee, uint32_t nonce);
+
+namespace TestPricesBets {
+
+    class TestPricesBets : public ::testing::Test {};
+
+    static CTransaction OpretTx(const CScript &opret)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout.hash = GetRandHash();
+        mtx.vout.push_back(CTxOut(0, opret));
+        return CTransaction(mtx);
+    }
+
+    // a block index entry at height, enough for the bet tracking
+    struct TestBlock {
+        uint256 hash;
+        CBlockIndex index;
+        CBlock block;
+
+        TestBlock(int32_t height, const CTransaction &tx) : hash(GetRandHash())
+        {
+            index.phashBlock = &hash;
+            index.SetHeight(height);
+            block.vtx.push_back(tx);
+        }
+    };
+
+    TEST(TestPricesBets, disconnected_blocks_are_undone)
+    {
+        CPubKey pk(ParseHex("02aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"));
+        std::vector<uint16_t> vec(1, 1);
+        // the positions count from height 200 on, so nothing is scanned
+        CTransaction bettx = OpretTx(prices_betopret(pk, 200, 1000, 10, 0, vec, uint256()));
+        uint256 bettxid = bettx.GetHash();
+
+        TestBlock opened(100, bettx);
+        TestBlock added(101, OpretTx(prices_addopret(bettxid, pk, 500)));
+        TestBlock closed(102, OpretTx(prices_finalopret(false, bettxid, pk, 102, 0, 0, 0, 0, 0, 0)));
+
+        ASSERT_EQ(PricesTrackedBets(bettxid), -1);
+        PricesBlockConnected(opened.block, &opened.index);
+        ASSERT_EQ(PricesTrackedBets(bettxid), 1);
+        PricesBlockConnected(added.block, &added.index);
+        ASSERT_EQ(PricesTrackedBets(bettxid), 2);
+        PricesBlockConnected(closed.block, &closed.index);
+        ASSERT_EQ(PricesTrackedBets(bettxid), -1);
+
+        // the close is disconnected, the bet is tracked again with its added position
+        PricesBlockDisconnected(closed.block, &closed.index);
+        ASSERT_EQ(PricesTrackedBets(bettxid), 2);
+        PricesBlockDisconnected(added.block, &added.index);
+        ASSERT_EQ(PricesTrackedBets(bettxid), 1);
+        PricesBlockDisconnected(opened.block, &opened.index);
+        ASSERT_EQ(PricesTrackedBets(bettxid), -1);
+
+        // and connected again on the other branch
+        PricesBlockConnected(opened.block, &opened.index);
+        ASSERT_EQ(PricesTrackedBets(bettxid), 1);
+    }
+
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "cc/pricesstore.h"
+#include "random.h"
+#include "util.h"
+
+#include <algorithm>
+
+namespace TestPricesStore {
+
+    class TestPricesStore : public ::testing::Test {};
+
+    TEST(TestPricesStore, range_queries_match_scan)
+    {
+        // sizes around the block size and the sparse table levels
+        const size_t sizes[] = { 1, 31, 32, 33, 64, 100, 1000 };
+        for (size_t n : sizes) {
+            std::vector<int64_t> vals;
+            for (size_t i = 0; i < n; i++)
+                vals.push_back((int64_t)GetRand(1000000) - 500000);
+            CPriceRangeTable table;
+            table.Build(1000, vals);
+            ASSERT_EQ(table.Begin(), 1000);
+            ASSERT_EQ(table.End(), 1000 + (int32_t)n);
+
+            for (int r = 0; r < 500; r++) {
+                int32_t i = (int32_t)GetRand(n), j = (int32_t)GetRand(n);
+                if (i > j)
+                    std::swap(i, j);
+                ASSERT_TRUE(table.Contains(1000 + i, 1000 + j));
+                int64_t sum = 0;
+                for (int32_t k = i; k <= j; k++)
+                    sum += vals[k];
+                ASSERT_EQ(table.Min(1000 + i, 1000 + j), *std::min_element(vals.begin() + i, vals.begin() + j + 1));
+                ASSERT_EQ(table.Max(1000 + i, 1000 + j), *std::max_element(vals.begin() + i, vals.begin() + j + 1));
+                ASSERT_EQ(table.Sum(1000 + i, 1000 + j), sum);
+            }
+            ASSERT_FALSE(table.Contains(999, 1000));
+            ASSERT_FALSE(table.Contains(1000, 1000 + n));
+        }
+    }
+
+    TEST(TestPricesStore, mapped_file_follows_writer)
+    {
+        std::string strPath = (GetTempPath() / ("pricesstore" + GetRandHash().GetHex().substr(0, 8))).string();
+        FILE* fp = fopen(strPath.c_str(), "wb+");
+        ASSERT_TRUE(fp != NULL);
+        int64_t record = 1;
+        fwrite(&record, 1, sizeof(record), fp);
+        fflush(fp);
+
+        CPricesFile view;
+        ASSERT_TRUE(view.Open(strPath));
+        ASSERT_EQ(view.Size(), sizeof(record));
+        int64_t readback = 0;
+        ASSERT_TRUE(view.Read(&readback, 0, sizeof(readback)));
+        ASSERT_EQ(readback, 1);
+        ASSERT_FALSE(view.Read(&readback, 8, sizeof(readback)));
+
+        // grow the file past the mapped reserve
+        std::vector<int64_t> vals(1 << 20);
+        for (size_t i = 0; i < vals.size(); i++)
+            vals[i] = i + 2;
+        fwrite(vals.data(), sizeof(int64_t), vals.size(), fp);
+        fflush(fp);
+        view.Extend((vals.size() + 1) * sizeof(int64_t));
+        ASSERT_TRUE(view.Read(&readback, vals.size() * sizeof(int64_t), sizeof(readback)));
+        ASSERT_EQ(readback, vals.back());
+
+        // records rewritten in place are seen without remapping
+        record = 42;
+        fseek(fp, 0, SEEK_SET);
+        fwrite(&record, 1, sizeof(record), fp);
+        fflush(fp);
+        ASSERT_TRUE(view.Read(&readback, 0, sizeof(readback)));
+        ASSERT_EQ(readback, 42);
+
+        view.Close();
+        ASSERT_FALSE(view.IsOpen());
+        fclose(fp);
+        remove(strPath.c_str());
+    }
+
+}
@@ -155,4 +155,21 @@ namespace TestSHA256Crypto {
             "d7a8fbb307d7809469ca9abcb0082e4f8d5651e46d3cdb762d02d0bf37c9e592");
     }
 
-}
\ No newline at end of file
+    TEST(TestSHA256Crypto, sha256d64) // crypto_tests.cpp
+    {
+        SHA256AutoDetect();
+        for (int i = 0; i <= 32; i++) {
+            unsigned char in[64 * 32];
+            unsigned char out1[32 * 32], out2[32 * 32];
+            for (int j = 0; j < 64 * i; j++)
+                in[j] = insecure_rand() & 0xff;
+            for (int j = 0; j < i; j++) {
+                unsigned char first[32];
+                CSHA256().Write(in + 64 * j, 64).Finalize(first);
+                CSHA256().Write(first, 32).Finalize(out1 + 32 * j);
+            }
+            SHA256D64(out2, in, i);
+            ASSERT_EQ(memcmp(out1, out2, 32 * i), 0) << i << " blocks";
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "key.h"
+#include "script/sigbatch.h"
+#include "utilstrencodings.h"
+#include "cryptoconditions/include/cryptoconditions.h"
+
+#include <secp256k1.h>
+#include <secp256k1_schnorrsig.h>
+
+namespace TestSigBatch {
+
+    class TestSigBatch : public ::testing::Test {};
+
+    std::vector<unsigned char> SignSchnorr(const CKey& key, const uint256& msg)
+    {
+        static secp256k1_context* ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+        secp256k1_schnorrsig sig;
+        std::vector<unsigned char> vchSig(64);
+        EXPECT_TRUE(secp256k1_schnorrsig_sign(ctx, &sig, NULL, msg.begin(), key.begin(), NULL, NULL));
+        secp256k1_schnorrsig_serialize(ctx, vchSig.data(), &sig);
+        return vchSig;
+    }
+
+    void AddSigs(CSignatureBatch& batch, const std::vector<CKey>& keys, int nSigs)
+    {
+        for (int i = 0; i < nSigs; i++) {
+            const CKey& key = keys[i % keys.size()];
+            uint256 hash = uint256S(strprintf("0x%x", i + 1));
+            std::vector<unsigned char> vchSig;
+            ASSERT_TRUE(key.Sign(hash, vchSig));
+            batch.AddECDSA(key.GetPubKey(), vchSig, hash);
+            batch.AddSchnorr(key.GetPubKey().begin(), SignSchnorr(key, hash).data(), hash.begin());
+        }
+    }
+
+    TEST(TestSigBatch, verifies_mixed_batch)
+    {
+        std::vector<CKey> keys(3);
+        for (CKey& key : keys)
+            key.MakeNewKey(true);
+
+        CSignatureBatch batch;
+        AddSigs(batch, keys, 7);
+        ASSERT_EQ(batch.size(), 14);
+
+        std::vector<size_t> vInvalid;
+        ASSERT_TRUE(batch.Verify(&vInvalid));
+        ASSERT_TRUE(vInvalid.empty());
+        ASSERT_TRUE(batch.VerifySequential());
+    }
+
+    TEST(TestSigBatch, reports_invalid_entries)
+    {
+        std::vector<CKey> keys(2);
+        for (CKey& key : keys)
+            key.MakeNewKey(true);
+
+        CSignatureBatch batch;
+        AddSigs(batch, keys, 4);
+
+        // a Schnorr signature over another message and an ECDSA signature by the wrong key
+        uint256 hash = uint256S("0x1"), other = uint256S("0x2");
+        batch.AddSchnorr(keys[0].GetPubKey().begin(), SignSchnorr(keys[0], other).data(), hash.begin());
+        std::vector<unsigned char> vchSig;
+        ASSERT_TRUE(keys[0].Sign(hash, vchSig));
+        batch.AddECDSA(keys[1].GetPubKey(), vchSig, hash);
+
+        std::vector<size_t> vInvalid, vInvalidSequential;
+        ASSERT_FALSE(batch.Verify());
+        ASSERT_FALSE(batch.Verify(&vInvalid));
+        ASSERT_FALSE(batch.VerifySequential(&vInvalidSequential));
+        ASSERT_EQ(vInvalid, std::vector<size_t>({8, 9}));
+        ASSERT_EQ(vInvalid, vInvalidSequential);
+    }
+
+    TEST(TestSigBatch, collects_crypto_condition_nodes)
+    {
+        CKey key1, key2;
+        key1.MakeNewKey(true);
+        key2.MakeNewKey(true);
+        std::string json = "{\"type\":\"threshold-sha-256\",\"threshold\":2,\"subfulfillments\":["
+            "{\"type\":\"secp256k1-sha-256\",\"publicKey\":\"" + HexStr(key1.GetPubKey()) + "\"},"
+            "{\"type\":\"secp256k1-sha-256\",\"publicKey\":\"" + HexStr(key2.GetPubKey()) + "\"}]}";
+        char err[1000] = "";
+        CC* cond = cc_conditionFromJSONString(json.c_str(), err);
+        ASSERT_TRUE(cond != NULL) << err;
+
+        uint256 sighash = uint256S("0xfeed");
+        ASSERT_EQ(cc_signTreeSecp256k1Msg32(cond, key1.begin(), sighash.begin()), 1);
+        ASSERT_EQ(cc_signTreeSecp256k1Msg32(cond, key2.begin(), sighash.begin()), 1);
+
+        CSignatureBatch batch;
+        ASSERT_TRUE(batch.AddCryptoCondition(cond, sighash));
+        ASSERT_EQ(batch.size(), 2);
+        ASSERT_TRUE(batch.Verify());
+
+        CSignatureBatch wrong;
+        ASSERT_TRUE(wrong.AddCryptoCondition(cond, uint256S("0xbeef")));
+        ASSERT_FALSE(wrong.Verify());
+        cc_free(cond);
+    }
+
+}
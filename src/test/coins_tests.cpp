@@ -200,11 +200,11 @@ public:
     void SelfTest() const
     {
         // Manually recompute the dynamic usage of the whole data, and compare it.
-        size_t ret = memusage::DynamicUsage(cacheCoins) +
-                     memusage::DynamicUsage(cacheSproutAnchors) +
-                     memusage::DynamicUsage(cacheSaplingAnchors) +
-                     memusage::DynamicUsage(cacheSproutNullifiers) +
-                     memusage::DynamicUsage(cacheSaplingNullifiers);
+        size_t ret = cacheCoins.DynamicMemoryUsage() +
+                     cacheSproutAnchors.DynamicMemoryUsage() +
+                     cacheSaplingAnchors.DynamicMemoryUsage() +
+                     cacheSproutNullifiers.DynamicMemoryUsage() +
+                     cacheSaplingNullifiers.DynamicMemoryUsage();
         for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
             ret += it->second.coins.DynamicMemoryUsage();
         }
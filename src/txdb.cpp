@@ -27,6 +27,9 @@
 #include "uint256.h"
 #include "core_io.h"
 
+#include <deque>
+#include <future>
+#include <memory>
 #include <stdint.h>
 
 #include <boost/thread.hpp>
@@ -52,6 +55,7 @@ static const char DB_BLOCK_INDEX = 'b';
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_BEST_SPROUT_ANCHOR = 'a';
 static const char DB_BEST_SAPLING_ANCHOR = 'z';
+static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
@@ -59,11 +63,14 @@ static const char DB_LAST_BLOCK = 'l';
 // cc module outputs index with opdrop or opreturn data
 static const char DB_ADDRESSUNSPENT_CC_INDEX = 'O';
 
+// oracles data samples by oracletxid, publisher baton and height
+static const char DB_ORACLESDATA_INDEX = 'o';
 
-CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe) {
+
+CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe), nBatchBytes(nDefaultDbBatchSize) {
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe)
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe), nBatchBytes(nDefaultDbBatchSize)
 {
 }
 
@@ -142,9 +149,16 @@ uint256 CCoinsViewDB::GetBestAnchor(ShieldedType type) const {
     return hashBestAnchor;
 }
 
-void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char& dbChar)
+std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
+    std::vector<uint256> vHashHeadBlocks;
+    if (!db.Read(DB_HEAD_BLOCKS, vHashHeadBlocks))
+        return std::vector<uint256>();
+    return vHashHeadBlocks;
+}
+
+void BatchWriteNullifiers(CDBBatch& batch, const CNullifiersMap& mapToUse, const char& dbChar)
 {
-    for (CNullifiersMap::iterator it = mapToUse.begin(); it != mapToUse.end();) {
+    for (CNullifiersMap::const_iterator it = mapToUse.begin(); it != mapToUse.end(); ++it) {
         if (it->second.flags & CNullifiersCacheEntry::DIRTY) {
             if (!it->second.entered)
                 batch.Erase(make_pair(dbChar, it->first));
@@ -152,15 +166,13 @@ void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char&
                 batch.Write(make_pair(dbChar, it->first), true);
             // TODO: changed++? ... See comment in CCoinsViewDB::BatchWrite. If this is needed we could return an int
         }
-        CNullifiersMap::iterator itOld = it++;
-        mapToUse.erase(itOld);
     }
 }
 
 template<typename Map, typename MapIterator, typename MapEntry, typename Tree>
-void BatchWriteAnchors(CDBBatch& batch, Map& mapToUse, const char& dbChar)
+void BatchWriteAnchors(CDBBatch& batch, const Map& mapToUse, const char& dbChar)
 {
-    for (MapIterator it = mapToUse.begin(); it != mapToUse.end();) {
+    for (MapIterator it = mapToUse.begin(); it != mapToUse.end(); ++it) {
         if (it->second.flags & MapEntry::DIRTY) {
             if (!it->second.entered)
                 batch.Erase(make_pair(dbChar, it->first));
@@ -171,23 +183,22 @@ void BatchWriteAnchors(CDBBatch& batch, Map& mapToUse, const char& dbChar)
             }
             // TODO: changed++?
         }
-        MapIterator itOld = it++;
-        mapToUse.erase(itOld);
     }
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
+bool CCoinsViewDB::WriteFlush(const CCoinsMap &mapCoins,
                               const uint256 &hashBlock,
                               const uint256 &hashSproutAnchor,
                               const uint256 &hashSaplingAnchor,
-                              CAnchorsSproutMap &mapSproutAnchors,
-                              CAnchorsSaplingMap &mapSaplingAnchors,
-                              CNullifiersMap &mapSproutNullifiers,
-                              CNullifiersMap &mapSaplingNullifiers) {
+                              const CAnchorsSproutMap &mapSproutAnchors,
+                              const CAnchorsSaplingMap &mapSaplingAnchors,
+                              const CNullifiersMap &mapSproutNullifiers,
+                              const CNullifiersMap &mapSaplingNullifiers) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    size_t batches = 0;
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); ++it) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             if (it->second.coins.IsPruned())
                 batch.Erase(make_pair(DB_COINS, it->first));
@@ -196,12 +207,31 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (batch.SizeEstimate() > nBatchBytes) {
+            if (batches == 0) {
+                // The best block stays at the pre-flush state until the last batch. A
+                // marker left by an earlier interrupted flush is kept, recovery has to
+                // go back to the best block that one recorded.
+                std::vector<uint256> vHashHeadBlocks = GetHeadBlocks();
+                if (vHashHeadBlocks.empty()) {
+                    vHashHeadBlocks.push_back(hashBlock);
+                    vHashHeadBlocks.push_back(GetBestBlock());
+                    CDBBatch marker(db);
+                    marker.Write(DB_HEAD_BLOCKS, vHashHeadBlocks);
+                    if (!db.WriteBatch(marker))
+                        return false;
+                }
+            }
+            LogPrint("coindb", "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+            batches++;
+        }
     }
 
-    ::BatchWriteAnchors<CAnchorsSproutMap, CAnchorsSproutMap::iterator, CAnchorsSproutCacheEntry, SproutMerkleTree>(batch, mapSproutAnchors, DB_SPROUT_ANCHOR);
-    ::BatchWriteAnchors<CAnchorsSaplingMap, CAnchorsSaplingMap::iterator, CAnchorsSaplingCacheEntry, SaplingMerkleTree>(batch, mapSaplingAnchors, DB_SAPLING_ANCHOR);
+    ::BatchWriteAnchors<CAnchorsSproutMap, CAnchorsSproutMap::const_iterator, CAnchorsSproutCacheEntry, SproutMerkleTree>(batch, mapSproutAnchors, DB_SPROUT_ANCHOR);
+    ::BatchWriteAnchors<CAnchorsSaplingMap, CAnchorsSaplingMap::const_iterator, CAnchorsSaplingCacheEntry, SaplingMerkleTree>(batch, mapSaplingAnchors, DB_SAPLING_ANCHOR);
 
     ::BatchWriteNullifiers(batch, mapSproutNullifiers, DB_NULLIFIER);
     ::BatchWriteNullifiers(batch, mapSaplingNullifiers, DB_SAPLING_NULLIFIER);
@@ -212,11 +242,29 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
         batch.Write(DB_BEST_SPROUT_ANCHOR, hashSproutAnchor);
     if (!hashSaplingAnchor.IsNull())
         batch.Write(DB_BEST_SAPLING_ANCHOR, hashSaplingAnchor);
+    batch.Erase(DB_HEAD_BLOCKS);
 
-    LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
+    LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database in %u batches...\n", (unsigned int)changed, (unsigned int)count, (unsigned int)batches + 1);
     return db.WriteBatch(batch);
 }
 
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
+                              const uint256 &hashBlock,
+                              const uint256 &hashSproutAnchor,
+                              const uint256 &hashSaplingAnchor,
+                              CAnchorsSproutMap &mapSproutAnchors,
+                              CAnchorsSaplingMap &mapSaplingAnchors,
+                              CNullifiersMap &mapSproutNullifiers,
+                              CNullifiersMap &mapSaplingNullifiers) {
+    bool fOk = WriteFlush(mapCoins, hashBlock, hashSproutAnchor, hashSaplingAnchor, mapSproutAnchors, mapSaplingAnchors, mapSproutNullifiers, mapSaplingNullifiers);
+    mapCoins.clear();
+    mapSproutAnchors.clear();
+    mapSaplingAnchors.clear();
+    mapSproutNullifiers.clear();
+    mapSaplingNullifiers.clear();
+    return fOk;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, compression, maxOpenFiles) {
 }
 
@@ -293,11 +341,23 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     }
     batch.Write(DB_LAST_BLOCK, nLastFile);
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
-        batch.Write(make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
+        CDiskBlockIndex diskindex(*it);
+        if (diskindex.nSolution.empty()) {
+            // trimmed from memory, carry over the solution already on disk
+            CDiskBlockIndex stored;
+            if (!ReadDiskBlockIndex((*it)->GetBlockHash(), stored))
+                return error("%s: missing stored solution for %s", __func__, (*it)->GetBlockHash().ToString());
+            diskindex.nSolution = stored.nSolution;
+        }
+        batch.Write(make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), diskindex);
     }
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::ReadDiskBlockIndex(const uint256 &blockhash, CDiskBlockIndex &dbindex) {
+    return Read(make_pair(DB_BLOCK_INDEX, blockhash), dbindex);
+}
+
 bool CBlockTreeDB::EraseBatchSync(const std::vector<const CBlockIndex*>& blockinfo) {
     CDBBatch batch(*this);
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
@@ -688,62 +748,145 @@ bool CBlockTreeDB::blockOnchainActive(const uint256 &hash) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts()
+namespace {
+
+/** Number of block index entries handed to a worker at a time by LoadBlockIndexGuts. */
+static const size_t BLOCK_INDEX_LOAD_BATCH = 4096;
+
+/** Block index entries scanned from disk but not yet linked into the block map. */
+struct CBlockIndexLoadBatch
+{
+    std::vector<uint256> vHash;                 // database keys
+    std::vector<CDataStream> vValue;            // serialized CDiskBlockIndex, released once decoded
+    std::vector<CDiskBlockIndex> vDiskIndex;
+    std::string strError;
+};
+
+/**
+ * Deserialize a batch and check that every header hashes to the key it is stored under.
+ * This is the expensive part of the load: a header hash covers the whole Equihash solution.
+ */
+bool DecodeBlockIndexBatch(CBlockIndexLoadBatch& batch)
+{
+    batch.vDiskIndex.resize(batch.vValue.size());
+    for (size_t i = 0; i < batch.vValue.size(); i++) {
+        CDiskBlockIndex& diskindex = batch.vDiskIndex[i];
+        try {
+            batch.vValue[i] >> diskindex;
+        } catch (const std::exception& e) {
+            batch.strError = "failed to read value";
+            return false;
+        }
+        batch.vValue[i].clear();
+        if (diskindex.GetBlockHash() != batch.vHash[i]) {
+            batch.strError = strprintf("block header inconsistency detected: key = %s, on-disk = %s",
+                                       batch.vHash[i].ToString(), diskindex.ToString());
+            return false;
+        }
+        std::vector<unsigned char>().swap(diskindex.nSolution);
+    }
+    std::vector<CDataStream>().swap(batch.vValue);
+    return true;
+}
+
+/** Create the CBlockIndex objects of a decoded batch, in disk order. */
+void LinkBlockIndexBatch(const CBlockIndexLoadBatch& batch, const std::function<CBlockIndex*(const uint256&)>& insertBlockIndex)
 {
+    for (size_t i = 0; i < batch.vDiskIndex.size(); i++) {
+        const CDiskBlockIndex& diskindex = batch.vDiskIndex[i];
+        // Construct block index object
+        CBlockIndex* pindexNew = insertBlockIndex(batch.vHash[i]);
+        pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+        pindexNew->SetHeight(diskindex.GetHeight());
+        pindexNew->nFile          = diskindex.nFile;
+        pindexNew->nDataPos       = diskindex.nDataPos;
+        pindexNew->nUndoPos       = diskindex.nUndoPos;
+        pindexNew->hashSproutAnchor     = diskindex.hashSproutAnchor;
+        pindexNew->nVersion       = diskindex.nVersion;
+        pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+        pindexNew->hashFinalSaplingRoot   = diskindex.hashFinalSaplingRoot;
+        pindexNew->nTime          = diskindex.nTime;
+        pindexNew->nBits          = diskindex.nBits;
+        pindexNew->nNonce         = diskindex.nNonce;
+        // nSolution stays on disk, see CBlockIndex::GetSolution
+        pindexNew->nStatus        = diskindex.nStatus;
+        pindexNew->nCachedBranchId = diskindex.nCachedBranchId;
+        pindexNew->nTx            = diskindex.nTx;
+        pindexNew->nSproutValue   = diskindex.nSproutValue;
+        pindexNew->nSaplingValue  = diskindex.nSaplingValue;
+        pindexNew->segid          = diskindex.segid;
+        pindexNew->nNotaryPay     = diskindex.nNotaryPay;
+    }
+}
+
+} // anon namespace
+
+bool CBlockTreeDB::LoadBlockIndexGuts(std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nThreads)
+{
+    if (nThreads <= 0)
+        nThreads = GetNumCores();
+
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(make_pair(DB_BLOCK_INDEX, uint256()));
 
+    // Phase one scans the database sequentially and hands batches of raw entries to
+    // workers; phase two links each decoded batch into the block map on this thread,
+    // oldest first, so the map is only ever touched by one thread. At most nThreads
+    // batches are in flight, which bounds the memory held by undecoded entries.
+    std::deque<std::pair<std::unique_ptr<CBlockIndexLoadBatch>, std::future<bool> > > inflight;
+    std::unique_ptr<CBlockIndexLoadBatch> batch(new CBlockIndexLoadBatch());
+
+    auto finishOldest = [&]() -> bool {
+        bool fOk = inflight.front().second.get();
+        std::unique_ptr<CBlockIndexLoadBatch> done(std::move(inflight.front().first));
+        inflight.pop_front();
+        if (!fOk)
+            return error("LoadBlockIndex(): %s", done->strError);
+        LinkBlockIndexBatch(*done, insertBlockIndex);
+        return true;
+    };
+    auto dispatch = [&]() -> bool {
+        if (nThreads <= 1) {
+            if (!DecodeBlockIndexBatch(*batch))
+                return error("LoadBlockIndex(): %s", batch->strError);
+            LinkBlockIndexBatch(*batch, insertBlockIndex);
+            batch.reset(new CBlockIndexLoadBatch());
+            return true;
+        }
+        while (inflight.size() >= (size_t)nThreads) {
+            if (!finishOldest())
+                return false;
+        }
+        CBlockIndexLoadBatch* pbatch = batch.get();
+        std::future<bool> result = std::async(std::launch::async, [pbatch]() { return DecodeBlockIndexBatch(*pbatch); });
+        inflight.push_back(std::make_pair(std::move(batch), std::move(result)));
+        batch.reset(new CBlockIndexLoadBatch());
+        return true;
+    };
+
     // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char, uint256> key;
         if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = InsertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = InsertBlockIndex(diskindex.hashPrev);
-                pindexNew->SetHeight(diskindex.GetHeight());
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->hashSproutAnchor     = diskindex.hashSproutAnchor;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->hashFinalSaplingRoot   = diskindex.hashFinalSaplingRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nSolution      = diskindex.nSolution;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nCachedBranchId = diskindex.nCachedBranchId;
-                pindexNew->nTx            = diskindex.nTx;
-                pindexNew->nSproutValue   = diskindex.nSproutValue;
-                pindexNew->nSaplingValue  = diskindex.nSaplingValue;
-                pindexNew->segid          = diskindex.segid;
-                pindexNew->nNotaryPay     = diskindex.nNotaryPay;
-//fprintf(stderr,"loadguts ht.%d\n",pindexNew->GetHeight());
-                // Consistency checks
-                auto header = pindexNew->GetBlockHeader();
-                if (header.GetHash() != pindexNew->GetBlockHash())
-                    return error("LoadBlockIndex(): block header inconsistency detected: on-disk = %s, in-memory = %s",
-                                 diskindex.ToString(),  pindexNew->ToString());
-                if ( 0 ) // POW will be checked before any block is connected
-                {
-                    uint8_t pubkey33[33];
-                    komodo_index2pubkey33(pubkey33,pindexNew,pindexNew->GetHeight());
-                    if (!CheckProofOfWork(header,pubkey33,pindexNew->GetHeight(),Params().GetConsensus()))
-                        return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
-                }
-                pcursor->Next();
-            } else {
+            batch->vValue.push_back(CDataStream(SER_DISK, CLIENT_VERSION));
+            if (!pcursor->GetValueDataStream(batch->vValue.back()))
                 return error("LoadBlockIndex() : failed to read value");
-            }
+            batch->vHash.push_back(key.second);
+            if (batch->vHash.size() >= BLOCK_INDEX_LOAD_BATCH && !dispatch())
+                return false;
+            pcursor->Next();
         } else {
             break;
         }
     }
+    if (!batch->vHash.empty() && !dispatch())
+        return false;
+    while (!inflight.empty()) {
+        if (!finishOldest())
+            return false;
+    }
 
     return true;
 }
@@ -804,3 +947,54 @@ bool CBlockTreeDB::ReadUnspentCCIndex(uint160 addressHash, uint256 creationid,
     }
     return true;
 }
+
+// write or erase oracles data samples
+bool CBlockTreeDB::UpdateOraclesDataIndex(const std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue > >&vect) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(make_pair(DB_ORACLESDATA_INDEX, it->first));
+        } else {
+            batch.Write(make_pair(DB_ORACLESDATA_INDEX, it->first), it->second);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+// read the samples of a publisher newest first, from endHeight down to beginHeight (-1 for no limit)
+bool CBlockTreeDB::ReadOraclesDataIndex(uint256 oracletxid, uint160 batonHash,
+                                           std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue> > &samples, int32_t beginHeight, int32_t endHeight, int64_t maxSamples) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_ORACLESDATA_INDEX, COraclesDataIndexKeyBaton(oracletxid, batonHash, endHeight)));
+
+    int64_t n = 0;
+    while (pcursor->Valid() && (maxSamples <= 0 || n < maxSamples)) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, COraclesDataIndexKey> keyObj;
+            pcursor->GetKey(keyObj);
+            char chType = keyObj.first;
+            const COraclesDataIndexKey &indexKey = keyObj.second;
+
+            if (chType == DB_ORACLESDATA_INDEX && indexKey.oracletxid == oracletxid && indexKey.batonHash == batonHash && (beginHeight < 0 || indexKey.blockHeight >= beginHeight)) {
+                try {
+                    COraclesDataIndexValue sample;
+                    pcursor->GetValue(sample);
+                    samples.push_back(make_pair(indexKey, sample));
+                    n ++;
+                    pcursor->Next();
+                } catch (const std::exception& e) {
+                    return error("failed to get oracles data index value");
+                }
+            }
+            else {
+                break;
+            }
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
@@ -23,8 +23,10 @@
 
 #include "coins.h"
 #include "dbwrapper.h"
+#include "oraclesindex.h"
 #include "unspentccindex.h"
 
+#include <functional>
 #include <map>
 #include <string>
 #include <utility>
@@ -33,6 +35,7 @@
 
 class CBlockFileInfo;
 class CBlockIndex;
+class CDiskBlockIndex;
 struct CDiskTxPos;
 struct CAddressUnspentKey;
 struct CAddressUnspentValue;
@@ -53,16 +56,47 @@ static const int64_t nDefaultDbCache = 450;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! -dbbatchsize default (bytes)
+static const int64_t nDefaultDbBatchSize = 16 << 20;
 
 /** CCoinsView backed by the coin database (chainstate/) */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
+    size_t nBatchBytes;
     CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
+    //! Target size of the LevelDB batches a flush is split into, see WriteFlush
+    void SetBatchSize(size_t nBytes) { nBatchBytes = nBytes; }
+
+    /**
+     * Returns the (new best block, previous best block) pair recorded by a
+     * flush that did not finish, or an empty vector if the last flush completed.
+     */
+    std::vector<uint256> GetHeadBlocks() const;
+
+    /**
+     * Write the dirty entries of a flushed cache without modifying the maps.
+     *
+     * Coins are written in batches of about nBatchBytes. When more than one
+     * batch is needed the first one also records DB_HEAD_BLOCKS; the last batch
+     * carries the anchors, nullifiers and the best block and anchor markers, and
+     * erases DB_HEAD_BLOCKS again. Until then the best block on disk is the one
+     * from before the flush, and RecoverInterruptedCoinsFlush can put the coins
+     * written so far back to it.
+     */
+    bool WriteFlush(const CCoinsMap &mapCoins,
+                    const uint256 &hashBlock,
+                    const uint256 &hashSproutAnchor,
+                    const uint256 &hashSaplingAnchor,
+                    const CAnchorsSproutMap &mapSproutAnchors,
+                    const CAnchorsSaplingMap &mapSaplingAnchors,
+                    const CNullifiersMap &mapSproutNullifiers,
+                    const CNullifiersMap &mapSaplingNullifiers);
+
     bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
     bool GetNullifier(const uint256 &nf, ShieldedType type) const;
@@ -90,6 +124,7 @@ private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
 public:
+    bool ReadDiskBlockIndex(const uint256 &blockhash, CDiskBlockIndex &dbindex);
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
     bool EraseBatchSync(const std::vector<const CBlockIndex*>& blockinfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &fileinfo);
@@ -114,7 +149,13 @@ public:
     bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts();
+    /**
+     * Load all block index entries, creating/looking up CBlockIndex objects through insertBlockIndex.
+     * Entries are scanned sequentially and deserialized and hash-checked on nThreads
+     * workers (0 = one per core) before being linked in disk order on the calling thread.
+     * Equihash solutions are verified but left on disk, see CBlockIndex::GetSolution.
+     */
+    bool LoadBlockIndexGuts(std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nThreads = 0);
     bool blockOnchainActive(const uint256 &hash);
     UniValue Snapshot(int top);
     bool Snapshot2(std::map <std::string, CAmount> &addressAmounts, UniValue *ret);
@@ -122,6 +163,10 @@ public:
     bool UpdateUnspentCCIndex(const std::vector<std::pair<CUnspentCCIndexKey, CUnspentCCIndexValue > >&vect);
     bool ReadUnspentCCIndex(uint160 addressHash, uint256 creationid,
                                  std::vector<std::pair<CUnspentCCIndexKey, CUnspentCCIndexValue> > &vect, int32_t beginHeight, int32_t endHeight, int64_t maxOutputs);
+
+    bool UpdateOraclesDataIndex(const std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue > >&vect);
+    bool ReadOraclesDataIndex(uint256 oracletxid, uint160 batonHash,
+                                 std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue> > &vect, int32_t beginHeight, int32_t endHeight, int64_t maxSamples);
 };
 
 #endif // BITCOIN_TXDB_H
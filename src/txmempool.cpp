@@ -400,6 +400,44 @@ bool CTxMemPool::getUnspentCCIndex(const std::vector<std::pair<uint160, uint256>
     return true;
 }
 
+// add the sample of an oracles data tx, at the height the tx would be mined at
+void CTxMemPool::addOraclesDataIndex(const CTxMemPoolEntry &entry)
+{
+    LOCK(cs);
+    const CTransaction& tx = entry.GetTx();
+    COraclesDataIndexKey key;
+    COraclesDataIndexValue sample;
+
+    if (mapOraclesDataInserted.count(tx.GetHash()) == 0 && OraclesDataIndexEntry(tx, entry.GetHeight() + 1, key, sample)) {
+        mapOraclesData.insert(make_pair(key, sample));
+        mapOraclesDataInserted.insert(make_pair(tx.GetHash(), key));
+    }
+}
+
+// finds the mempool samples of a publisher baton, newest first
+bool CTxMemPool::getOraclesDataIndex(uint256 oracletxid, uint160 batonHash, std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue> > &samples)
+{
+    LOCK(cs);
+    mapOraclesDataIndexType::iterator it = mapOraclesData.lower_bound(COraclesDataIndexKey(oracletxid, batonHash, std::numeric_limits<int32_t>::max(), zeroid));
+    while (it != mapOraclesData.end() && it->first.oracletxid == oracletxid && it->first.batonHash == batonHash) {
+        samples.push_back(*it);
+        it++;
+    }
+    return true;
+}
+
+bool CTxMemPool::removeOraclesDataIndex(const uint256 txhash)
+{
+    LOCK(cs);
+    mapOraclesDataInsertedType::iterator it = mapOraclesDataInserted.find(txhash);
+
+    if (it != mapOraclesDataInserted.end()) {
+        mapOraclesData.erase(it->second);
+        mapOraclesDataInserted.erase(it);
+    }
+    return true;
+}
+
 // erase tx unspent entry and restore previous as unspents
 bool CTxMemPool::removeUnspentCCIndex(const CTransaction &tx)
 {
@@ -544,6 +582,7 @@ void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& rem
             removeAddressIndex(hash);
             removeSpentIndex(hash);
             removeUnspentCCIndex(txCopy);  // erase cc index entry if present
+            removeOraclesDataIndex(hash);
         }
     }
 }
@@ -748,6 +787,8 @@ void CTxMemPool::clear()
     LOCK(cs);
     mapTx.clear();
     mapNextTx.clear();
+    mapOraclesData.clear();
+    mapOraclesDataInserted.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     ++nTransactionsUpdated;
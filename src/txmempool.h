@@ -30,6 +30,7 @@
 #include "primitives/transaction.h"
 #include "sync.h"
 
+#include "oraclesindex.h"
 #include "unspentccindex.h"
 
 #undef foreach
@@ -195,6 +196,12 @@ private:
     typedef std::map<uint256, std::vector<CUnspentCCIndexKey> > mapUnspentCCIndexInsertedType;
     mapUnspentCCIndexInsertedType mapUnspentCCIndexInserted;
 
+    typedef std::map<COraclesDataIndexKey, COraclesDataIndexValue, COraclesDataIndexKeyCompare> mapOraclesDataIndexType;
+    mapOraclesDataIndexType mapOraclesData;
+
+    typedef std::map<uint256, COraclesDataIndexKey> mapOraclesDataInsertedType;
+    mapOraclesDataInsertedType mapOraclesDataInserted;
+
 public:
     std::map<COutPoint, CInPoint> mapNextTx;
     std::map<uint256, std::pair<double, CAmount> > mapDeltas;
@@ -226,6 +233,11 @@ public:
     bool getUnspentCCIndex(const std::vector<std::pair<uint160, uint256> > &keys, std::vector<std::pair<CUnspentCCIndexKey, CUnspentCCIndexValue> > &outputs);
     bool removeUnspentCCIndex(const CTransaction &tx);
 
+    // oracles data index support, samples in the mempool:
+    void addOraclesDataIndex(const CTxMemPoolEntry &entry);
+    bool getOraclesDataIndex(uint256 oracletxid, uint160 batonHash, std::vector<std::pair<COraclesDataIndexKey, COraclesDataIndexValue> > &samples);
+    bool removeOraclesDataIndex(const uint256 txhash);
+
     void remove(const CTransaction &tx, std::list<CTransaction>& removed, bool fRecursive = false);
     void removeWithAnchor(const uint256 &invalidRoot, ShieldedType type);
     void removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMemPoolHeight, int flags);
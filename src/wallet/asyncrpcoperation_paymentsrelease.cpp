@@ -0,0 +1,113 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "asyncrpcoperation_paymentsrelease.h"
+
+#include "main.h"
+#include "rpc/protocol.h"
+#include "util.h"
+#include "wallet.h"
+
+#include <string>
+
+AsyncRPCOperation_paymentsrelease::AsyncRPCOperation_paymentsrelease(std::string jsonstr, UniValue contextInfo) :
+        jsonstr_(jsonstr), contextinfo_(contextInfo)
+{
+    LogPrint("zrpc", "%s: paymentsrelease initialized\n", getId());
+}
+
+AsyncRPCOperation_paymentsrelease::~AsyncRPCOperation_paymentsrelease() {
+}
+
+void AsyncRPCOperation_paymentsrelease::main() {
+    if (isCancelled())
+        return;
+
+    set_state(OperationStatus::EXECUTING);
+    start_execution_clock();
+
+    bool success = false;
+
+    try {
+        success = main_impl();
+    } catch (const UniValue& objError) {
+        int code = find_value(objError, "code").get_int();
+        std::string message = find_value(objError, "message").get_str();
+        set_error_code(code);
+        set_error_message(message);
+    } catch (const std::runtime_error& e) {
+        set_error_code(-1);
+        set_error_message("runtime error: " + std::string(e.what()));
+    } catch (const std::logic_error& e) {
+        set_error_code(-1);
+        set_error_message("logic error: " + std::string(e.what()));
+    } catch (const std::exception& e) {
+        set_error_code(-1);
+        set_error_message("general exception: " + std::string(e.what()));
+    } catch (...) {
+        set_error_code(-2);
+        set_error_message("unknown error");
+    }
+
+    stop_execution_clock();
+
+    if (success) {
+        set_state(OperationStatus::SUCCESS);
+    } else {
+        set_state(OperationStatus::FAILED);
+    }
+
+    std::string s = strprintf("%s: paymentsrelease finished (status=%s", getId(), getStateAsString());
+    if (success) {
+        s += strprintf(", txid=%s)\n", find_value(getResult(), "txid").get_str());
+    } else {
+        s += strprintf(", error=%s)\n", getErrorMessage());
+    }
+    LogPrintf("%s",s);
+}
+
+bool AsyncRPCOperation_paymentsrelease::main_impl() {
+    struct CCcontract_info *cp, C;
+    UniValue result;
+    {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+        cp = CCinit(&C, EVAL_PAYMENTS);
+        result = PaymentsRelease(cp, (char *)jsonstr_.c_str(), &progress_);
+    }
+    const UniValue& status = find_value(result, "result");
+    if (!status.isStr() || status.get_str() != "success") {
+        const UniValue& error = find_value(result, "error");
+        throw JSONRPCError(RPC_WALLET_ERROR, error.isStr() ? error.get_str() : "payments release failed");
+    }
+    set_result(result);
+    return true;
+}
+
+UniValue AsyncRPCOperation_paymentsrelease::getStatus() const {
+    static const char *stages[] = { "allocations", "shares", "inputs", "signing" };
+    UniValue v = AsyncRPCOperation::getStatus();
+    UniValue obj = v.get_obj();
+    obj.push_back(Pair("method", "paymentsreleaseasync"));
+    if (!contextinfo_.isNull())
+        obj.push_back(Pair("params", contextinfo_));
+    if (getState() == OperationStatus::EXECUTING) {
+        UniValue progress(UniValue::VOBJ);
+        progress.push_back(Pair("stage", stages[progress_.nStage.load()]));
+        progress.push_back(Pair("recipients", progress_.nRecipients.load()));
+        progress.push_back(Pair("shares", progress_.nShares.load()));
+        obj.push_back(Pair("progress", progress));
+    }
+    return obj;
+}
@@ -0,0 +1,52 @@
+/******************************************************************************
+ * Copyright © 2014-2022 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef ASYNCRPCOPERATION_PAYMENTSRELEASE_H
+#define ASYNCRPCOPERATION_PAYMENTSRELEASE_H
+
+#include "asyncrpcoperation.h"
+#include "cc/CCPayments.h"
+
+#include <univalue.h>
+
+/**
+ * Runs a payments release in the background, for snapshot plans paying thousands of addresses.
+ * The release holds cs_main while it runs, so the address snapshot it pays stays consistent.
+ * getStatus() reports the stage and the number of shares computed so far.
+ */
+class AsyncRPCOperation_paymentsrelease : public AsyncRPCOperation {
+public:
+    AsyncRPCOperation_paymentsrelease(std::string jsonstr, UniValue contextInfo = NullUniValue);
+    virtual ~AsyncRPCOperation_paymentsrelease();
+
+    // We don't want to be copied or moved around
+    AsyncRPCOperation_paymentsrelease(AsyncRPCOperation_paymentsrelease const&) = delete;             // Copy construct
+    AsyncRPCOperation_paymentsrelease(AsyncRPCOperation_paymentsrelease&&) = delete;                  // Move construct
+    AsyncRPCOperation_paymentsrelease& operator=(AsyncRPCOperation_paymentsrelease const&) = delete;  // Copy assign
+    AsyncRPCOperation_paymentsrelease& operator=(AsyncRPCOperation_paymentsrelease &&) = delete;      // Move assign
+
+    virtual void main();
+
+    virtual UniValue getStatus() const;
+
+private:
+    std::string jsonstr_;
+    UniValue contextinfo_;     // optional data to include in return value from getStatus()
+    PaymentsReleaseProgress progress_;
+
+    bool main_impl();
+};
+
+#endif /* ASYNCRPCOPERATION_PAYMENTSRELEASE_H */
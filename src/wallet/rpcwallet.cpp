@@ -29,6 +29,7 @@
 #include "rpc/server.h"
 #include "timedata.h"
 #include "transaction_builder.h"
+#include "txdb.h"
 #include "util.h"
 #include "utilmoneystr.h"
 #include "wallet.h"
@@ -46,6 +47,7 @@
 #include "wallet/asyncrpcoperation_mergetoaddress.h"
 #include "wallet/asyncrpcoperation_sendmany.h"
 #include "wallet/asyncrpcoperation_shieldcoinbase.h"
+#include "wallet/asyncrpcoperation_paymentsrelease.h"
 
 #include "consensus/upgrades.h"
 
@@ -3389,8 +3391,44 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp, const CPubKey& mypk)
                 sample_times.insert(sample_times.end(), vals.begin(), vals.end());
             }
 #endif
-        } else if (benchmarktype == "verifyequihash") {
-            sample_times.push_back(benchmark_verify_equihash());
+        } else if (benchmarktype == "verifyequihash" || benchmarktype == "verifyequihashsequential") {
+            // With a header count, measure the throughput of a batch of headers
+            if (benchmarktype == "verifyequihash" && params.size() < 3) {
+                sample_times.push_back(benchmark_verify_equihash());
+            } else {
+                int nHeaders = 160;
+                if (params.size() >= 3) {
+                    nHeaders = params[2].get_int();
+                }
+                if (nHeaders <= 0) {
+                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid header count");
+                }
+                sample_times.push_back(benchmark_verify_equihash_batch(nHeaders, benchmarktype == "verifyequihash"));
+            }
+        } else if (benchmarktype == "verifysigbatch" || benchmarktype == "verifysigsequential") {
+            // Number of signatures and their kind, "schnorr" or "ecdsa"
+            int nSigs = 64;
+            std::string strKind = "schnorr";
+            if (params.size() >= 3) {
+                nSigs = params[2].get_int();
+            }
+            if (params.size() >= 4) {
+                strKind = params[3].get_str();
+            }
+            if (nSigs <= 0 || (strKind != "schnorr" && strKind != "ecdsa")) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid signature count or kind");
+            }
+            sample_times.push_back(benchmark_verify_sigbatch(nSigs, strKind == "schnorr", benchmarktype == "verifysigbatch"));
+        } else if (benchmarktype == "merkleroot" || benchmarktype == "merklerootsequential") {
+            // Number of leaves, roughly the transactions of a large block by default
+            int nLeaves = 4096;
+            if (params.size() >= 3) {
+                nLeaves = params[2].get_int();
+            }
+            if (nLeaves <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid leaf count");
+            }
+            sample_times.push_back(benchmark_merkle_root(nLeaves, benchmarktype == "merkleroot"));
         } else if (benchmarktype == "validatelargetx") {
             // Number of inputs in the spending transaction that we will simulate
             int nInputs = 11130;
@@ -3404,6 +3442,39 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp, const CPubKey& mypk)
         } else if (benchmarktype == "incnotewitnesses") {
             int nTxs = params[2].get_int();
             sample_times.push_back(benchmark_increment_note_witnesses(nTxs));
+        } else if (benchmarktype == "loadblockindex") {
+            // Number of synthetic block index entries and loader threads (0 = one per core)
+            int nBlocks = 100000;
+            int nThreads = 0;
+            if (params.size() >= 3) {
+                nBlocks = params[2].get_int();
+            }
+            if (params.size() >= 4) {
+                nThreads = params[3].get_int();
+            }
+            if (nBlocks <= 0 || nThreads < 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block or thread count");
+            }
+            sample_times.push_back(benchmark_load_block_index(nBlocks, nThreads));
+        } else if (benchmarktype == "replaycoins") {
+            // Replays the UTXO changes of active chain blocks [startheight, startheight + blocks)
+            // read from the local block files, flushing at the given cache size in MiB
+            int nStartHeight = 1;
+            int nBlocks = 1000;
+            int nCacheMB = nDefaultDbCache;
+            if (params.size() >= 3) {
+                nStartHeight = params[2].get_int();
+            }
+            if (params.size() >= 4) {
+                nBlocks = params[3].get_int();
+            }
+            if (params.size() >= 5) {
+                nCacheMB = params[4].get_int();
+            }
+            if (nStartHeight < 0 || nStartHeight > chainActive.Height() || nBlocks <= 0 || nCacheMB <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid start height, block count or cache size");
+            }
+            sample_times.push_back(benchmark_replay_coins(nStartHeight, nBlocks, (size_t)nCacheMB << 20));
         } else if (benchmarktype == "connectblockslow") {
             if (Params().NetworkIDString() != "regtest") {
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
@@ -5845,6 +5916,21 @@ UniValue payments_release(const UniValue& params, bool fHelp, const CPubKey& myp
     return(PaymentsRelease(cp,(char *)params[0].get_str().c_str()));
 }
 
+UniValue payments_releaseasync(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if ( fHelp || params.size() != 1 )
+        throw runtime_error("paymentsreleaseasync \"[%22createtxid%22,amount,(skipminimum)]\"\n"
+                            "same as paymentsrelease, runs in the background and returns an operationid for z_getoperationstatus\n");
+    if ( ensure_CCrequirements(EVAL_PAYMENTS) < 0 )
+        throw runtime_error(CC_REQUIREMENTS_MSG);
+    UniValue contextInfo(UniValue::VOBJ);
+    contextInfo.push_back(Pair("params", params[0].get_str()));
+    std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
+    std::shared_ptr<AsyncRPCOperation> operation( new AsyncRPCOperation_paymentsrelease(params[0].get_str(), contextInfo) );
+    q->addOperation(operation);
+    return operation->getId();
+}
+
 UniValue payments_fund(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     struct CCcontract_info *cp,C;
@@ -6818,16 +6904,21 @@ UniValue oraclessamples(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     UniValue result(UniValue::VOBJ);
     uint256 txid;
-    int32_t num;
+    int32_t num, beginheight = -1, endheight = -1;
     char* batonaddr;
-    if (fHelp || params.size() != 3)
-        throw runtime_error("oraclessamples oracletxid batonaddress num\n");
+    if (fHelp || params.size() < 3 || params.size() > 5)
+        throw runtime_error("oraclessamples oracletxid batonaddress num [beginheight [endheight]]\n"
+                            "samples are returned newest first, a height range needs -oraclesindex\n");
     if (ensure_CCrequirements(EVAL_ORACLES) < 0)
         throw runtime_error(CC_REQUIREMENTS_MSG);
     txid = Parseuint256((char*)params[0].get_str().c_str());
     batonaddr = (char*)params[1].get_str().c_str();
     num = atoi((char*)params[2].get_str().c_str());
-    return (OracleDataSamples(txid, batonaddr, num));
+    if (params.size() > 3)
+        beginheight = atoi((char*)params[3].get_str().c_str());
+    if (params.size() > 4)
+        endheight = atoi((char*)params[4].get_str().c_str());
+    return (OracleDataSamples(txid, batonaddr, num, beginheight, endheight));
 }
 
 UniValue oraclesdata(const UniValue& params, bool fHelp, const CPubKey& mypk)
@@ -19,6 +19,7 @@
 #include "miner.h"
 #include "pow.h"
 #include "rpc/server.h"
+#include "script/sigbatch.h"
 #include "script/sign.h"
 #include "sodium.h"
 #include "streams.h"
@@ -33,6 +34,9 @@
 #include "zcash/Note.hpp"
 #include "librustzcash.h"
 
+#include <secp256k1.h>
+#include <secp256k1_schnorrsig.h>
+
 using namespace libzcash;
 // This method is based on Shutdown from init.cpp
 void pre_wallet_load()
@@ -221,7 +225,90 @@ double benchmark_verify_equihash()
     CBlockHeader genesis_header = genesis.GetBlockHeader();
     struct timeval tv_start;
     timer_start(tv_start);
-    CheckEquihashSolution(&genesis_header, params);
+    CheckEquihashSolution(&genesis_header, params, false);
+    return timer_stop(tv_start);
+}
+
+double benchmark_verify_equihash_batch(size_t nHeaders, bool fBatch)
+{
+    CChainParams params = Params(CBaseChainParams::MAIN);
+    CBlockHeader genesis_header = params.GenesisBlock().GetBlockHeader();
+    // every check does the full verification, the solutions are not cached
+    std::vector<const CBlockHeader*> vHeaders(nHeaders, &genesis_header);
+    struct timeval tv_start;
+    timer_start(tv_start);
+    bool fValid = true;
+    if (fBatch) {
+        fValid = CheckEquihashSolutions(vHeaders, params, false);
+    } else {
+        for (const CBlockHeader* pheader : vHeaders)
+            fValid &= CheckEquihashSolution(pheader, params, false);
+    }
+    double ret = timer_stop(tv_start);
+    assert(fValid);
+    return ret;
+}
+
+double benchmark_verify_sigbatch(size_t nSigs, bool fSchnorr, bool fBatch)
+{
+    // Signers rotate like the 13 notaries of a notarization
+    std::vector<CKey> keys(13);
+    for (CKey& key : keys)
+        key.MakeNewKey(true);
+
+    secp256k1_context* ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+    CSignatureBatch batch;
+    for (size_t i = 0; i < nSigs; i++) {
+        const CKey& key = keys[i % keys.size()];
+        uint256 hash = GetRandHash();
+        if (fSchnorr) {
+            secp256k1_schnorrsig sig;
+            unsigned char sig64[64];
+            int fSigned = secp256k1_schnorrsig_sign(ctx, &sig, NULL, hash.begin(), key.begin(), NULL, NULL);
+            assert(fSigned);
+            secp256k1_schnorrsig_serialize(ctx, sig64, &sig);
+            batch.AddSchnorr(key.GetPubKey().begin(), sig64, hash.begin());
+        } else {
+            std::vector<unsigned char> vchSig;
+            bool fSigned = key.Sign(hash, vchSig);
+            assert(fSigned);
+            batch.AddECDSA(key.GetPubKey(), vchSig, hash);
+        }
+    }
+    secp256k1_context_destroy(ctx);
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    bool fValid = fBatch ? batch.Verify() : batch.VerifySequential();
+    double ret = timer_stop(tv_start);
+    assert(fValid);
+    return ret;
+}
+
+double benchmark_merkle_root(size_t nLeaves, bool fMultiLane)
+{
+    std::vector<uint256> leaves(nLeaves);
+    for (uint256& leaf : leaves)
+        leaf = GetRandHash();
+    std::vector<uint256> vMerkleTree;
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    if (fMultiLane) {
+        BuildMerkleTree(NULL, leaves, vMerkleTree);
+    } else {
+        // the pair-at-a-time loop BuildMerkleTree used before SHA256D64
+        vMerkleTree = leaves;
+        int j = 0;
+        for (int nSize = leaves.size(); nSize > 1; nSize = (nSize + 1) / 2) {
+            for (int i = 0; i < nSize; i += 2) {
+                int i2 = std::min(i+1, nSize-1);
+                vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j+i]),  END(vMerkleTree[j+i]),
+                                           BEGIN(vMerkleTree[j+i2]), END(vMerkleTree[j+i2])));
+            }
+            j += nSize;
+        }
+    }
     return timer_stop(tv_start);
 }
 
@@ -434,6 +521,106 @@ double benchmark_connectblock_slow()
     return duration;
 }
 
+double benchmark_load_block_index(size_t nBlocks, int nThreads)
+{
+    // An in-memory block tree filled with a synthetic chain of Equihash 200,9 sized headers
+    CBlockTreeDB db(64 << 20, true, true);
+    std::vector<uint256> vHashes(nBlocks);
+    std::vector<std::pair<int, const CBlockFileInfo*> > fileInfo;
+    const size_t nChunk = 10000;
+    std::unique_ptr<CBlockIndex> pprev;
+    for (size_t nStart = 0; nStart < nBlocks; nStart += nChunk) {
+        std::vector<std::unique_ptr<CBlockIndex> > vIndex;
+        std::vector<const CBlockIndex*> blockinfo;
+        for (size_t i = nStart; i < std::min(nBlocks, nStart + nChunk); i++) {
+            CBlockHeader header;
+            header.nVersion = 4;
+            header.hashPrevBlock = pprev ? pprev->GetBlockHash() : uint256();
+            header.hashMerkleRoot = GetRandHash();
+            header.nTime = 1473793441 + i * 60;
+            header.nBits = 0x200f0f0f;
+            header.nNonce = GetRandHash();
+            header.nSolution.resize(1344);
+            GetRandBytes(header.nSolution.data(), header.nSolution.size());
+            vHashes[i] = header.GetHash();
+
+            std::unique_ptr<CBlockIndex> pindex(new CBlockIndex(header));
+            pindex->phashBlock = &vHashes[i];
+            pindex->pprev = pprev.get();
+            pindex->SetHeight(i);
+            pindex->nStatus = BLOCK_VALID_TREE;
+            blockinfo.push_back(pindex.get());
+            if (pprev)
+                vIndex.push_back(std::move(pprev));
+            pprev = std::move(pindex);
+        }
+        assert(db.WriteBatchSync(fileInfo, 0, blockinfo));
+    }
+
+    BlockMap mapLoaded;
+    auto insertBlockIndex = [&mapLoaded](const uint256& hash) -> CBlockIndex* {
+        if (hash.IsNull())
+            return NULL;
+        BlockMap::iterator mi = mapLoaded.find(hash);
+        if (mi != mapLoaded.end())
+            return mi->second;
+        CBlockIndex* pindexNew = new CBlockIndex();
+        mi = mapLoaded.insert(std::make_pair(hash, pindexNew)).first;
+        pindexNew->phashBlock = &mi->first;
+        return pindexNew;
+    };
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    assert(db.LoadBlockIndexGuts(insertBlockIndex, nThreads));
+    auto duration = timer_stop(tv_start);
+
+    assert(mapLoaded.size() == nBlocks);
+    for (const std::pair<const uint256, CBlockIndex*>& item : mapLoaded)
+        delete item.second;
+    return duration;
+}
+
+double benchmark_replay_coins(int nStartHeight, int nBlocks, size_t nCacheBytes)
+{
+    // Blocks are read up front so that only the coins caches and the coins database are timed
+    std::vector<CBlock> vBlocks;
+    for (int nHeight = nStartHeight; nHeight < nStartHeight + nBlocks && nHeight <= chainActive.Height(); nHeight++) {
+        vBlocks.push_back(CBlock());
+        if (!ReadBlockFromDisk(vBlocks.back(), chainActive[nHeight], false))
+            throw std::runtime_error(strprintf("Failed to read block at height %d", nHeight));
+    }
+
+    // Same layering as ConnectBlock: a per-block cache flushed into a long lived
+    // cache, which is flushed into the coins database whenever it outgrows nCacheBytes
+    CCoinsViewDB db(8 << 20, true, true);
+    CCoinsViewCache tip(&db);
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (size_t i = 0; i < vBlocks.size(); i++) {
+        CCoinsViewCache view(&tip);
+        int nHeight = nStartHeight + i;
+        for (const CTransaction& tx : vBlocks[i].vtx) {
+            if (!tx.IsMint()) {
+                for (const CTxIn& txin : tx.vin) {
+                    // outputs created before nStartHeight are not part of the replay
+                    if (!view.HaveCoins(txin.prevout.hash))
+                        continue;
+                    view.ModifyCoins(txin.prevout.hash)->Spend(txin.prevout.n);
+                }
+            }
+            view.ModifyCoins(tx.GetHash())->FromTx(tx, nHeight);
+        }
+        view.SetBestBlock(vBlocks[i].GetHash());
+        assert(view.Flush());
+        if (tip.DynamicMemoryUsage() > nCacheBytes)
+            assert(tip.Flush());
+    }
+    assert(tip.Flush());
+    return timer_stop(tv_start);
+}
+
 extern UniValue getnewaddress(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcwallet.cpp
 extern UniValue sendtoaddress(const UniValue& params, bool fHelp, const CPubKey& mypk);
 
@@ -12,10 +12,15 @@ extern double benchmark_solve_equihash();
 extern std::vector<double> benchmark_solve_equihash_threaded(int nThreads);
 extern double benchmark_verify_joinsplit(const JSDescription &joinsplit);
 extern double benchmark_verify_equihash();
+extern double benchmark_verify_sigbatch(size_t nSigs, bool fSchnorr, bool fBatch);
+extern double benchmark_verify_equihash_batch(size_t nHeaders, bool fBatch);
+extern double benchmark_merkle_root(size_t nLeaves, bool fMultiLane);
 extern double benchmark_large_tx(size_t nInputs);
 extern double benchmark_try_decrypt_notes(size_t nAddrs);
 extern double benchmark_increment_note_witnesses(size_t nTxs);
 extern double benchmark_connectblock_slow();
+extern double benchmark_load_block_index(size_t nBlocks, int nThreads);
+extern double benchmark_replay_coins(int nStartHeight, int nBlocks, size_t nCacheBytes);
 extern double benchmark_sendtoaddress(CAmount amount);
 extern double benchmark_loadwallet();
 extern double benchmark_listunspent();
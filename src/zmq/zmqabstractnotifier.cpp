@@ -16,6 +16,11 @@ bool CZMQAbstractNotifier::NotifyBlock(const CBlockIndex * /*CBlockIndex*/)
     return true;
 }
 
+bool CZMQAbstractNotifier::NotifyBlock(const CBlockIndex *pindex, const CBlock * /*pblock*/)
+{
+    return NotifyBlock(pindex);
+}
+
 bool CZMQAbstractNotifier::NotifyBlock(const CBlock &)
 {
     return true;
@@ -25,3 +30,12 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &transaction, const CBlock * /*pblock*/)
+{
+    return NotifyTransaction(transaction);
+}
+
+void CZMQAbstractNotifier::SkipDropped(const CNotificationGap &/*gap*/)
+{
+}
@@ -7,7 +7,9 @@
 
 #include "zmqconfig.h"
 
+class CBlock;
 class CBlockIndex;
+struct CNotificationGap;
 class CZMQAbstractNotifier;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
@@ -33,8 +35,14 @@ public:
     virtual void Shutdown() = 0;
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
+    // pblock is the tip block itself, NULL if it could not be read
+    virtual bool NotifyBlock(const CBlockIndex *pindex, const CBlock *pblock);
     virtual bool NotifyBlock(const CBlock& pblock);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    // pblock is the block of a confirmed tx, NULL for mempool txns
+    virtual bool NotifyTransaction(const CTransaction &transaction, const CBlock *pblock);
+    // before a notification that had others dropped ahead of it, see CNotificationGap
+    virtual void SkipDropped(const CNotificationGap &gap);
 
 protected:
     void *psocket;
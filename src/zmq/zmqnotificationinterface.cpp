@@ -40,6 +40,16 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
     factories["pubcheckedblock"] = CZMQAbstractNotifier::Create<CZMQPublishCheckedBlockNotifier>;
+    factories["pubccevent"] = CZMQAbstractNotifier::Create<CZMQPublishCCEventNotifier>;
+    factories["pubccaddress"] = CZMQAbstractNotifier::Create<CZMQPublishCCAddressNotifier>;
+
+    CCEventFilter filter;
+    std::map<std::string, std::string>::const_iterator f = args.find("-ccnotifyfilter");
+    if (f != args.end() && !filter.Parse(f->second))
+    {
+        LogPrintf("zmq: Invalid -ccnotifyfilter %s\n", f->second);
+        return NULL;
+    }
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
     {
@@ -51,6 +61,8 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
             CZMQAbstractNotifier *notifier = factory();
             notifier->SetType(i->first);
             notifier->SetAddress(address);
+            if (CZMQPublishCCEventNotifier *ccnotifier = dynamic_cast<CZMQPublishCCEventNotifier*>(notifier))
+                ccnotifier->SetFilter(filter);
             notifiers.push_back(notifier);
         }
     }
@@ -59,8 +71,11 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     {
         notificationInterface = new CZMQNotificationInterface();
         notificationInterface->notifiers = notifiers;
+        notificationInterface->fCheckedBlocks = args.count("-zmqpubcheckedblock") != 0;
+        notificationInterface->fCCEvents = args.count("-zmqpubccevent") != 0 || args.count("-zmqpubccaddress") != 0;
+        notificationInterface->ccfilter = filter;
 
-        if (!notificationInterface->Initialize())
+        if (!notificationInterface->Initialize() || !notificationInterface->StartQueue("zmq", args))
         {
             delete notificationInterface;
             notificationInterface = NULL;
@@ -111,6 +126,7 @@ bool CZMQNotificationInterface::Initialize()
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint("zmq", "zmq: Shutdown notification interface\n");
+    StopQueue();
     if (pcontext)
     {
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
@@ -125,50 +141,29 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+void CZMQNotificationInterface::Dispatch(const CValidationNotification &notification)
 {
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindex))
-        {
-            i++;
-        }
-        else
+        if (notification.gap)
+            notifier->SkipDropped(*notification.gap);
+        bool fOk = true;
+        switch (notification.type)
         {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
-        }
-    }
-}
-
-void CZMQNotificationInterface::BlockChecked(const CBlock& block, const CValidationState& state)
-{
-    if (state.IsInvalid()) {
-        return;
-    }
-
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
-    {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(block))
-        {
-            i++;
-        }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
+        case CValidationNotification::BLOCK_TIP:
+            fOk = notifier->NotifyBlock(notification.pindex, notification.block.get());
+            break;
+        case CValidationNotification::BLOCK_CHECKED:
+            fOk = notifier->NotifyBlock(*notification.block);
+            break;
+        case CValidationNotification::TRANSACTION:
+            fOk = notifier->NotifyTransaction(*notification.tx, notification.block.get());
+            break;
+        default:
+            break;
         }
-    }
-}
-
-void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
-{
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
-    {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
+        if (fOk)
         {
             i++;
         }
@@ -5,7 +5,7 @@
 #ifndef BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
-#include "validationinterface.h"
+#include "notificationqueue.h"
 #include "consensus/validation.h"
 #include <string>
 #include <map>
@@ -13,7 +13,7 @@
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
-class CZMQNotificationInterface : public CValidationInterface
+class CZMQNotificationInterface : public CQueuedNotificationInterface
 {
 public:
     virtual ~CZMQNotificationInterface();
@@ -24,10 +24,8 @@ protected:
     bool Initialize();
     void Shutdown();
 
-    // CValidationInterface
-    void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
-    void UpdatedBlockTip(const CBlockIndex *pindex);
-    void BlockChecked(const CBlock& block, const CValidationState& state);
+    // CQueuedNotificationInterface, on the notification thread
+    void Dispatch(const CValidationNotification &notification);
 
 private:
     CZMQNotificationInterface();
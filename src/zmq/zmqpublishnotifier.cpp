@@ -4,7 +4,9 @@
 
 #include "zmqpublishnotifier.h"
 #include "main.h"
+#include "notificationqueue.h"
 #include "util.h"
+#include "utilstrencodings.h"
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
@@ -13,6 +15,8 @@ static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
 static const char *MSG_CHECKEDBLOCK = "checkedblock";
+static const char *MSG_CCEVENT   = "ccevent";
+static const char *MSG_CCADDRESS = "ccaddress";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -143,6 +147,48 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
     return true;
 }
 
+void CZMQAbstractPublishNotifier::SkipMessages(uint64_t nMessages)
+{
+    nSequence += nMessages;
+}
+
+void CZMQPublishHashBlockNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.nBlockTips);
+}
+
+void CZMQPublishHashTransactionNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.nTransactions);
+}
+
+void CZMQPublishRawBlockNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.nBlockTips);
+}
+
+void CZMQPublishRawTransactionNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.nTransactions);
+}
+
+void CZMQPublishCheckedBlockNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.nCheckedBlocks);
+}
+
+void CZMQPublishCCEventNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.cc.nEvents);
+    sequences.SkipEvalcodes(gap.cc);
+}
+
+void CZMQPublishCCAddressNotifier::SkipDropped(const CNotificationGap &gap)
+{
+    SkipMessages(gap.cc.nAddressEvents);
+    sequences.SkipAddresses(gap.cc);
+}
+
 bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     uint256 hash = pindex->GetBlockHash();
@@ -163,23 +209,20 @@ bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &t
     return SendMessage(MSG_HASHTX, data, 32);
 }
 
-bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const CBlock *pblock)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    // the block comes with the notification, it is not read back from disk
+    if (pblock == NULL)
     {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex,1))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
+        zmqError("Can't read block from disk");
+        return false;
     }
 
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << *pblock;
+
     return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
 }
 
@@ -188,10 +231,7 @@ bool CZMQPublishCheckedBlockNotifier::NotifyBlock(const CBlock& block)
     LogPrint("zmq", "zmq: Publish checkedblock %s\n", block.GetHash().GetHex());
 
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        ss << block;
-    }
+    ss << block;
 
     return SendMessage(MSG_CHECKEDBLOCK, &(*ss.begin()), ss.size());
 }
@@ -204,3 +244,31 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishCCEventNotifier::NotifyTransaction(const CTransaction &transaction, const CBlock *pblock)
+{
+    CCEvent event;
+    if (!DecodeCCEvent(transaction, pblock, event) || !filter.Match(event))
+        return true;
+    LogPrint("zmq", "zmq: Publish ccevent %s\n", event.txid.GetHex());
+    std::string topic = MSG_CCEVENT + HexStr(&event.evalcode, &event.evalcode + 1);
+    std::vector<unsigned char> data = SerializeCCEvent(event, sequences.NextEvalcode(event.evalcode));
+    return SendMessage(topic.c_str(), data.data(), data.size());
+}
+
+bool CZMQPublishCCAddressNotifier::NotifyTransaction(const CTransaction &transaction, const CBlock *pblock)
+{
+    CCEvent event;
+    if (!DecodeCCEvent(transaction, pblock, event))
+        return true;
+    std::vector<std::string> addresses = filter.MatchAddresses(event);
+    for (std::vector<std::string>::const_iterator it = addresses.begin(); it != addresses.end(); it++)
+    {
+        LogPrint("zmq", "zmq: Publish ccaddress %s %s\n", *it, event.txid.GetHex());
+        std::string topic = MSG_CCADDRESS + *it;
+        std::vector<unsigned char> data = SerializeCCEvent(event, sequences.NextAddress(*it));
+        if (!SendMessage(topic.c_str(), data.data(), data.size()))
+            return false;
+    }
+    return true;
+}
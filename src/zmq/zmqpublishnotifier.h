@@ -6,6 +6,7 @@
 #define BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
 
 #include "zmqabstractnotifier.h"
+#include "cc/CCevents.h"
 
 class CBlockIndex;
 
@@ -23,6 +24,8 @@ public:
           * message sequence number
     */
     bool SendMessage(const char *command, const void* data, size_t size);
+    /* skip the sequence numbers of messages that were dropped */
+    void SkipMessages(uint64_t nMessages);
 
     bool Initialize(void *pcontext);
     void Shutdown();
@@ -32,30 +35,62 @@ class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
     bool NotifyBlock(const CBlockIndex *pindex);
+    void SkipDropped(const CNotificationGap &gap);
 };
 
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
     bool NotifyTransaction(const CTransaction &transaction);
+    void SkipDropped(const CNotificationGap &gap);
 };
 
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    using CZMQAbstractNotifier::NotifyBlock;
+    bool NotifyBlock(const CBlockIndex *pindex, const CBlock *pblock);
+    void SkipDropped(const CNotificationGap &gap);
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
     bool NotifyTransaction(const CTransaction &transaction);
+    void SkipDropped(const CNotificationGap &gap);
 };
 
 class CZMQPublishCheckedBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
     bool NotifyBlock(const CBlock &block);
+    void SkipDropped(const CNotificationGap &gap);
+};
+
+/* decoded cc transactions, the topic is ccevent followed by the evalcode
+   in hex so subscribers can subscribe to single modules, see CCEvent */
+class CZMQPublishCCEventNotifier : public CZMQAbstractPublishNotifier
+{
+protected:
+    CCEventFilter filter;
+    CCEventSequences sequences;
+
+public:
+    void SetFilter(const CCEventFilter &filterIn) { filter = filterIn; }
+
+    using CZMQAbstractNotifier::NotifyTransaction;
+    bool NotifyTransaction(const CTransaction &transaction, const CBlock *pblock);
+    void SkipDropped(const CNotificationGap &gap);
+};
+
+/* decoded cc transactions once per output address, the topic is ccaddress
+   followed by the address */
+class CZMQPublishCCAddressNotifier : public CZMQPublishCCEventNotifier
+{
+public:
+    using CZMQAbstractNotifier::NotifyTransaction;
+    bool NotifyTransaction(const CTransaction &transaction, const CBlock *pblock);
+    void SkipDropped(const CNotificationGap &gap);
 };
 
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H